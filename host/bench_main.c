@@ -0,0 +1,84 @@
+/******************************************************************************
+ * @file        bench_main.c
+ * @brief       Host runner of the benchmark suite.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Boots the storage and relay modules on the host fakes and runs BENCH_RunAll. The
+ * first argument selects the NVS file; a file provisioned with okta_sim benchmarks
+ * the configuration paths with realistic values. The relay backend is the one the
+ * program was built with: okta_bench uses the board default (gpio), okta_bench_shift
+ * and okta_bench_mock the other two, so the relay benchmarks can be compared across
+ * backends; the shift backend runs on the shift register model and reports its SPI
+ * transactions per benchmark. Logging is limited to warnings so
+ * the JSON lines on stdout are not interleaved with debug output.
+ ******************************************************************************/
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+#include "okta_fakes.h"
+#include "Relay_module.h"
+#include "RelayBackend_module.h"
+#include "LOG_module.h"
+#include "JSON_module.h"
+#include "SensorRegistry_module.h"
+#include "Rule_module.h"
+#include "BENCH_module.h"
+
+// Stand-in for the ADC sensors, which the host does not have, so the rule benchmark has a sensor
+static bool Bench_Sample(sensorReading *reading)
+{
+    reading->value = 0;
+    return true;
+}
+
+static int Bench_Encode(const sensorReading *reading, char *payload, size_t payloadSize)
+{
+    return snprintf(payload, payloadSize, "{\"value\":%ld}", (long)reading->value);
+}
+
+static const sensorDriver benchDriver = {"bench", "bench_topic", 99, 0, NULL, Bench_Sample, Bench_Encode};
+
+int main(int argc, char **argv)
+{
+    uint32_t mockWrites = 0;
+
+    FakeNvs_SetPath(argc > 1 ? argv[1] : "okta_bench.nvs");
+
+    LOG_Init();
+    JSON_Init();
+    for (int module = 0; module < LOG_MODULE_COUNT; module++)
+    {
+        LOG_SetLevel((logModule)module, ESP_LOG_WARN);
+    }
+    ESP_ERROR_CHECK(nvs_flash_init());
+    if (!Relay_Init())
+    {
+        return 1;
+    }
+    Relay_RetDataState();
+    SensorRegistry_Register(&benchDriver);
+
+    uint32_t spiTransactions = FakeSpi_GetTransactionCount();
+    BENCH_RunAll();
+    ruleStats rules;
+    Rule_GetStats(&rules); // The rule benchmark evaluates through Rule_Evaluate
+#if RELAY_BACKEND == RELAY_BACKEND_MOCK
+    mockWrites = RelayMock_GetWriteCount();
+#endif
+    printf("{\"backend\":\"%s\",\"relays\":%u,\"spi_transactions\":%lu,\"mock_writes\":%lu,\"rules\":{\"readings\":%lu,\"checks\":%lu,"
+           "\"fired\":%lu,\"total_us\":%lu,\"max_us\":%lu}}\n",
+           RELAY_BACKEND_NAME, (unsigned)Relay_GetCount(), (unsigned long)(FakeSpi_GetTransactionCount() - spiTransactions),
+           (unsigned long)mockWrites, (unsigned long)rules.readings, (unsigned long)rules.checks,
+           (unsigned long)rules.fired, (unsigned long)rules.totalUs, (unsigned long)rules.maxUs);
+
+    vTaskDelay(pdMS_TO_TICKS(2 * LOG_DRAIN_PERIOD_MS)); // Let the log drain
+    return 0;
+}
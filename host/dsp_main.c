@@ -0,0 +1,145 @@
+/******************************************************************************
+ * @file        dsp_main.c
+ * @brief       Host check of the sensor filter stages against synthetic streams.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Generates ADC code streams with a known true value (noise, relay switching spikes,
+ * a step and a ramp), runs them through the same stages and settings as the sensor
+ * task (median of SENSOR_OVERSAMPLE samples, moving average of SENSOR_AVERAGE_WINDOW
+ * medians) and prints one JSON line per stream:
+ * {"stream":"s","blocks":n,"truth":t,"filtered":f,"max_error":e,"limit":l,"settle_blocks":b}
+ * max_error is the largest error in codes once the filter has settled. The noise is a
+ * fixed pseudo-random sequence, so results are reproducible. The program exits with
+ * status 2 when a stream exceeds its limit, or when a calibration point is off.
+ *
+ * Usage: okta_dsp
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "DSP_module.h"
+#include "Sensor_module.h"
+
+#define DSP_CHECK_BLOCKS 200        // Blocks per stream
+#define DSP_CHECK_STEP_BLOCK 100    // Block at which the step stream changes level
+#define DSP_CHECK_FULL_SCALE 4095   // Largest 12-bit code
+
+typedef struct
+{
+    const char *name;
+    int32_t noise;          // Uniform noise amplitude in codes
+    uint32_t spikePercent;  // Share of samples replaced by a full-scale spike
+    int32_t start;          // True value at block 0
+    int32_t end;            // True value after the step, or at the last block of a ramp
+    bool ramp;              // Ramp from start to end instead of a step
+    int32_t limit;          // Largest settled error accepted, in codes
+} dspStream;
+
+static const dspStream dspStreams[] = {
+    {"noise", 40, 0, 1800, 1800, false, 4},
+    {"spikes", 10, 10, 1800, 1800, false, 2},
+    {"step", 10, 0, 1000, 3000, false, 2},
+    // The moving average lags a ramp by half its window
+    {"ramp", 10, 0, 500, 3500, true, 2 + (3000 * SENSOR_AVERAGE_WINDOW) / (2 * DSP_CHECK_BLOCKS)},
+};
+
+static uint32_t dspSeed = 12345;
+
+// Deterministic linear congruential generator
+static uint32_t Dsp_Random(void)
+{
+    dspSeed = dspSeed * 1103515245u + 12345u;
+    return (dspSeed >> 16) & 0x7fff;
+}
+
+static int32_t Dsp_Truth(const dspStream *stream, int block)
+{
+    if (stream->ramp)
+    {
+        return stream->start + (stream->end - stream->start) * block / (DSP_CHECK_BLOCKS - 1);
+    }
+    return block < DSP_CHECK_STEP_BLOCK ? stream->start : stream->end;
+}
+
+// Run one stream, print its line and return true if it met its limit
+static bool Dsp_RunStream(const dspStream *stream)
+{
+    uint16_t block[SENSOR_OVERSAMPLE];
+    dspMovingAverage average;
+    int32_t filtered = 0, maxError = 0, truth = 0;
+    int settleBlocks = -1;
+
+    DSP_MovingAverageInit(&average, SENSOR_AVERAGE_WINDOW);
+
+    for (int b = 0; b < DSP_CHECK_BLOCKS; b++)
+    {
+        truth = Dsp_Truth(stream, b);
+        for (int i = 0; i < SENSOR_OVERSAMPLE; i++)
+        {
+            int32_t sample = truth + (int32_t)(Dsp_Random() % (2 * stream->noise + 1)) - stream->noise;
+            if (Dsp_Random() % 100 < stream->spikePercent)
+            {
+                sample = DSP_CHECK_FULL_SCALE;
+            }
+            block[i] = (uint16_t)(sample < 0 ? 0 : sample > DSP_CHECK_FULL_SCALE ? DSP_CHECK_FULL_SCALE : sample);
+        }
+
+        int32_t mean = DSP_MovingAverageUpdate(&average, DSP_Median(block, SENSOR_OVERSAMPLE));
+        filtered = (mean + (1 << (DSP_AVERAGE_FRACTION_BITS - 1))) >> DSP_AVERAGE_FRACTION_BITS;
+        int32_t error = abs(filtered - truth);
+
+        // Settled once a full window has passed since the last level change
+        bool settled = b >= SENSOR_AVERAGE_WINDOW && (stream->ramp || b < DSP_CHECK_STEP_BLOCK || b >= DSP_CHECK_STEP_BLOCK + SENSOR_AVERAGE_WINDOW);
+        if (settled && error > maxError)
+        {
+            maxError = error;
+        }
+        if (!stream->ramp && b >= DSP_CHECK_STEP_BLOCK && settleBlocks < 0 && error <= stream->limit)
+        {
+            settleBlocks = b - DSP_CHECK_STEP_BLOCK;
+        }
+    }
+
+    printf("{\"stream\":\"%s\",\"blocks\":%d,\"truth\":%ld,\"filtered\":%ld,\"max_error\":%ld,\"limit\":%ld,\"settle_blocks\":%d}\n",
+           stream->name, DSP_CHECK_BLOCKS, (long)truth, (long)filtered, (long)maxError, (long)stream->limit, settleBlocks);
+    return maxError <= stream->limit;
+}
+
+// Calibration points of the firmware settings
+static bool Dsp_CheckCalibration(void)
+{
+    const dspCalibration temperature = SENSOR_TEMP_CALIBRATION;
+    const dspCalibration light = SENSOR_LIGHT_CALIBRATION;
+    bool passed = DSP_Calibrate(&temperature, 250) == 2500 && DSP_Calibrate(&temperature, 0) == 0 &&
+                  DSP_Calibrate(&light, 100) == 0 && DSP_Calibrate(&light, 3000) == 10000 &&
+                  DSP_Calibrate(&light, 1550) == 5000;
+
+    printf("{\"stream\":\"calibration\",\"temp_250mV\":%ld,\"light_1550mV\":%ld,\"passed\":%s}\n",
+           (long)DSP_Calibrate(&temperature, 250), (long)DSP_Calibrate(&light, 1550), passed ? "true" : "false");
+    return passed;
+}
+
+int main(void)
+{
+    bool passed = Dsp_CheckCalibration();
+
+    for (size_t i = 0; i < sizeof(dspStreams) / sizeof(dspStreams[0]); i++)
+    {
+        passed = Dsp_RunStream(&dspStreams[i]) && passed;
+    }
+
+    if (!passed)
+    {
+        fprintf(stderr, "filter stages out of limits\n");
+        return 2;
+    }
+    return 0;
+}
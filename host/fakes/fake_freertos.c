@@ -0,0 +1,475 @@
+/******************************************************************************
+ * @file        fake_freertos.c
+ * @brief       Host fake of the FreeRTOS task, queue and semaphore API on pthreads.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Every task is a detached thread registered in a fixed task table. Threads that
+ * were not created through xTaskCreate, such as the simulator main thread, are
+ * registered the first time they ask for their handle, so code that keys state on
+ * the current task (the trace module does) behaves as on the device. Run-time
+ * counters are the thread CPU clocks in microseconds, which keeps the diagnostics
+ * CPU shares meaningful. Queues are a ring of fixed-size items guarded by a mutex
+ * and two condition variables; semaphores are queues of zero-sized items.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#define FAKE_MAX_TASKS 32
+#define FAKE_TASK_NAME_LENGTH 16
+
+struct fakeTask
+{
+    bool used;
+    pthread_t thread;
+    char name[FAKE_TASK_NAME_LENGTH];
+    UBaseType_t number;
+    UBaseType_t priority;
+    BaseType_t coreId;
+    TaskFunction_t function;
+    void *parameters;
+};
+
+struct fakeQueue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;
+};
+
+static pthread_mutex_t taskLock = PTHREAD_MUTEX_INITIALIZER;
+static struct fakeTask taskTable[FAKE_MAX_TASKS];
+static UBaseType_t taskNextNumber = 1;
+static _Thread_local struct fakeTask *taskCurrent = NULL;
+
+// Claim a task table slot, NULL when the table is full
+static struct fakeTask *FakeTask_Register(const char *name, UBaseType_t priority, BaseType_t coreId)
+{
+    struct fakeTask *task = NULL;
+
+    pthread_mutex_lock(&taskLock);
+    for (size_t i = 0; i < FAKE_MAX_TASKS; i++)
+    {
+        if (!taskTable[i].used)
+        {
+            task = &taskTable[i];
+            memset(task, 0, sizeof(*task));
+            task->used = true;
+            snprintf(task->name, sizeof(task->name), "%s", name);
+            task->number = taskNextNumber++;
+            task->priority = priority;
+            task->coreId = coreId;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&taskLock);
+
+    return task;
+}
+
+static void FakeTask_Unregister(struct fakeTask *task)
+{
+    pthread_mutex_lock(&taskLock);
+    task->used = false;
+    pthread_mutex_unlock(&taskLock);
+}
+
+static void *FakeTask_Entry(void *argument)
+{
+    struct fakeTask *task = argument;
+
+    taskCurrent = task;
+    task->function(task->parameters);
+
+    // A FreeRTOS task must not return; treat it as a self-delete
+    FakeTask_Unregister(task);
+    return NULL;
+}
+
+// Absolute CLOCK_REALTIME deadline for a timeout in ticks
+static struct timespec FakeTicks_Deadline(TickType_t ticks)
+{
+    struct timespec deadline;
+    uint64_t nanoseconds = (uint64_t)pdTICKS_TO_MS(ticks) * 1000000;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += nanoseconds / 1000000000;
+    deadline.tv_nsec += nanoseconds % 1000000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return deadline;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+    pthread_attr_t attributes;
+    struct fakeTask *task = FakeTask_Register(name, priority, coreId);
+
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+    task->function = function;
+    task->parameters = parameters;
+
+    // Host libraries (printf, the allocator) need more stack than the firmware budget
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attributes, stackDepth < 65536 ? 65536 : stackDepth);
+    int err = pthread_create(&task->thread, &attributes, FakeTask_Entry, task);
+    pthread_attr_destroy(&attributes);
+
+    if (err != 0)
+    {
+        FakeTask_Unregister(task);
+        return pdFAIL;
+    }
+    if (createdTask != NULL)
+    {
+        *createdTask = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+// The thread runs on its own stack, the static buffers only record the object
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, StackType_t *stack, StaticTask_t *taskBuffer, BaseType_t coreId)
+{
+    TaskHandle_t task = NULL;
+
+    if (stack == NULL || taskBuffer == NULL ||
+        xTaskCreatePinnedToCore(function, name, stackDepth, parameters, priority, &task, coreId) != pdPASS)
+    {
+        return NULL;
+    }
+    taskBuffer->object = task;
+    return task;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, StackType_t *stack, StaticTask_t *taskBuffer)
+{
+    return xTaskCreateStaticPinnedToCore(function, name, stackDepth, parameters, priority, stack, taskBuffer, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == taskCurrent)
+    {
+        struct fakeTask *self = xTaskGetCurrentTaskHandle();
+        FakeTask_Unregister(self);
+        pthread_exit(NULL);
+    }
+
+    // Deleting another task: forget it, the thread is left blocked where it is
+    FakeTask_Unregister(task);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t nanoseconds = (uint64_t)pdTICKS_TO_MS(ticks) * 1000000;
+    struct timespec delay = {.tv_sec = nanoseconds / 1000000000, .tv_nsec = nanoseconds % 1000000000};
+
+    if (ticks == 0)
+    {
+        sched_yield();
+        return;
+    }
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR)
+        ;
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement)
+{
+    TickType_t wakeTime = *previousWakeTime + timeIncrement;
+    TickType_t now = xTaskGetTickCount();
+    BaseType_t delayed = pdFALSE;
+
+    if ((int32_t)(wakeTime - now) > 0)
+    {
+        vTaskDelay(wakeTime - now);
+        delayed = pdTRUE;
+    }
+    *previousWakeTime = wakeTime;
+    return delayed;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)((esp_timer_get_time() * configTICK_RATE_HZ) / 1000000);
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    struct fakeTask *task = xTaskGetCurrentTaskHandle();
+    return (task != NULL && task->coreId != tskNO_AFFINITY) ? task->coreId : 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (taskCurrent == NULL)
+    {
+        // Foreign thread, register it the first time it shows up
+        char name[FAKE_TASK_NAME_LENGTH];
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        taskCurrent = FakeTask_Register(name, tskIDLE_PRIORITY + 1, tskNO_AFFINITY);
+        if (taskCurrent != NULL)
+        {
+            taskCurrent->thread = pthread_self();
+        }
+    }
+    return taskCurrent;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    task = (task != NULL) ? task : xTaskGetCurrentTaskHandle();
+    return task != NULL ? task->name : "";
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&taskLock);
+    for (size_t i = 0; i < FAKE_MAX_TASKS; i++)
+    {
+        count += taskTable[i].used ? 1 : 0;
+    }
+    pthread_mutex_unlock(&taskLock);
+
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *taskStatusArray, UBaseType_t arraySize, uint32_t *totalRunTime)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&taskLock);
+    for (size_t i = 0; i < FAKE_MAX_TASKS && count < arraySize; i++)
+    {
+        struct fakeTask *task = &taskTable[i];
+        struct timespec cpuTime = {0};
+        clockid_t clock;
+
+        if (!task->used)
+        {
+            continue;
+        }
+        if (pthread_getcpuclockid(task->thread, &clock) == 0)
+        {
+            clock_gettime(clock, &cpuTime);
+        }
+
+        TaskStatus_t *status = &taskStatusArray[count++];
+        memset(status, 0, sizeof(*status));
+        status->xHandle = task;
+        status->pcTaskName = task->name;
+        status->xTaskNumber = task->number;
+        status->eCurrentState = (task == taskCurrent) ? eRunning : eBlocked;
+        status->uxCurrentPriority = task->priority;
+        status->uxBasePriority = task->priority;
+        status->ulRunTimeCounter = (uint32_t)(cpuTime.tv_sec * 1000000 + cpuTime.tv_nsec / 1000);
+        status->xCoreID = task->coreId;
+    }
+    pthread_mutex_unlock(&taskLock);
+
+    // Total run time of all cores, so a task's share is relative to one core
+    if (totalRunTime != NULL)
+    {
+        *totalRunTime = (uint32_t)esp_timer_get_time();
+    }
+    return count;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    struct fakeQueue *queue = calloc(1, sizeof(*queue));
+
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+    queue->length = length;
+    queue->itemSize = itemSize;
+    if (itemSize != 0)
+    {
+        queue->storage = calloc(length, itemSize);
+        if (queue->storage == NULL)
+        {
+            free(queue);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t *storage, StaticQueue_t *queueBuffer)
+{
+    return xQueueCreate(length, itemSize);
+}
+
+// Wait on a condition until it holds or the timeout expires, the lock is held
+static bool FakeQueue_Wait(struct fakeQueue *queue, pthread_cond_t *condition, bool (*ready)(const struct fakeQueue *), TickType_t ticksToWait)
+{
+    struct timespec deadline = FakeTicks_Deadline(ticksToWait);
+
+    while (!ready(queue))
+    {
+        if (ticksToWait == 0)
+        {
+            return false;
+        }
+        if (ticksToWait == portMAX_DELAY)
+        {
+            pthread_cond_wait(condition, &queue->lock);
+        }
+        else if (pthread_cond_timedwait(condition, &queue->lock, &deadline) == ETIMEDOUT)
+        {
+            return ready(queue);
+        }
+    }
+    return true;
+}
+
+static bool FakeQueue_HasSpace(const struct fakeQueue *queue)
+{
+    return queue->count < queue->length;
+}
+
+static bool FakeQueue_HasItem(const struct fakeQueue *queue)
+{
+    return queue->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!FakeQueue_Wait(queue, &queue->notFull, FakeQueue_HasSpace, ticksToWait))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return errQUEUE_FULL;
+    }
+
+    if (queue->itemSize != 0)
+    {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->storage + tail * queue->itemSize, item, queue->itemSize);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+    if (higherPriorityTaskWoken != NULL)
+    {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!FakeQueue_Wait(queue, &queue->notEmpty, FakeQueue_HasItem, ticksToWait))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return errQUEUE_EMPTY;
+    }
+
+    if (queue->itemSize != 0)
+    {
+        memcpy(item, queue->storage + queue->head * queue->itemSize, queue->itemSize);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->notFull);
+    pthread_mutex_unlock(&queue->lock);
+
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (queue != NULL)
+    {
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->notEmpty);
+        pthread_cond_destroy(&queue->notFull);
+        free(queue->storage);
+        free(queue);
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    if (mutex != NULL)
+    {
+        xQueueSend(mutex, NULL, 0); // Mutexes start available
+    }
+    return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    SemaphoreHandle_t semaphore = xQueueCreate(maxCount, 0);
+    for (UBaseType_t i = 0; semaphore != NULL && i < initialCount; i++)
+    {
+        xQueueSend(semaphore, NULL, 0);
+    }
+    return semaphore;
+}
@@ -0,0 +1,132 @@
+/******************************************************************************
+ * @file        fake_gpio.c
+ * @brief       Host fake of the GPIO driver over a modelled register file.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The model holds the output, output-enable and input registers of the ESP32 GPIO
+ * matrix as 64-bit words. Writes to an output pin update the output register and,
+ * when the level actually changes, an edge counter and the time of the edge, which
+ * is what a logic analyser on the relay lines would show.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "okta_fakes.h"
+
+static _Atomic uint64_t gpioOutput;  // Levels driven by the firmware
+static _Atomic uint64_t gpioEnable;  // Pins configured as outputs
+static _Atomic uint64_t gpioInput;   // Levels driven by the outside world
+static _Atomic uint32_t gpioEdges[GPIO_NUM_MAX];
+static _Atomic int64_t gpioEdgeTime[GPIO_NUM_MAX];
+
+static bool FakeGpio_IsValid(gpio_num_t pin)
+{
+    return pin >= GPIO_NUM_0 && pin < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    if (!FakeGpio_IsValid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint64_t bit = 1ULL << gpio_num;
+    if (mode & GPIO_MODE_OUTPUT)
+    {
+        atomic_fetch_or(&gpioEnable, bit);
+    }
+    else
+    {
+        atomic_fetch_and(&gpioEnable, ~bit);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!FakeGpio_IsValid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint64_t bit = 1ULL << gpio_num;
+    uint64_t previous = level ? atomic_fetch_or(&gpioOutput, bit) : atomic_fetch_and(&gpioOutput, ~bit);
+
+    // Only an enabled output drives the pad, as on the chip
+    if ((atomic_load(&gpioEnable) & bit) && ((previous & bit) != 0) != (level != 0))
+    {
+        atomic_store(&gpioEdgeTime[gpio_num], esp_timer_get_time());
+        atomic_fetch_add(&gpioEdges[gpio_num], 1);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!FakeGpio_IsValid(gpio_num))
+    {
+        return 0;
+    }
+
+    uint64_t bit = 1ULL << gpio_num;
+    uint64_t source = (atomic_load(&gpioEnable) & bit) ? atomic_load(&gpioOutput) : atomic_load(&gpioInput);
+    return (source & bit) ? 1 : 0;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    if (!FakeGpio_IsValid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_fetch_and(&gpioEnable, ~(1ULL << gpio_num));
+    atomic_fetch_and(&gpioOutput, ~(1ULL << gpio_num));
+    return ESP_OK;
+}
+
+uint64_t FakeGpio_GetOutputs(void)
+{
+    return atomic_load(&gpioOutput) & atomic_load(&gpioEnable);
+}
+
+uint64_t FakeGpio_GetEnabled(void)
+{
+    return atomic_load(&gpioEnable);
+}
+
+uint32_t FakeGpio_GetEdgeCount(gpio_num_t pin)
+{
+    return FakeGpio_IsValid(pin) ? atomic_load(&gpioEdges[pin]) : 0;
+}
+
+int64_t FakeGpio_GetLastEdgeTime(gpio_num_t pin)
+{
+    return FakeGpio_IsValid(pin) ? atomic_load(&gpioEdgeTime[pin]) : 0;
+}
+
+void FakeGpio_SetInput(gpio_num_t pin, bool level)
+{
+    if (FakeGpio_IsValid(pin))
+    {
+        if (level)
+        {
+            atomic_fetch_or(&gpioInput, 1ULL << pin);
+        }
+        else
+        {
+            atomic_fetch_and(&gpioInput, ~(1ULL << pin));
+        }
+    }
+}
@@ -0,0 +1,941 @@
+/******************************************************************************
+ * @file        fake_httpd.c
+ * @brief       Host fake of the ESP-IDF HTTP server, WebSocket included.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * One server task polls the listening socket, the open sessions and a wake pipe, as
+ * the esp_http_server task does with its control socket. Requests are HTTP/1.1 with
+ * keep-alive and a Content-Length body; a GET with "Upgrade: websocket" on a
+ * WebSocket route is answered with the RFC 6455 handshake, after which every frame
+ * calls the route handler. Handlers, queued work and pushes all run on the server
+ * task, so the firmware sees the same threading as on the kit. Sends are serialized
+ * by a lock so a tool thread may also push through httpd_ws_send_frame_async.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+
+#define FAKE_HTTPD_MAX_SOCKETS 16      // Sessions, beyond any max_open_sockets used
+#define FAKE_HTTPD_MAX_ROUTES 16       // Registered URI handlers
+#define FAKE_HTTPD_BUFFER_SIZE 2048    // Received bytes buffered per session
+#define FAKE_HTTPD_WORK_QUEUE_SIZE 16  // Work items queued with httpd_queue_work
+#define FAKE_HTTPD_WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct
+{
+    int fd;                    // -1 when the slot is free
+    bool websocket;            // Handshake done
+    const httpd_uri_t *route;  // WebSocket route of the session
+    int64_t lastUsed;          // For the LRU purge
+    size_t length;             // Buffered bytes
+    uint8_t buffer[FAKE_HTTPD_BUFFER_SIZE];
+} fakeHttpSession;
+
+// Request state behind httpd_req_t.aux
+typedef struct
+{
+    fakeHttpSession *session;
+    size_t bodyBuffered;      // Body bytes still in the session buffer, at bodyOffset
+    size_t bodyOffset;
+    size_t bodyRemaining;     // Body bytes not read by the handler yet
+    const char *status;
+    const char *type;
+    httpd_ws_type_t frameType;
+    const uint8_t *framePayload;
+    size_t frameLength;
+} fakeHttpRequest;
+
+typedef struct
+{
+    httpd_work_fn_t work;
+    void *arg;
+} fakeHttpWork;
+
+struct fakeHttpServer
+{
+    httpd_config_t config;
+    httpd_uri_t routes[FAKE_HTTPD_MAX_ROUTES];
+    size_t routeCount;
+    int listenFd;
+    int wake[2];
+    volatile bool running;
+    SemaphoreHandle_t stopped;
+    pthread_mutex_t sendLock;
+    pthread_mutex_t workLock;
+    fakeHttpWork work[FAKE_HTTPD_WORK_QUEUE_SIZE];
+    size_t workHead;
+    size_t workCount;
+    fakeHttpSession sessions[FAKE_HTTPD_MAX_SOCKETS];
+};
+
+static struct fakeHttpServer httpServer = {.listenFd = -1};
+
+// ---- SHA-1 and base64, for the WebSocket handshake ------------------------------
+
+static uint32_t FakeSha1_Rotate(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void FakeSha1_Block(uint32_t state[5], const uint8_t block[64])
+{
+    uint32_t w[80];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++)
+    {
+        w[i] = FakeSha1_Rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    for (int i = 0; i < 80; i++)
+    {
+        uint32_t f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d), k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d, k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d), k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d, k = 0xCA62C1D6;
+        }
+        uint32_t t = FakeSha1_Rotate(a, 5) + f + e + k + w[i];
+        e = d, d = c, c = FakeSha1_Rotate(b, 30), b = a, a = t;
+    }
+    state[0] += a, state[1] += b, state[2] += c, state[3] += d, state[4] += e;
+}
+
+// SHA-1 of a short message, under 119 bytes (two blocks)
+static void FakeSha1(const char *message, uint8_t digest[20])
+{
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t blocks[128] = {0};
+    size_t length = strlen(message);
+    size_t total = length + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)length * 8;
+
+    memcpy(blocks, message, length);
+    blocks[length] = 0x80;
+    for (int i = 0; i < 8; i++)
+    {
+        blocks[total - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    for (size_t offset = 0; offset < total; offset += 64)
+    {
+        FakeSha1_Block(state, blocks + offset);
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        digest[i] = (uint8_t)(state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static void FakeBase64(const uint8_t *data, size_t length, char *text)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (size_t i = 0; i < length; i += 3)
+    {
+        uint32_t group = (uint32_t)data[i] << 16 | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0) | (i + 2 < length ? data[i + 2] : 0);
+        *text++ = digits[(group >> 18) & 63];
+        *text++ = digits[(group >> 12) & 63];
+        *text++ = i + 1 < length ? digits[(group >> 6) & 63] : '=';
+        *text++ = i + 2 < length ? digits[group & 63] : '=';
+    }
+    *text = '\0';
+}
+
+// ---- Sockets ---------------------------------------------------------------------
+
+static bool FakeHttpd_SendAll(int fd, const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+
+    pthread_mutex_lock(&httpServer.sendLock);
+    while (length > 0)
+    {
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            pthread_mutex_unlock(&httpServer.sendLock);
+            return false;
+        }
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+    pthread_mutex_unlock(&httpServer.sendLock);
+    return true;
+}
+
+static fakeHttpSession *FakeHttpd_FindSession(int fd)
+{
+    for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+    {
+        if (httpServer.sessions[i].fd == fd && fd >= 0)
+        {
+            return &httpServer.sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static void FakeHttpd_Close(fakeHttpSession *session)
+{
+    close(session->fd);
+    session->fd = -1;
+    session->websocket = false;
+    session->route = NULL;
+    session->length = 0;
+}
+
+// Drop the first bytes of the session buffer
+static void FakeHttpd_Consume(fakeHttpSession *session, size_t length)
+{
+    memmove(session->buffer, session->buffer + length, session->length - length);
+    session->length -= length;
+}
+
+static void FakeHttpd_Accept(void)
+{
+    int fd = accept(httpServer.listenFd, NULL, NULL);
+    fakeHttpSession *slot = NULL;
+    fakeHttpSession *oldest = NULL;
+    size_t openCount = 0;
+    int one = 1;
+    struct timeval timeout = {.tv_sec = httpServer.config.recv_wait_timeout};
+
+    if (fd < 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+    {
+        fakeHttpSession *session = &httpServer.sessions[i];
+        if (session->fd < 0)
+        {
+            slot = slot != NULL ? slot : session;
+            continue;
+        }
+        openCount++;
+        if (oldest == NULL || session->lastUsed < oldest->lastUsed)
+        {
+            oldest = session;
+        }
+    }
+
+    // Full: recycle the least recently used session, or refuse the new one
+    if (openCount >= httpServer.config.max_open_sockets || slot == NULL)
+    {
+        if (!httpServer.config.lru_purge_enable || oldest == NULL)
+        {
+            close(fd);
+            return;
+        }
+        FakeHttpd_Close(oldest);
+        slot = oldest;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    slot->fd = fd;
+    slot->length = 0;
+    slot->websocket = false;
+    slot->route = NULL;
+    slot->lastUsed = esp_timer_get_time();
+}
+
+// ---- HTTP ------------------------------------------------------------------------
+
+static const char *FakeHttpd_Header(const char *headers, const char *name, char *value, size_t size)
+{
+    size_t nameLength = strlen(name);
+
+    for (const char *line = strstr(headers, "\r\n"); line != NULL && line[2] != '\r'; line = strstr(line + 2, "\r\n"))
+    {
+        const char *start = line + 2;
+        if (strncasecmp(start, name, nameLength) == 0 && start[nameLength] == ':')
+        {
+            start += nameLength + 1;
+            while (*start == ' ')
+            {
+                start++;
+            }
+            size_t length = strcspn(start, "\r");
+            if (length >= size)
+            {
+                length = size - 1;
+            }
+            memcpy(value, start, length);
+            value[length] = '\0';
+            return value;
+        }
+    }
+    return NULL;
+}
+
+static int FakeHttpd_Method(const char *name)
+{
+    static const char *const names[] = {"DELETE", "GET", "HEAD", "POST", "PUT"};
+
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void FakeHttpd_SendStatus(int fd, const char *status, const char *type, const char *body, size_t length)
+{
+    char head[256];
+    int headLength = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n", status, type,
+                              length);
+
+    pthread_mutex_lock(&httpServer.sendLock); // One response, not interleaved with a push
+    FakeHttpd_SendAll(fd, head, (size_t)headLength);
+    FakeHttpd_SendAll(fd, body, length);
+    pthread_mutex_unlock(&httpServer.sendLock);
+}
+
+// Answer the WebSocket handshake, false if the request is not a valid one
+static bool FakeHttpd_Upgrade(fakeHttpSession *session, const char *headers)
+{
+    char key[64];
+    char accept[64];
+    char digestInput[sizeof(key) + sizeof(FAKE_HTTPD_WS_GUID)];
+    uint8_t digest[20];
+    char response[256];
+
+    if (FakeHttpd_Header(headers, "Sec-WebSocket-Key", key, sizeof(key)) == NULL)
+    {
+        return false;
+    }
+    snprintf(digestInput, sizeof(digestInput), "%s" FAKE_HTTPD_WS_GUID, key);
+    FakeSha1(digestInput, digest);
+    FakeBase64(digest, sizeof(digest), accept);
+    int length = snprintf(response, sizeof(response),
+                          "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: %s\r\n\r\n",
+                          accept);
+    return FakeHttpd_SendAll(session->fd, response, (size_t)length);
+}
+
+// Handle one complete request at the start of the buffer, false to close the session
+static bool FakeHttpd_Request(fakeHttpSession *session, size_t headLength)
+{
+    char headers[FAKE_HTTPD_BUFFER_SIZE + 1];
+    char methodName[8];
+    char value[64];
+    httpd_req_t req = {.handle = &httpServer};
+    fakeHttpRequest state = {.session = session, .status = "200 OK", .type = "text/html"};
+    const httpd_uri_t *route = NULL;
+    bool uriMatched = false;
+    bool keep = true;
+
+    memcpy(headers, session->buffer, headLength);
+    headers[headLength] = '\0';
+    if (sscanf(headers, "%7s %512s", methodName, (char *)req.uri) != 2)
+    {
+        return false;
+    }
+    req.method = FakeHttpd_Method(methodName);
+    req.aux = &state;
+    if (FakeHttpd_Header(headers, "Content-Length", value, sizeof(value)) != NULL)
+    {
+        req.content_len = strtoul(value, NULL, 10);
+    }
+    if (FakeHttpd_Header(headers, "Connection", value, sizeof(value)) != NULL && strcasecmp(value, "close") == 0)
+    {
+        keep = false;
+    }
+
+    FakeHttpd_Consume(session, headLength);
+    state.bodyOffset = 0;
+    state.bodyBuffered = req.content_len < session->length ? req.content_len : session->length;
+    state.bodyRemaining = req.content_len;
+
+    for (size_t i = 0; i < httpServer.routeCount; i++)
+    {
+        char *query = strchr((char *)req.uri, '?');
+        size_t uriLength = query != NULL ? (size_t)(query - req.uri) : strlen(req.uri);
+        if (strlen(httpServer.routes[i].uri) == uriLength && strncmp(httpServer.routes[i].uri, req.uri, uriLength) == 0)
+        {
+            uriMatched = true;
+            if ((int)httpServer.routes[i].method == req.method)
+            {
+                route = &httpServer.routes[i];
+                break;
+            }
+        }
+    }
+
+    if (route == NULL)
+    {
+        httpd_resp_send_err(&req, uriMatched ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+    }
+    else if (route->is_websocket)
+    {
+        if (FakeHttpd_Header(headers, "Upgrade", value, sizeof(value)) == NULL || strcasecmp(value, "websocket") != 0 ||
+            !FakeHttpd_Upgrade(session, headers))
+        {
+            httpd_resp_send_err(&req, HTTPD_400_BAD_REQUEST, NULL);
+            return false;
+        }
+        session->websocket = true;
+        session->route = route;
+        req.user_ctx = route->user_ctx;
+        keep = route->handler(&req) == ESP_OK;
+    }
+    else
+    {
+        req.user_ctx = route->user_ctx;
+        keep = route->handler(&req) == ESP_OK && keep;
+    }
+
+    // Drop the body the handler did not read, buffered part first
+    size_t unread = state.bodyRemaining;
+    size_t buffered = state.bodyBuffered;
+    FakeHttpd_Consume(session, state.bodyOffset + buffered);
+    unread -= buffered;
+    while (keep && unread > 0)
+    {
+        char discard[256];
+        ssize_t length = recv(session->fd, discard, unread < sizeof(discard) ? unread : sizeof(discard), 0);
+        if (length <= 0)
+        {
+            return false;
+        }
+        unread -= (size_t)length;
+    }
+    return keep;
+}
+
+// ---- WebSocket -------------------------------------------------------------------
+
+static bool FakeHttpd_SendFrame(int fd, const httpd_ws_frame_t *frame)
+{
+    uint8_t head[10];
+    size_t headLength = 2;
+    bool sent;
+
+    head[0] = (uint8_t)((frame->final || !frame->fragmented ? 0x80 : 0) | (frame->type & 0x0F));
+    if (frame->len < 126)
+    {
+        head[1] = (uint8_t)frame->len;
+    }
+    else if (frame->len <= 0xFFFF)
+    {
+        head[1] = 126;
+        head[2] = (uint8_t)(frame->len >> 8);
+        head[3] = (uint8_t)frame->len;
+        headLength = 4;
+    }
+    else
+    {
+        head[1] = 127;
+        for (int i = 0; i < 8; i++)
+        {
+            head[2 + i] = (uint8_t)((uint64_t)frame->len >> (56 - 8 * i));
+        }
+        headLength = 10;
+    }
+
+    pthread_mutex_lock(&httpServer.sendLock); // Header and payload in one piece
+    sent = FakeHttpd_SendAll(fd, head, headLength) && FakeHttpd_SendAll(fd, frame->payload, frame->len);
+    pthread_mutex_unlock(&httpServer.sendLock);
+    return sent;
+}
+
+// Handle one complete frame at the start of the buffer, false to close the session
+static bool FakeHttpd_Frame(fakeHttpSession *session, size_t frameLength, size_t headLength, size_t payloadLength)
+{
+    uint8_t *payload = session->buffer + headLength;
+    httpd_ws_type_t type = (httpd_ws_type_t)(session->buffer[0] & 0x0F);
+    httpd_req_t req = {.handle = &httpServer, .method = HTTP_DELETE, .user_ctx = session->route->user_ctx};
+    fakeHttpRequest state = {.session = session, .frameType = type, .framePayload = payload, .frameLength = payloadLength};
+    bool keep = true;
+
+    // Clients mask every frame
+    if (session->buffer[1] & 0x80)
+    {
+        const uint8_t *mask = payload - 4;
+        for (size_t i = 0; i < payloadLength; i++)
+        {
+            payload[i] ^= mask[i % 4];
+        }
+    }
+    snprintf((char *)req.uri, sizeof(req.uri), "%s", session->route->uri);
+    req.aux = &state;
+
+    if (!session->route->handle_ws_control_frames && type == HTTPD_WS_TYPE_CLOSE)
+    {
+        httpd_ws_frame_t reply = {.final = true, .type = HTTPD_WS_TYPE_CLOSE, .payload = payload, .len = payloadLength < 2 ? payloadLength : 2};
+        FakeHttpd_SendFrame(session->fd, &reply);
+        keep = false;
+    }
+    else if (!session->route->handle_ws_control_frames && type == HTTPD_WS_TYPE_PING)
+    {
+        httpd_ws_frame_t pong = {.final = true, .type = HTTPD_WS_TYPE_PONG, .payload = payload, .len = payloadLength};
+        keep = FakeHttpd_SendFrame(session->fd, &pong);
+    }
+    else if (session->route->handle_ws_control_frames || type < HTTPD_WS_TYPE_CLOSE)
+    {
+        keep = session->route->handler(&req) == ESP_OK;
+    }
+
+    FakeHttpd_Consume(session, frameLength);
+    return keep;
+}
+
+// Size of the complete frame at the start of the buffer, 0 if more bytes are needed
+static size_t FakeHttpd_FrameLength(const fakeHttpSession *session, size_t *headLength, size_t *payloadLength)
+{
+    const uint8_t *buffer = session->buffer;
+    size_t head = 2;
+    uint64_t length;
+
+    if (session->length < 2)
+    {
+        return 0;
+    }
+    length = buffer[1] & 0x7F;
+    if (length == 126)
+    {
+        if (session->length < 4)
+        {
+            return 0;
+        }
+        length = (uint64_t)buffer[2] << 8 | buffer[3];
+        head = 4;
+    }
+    else if (length == 127)
+    {
+        if (session->length < 10)
+        {
+            return 0;
+        }
+        length = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            length = length << 8 | buffer[2 + i];
+        }
+        head = 10;
+    }
+    if (buffer[1] & 0x80)
+    {
+        head += 4;
+    }
+    if (length > FAKE_HTTPD_BUFFER_SIZE)
+    {
+        return SIZE_MAX; // Never fits the buffer
+    }
+    if (session->length < head + length)
+    {
+        return 0;
+    }
+    *headLength = head;
+    *payloadLength = (size_t)length;
+    return head + (size_t)length;
+}
+
+// ---- Server task -----------------------------------------------------------------
+
+// Handle what a session received, false to close it
+static bool FakeHttpd_Receive(fakeHttpSession *session)
+{
+    ssize_t received = recv(session->fd, session->buffer + session->length, sizeof(session->buffer) - session->length, 0);
+
+    if (received <= 0)
+    {
+        return false;
+    }
+    session->length += (size_t)received;
+    session->lastUsed = esp_timer_get_time();
+
+    while (session->fd >= 0 && session->length > 0)
+    {
+        if (session->websocket)
+        {
+            size_t headLength, payloadLength;
+            size_t frameLength = FakeHttpd_FrameLength(session, &headLength, &payloadLength);
+            if (frameLength == SIZE_MAX)
+            {
+                return false;
+            }
+            if (frameLength == 0)
+            {
+                break;
+            }
+            if (!FakeHttpd_Frame(session, frameLength, headLength, payloadLength))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            const uint8_t *end = memmem(session->buffer, session->length, "\r\n\r\n", 4);
+            if (end == NULL)
+            {
+                return session->length < sizeof(session->buffer); // Headers larger than the buffer
+            }
+            if (!FakeHttpd_Request(session, (size_t)(end - session->buffer) + 4))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void FakeHttpd_RunWork(void)
+{
+    char drain[32];
+
+    while (read(httpServer.wake[0], drain, sizeof(drain)) == sizeof(drain))
+    {
+    }
+    while (1)
+    {
+        fakeHttpWork item;
+
+        pthread_mutex_lock(&httpServer.workLock);
+        if (httpServer.workCount == 0)
+        {
+            pthread_mutex_unlock(&httpServer.workLock);
+            return;
+        }
+        item = httpServer.work[httpServer.workHead];
+        httpServer.workHead = (httpServer.workHead + 1) % FAKE_HTTPD_WORK_QUEUE_SIZE;
+        httpServer.workCount--;
+        pthread_mutex_unlock(&httpServer.workLock);
+
+        item.work(item.arg);
+    }
+}
+
+static void FakeHttpd_Task(void *param)
+{
+    struct pollfd fds[FAKE_HTTPD_MAX_SOCKETS + 2];
+    fakeHttpSession *polled[FAKE_HTTPD_MAX_SOCKETS];
+
+    while (httpServer.running)
+    {
+        size_t count = 0;
+
+        fds[count++] = (struct pollfd){.fd = httpServer.listenFd, .events = POLLIN};
+        fds[count++] = (struct pollfd){.fd = httpServer.wake[0], .events = POLLIN};
+        for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+        {
+            if (httpServer.sessions[i].fd >= 0)
+            {
+                polled[count - 2] = &httpServer.sessions[i];
+                fds[count++] = (struct pollfd){.fd = httpServer.sessions[i].fd, .events = POLLIN};
+            }
+        }
+        if (poll(fds, count, -1) <= 0)
+        {
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            FakeHttpd_RunWork();
+        }
+        for (size_t i = 2; i < count; i++)
+        {
+            if (fds[i].revents != 0 && polled[i - 2]->fd == fds[i].fd && !FakeHttpd_Receive(polled[i - 2]))
+            {
+                FakeHttpd_Close(polled[i - 2]);
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            FakeHttpd_Accept();
+        }
+    }
+
+    for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+    {
+        if (httpServer.sessions[i].fd >= 0)
+        {
+            FakeHttpd_Close(&httpServer.sessions[i]);
+        }
+    }
+    xSemaphoreGive(httpServer.stopped);
+}
+
+// ---- API -------------------------------------------------------------------------
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY)};
+    int one = 1;
+
+    if (handle == NULL || config == NULL || httpServer.running)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpServer.config = *config;
+    httpServer.routeCount = 0;
+    httpServer.workHead = 0;
+    httpServer.workCount = 0;
+    for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+    {
+        httpServer.sessions[i].fd = -1;
+    }
+
+    address.sin_port = htons(config->server_port);
+    httpServer.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (httpServer.listenFd < 0)
+    {
+        return ESP_FAIL;
+    }
+    setsockopt(httpServer.listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(httpServer.listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(httpServer.listenFd, config->backlog_conn) != 0 || pipe2(httpServer.wake, O_NONBLOCK) != 0)
+    {
+        close(httpServer.listenFd);
+        httpServer.listenFd = -1;
+        return ESP_FAIL;
+    }
+
+    pthread_mutexattr_t recursive;
+    pthread_mutexattr_init(&recursive);
+    pthread_mutexattr_settype(&recursive, PTHREAD_MUTEX_RECURSIVE); // A response locks around its parts
+    pthread_mutex_init(&httpServer.sendLock, &recursive);
+    pthread_mutex_init(&httpServer.workLock, NULL);
+    httpServer.stopped = xSemaphoreCreateBinary();
+    httpServer.running = true;
+    if (xTaskCreatePinnedToCore(FakeHttpd_Task, "httpd", config->stack_size, NULL, config->task_priority, NULL,
+                                config->core_id) != pdPASS)
+    {
+        httpServer.running = false;
+        return ESP_FAIL;
+    }
+    *handle = &httpServer;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    if (handle != &httpServer || !httpServer.running)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpServer.running = false;
+    (void)!write(httpServer.wake[1], "", 1);
+    xSemaphoreTake(httpServer.stopped, portMAX_DELAY);
+    close(httpServer.listenFd);
+    close(httpServer.wake[0]);
+    close(httpServer.wake[1]);
+    httpServer.listenFd = -1;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    if (handle != &httpServer || uri_handler == NULL || httpServer.routeCount >= httpServer.config.max_uri_handlers ||
+        httpServer.routeCount >= FAKE_HTTPD_MAX_ROUTES)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpServer.routes[httpServer.routeCount++] = *uri_handler;
+    return ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    fakeHttpRequest *state = r->aux;
+    size_t length = buf_len < state->bodyRemaining ? buf_len : state->bodyRemaining;
+
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (state->bodyBuffered > 0)
+    {
+        length = length < state->bodyBuffered ? length : state->bodyBuffered;
+        memcpy(buf, state->session->buffer + state->bodyOffset, length);
+        state->bodyOffset += length;
+        state->bodyBuffered -= length;
+        state->bodyRemaining -= length;
+        return (int)length;
+    }
+
+    ssize_t received = recv(state->session->fd, buf, length, 0);
+    if (received < 0)
+    {
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    if (received == 0)
+    {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    state->bodyRemaining -= (size_t)received;
+    return (int)received;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return ((fakeHttpRequest *)r->aux)->session->fd;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    ((fakeHttpRequest *)r->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    ((fakeHttpRequest *)r->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    fakeHttpRequest *state = r->aux;
+    size_t length = buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+
+    FakeHttpd_SendStatus(state->session->fd, state->status, state->type, buf, length);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const char *const statuses[] = {"400 Bad Request", "404 Not Found", "405 Method Not Allowed",
+                                           "500 Internal Server Error"};
+    fakeHttpRequest *state = req->aux;
+    const char *status = error <= HTTPD_500_INTERNAL_SERVER_ERROR ? statuses[error] : statuses[HTTPD_500_INTERNAL_SERVER_ERROR];
+    const char *body = msg != NULL ? msg : status;
+
+    FakeHttpd_SendStatus(state->session->fd, status, "text/html", body, strlen(body));
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    fakeHttpRequest *state = req->aux;
+
+    if (state->framePayload == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pkt->type = state->frameType;
+    pkt->final = true;
+    pkt->fragmented = false;
+    pkt->len = state->frameLength;
+    if (max_len == 0)
+    {
+        return ESP_OK;
+    }
+    if (pkt->payload == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pkt->len = state->frameLength < max_len ? state->frameLength : max_len;
+    memcpy(pkt->payload, state->framePayload, pkt->len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt)
+{
+    return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), pkt);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (hd != &httpServer || frame == NULL || fd < 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return FakeHttpd_SendFrame(fd, frame) ? ESP_OK : ESP_FAIL;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    fakeHttpSession *session = FakeHttpd_FindSession(fd);
+
+    if (hd != &httpServer || session == NULL)
+    {
+        return HTTPD_WS_CLIENT_INVALID;
+    }
+    return session->websocket ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t *fds, int *client_fds)
+{
+    size_t count = 0;
+
+    if (handle != &httpServer || fds == NULL || client_fds == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < FAKE_HTTPD_MAX_SOCKETS; i++)
+    {
+        if (httpServer.sessions[i].fd >= 0)
+        {
+            if (count >= *fds)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            client_fds[count++] = httpServer.sessions[i].fd;
+        }
+    }
+    *fds = count;
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    if (handle != &httpServer || work == NULL || !httpServer.running)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&httpServer.workLock);
+    if (httpServer.workCount >= FAKE_HTTPD_WORK_QUEUE_SIZE)
+    {
+        pthread_mutex_unlock(&httpServer.workLock);
+        return ESP_FAIL;
+    }
+    httpServer.work[(httpServer.workHead + httpServer.workCount) % FAKE_HTTPD_WORK_QUEUE_SIZE] = (fakeHttpWork){work, arg};
+    httpServer.workCount++;
+    pthread_mutex_unlock(&httpServer.workLock);
+
+    return write(httpServer.wake[1], "", 1) == 1 ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,519 @@
+/******************************************************************************
+ * @file        fake_mqtt.c
+ * @brief       Host fake of the esp-mqtt client and an in-process broker.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The broker keeps the subscriptions of every client in a fixed table and routes
+ * each published message to the bounded inbox of the subscribed clients. Each
+ * client has a task that takes messages from its inbox and calls the registered
+ * event handler, so firmware callbacks run on a dedicated task exactly as with the
+ * esp-mqtt task. A full inbox drops the message and counts it, which is how a slow
+ * handler shows up under load. Observers let host tools see what the firmware
+ * publishes (acks, diagnostics) without being an MQTT client themselves. Retained
+ * messages are kept per topic, replaced by the next one and delivered on subscribe,
+ * and an empty retained message clears the topic, as on a real broker.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "mqtt_client.h"
+#include "okta_fakes.h"
+
+#define FAKE_MQTT_TASK_STACK_SIZE 6144 // Same as the esp-mqtt default
+#define FAKE_MQTT_TASK_PRIORITY 5      // Same as the esp-mqtt default
+#if CONFIG_MQTT_USE_CORE_1
+#define FAKE_MQTT_TASK_CORE 1          // CONFIG_MQTT_USE_CORE_1, as in the project sdkconfig
+#else
+#define FAKE_MQTT_TASK_CORE tskNO_AFFINITY // esp-mqtt default
+#endif
+
+// One queued event, the payload is copied like the esp-mqtt receive buffer
+typedef struct
+{
+    esp_mqtt_event_id_t eventId;
+    int msgId;
+    int topicLength;
+    int dataLength;
+    char topic[FAKE_BROKER_TOPIC_LENGTH];
+    char data[FAKE_BROKER_PAYLOAD_LENGTH];
+} fakeBrokerMessage;
+
+struct esp_mqtt_client
+{
+    bool used;
+    bool started;
+    esp_event_handler_t handler;
+    void *handlerArgument;
+    QueueHandle_t inbox;
+    fakeBrokerMessage current; // Message being handled, kept off the task stack
+};
+
+typedef struct
+{
+    bool used;
+    struct esp_mqtt_client *client;
+    char filter[FAKE_BROKER_TOPIC_LENGTH];
+} fakeBrokerSubscription;
+
+typedef struct
+{
+    char filter[FAKE_BROKER_TOPIC_LENGTH];
+    fakeBrokerObserver observer;
+    void *context;
+} fakeBrokerObserverEntry;
+
+typedef struct
+{
+    bool used;
+    int dataLength;
+    char topic[FAKE_BROKER_TOPIC_LENGTH];
+    char data[FAKE_BROKER_PAYLOAD_LENGTH];
+} fakeBrokerRetained;
+
+static pthread_mutex_t brokerLock = PTHREAD_MUTEX_INITIALIZER;
+static struct esp_mqtt_client brokerClients[FAKE_BROKER_MAX_CLIENTS];
+static fakeBrokerSubscription brokerSubscriptions[FAKE_BROKER_MAX_SUBSCRIPTIONS];
+static fakeBrokerObserverEntry brokerObservers[FAKE_BROKER_MAX_OBSERVERS];
+static size_t brokerObserverCount = 0;
+static fakeBrokerRetained brokerRetained[FAKE_BROKER_MAX_RETAINED];
+static _Atomic uint32_t brokerDropped;
+static _Atomic uint32_t brokerPending;
+static _Atomic int brokerNextMsgId = 1;
+
+// MQTT topic matching with the + and # wildcards
+static bool FakeBroker_Matches(const char *filter, const char *topic)
+{
+    while (*filter != '\0')
+    {
+        if (*filter == '#')
+        {
+            return true; // Matches the rest, including the parent level
+        }
+        if (*filter == '+')
+        {
+            while (*topic != '\0' && *topic != '/')
+            {
+                topic++;
+            }
+            filter++;
+            continue;
+        }
+        if (*topic == '\0')
+        {
+            // "a/#" also matches "a"
+            return filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+        }
+        if (*filter != *topic)
+        {
+            return false;
+        }
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
+
+// Queue an event for one client, the broker lock is held
+static bool FakeBroker_Enqueue(struct esp_mqtt_client *client, const fakeBrokerMessage *message)
+{
+    atomic_fetch_add(&brokerPending, 1);
+    if (xQueueSend(client->inbox, message, 0) != pdPASS)
+    {
+        atomic_fetch_sub(&brokerPending, 1);
+        atomic_fetch_add(&brokerDropped, 1);
+        return false;
+    }
+    return true;
+}
+
+// Queue a control event (connected, subscribed...) for one client
+static int FakeBroker_Notify(struct esp_mqtt_client *client, esp_mqtt_event_id_t eventId)
+{
+    static fakeBrokerMessage notification; // Guarded by the broker lock
+    int msgId = atomic_fetch_add(&brokerNextMsgId, 1);
+
+    pthread_mutex_lock(&brokerLock);
+    memset(&notification, 0, offsetof(fakeBrokerMessage, topic));
+    notification.eventId = eventId;
+    notification.msgId = msgId;
+    FakeBroker_Enqueue(client, &notification);
+    pthread_mutex_unlock(&brokerLock);
+
+    return msgId;
+}
+
+// Keep or clear the retained message of a topic, the broker lock is held
+static bool FakeBroker_Retain(const char *topic, const char *data, int dataLength)
+{
+    fakeBrokerRetained *slot = NULL;
+
+    for (size_t i = 0; i < FAKE_BROKER_MAX_RETAINED; i++)
+    {
+        if (brokerRetained[i].used && strcmp(brokerRetained[i].topic, topic) == 0)
+        {
+            slot = &brokerRetained[i];
+            break;
+        }
+        if (!brokerRetained[i].used && slot == NULL)
+        {
+            slot = &brokerRetained[i];
+        }
+    }
+    if (slot == NULL)
+    {
+        return false;
+    }
+    slot->used = dataLength > 0;
+    slot->dataLength = dataLength;
+    strcpy(slot->topic, topic);
+    memcpy(slot->data, data, dataLength);
+    return true;
+}
+
+// Route a message to subscribers and observers, returns the number of deliveries
+static int FakeBroker_Route(const char *topic, const char *data, int dataLength)
+{
+    static fakeBrokerMessage message; // Guarded by the broker lock
+    fakeBrokerObserverEntry observers[FAKE_BROKER_MAX_OBSERVERS];
+    size_t observerCount;
+    int delivered = 0;
+
+    if (topic == NULL || strlen(topic) >= FAKE_BROKER_TOPIC_LENGTH || dataLength < 0 || dataLength > FAKE_BROKER_PAYLOAD_LENGTH)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&brokerLock);
+    message.eventId = MQTT_EVENT_DATA;
+    message.msgId = atomic_fetch_add(&brokerNextMsgId, 1);
+    message.topicLength = (int)strlen(topic);
+    message.dataLength = dataLength;
+    memcpy(message.topic, topic, message.topicLength);
+    memcpy(message.data, data, dataLength);
+
+    // At most one delivery per client, however many of its filters match
+    for (size_t c = 0; c < FAKE_BROKER_MAX_CLIENTS; c++)
+    {
+        struct esp_mqtt_client *client = &brokerClients[c];
+        if (!client->used || !client->started)
+        {
+            continue;
+        }
+        for (size_t s = 0; s < FAKE_BROKER_MAX_SUBSCRIPTIONS; s++)
+        {
+            if (brokerSubscriptions[s].used && brokerSubscriptions[s].client == client && FakeBroker_Matches(brokerSubscriptions[s].filter, topic))
+            {
+                delivered += FakeBroker_Enqueue(client, &message) ? 1 : 0;
+                break;
+            }
+        }
+    }
+
+    observerCount = brokerObserverCount;
+    memcpy(observers, brokerObservers, observerCount * sizeof(observers[0]));
+    pthread_mutex_unlock(&brokerLock);
+
+    // Observers run unlocked so they may publish in turn
+    for (size_t i = 0; i < observerCount; i++)
+    {
+        if (FakeBroker_Matches(observers[i].filter, topic))
+        {
+            observers[i].observer(topic, data, dataLength, observers[i].context);
+        }
+    }
+    return delivered;
+}
+
+// Client task: deliver queued events to the registered handler
+static void FakeBroker_ClientTask(void *param)
+{
+    struct esp_mqtt_client *client = param;
+    esp_mqtt_event_t event;
+
+    while (1)
+    {
+        xQueueReceive(client->inbox, &client->current, portMAX_DELAY);
+
+        memset(&event, 0, sizeof(event));
+        event.event_id = client->current.eventId;
+        event.client = client;
+        event.msg_id = client->current.msgId;
+        if (client->current.eventId == MQTT_EVENT_DATA)
+        {
+            // Neither buffer is null-terminated, as with esp-mqtt
+            event.topic = client->current.topic;
+            event.topic_len = client->current.topicLength;
+            event.data = client->current.data;
+            event.data_len = client->current.dataLength;
+            event.total_data_len = client->current.dataLength;
+        }
+
+        if (client->handler != NULL)
+        {
+            client->handler(client->handlerArgument, "MQTT_EVENTS", event.event_id, &event);
+        }
+        atomic_fetch_sub(&brokerPending, 1);
+    }
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    struct esp_mqtt_client *client = NULL;
+
+    pthread_mutex_lock(&brokerLock);
+    for (size_t i = 0; i < FAKE_BROKER_MAX_CLIENTS; i++)
+    {
+        if (!brokerClients[i].used)
+        {
+            client = &brokerClients[i];
+            memset(client, 0, sizeof(*client));
+            client->used = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    if (client == NULL)
+    {
+        return NULL;
+    }
+    client->inbox = xQueueCreate(FAKE_BROKER_INBOX_SIZE, sizeof(fakeBrokerMessage));
+    xTaskCreatePinnedToCore(FakeBroker_ClientTask, "mqtt_task", config->task.stack_size ? config->task.stack_size : FAKE_MQTT_TASK_STACK_SIZE,
+                            client, config->task.priority ? config->task.priority : FAKE_MQTT_TASK_PRIORITY, NULL, FAKE_MQTT_TASK_CORE);
+    return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->handlerArgument = event_handler_arg;
+    client->handler = event_handler;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->started = true;
+    FakeBroker_Notify(client, MQTT_EVENT_CONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->started = false;
+
+    // Clean session: the broker forgets the subscriptions of the client
+    pthread_mutex_lock(&brokerLock);
+    for (size_t s = 0; s < FAKE_BROKER_MAX_SUBSCRIPTIONS; s++)
+    {
+        if (brokerSubscriptions[s].used && brokerSubscriptions[s].client == client)
+        {
+            brokerSubscriptions[s].used = false;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    FakeBroker_Notify(client, MQTT_EVENT_DISCONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_set_config(esp_mqtt_client_handle_t client, const esp_mqtt_client_config_t *config)
+{
+    if (client == NULL || config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK; // A single in-process broker, whatever the address
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain)
+{
+    if (client == NULL || !client->started)
+    {
+        return -1;
+    }
+    if (len == 0 && data != NULL)
+    {
+        len = (int)strlen(data);
+    }
+    if (retain)
+    {
+        if (topic == NULL || strlen(topic) >= FAKE_BROKER_TOPIC_LENGTH || len < 0 || len > FAKE_BROKER_PAYLOAD_LENGTH)
+        {
+            return -1;
+        }
+        pthread_mutex_lock(&brokerLock);
+        bool kept = FakeBroker_Retain(topic, data, len);
+        pthread_mutex_unlock(&brokerLock);
+        if (!kept)
+        {
+            return -1;
+        }
+    }
+    if (FakeBroker_Route(topic, data, len) < 0)
+    {
+        return -1;
+    }
+    return qos > 0 ? atomic_fetch_add(&brokerNextMsgId, 1) : 0;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    bool added = false;
+
+    if (client == NULL || !client->started || topic == NULL || strlen(topic) >= FAKE_BROKER_TOPIC_LENGTH)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&brokerLock);
+    for (size_t s = 0; s < FAKE_BROKER_MAX_SUBSCRIPTIONS && !added; s++)
+    {
+        // A subscription to the same filter replaces the existing one
+        added = brokerSubscriptions[s].used && brokerSubscriptions[s].client == client && strcmp(brokerSubscriptions[s].filter, topic) == 0;
+    }
+    for (size_t s = 0; s < FAKE_BROKER_MAX_SUBSCRIPTIONS && !added; s++)
+    {
+        if (!brokerSubscriptions[s].used)
+        {
+            brokerSubscriptions[s].used = true;
+            brokerSubscriptions[s].client = client;
+            strcpy(brokerSubscriptions[s].filter, topic);
+            added = true;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+    if (!added)
+    {
+        return -1;
+    }
+    int msgId = FakeBroker_Notify(client, MQTT_EVENT_SUBSCRIBED);
+
+    // Then the retained messages the new filter matches, as a broker sends them after the SUBACK
+    static fakeBrokerMessage message; // Guarded by the broker lock
+    pthread_mutex_lock(&brokerLock);
+    for (size_t i = 0; i < FAKE_BROKER_MAX_RETAINED; i++)
+    {
+        if (brokerRetained[i].used && FakeBroker_Matches(topic, brokerRetained[i].topic))
+        {
+            message.eventId = MQTT_EVENT_DATA;
+            message.msgId = atomic_fetch_add(&brokerNextMsgId, 1);
+            message.topicLength = (int)strlen(brokerRetained[i].topic);
+            message.dataLength = brokerRetained[i].dataLength;
+            memcpy(message.topic, brokerRetained[i].topic, message.topicLength);
+            memcpy(message.data, brokerRetained[i].data, message.dataLength);
+            FakeBroker_Enqueue(client, &message);
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    return msgId;
+}
+
+int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic)
+{
+    if (client == NULL || topic == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&brokerLock);
+    for (size_t s = 0; s < FAKE_BROKER_MAX_SUBSCRIPTIONS; s++)
+    {
+        if (brokerSubscriptions[s].used && brokerSubscriptions[s].client == client && strcmp(brokerSubscriptions[s].filter, topic) == 0)
+        {
+            brokerSubscriptions[s].used = false;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    return FakeBroker_Notify(client, MQTT_EVENT_UNSUBSCRIBED);
+}
+
+int FakeBroker_Publish(const char *topic, const char *data, int dataLength)
+{
+    return FakeBroker_Route(topic, data, dataLength);
+}
+
+bool FakeBroker_Observe(const char *filter, fakeBrokerObserver observer, void *context)
+{
+    bool added = false;
+
+    if (filter == NULL || observer == NULL || strlen(filter) >= FAKE_BROKER_TOPIC_LENGTH)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&brokerLock);
+    if (brokerObserverCount < FAKE_BROKER_MAX_OBSERVERS)
+    {
+        strcpy(brokerObservers[brokerObserverCount].filter, filter);
+        brokerObservers[brokerObserverCount].observer = observer;
+        brokerObservers[brokerObserverCount].context = context;
+        brokerObserverCount++;
+        added = true;
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    return added;
+}
+
+int FakeBroker_GetRetained(const char *topic, char *data, size_t dataSize)
+{
+    int length = -1;
+
+    if (topic == NULL || data == NULL || dataSize == 0)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&brokerLock);
+    for (size_t i = 0; i < FAKE_BROKER_MAX_RETAINED; i++)
+    {
+        if (brokerRetained[i].used && strcmp(brokerRetained[i].topic, topic) == 0)
+        {
+            length = brokerRetained[i].dataLength < (int)dataSize ? brokerRetained[i].dataLength : (int)dataSize - 1;
+            memcpy(data, brokerRetained[i].data, length);
+            data[length] = '\0';
+            break;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock);
+
+    return length;
+}
+
+uint32_t FakeBroker_GetDroppedCount(void)
+{
+    return atomic_load(&brokerDropped);
+}
+
+uint32_t FakeBroker_GetPendingCount(void)
+{
+    return atomic_load(&brokerPending);
+}
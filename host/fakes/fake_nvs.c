@@ -0,0 +1,416 @@
+/******************************************************************************
+ * @file        fake_nvs.c
+ * @brief       Host fake of the NVS partition, persisted to a text file.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Entries live in a fixed table keyed by namespace and key, with the NVS type of
+ * their value. Every nvs_commit rewrites the partition file through a temporary
+ * file and a rename, so the file always holds the last committed state and a killed
+ * simulator restarts from it the way the kit restarts from flash. One line is kept
+ * per entry: namespace, key, type and the value in hex.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "okta_fakes.h"
+
+#define FAKE_NVS_MAX_HANDLES 16
+
+typedef enum
+{
+    FAKE_NVS_TYPE_I32,
+    FAKE_NVS_TYPE_STR,
+    FAKE_NVS_TYPE_BLOB,
+} fakeNvsType;
+
+typedef struct
+{
+    bool used;
+    char nameSpace[NVS_KEY_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    fakeNvsType type;
+    size_t length;
+    uint8_t value[FAKE_NVS_VALUE_LENGTH];
+} fakeNvsEntry;
+
+typedef struct
+{
+    bool open;
+    bool writable;
+    char nameSpace[NVS_KEY_NAME_MAX_SIZE];
+} fakeNvsHandle;
+
+static pthread_mutex_t nvsLock = PTHREAD_MUTEX_INITIALIZER;
+static fakeNvsEntry nvsEntries[FAKE_NVS_MAX_ENTRIES];
+static fakeNvsHandle nvsHandles[FAKE_NVS_MAX_HANDLES];
+static char nvsPath[256] = FAKE_NVS_DEFAULT_PATH;
+static bool nvsReady = false;
+static uint32_t nvsCommits = 0;
+
+// Handles are 1-based so that 0 is never valid
+static fakeNvsHandle *FakeNvs_Handle(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > FAKE_NVS_MAX_HANDLES || !nvsHandles[handle - 1].open)
+    {
+        return NULL;
+    }
+    return &nvsHandles[handle - 1];
+}
+
+static fakeNvsEntry *FakeNvs_Find(const char *nameSpace, const char *key)
+{
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        if (nvsEntries[i].used && strcmp(nvsEntries[i].nameSpace, nameSpace) == 0 && strcmp(nvsEntries[i].key, key) == 0)
+        {
+            return &nvsEntries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool FakeNvs_NamespaceExists(const char *nameSpace)
+{
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        if (nvsEntries[i].used && strcmp(nvsEntries[i].nameSpace, nameSpace) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rewrite the partition file with the current table
+static esp_err_t FakeNvs_Flush(void)
+{
+    char temporaryPath[sizeof(nvsPath) + 4];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", nvsPath);
+
+    FILE *file = fopen(temporaryPath, "w");
+    if (file == NULL)
+    {
+        return ESP_FAIL;
+    }
+
+    for (size_t i = 0; i < FAKE_NVS_MAX_ENTRIES; i++)
+    {
+        if (!nvsEntries[i].used)
+        {
+            continue;
+        }
+        fprintf(file, "%s %s %d ", nvsEntries[i].nameSpace, nvsEntries[i].key, (int)nvsEntries[i].type);
+        for (size_t j = 0; j < nvsEntries[i].length; j++)
+        {
+            fprintf(file, "%02x", nvsEntries[i].value[j]);
+        }
+        fprintf(file, "\n");
+    }
+
+    bool written = (fclose(file) == 0);
+    return (written && rename(temporaryPath, nvsPath) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+// Load the partition file, a missing file is an empty partition
+static void FakeNvs_Load(void)
+{
+    char line[NVS_KEY_NAME_MAX_SIZE * 2 + FAKE_NVS_VALUE_LENGTH * 2 + 16];
+    size_t count = 0;
+
+    memset(nvsEntries, 0, sizeof(nvsEntries));
+    FILE *file = fopen(nvsPath, "r");
+    if (file == NULL)
+    {
+        return;
+    }
+
+    while (count < FAKE_NVS_MAX_ENTRIES && fgets(line, sizeof(line), file) != NULL)
+    {
+        fakeNvsEntry *entry = &nvsEntries[count];
+        char hex[FAKE_NVS_VALUE_LENGTH * 2 + 1] = "";
+        int type;
+
+        if (sscanf(line, "%15s %15s %d %1024s", entry->nameSpace, entry->key, &type, hex) < 3)
+        {
+            continue;
+        }
+        entry->type = (fakeNvsType)type;
+        entry->length = strlen(hex) / 2;
+        for (size_t j = 0; j < entry->length; j++)
+        {
+            unsigned byte;
+            sscanf(&hex[j * 2], "%2x", &byte);
+            entry->value[j] = (uint8_t)byte;
+        }
+        entry->used = true;
+        count++;
+    }
+    fclose(file);
+}
+
+// Store a value under the handle's namespace
+static esp_err_t FakeNvs_Set(nvs_handle_t handle, const char *key, fakeNvsType type, const void *value, size_t length)
+{
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&nvsLock);
+    fakeNvsHandle *nvs = FakeNvs_Handle(handle);
+    if (nvs == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    else if (!nvs->writable)
+    {
+        err = ESP_ERR_NVS_READ_ONLY;
+    }
+    else if (key == NULL || strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        err = ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    else if (length > FAKE_NVS_VALUE_LENGTH)
+    {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    else
+    {
+        fakeNvsEntry *entry = FakeNvs_Find(nvs->nameSpace, key);
+        for (size_t i = 0; entry == NULL && i < FAKE_NVS_MAX_ENTRIES; i++)
+        {
+            if (!nvsEntries[i].used)
+            {
+                entry = &nvsEntries[i];
+                memset(entry, 0, sizeof(*entry));
+                strcpy(entry->nameSpace, nvs->nameSpace);
+                strcpy(entry->key, key);
+                entry->used = true;
+            }
+        }
+
+        if (entry == NULL)
+        {
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        else
+        {
+            entry->type = type;
+            entry->length = length;
+            memcpy(entry->value, value, length);
+        }
+    }
+    pthread_mutex_unlock(&nvsLock);
+
+    return err;
+}
+
+// Read a value of the expected type, *length is updated to the stored length
+static esp_err_t FakeNvs_Get(nvs_handle_t handle, const char *key, fakeNvsType type, void *value, size_t *length)
+{
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&nvsLock);
+    fakeNvsHandle *nvs = FakeNvs_Handle(handle);
+    fakeNvsEntry *entry = (nvs != NULL && key != NULL) ? FakeNvs_Find(nvs->nameSpace, key) : NULL;
+    if (nvs == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    else if (entry == NULL)
+    {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    else if (entry->type != type)
+    {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    else if (value == NULL)
+    {
+        *length = entry->length; // Size query
+    }
+    else if (*length < entry->length)
+    {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    else
+    {
+        memcpy(value, entry->value, entry->length);
+        *length = entry->length;
+    }
+    pthread_mutex_unlock(&nvsLock);
+
+    return err;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    pthread_mutex_lock(&nvsLock);
+    FakeNvs_Load();
+    nvsReady = true;
+    pthread_mutex_unlock(&nvsLock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&nvsLock);
+    memset(nvsEntries, 0, sizeof(nvsEntries));
+    remove(nvsPath);
+    pthread_mutex_unlock(&nvsLock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+    if (namespace_name == NULL || strlen(namespace_name) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+
+    pthread_mutex_lock(&nvsLock);
+    if (!nvsReady)
+    {
+        err = ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    else if (open_mode == NVS_READONLY && !FakeNvs_NamespaceExists(namespace_name))
+    {
+        err = ESP_ERR_NVS_NOT_FOUND; // Read-only opens do not create namespaces
+    }
+    else
+    {
+        for (size_t i = 0; i < FAKE_NVS_MAX_HANDLES; i++)
+        {
+            if (!nvsHandles[i].open)
+            {
+                nvsHandles[i].open = true;
+                nvsHandles[i].writable = (open_mode == NVS_READWRITE);
+                strcpy(nvsHandles[i].nameSpace, namespace_name);
+                *out_handle = (nvs_handle_t)(i + 1);
+                err = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&nvsLock);
+
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvsLock);
+    fakeNvsHandle *nvs = FakeNvs_Handle(handle);
+    if (nvs != NULL)
+    {
+        nvs->open = false;
+    }
+    pthread_mutex_unlock(&nvsLock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    esp_err_t err;
+
+    pthread_mutex_lock(&nvsLock);
+    if (FakeNvs_Handle(handle) == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    else
+    {
+        err = FakeNvs_Flush();
+        if (err == ESP_OK)
+        {
+            nvsCommits++;
+        }
+    }
+    pthread_mutex_unlock(&nvsLock);
+
+    return err;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return FakeNvs_Set(handle, key, FAKE_NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return FakeNvs_Get(handle, key, FAKE_NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value)
+{
+    return FakeNvs_Set(handle, key, FAKE_NVS_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return FakeNvs_Get(handle, key, FAKE_NVS_TYPE_I32, out_value, &length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return FakeNvs_Set(handle, key, FAKE_NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return FakeNvs_Get(handle, key, FAKE_NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&nvsLock);
+    fakeNvsHandle *nvs = FakeNvs_Handle(handle);
+    fakeNvsEntry *entry = (nvs != NULL && key != NULL) ? FakeNvs_Find(nvs->nameSpace, key) : NULL;
+    if (nvs == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    else if (!nvs->writable)
+    {
+        err = ESP_ERR_NVS_READ_ONLY;
+    }
+    else if (entry == NULL)
+    {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    else
+    {
+        entry->used = false;
+    }
+    pthread_mutex_unlock(&nvsLock);
+
+    return err;
+}
+
+void FakeNvs_SetPath(const char *path)
+{
+    pthread_mutex_lock(&nvsLock);
+    snprintf(nvsPath, sizeof(nvsPath), "%s", path);
+    pthread_mutex_unlock(&nvsLock);
+}
+
+uint32_t FakeNvs_GetCommitCount(void)
+{
+    pthread_mutex_lock(&nvsLock);
+    uint32_t commits = nvsCommits;
+    pthread_mutex_unlock(&nvsLock);
+    return commits;
+}
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * @file        fake_spi.c
+ * @brief       Host fake of the SPI master driver, wired to a 74HC595 chain model.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Every device on the bus is taken to be a chain of FAKE_SPI_CHAIN_CHIPS shift
+ * registers. Each byte sent shifts the chain by one chip, and the chip select rising
+ * at the end of the transaction copies the chain to the output latches, as RCLK does
+ * on a 74HC595. Transactions are counted, so a test can tell how many bus writes an
+ * update of the relay bank took.
+ ******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+#include "okta_fakes.h"
+
+struct spi_device_t
+{
+    int clockHz;
+};
+
+static struct spi_device_t spiDevice;
+static bool spiBusReady[SPI_HOST_MAX];
+static pthread_mutex_t spiLock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t spiChain[FAKE_SPI_CHAIN_CHIPS];   // Shift registers, chip 0 nearest the master
+static uint8_t spiLatched[FAKE_SPI_CHAIN_CHIPS]; // Output latches
+static _Atomic uint32_t spiTransactions = 0;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+    if (host_id >= SPI_HOST_MAX || bus_config == NULL || spiBusReady[host_id])
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    spiBusReady[host_id] = true;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    if (host_id >= SPI_HOST_MAX || !spiBusReady[host_id] || dev_config == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    spiDevice.clockHz = dev_config->clock_speed_hz;
+    *handle = &spiDevice;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    const uint8_t *data = trans_desc->tx_buffer;
+
+    if (handle == NULL || data == NULL || trans_desc->length % 8 != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&spiLock);
+    for (size_t i = 0; i < trans_desc->length / 8; i++)
+    {
+        memmove(&spiChain[1], &spiChain[0], FAKE_SPI_CHAIN_CHIPS - 1);
+        spiChain[0] = data[i];
+    }
+    memcpy(spiLatched, spiChain, sizeof(spiLatched)); // Chip select rises: latch
+    pthread_mutex_unlock(&spiLock);
+    atomic_fetch_add(&spiTransactions, 1);
+    return ESP_OK;
+}
+
+uint8_t FakeSpi_GetChipOutputs(size_t chip)
+{
+    uint8_t outputs = 0;
+
+    pthread_mutex_lock(&spiLock);
+    if (chip < FAKE_SPI_CHAIN_CHIPS)
+    {
+        outputs = spiLatched[chip];
+    }
+    pthread_mutex_unlock(&spiLock);
+    return outputs;
+}
+
+uint32_t FakeSpi_GetTransactionCount(void)
+{
+    return atomic_load(&spiTransactions);
+}
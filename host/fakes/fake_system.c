@@ -0,0 +1,294 @@
+/******************************************************************************
+ * @file        fake_system.c
+ * @brief       Host fakes of esp_timer, esp_err, esp_system and heap_caps.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Time is the monotonic clock measured from the first call, like esp_timer counts
+ * from boot. A one-shot timer is a thread waiting on a condition variable against
+ * the same monotonic clock, so its lateness is the host scheduler's. The allocator entry points are wrapped to call the heap hooks like
+ * CONFIG_HEAP_USE_HOOKS does, and to count the bytes in use: heap statistics are
+ * FAKE_HEAP_SIZE minus those bytes. Only the program's own allocations pass through
+ * the wrappers, allocations made inside glibc (thread stacks, stdio) are not seen,
+ * so the figures follow the application heap exactly.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "okta_fakes.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+
+static struct timespec bootTime;
+static pthread_once_t bootOnce = PTHREAD_ONCE_INIT;
+static size_t heapMinimum = SIZE_MAX;
+static _Atomic long heapUsed = 0; // Bytes held by the program
+
+static void FakeSystem_Boot(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &bootTime);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+
+    pthread_once(&bootOnce, FakeSystem_Boot);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - bootTime.tv_sec) * 1000000 + (now.tv_nsec - bootTime.tv_nsec) / 1000;
+}
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int64_t due; // esp_timer time of expiry, -1 while disarmed
+};
+
+static void *FakeTimer_Thread(void *param)
+{
+    struct esp_timer *timer = param;
+
+    pthread_mutex_lock(&timer->lock);
+    while (1)
+    {
+        if (timer->due < 0)
+        {
+            pthread_cond_wait(&timer->changed, &timer->lock);
+            continue;
+        }
+
+        struct timespec deadline = bootTime;
+        deadline.tv_sec += timer->due / 1000000;
+        deadline.tv_nsec += (timer->due % 1000000) * 1000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        if (pthread_cond_timedwait(&timer->changed, &timer->lock, &deadline) == 0 || timer->due < 0 ||
+            esp_timer_get_time() < timer->due)
+        {
+            continue; // Re-armed, stopped or woken early
+        }
+
+        timer->due = -1;
+        pthread_mutex_unlock(&timer->lock);
+        timer->callback(timer->arg);
+        pthread_mutex_lock(&timer->lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    pthread_condattr_t attributes;
+    pthread_t thread;
+
+    if (timer == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_timer_get_time(); // Sets bootTime
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->due = -1;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer->changed, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_create(&thread, NULL, FakeTimer_Thread, timer);
+    pthread_detach(thread);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    esp_err_t result = ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_lock(&timer->lock);
+    if (timer->due < 0)
+    {
+        timer->due = esp_timer_get_time() + (int64_t)timeout_us;
+        pthread_cond_signal(&timer->changed);
+        result = ESP_OK;
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return result;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t result = ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_lock(&timer->lock);
+    if (timer->due >= 0)
+    {
+        timer->due = -1;
+        pthread_cond_signal(&timer->changed);
+        result = ESP_OK;
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return result;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    static const struct
+    {
+        esp_err_t code;
+        const char *name;
+    } errorNames[] = {
+        {ESP_OK, "ESP_OK"},
+        {ESP_FAIL, "ESP_FAIL"},
+        {ESP_ERR_NO_MEM, "ESP_ERR_NO_MEM"},
+        {ESP_ERR_INVALID_ARG, "ESP_ERR_INVALID_ARG"},
+        {ESP_ERR_INVALID_STATE, "ESP_ERR_INVALID_STATE"},
+        {ESP_ERR_INVALID_SIZE, "ESP_ERR_INVALID_SIZE"},
+        {ESP_ERR_NOT_FOUND, "ESP_ERR_NOT_FOUND"},
+        {ESP_ERR_TIMEOUT, "ESP_ERR_TIMEOUT"},
+        {ESP_ERR_NVS_NOT_INITIALIZED, "ESP_ERR_NVS_NOT_INITIALIZED"},
+        {ESP_ERR_NVS_NOT_FOUND, "ESP_ERR_NVS_NOT_FOUND"},
+        {ESP_ERR_NVS_TYPE_MISMATCH, "ESP_ERR_NVS_TYPE_MISMATCH"},
+        {ESP_ERR_NVS_READ_ONLY, "ESP_ERR_NVS_READ_ONLY"},
+        {ESP_ERR_NVS_NOT_ENOUGH_SPACE, "ESP_ERR_NVS_NOT_ENOUGH_SPACE"},
+        {ESP_ERR_NVS_INVALID_HANDLE, "ESP_ERR_NVS_INVALID_HANDLE"},
+        {ESP_ERR_NVS_KEY_TOO_LONG, "ESP_ERR_NVS_KEY_TOO_LONG"},
+        {ESP_ERR_NVS_INVALID_LENGTH, "ESP_ERR_NVS_INVALID_LENGTH"},
+    };
+
+    for (size_t i = 0; i < sizeof(errorNames) / sizeof(errorNames[0]); i++)
+    {
+        if (errorNames[i].code == code)
+        {
+            return errorNames[i].name;
+        }
+    }
+    return "UNKNOWN ERROR";
+}
+
+void esp_restart(void)
+{
+    fflush(stdout);
+    exit(0);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    long used = atomic_load_explicit(&heapUsed, memory_order_relaxed);
+    size_t freeSize = used <= 0 ? FAKE_HEAP_SIZE : used < FAKE_HEAP_SIZE ? FAKE_HEAP_SIZE - (size_t)used : 0;
+
+    if (freeSize < heapMinimum)
+    {
+        heapMinimum = freeSize;
+    }
+    return freeSize;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    heap_caps_get_free_size(caps);
+    return heapMinimum;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+// Default hooks, replaced by any module that defines its own
+__attribute__((weak)) void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+}
+
+__attribute__((weak)) void esp_heap_trace_free_hook(void *ptr)
+{
+}
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+// Account a block the program takes (sign 1) or gives back (sign -1)
+static void FakeHeap_Account(void *ptr, long sign)
+{
+    atomic_fetch_add_explicit(&heapUsed, sign * (long)malloc_usable_size(ptr), memory_order_relaxed);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    if (ptr != NULL)
+    {
+        FakeHeap_Account(ptr, 1);
+        esp_heap_trace_alloc_hook(ptr, size, MALLOC_CAP_DEFAULT);
+    }
+    return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *ptr = __real_calloc(count, size);
+    if (ptr != NULL)
+    {
+        FakeHeap_Account(ptr, 1);
+        esp_heap_trace_alloc_hook(ptr, count * size, MALLOC_CAP_DEFAULT);
+    }
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    size_t previous = ptr != NULL ? malloc_usable_size(ptr) : 0;
+    void *resized = __real_realloc(ptr, size);
+    if (resized != NULL)
+    {
+        if (ptr != NULL)
+        {
+            atomic_fetch_sub_explicit(&heapUsed, (long)previous, memory_order_relaxed);
+            esp_heap_trace_free_hook(ptr);
+        }
+        FakeHeap_Account(resized, 1);
+        esp_heap_trace_alloc_hook(resized, size, MALLOC_CAP_DEFAULT);
+    }
+    return resized;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        FakeHeap_Account(ptr, -1);
+        esp_heap_trace_free_hook(ptr);
+    }
+    __real_free(ptr);
+}
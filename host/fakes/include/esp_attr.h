@@ -0,0 +1,19 @@
+/******************************************************************************
+ * @file        esp_attr.h
+ * @brief       Host fake of the ESP-IDF memory placement attributes.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define DMA_ATTR
+
+#endif // ESP_ATTR_H
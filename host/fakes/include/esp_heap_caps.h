@@ -0,0 +1,36 @@
+/******************************************************************************
+ * @file        esp_heap_caps.h
+ * @brief       Host fake of the heap_caps statistics, backed by mallinfo2.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * The host heap grows on demand, so the figures only show trends: free size is the
+ * free memory held by the allocator and the largest block is approximated by it.
+ * malloc, calloc, realloc and free are wrapped at link time (-Wl,--wrap) to call the
+ * allocation hooks, so code linked into the host build sees the same hooks as on the
+ * device. Allocations made inside shared libraries are not seen.
+ ******************************************************************************/
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+// Allocation hooks, called by the host malloc wrappers as CONFIG_HEAP_USE_HOOKS does
+void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps);
+void esp_heap_trace_free_hook(void *ptr);
+
+#endif // ESP_HEAP_CAPS_H
@@ -0,0 +1,17 @@
+/******************************************************************************
+ * @file        esp_mac.h
+ * @brief       Host fake of the MAC address API.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef ESP_MAC_H
+#define ESP_MAC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#endif // ESP_MAC_H
@@ -0,0 +1,24 @@
+/******************************************************************************
+ * @file        esp_system.h
+ * @brief       Host fake of the ESP-IDF system API.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Ends the host process, the fake NVS file survives like the flash would.
+ */
+void esp_restart(void);
+
+uint32_t esp_get_free_heap_size(void);
+
+#endif // ESP_SYSTEM_H
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * @file        esp_timer.h
+ * @brief       Host fake of esp_timer: the clock and one-shot timers.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+/**
+ * @brief Microseconds since the host process started.
+ */
+int64_t esp_timer_get_time(void);
+
+/**
+ * @brief Creates a timer served by its own thread; the callback runs on that thread.
+ */
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+
+/**
+ * @brief Arms the timer to expire once after timeout_us.
+ *
+ * @return ESP_ERR_INVALID_STATE if it is already armed, as on the device.
+ */
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+
+/**
+ * @brief Disarms the timer.
+ *
+ * @return ESP_ERR_INVALID_STATE if it was not armed.
+ */
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * @file        FreeRTOS.h
+ * @brief       Host fake of the FreeRTOS base types, running tasks on pthreads.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * The fake keeps the FreeRTOS names and tick arithmetic of the firmware. Tasks are
+ * threads scheduled by the host, priorities are recorded but not enforced, and
+ * critical sections are recursive mutexes rather than interrupt masking.
+ ******************************************************************************/
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define configSTACK_DEPTH_TYPE uint32_t
+#define configASSERT(x) ((void)(x))
+#define portNUM_PROCESSORS CONFIG_FREERTOS_NUMBER_OF_CORES
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks) ((TickType_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+#define errQUEUE_EMPTY 0
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7fffffff
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+// Core the calling task is pinned to, 0 for tasks without affinity
+BaseType_t xPortGetCoreID(void);
+
+// Storage for statically created objects; the fake keeps its state elsewhere
+typedef struct
+{
+    void *object;
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct
+{
+    void *object;
+} StaticTask_t;
+
+// Spinlocks become recursive mutexes, ESP-IDF portMUX is recursive too
+typedef struct
+{
+    pthread_mutex_t lock;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP}
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(&(mux)->lock)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(&(mux)->lock)
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux) portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+#endif // FREERTOS_H
@@ -0,0 +1,19 @@
+/******************************************************************************
+ * @file        event_groups.h
+ * @brief       Host fake of the FreeRTOS event group types.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+typedef struct fakeEventGroup *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#endif // EVENT_GROUPS_H
@@ -0,0 +1,29 @@
+/******************************************************************************
+ * @file        semphr.h
+ * @brief       Host fake of the FreeRTOS semaphore API, built on the fake queues.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+
+#define xSemaphoreCreateMutexStatic(buffer) ((void)(buffer), xSemaphoreCreateMutex())
+#define xSemaphoreCreateBinaryStatic(buffer) ((void)(buffer), xSemaphoreCreateBinary())
+#define xSemaphoreTake(semaphore, ticksToWait) xQueueReceive(semaphore, NULL, ticksToWait)
+#define xSemaphoreGive(semaphore) xQueueSend(semaphore, NULL, 0)
+#define xSemaphoreGiveFromISR(semaphore, woken) xQueueSendFromISR(semaphore, NULL, woken)
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+
+#endif // SEMPHR_H
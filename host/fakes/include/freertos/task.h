@@ -0,0 +1,58 @@
+/******************************************************************************
+ * @file        task.h
+ * @brief       Host fake of the FreeRTOS task API.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct fakeTask *TaskHandle_t;
+
+typedef enum
+{
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid,
+} eTaskState;
+
+typedef struct
+{
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter; // Thread CPU time in microseconds
+    StackType_t *pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark; // Not measurable on the host, always 0
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *createdTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, StackType_t *stack, StaticTask_t *taskBuffer);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char *name, configSTACK_DEPTH_TYPE stackDepth, void *parameters, UBaseType_t priority, StackType_t *stack, StaticTask_t *taskBuffer, BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement);
+#define vTaskDelayUntil(previousWakeTime, timeIncrement) ((void)xTaskDelayUntil(previousWakeTime, timeIncrement))
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *taskStatusArray, UBaseType_t arraySize, uint32_t *totalRunTime);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#endif // TASK_H
@@ -0,0 +1,26 @@
+/******************************************************************************
+ * @file        nvs_flash.h
+ * @brief       Host fake of the NVS partition API, backed by a file.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ ******************************************************************************/
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+#include "nvs.h"
+
+/**
+ * @brief Loads the fake partition from the file named by FakeNvs_SetPath.
+ */
+esp_err_t nvs_flash_init(void);
+
+/**
+ * @brief Clears the fake partition and its file.
+ */
+esp_err_t nvs_flash_erase(void);
+
+#endif // NVS_FLASH_H
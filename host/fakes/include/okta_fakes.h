@@ -0,0 +1,138 @@
+/******************************************************************************
+ * @file        okta_fakes.h
+ * @brief       Control and inspection API of the host fakes.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * The host build replaces the ESP-IDF drivers the application modules use with
+ * fakes: a GPIO register model, a shift register chain on SPI, a file-backed NVS
+ * partition and an in-process MQTT broker. This header exposes their state to the
+ * simulator and to load tools, which play the role of the wiring, the flash chip and
+ * the remote MQTT clients.
+ ******************************************************************************/
+#ifndef OKTA_FAKES_H
+#define OKTA_FAKES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driver/gpio.h"
+
+#define FAKE_NVS_DEFAULT_PATH "okta_nvs.txt" // Partition file when none is set
+#define FAKE_NVS_MAX_ENTRIES 128             // Keys across all namespaces
+#define FAKE_NVS_VALUE_LENGTH 512            // Largest string or blob value
+#define FAKE_BROKER_MAX_CLIENTS 8            // Connected clients, firmware and tools
+#define FAKE_BROKER_MAX_SUBSCRIPTIONS 32     // Subscriptions across all clients
+#define FAKE_BROKER_MAX_OBSERVERS 8          // Tool callbacks on published messages
+#define FAKE_BROKER_INBOX_SIZE 64            // Messages queued per client before drops
+#define FAKE_BROKER_MAX_RETAINED 16          // Topics with a retained message
+#define FAKE_BROKER_TOPIC_LENGTH 128         // Largest topic
+#define FAKE_BROKER_PAYLOAD_LENGTH 1024      // Largest payload
+#define FAKE_HEAP_SIZE (64 * 1024 * 1024)    // Heap reported by heap_caps, used bytes are subtracted
+#define FAKE_SPI_CHAIN_CHIPS 16              // Shift registers modelled behind every SPI device
+
+/**
+ * @brief Called for every message published to a topic matching an observer filter.
+ *
+ * @details
+ * Observers run on the publishing task, so they see a message at the instant the
+ * firmware hands it to the client.
+ */
+typedef void (*fakeBrokerObserver)(const char *topic, const char *data, int dataLength, void *context);
+
+// ---- GPIO register model ----------------------------------------------------
+
+/**
+ * @brief Returns the output register, bit n is the level driven on GPIO n.
+ */
+uint64_t FakeGpio_GetOutputs(void);
+
+/**
+ * @brief Returns the output-enable register, bit n is set when GPIO n is an output.
+ */
+uint64_t FakeGpio_GetEnabled(void);
+
+/**
+ * @brief Returns the number of level changes driven on a pin since start.
+ */
+uint32_t FakeGpio_GetEdgeCount(gpio_num_t pin);
+
+/**
+ * @brief Returns the esp_timer time of the last level change of a pin, 0 if none.
+ */
+int64_t FakeGpio_GetLastEdgeTime(gpio_num_t pin);
+
+/**
+ * @brief Drives the input level of a pin, as the external circuit would.
+ */
+void FakeGpio_SetInput(gpio_num_t pin, bool level);
+
+// ---- SPI shift register chain ----------------------------------------------
+
+/**
+ * @brief Returns the latched outputs of one chip of the chain, bit 0 on QA.
+ *
+ * @param chip (size_t): Position in the chain, 0 nearest the ESP32.
+ */
+uint8_t FakeSpi_GetChipOutputs(size_t chip);
+
+/**
+ * @brief Returns the number of SPI transactions since start.
+ */
+uint32_t FakeSpi_GetTransactionCount(void);
+
+// ---- NVS partition ----------------------------------------------------------
+
+/**
+ * @brief Selects the partition file, must be called before nvs_flash_init.
+ */
+void FakeNvs_SetPath(const char *path);
+
+/**
+ * @brief Returns the number of nvs_commit calls that reached the file.
+ */
+uint32_t FakeNvs_GetCommitCount(void);
+
+// ---- MQTT broker ------------------------------------------------------------
+
+/**
+ * @brief Publishes a message as a remote client would.
+ *
+ * @return int: Number of subscribed clients the message was queued for.
+ */
+int FakeBroker_Publish(const char *topic, const char *data, int dataLength);
+
+/**
+ * @brief Registers an observer on a topic filter, MQTT wildcards + and # allowed.
+ *
+ * @return bool: false when all observer slots are used.
+ */
+bool FakeBroker_Observe(const char *filter, fakeBrokerObserver observer, void *context);
+
+/**
+ * @brief Copies the message the broker retains for a topic.
+ *
+ * @param topic (const char *): The topic, no wildcards.
+ * @param data (char *): Receives the payload, null-terminated.
+ * @param dataSize (size_t): Size of the data buffer.
+ *
+ * @return int: Length of the payload, -1 if the topic has no retained message.
+ */
+int FakeBroker_GetRetained(const char *topic, char *data, size_t dataSize);
+
+/**
+ * @brief Returns the number of messages dropped because a client inbox was full.
+ */
+uint32_t FakeBroker_GetDroppedCount(void);
+
+/**
+ * @brief Returns the number of messages queued to clients and not yet handled.
+ */
+uint32_t FakeBroker_GetPendingCount(void);
+
+#endif // OKTA_FAKES_H
@@ -0,0 +1,32 @@
+/******************************************************************************
+ * @file        sdkconfig.h
+ * @brief       Host build configuration, the subset of sdkconfig the modules read.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * Mirrors the values of the project sdkconfig that change module behaviour, so the
+ * host build takes the same code paths as the firmware.
+ ******************************************************************************/
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY 1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 1
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
+#define CONFIG_HEAP_USE_HOOKS 1
+#define CONFIG_MQTT_TASK_CORE_SELECTION_ENABLED 1
+#define CONFIG_MQTT_USE_CORE_1 1
+#define CONFIG_OKTA_BOARD_OKTA_T 1
+#define CONFIG_OKTA_LOCAL_API 1
+#define CONFIG_OKTA_LOCAL_API_PORT 8080
+#define CONFIG_HTTPD_WS_SUPPORT 1
+
+#endif // SDKCONFIG_H
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * @file        host_kit.c
+ * @brief       Boot sequence of a simulated kit, shared by the host programs.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+#include "okta_fakes.h"
+#include "Relay_module.h"
+#include "Schedule_module.h"
+#include "Shadow_module.h"
+#include "Http_module.h"
+#include "MQTT_module.h"
+#include "LOG_module.h"
+#include "JSON_module.h"
+#include "DIAG_module.h"
+#include "Command_module.h"
+#include "Topic_module.h"
+#include "TRACE_module.h"
+#include "Reconfig_module.h"
+#include "Event_module.h"
+#include "Rule_module.h"
+#include "host_kit.h"
+
+static credentialConfig *kitConfig;
+
+static void HostKit_Received(const appEvent *event, void *context)
+{
+    topicId topic;
+
+    if (!Topic_Find(event->mqttData.topic, event->mqttData.topicLength, &topic) || topic == TOPIC_RULES_TYPE)
+    {
+        TRACE_End(NULL);
+        return;
+    }
+    Command_HandleRelayMessage(topic, event->mqttData.data, event->mqttData.dataLength);
+}
+
+// The host link is always up, Wi-Fi credentials are only compared and stored
+static bool HostKit_ApplyWifi(const char *ssid, const char *password, TickType_t timeout)
+{
+    return true;
+}
+
+void HostKit_Start(const char *nvsPath, credentialConfig *config)
+{
+    kitConfig = config;
+    FakeNvs_SetPath(nvsPath);
+
+    // Same order as app_main
+    LOG_Init();
+    JSON_Init();
+    ESP_ERROR_CHECK(nvs_flash_init());
+    RetrieveConfigFromStorage(config);
+    Rule_Load();
+
+    // Subscribers before publishers
+    Reconfig_Start(config, HostKit_ApplyWifi);
+    Event_Subscribe(EVENT_MQTT_DATA, HostKit_Received, NULL);
+    Http_Start();                         // On HTTP_PORT of the host
+    Shadow_Start(TOPIC_RELAY_TYPE, NULL); // No Wi-Fi on the host, link metrics read 0
+
+    Relay_Init();
+    Relay_RetDataState();
+    Schedule_Start();
+    Reconfig_Connect();
+    DIAG_Start(TOPIC_DIAG_TYPE);
+
+    HostKit_WaitIdle(); // Connected and subscribed before returning
+}
+
+void HostKit_WaitIdle(void)
+{
+    while (FakeBroker_GetPendingCount() != 0)
+    {
+        vTaskDelay(1);
+    }
+}
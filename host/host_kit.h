@@ -0,0 +1,36 @@
+/******************************************************************************
+ * @file        host_kit.h
+ * @brief       Boot sequence of a simulated kit, shared by the host programs.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * Starts the application modules the way app_main does, without BLE and Wi-Fi: the
+ * NVS partition, the relays, the stored configuration, the MQTT client on the
+ * in-process broker, the diagnostics and shadow tasks and the local API.
+ ******************************************************************************/
+#ifndef HOST_KIT_H
+#define HOST_KIT_H
+
+#include "DataHandle.h"
+
+/**
+ * @brief Boots the kit and waits until it is subscribed to its relay topic.
+ *
+ * @param nvsPath (const char *): NVS partition file of the kit.
+ * @param config (credentialConfig *): Receives the stored configuration. Fields set
+ * before the call and missing from storage are kept, which lets tools choose a relay
+ * topic for an unprovisioned kit. The structure must outlive the kit.
+ */
+void HostKit_Start(const char *nvsPath, credentialConfig *config);
+
+/**
+ * @brief Waits until every queued MQTT event has been handled.
+ */
+void HostKit_WaitIdle(void);
+
+#endif // HOST_KIT_H
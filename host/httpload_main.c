@@ -0,0 +1,435 @@
+/******************************************************************************
+ * @file        httpload_main.c
+ * @brief       Host load test of the local HTTP and WebSocket relay API.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Boots a simulated kit, whose local API listens on HTTP_PORT of the host, and
+ * connects to it over TCP as a local client would. Three paths are measured one
+ * after the other, each printing one JSON line:
+ * {"path":"p","sent":n,"ok":a,"failed":f,"p50_us":x,"p90_us":x,"p99_us":x,"max_us":x}
+ * - http: POST /relays on one keep-alive connection, request to response.
+ * - ws: command frames on a WebSocket, frame to result frame.
+ * - push: a command over HTTP to the shadow push on a second WebSocket, which
+ *   includes SHADOW_SETTLE_MS; -p sets how many of them are sent.
+ * Commands toggle the relays in turn, so every one changes the bank. The program
+ * exits with status 2 when a command fails or a push does not arrive.
+ *
+ * Usage: okta_httpload [-n nvs] [-c commands] [-p pushes]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "esp_timer.h"
+#include "DataHandle.h"
+#include "LOG_module.h"
+#include "Relay_module.h"
+#include "Command_module.h"
+#include "Shadow_module.h"
+#include "Http_module.h"
+#include "host_kit.h"
+
+#define HTTPLOAD_DEFAULT_COMMANDS 2000     // Commands per path
+#define HTTPLOAD_DEFAULT_PUSHES 50         // Pushes awaited, each takes SHADOW_SETTLE_MS
+#define HTTPLOAD_BUFFER_SIZE 4096          // Received bytes buffered per connection
+#define HTTPLOAD_TIMEOUT_S 2               // Receive timeout, a missing reply fails
+#define HTTPLOAD_RELAYS 8                  // Relays toggled in turn
+
+// One client connection with its receive buffer
+typedef struct
+{
+    int fd;
+    size_t length;
+    char buffer[HTTPLOAD_BUFFER_SIZE];
+} httploadConnection;
+
+typedef struct
+{
+    const char *path;
+    uint32_t sent;
+    uint32_t ok;
+    uint32_t *latency;
+} httploadResult;
+
+static credentialConfig httploadConfig;
+static uint32_t httploadStates = 0;        // Relay states last commanded
+
+static bool Httpload_Connect(httploadConnection *connection)
+{
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(HTTP_PORT)};
+    struct timeval timeout = {.tv_sec = HTTPLOAD_TIMEOUT_S};
+    int one = 1;
+
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connection->length = 0;
+    connection->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connection->fd < 0 || connect(connection->fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        perror("connect");
+        return false;
+    }
+    setsockopt(connection->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(connection->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+static bool Httpload_Send(httploadConnection *connection, const void *data, size_t length)
+{
+    return send(connection->fd, data, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+// Receive more bytes into the buffer, false on timeout or close
+static bool Httpload_Fill(httploadConnection *connection)
+{
+    ssize_t received = recv(connection->fd, connection->buffer + connection->length,
+                            sizeof(connection->buffer) - connection->length - 1, 0);
+    if (received <= 0)
+    {
+        return false;
+    }
+    connection->length += (size_t)received;
+    connection->buffer[connection->length] = '\0';
+    return true;
+}
+
+static void Httpload_Consume(httploadConnection *connection, size_t length)
+{
+    memmove(connection->buffer, connection->buffer + length, connection->length - length);
+    connection->length -= length;
+    connection->buffer[connection->length] = '\0';
+}
+
+// Read one HTTP response, its body null-terminated into body; returns the status code, -1 on error
+static int Httpload_ReadResponse(httploadConnection *connection, char *body, size_t bodySize)
+{
+    char *end;
+    const char *field;
+    size_t headLength, bodyLength = 0;
+    int status = -1;
+
+    while ((end = strstr(connection->buffer, "\r\n\r\n")) == NULL)
+    {
+        if (!Httpload_Fill(connection))
+        {
+            return -1;
+        }
+    }
+    headLength = (size_t)(end - connection->buffer) + 4;
+    sscanf(connection->buffer, "HTTP/1.1 %d", &status);
+    field = strcasestr(connection->buffer, "Content-Length:");
+    if (field != NULL && field < end)
+    {
+        bodyLength = strtoul(field + 15, NULL, 10);
+    }
+    while (connection->length < headLength + bodyLength)
+    {
+        if (!Httpload_Fill(connection))
+        {
+            return -1;
+        }
+    }
+    snprintf(body, bodySize, "%.*s", (int)bodyLength, connection->buffer + headLength);
+    Httpload_Consume(connection, headLength + bodyLength);
+    return status;
+}
+
+// Upgrade the connection to a WebSocket
+static bool Httpload_WsOpen(httploadConnection *connection)
+{
+    static const char request[] = "GET " HTTP_WS_URI " HTTP/1.1\r\nHost: kit\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    char *end;
+
+    if (!Httpload_Connect(connection) || !Httpload_Send(connection, request, sizeof(request) - 1))
+    {
+        return false;
+    }
+    while ((end = strstr(connection->buffer, "\r\n\r\n")) == NULL)
+    {
+        if (!Httpload_Fill(connection))
+        {
+            return false;
+        }
+    }
+    // Accept value of the RFC 6455 example key
+    bool upgraded = strncmp(connection->buffer, "HTTP/1.1 101", 12) == 0 &&
+                    strstr(connection->buffer, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != NULL;
+    Httpload_Consume(connection, (size_t)(end - connection->buffer) + 4);
+    return upgraded;
+}
+
+// Send a masked text frame, as a client must
+static bool Httpload_WsSend(httploadConnection *connection, const char *text)
+{
+    uint8_t frame[8 + COMMAND_PAYLOAD_LENGTH];
+    size_t length = strlen(text);
+    const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    size_t head = 2;
+
+    if (length >= COMMAND_PAYLOAD_LENGTH)
+    {
+        return false;
+    }
+    frame[0] = 0x81; // Final text frame
+    if (length < 126)
+    {
+        frame[1] = (uint8_t)(0x80 | length);
+    }
+    else
+    {
+        frame[1] = 0x80 | 126;
+        frame[2] = (uint8_t)(length >> 8);
+        frame[3] = (uint8_t)length;
+        head = 4;
+    }
+    memcpy(frame + head, mask, sizeof(mask));
+    for (size_t i = 0; i < length; i++)
+    {
+        frame[head + 4 + i] = (uint8_t)text[i] ^ mask[i % 4];
+    }
+    return Httpload_Send(connection, frame, head + 4 + length);
+}
+
+// Read one server frame, its payload null-terminated into text
+static bool Httpload_WsReceive(httploadConnection *connection, char *text, size_t textSize)
+{
+    size_t head = 2, length;
+
+    while (connection->length < 2 || connection->length < (((uint8_t)connection->buffer[1] & 0x7F) == 126 ? 4u : 2u))
+    {
+        if (!Httpload_Fill(connection))
+        {
+            return false;
+        }
+    }
+    length = (uint8_t)connection->buffer[1] & 0x7F;
+    if (length == 126)
+    {
+        length = (size_t)(uint8_t)connection->buffer[2] << 8 | (uint8_t)connection->buffer[3];
+        head = 4;
+    }
+    while (connection->length < head + length)
+    {
+        if (!Httpload_Fill(connection))
+        {
+            return false;
+        }
+    }
+    snprintf(text, textSize, "%.*s", (int)length, connection->buffer + head);
+    Httpload_Consume(connection, head + length);
+    return true;
+}
+
+// Next command: toggle relay sequence % HTTPLOAD_RELAYS + 1
+static void Httpload_Command(char *payload, size_t size, uint32_t sequence)
+{
+    uint32_t relay = sequence % HTTPLOAD_RELAYS;
+
+    httploadStates ^= 1UL << relay;
+    snprintf(payload, size, "{\"relayNo\":%lu,\"state\":%lu,\"id\":%lu}", (unsigned long)relay + 1,
+             (unsigned long)((httploadStates >> relay) & 1UL), (unsigned long)sequence);
+}
+
+static int Httpload_CompareLatency(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t Httpload_Percentile(const uint32_t *sorted, uint32_t count, uint32_t percentile)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)count * percentile + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void Httpload_Print(httploadResult *result)
+{
+    qsort(result->latency, result->ok, sizeof(result->latency[0]), Httpload_CompareLatency);
+    printf("{\"path\":\"%s\",\"sent\":%lu,\"ok\":%lu,\"failed\":%lu,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}\n",
+           result->path, (unsigned long)result->sent, (unsigned long)result->ok, (unsigned long)(result->sent - result->ok),
+           (unsigned long)Httpload_Percentile(result->latency, result->ok, 50),
+           (unsigned long)Httpload_Percentile(result->latency, result->ok, 90),
+           (unsigned long)Httpload_Percentile(result->latency, result->ok, 99),
+           (unsigned long)(result->ok ? result->latency[result->ok - 1] : 0));
+    fflush(stdout);
+}
+
+// POST one command, true if it was applied; the reply goes to body
+static bool Httpload_Post(httploadConnection *connection, const char *payload, char *body, size_t bodySize)
+{
+    char request[256 + COMMAND_PAYLOAD_LENGTH];
+    int length = snprintf(request, sizeof(request), "POST " HTTP_RELAY_URI " HTTP/1.1\r\nHost: kit\r\n"
+                          "Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s", strlen(payload), payload);
+
+    return Httpload_Send(connection, request, (size_t)length) && Httpload_ReadResponse(connection, body, bodySize) == 200 &&
+           strstr(body, "\"ok\":1") != NULL;
+}
+
+static void Httpload_RunHttp(httploadResult *result, uint32_t commands)
+{
+    httploadConnection connection;
+    char payload[96];
+    char body[COMMAND_REPLY_LENGTH];
+
+    result->sent = commands; // All failed unless answered
+    if (!Httpload_Connect(&connection))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < commands; i++)
+    {
+        Httpload_Command(payload, sizeof(payload), i);
+        int64_t start = esp_timer_get_time();
+        if (Httpload_Post(&connection, payload, body, sizeof(body)))
+        {
+            result->latency[result->ok++] = (uint32_t)(esp_timer_get_time() - start);
+        }
+    }
+    close(connection.fd);
+}
+
+static void Httpload_RunWs(httploadResult *result, uint32_t commands)
+{
+    httploadConnection connection;
+    char payload[96];
+    char frame[COMMAND_REPLY_LENGTH + SHADOW_LENGTH];
+
+    result->sent = commands;
+    if (!Httpload_WsOpen(&connection))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < commands; i++)
+    {
+        Httpload_Command(payload, sizeof(payload), i);
+        int64_t start = esp_timer_get_time();
+        if (!Httpload_WsSend(&connection, payload))
+        {
+            break;
+        }
+        // Shadow pushes interleave with the results; a result has no "seq"
+        while (Httpload_WsReceive(&connection, frame, sizeof(frame)))
+        {
+            if (strstr(frame, "\"seq\"") == NULL)
+            {
+                if (strstr(frame, "\"ok\":1") != NULL)
+                {
+                    result->latency[result->ok++] = (uint32_t)(esp_timer_get_time() - start);
+                }
+                break;
+            }
+        }
+    }
+    close(connection.fd);
+}
+
+static void Httpload_RunPush(httploadResult *result, uint32_t pushes)
+{
+    httploadConnection command, watcher;
+    char payload[96];
+    char body[COMMAND_REPLY_LENGTH];
+    char expected[16 + RELAY_HEX_LENGTH];
+    char frame[SHADOW_LENGTH];
+
+    result->sent = pushes;
+    if (!Httpload_Connect(&command) || !Httpload_WsOpen(&watcher) || !Httpload_WsReceive(&watcher, frame, sizeof(frame)))
+    {
+        return; // The greeting is the shadow at connection
+    }
+    for (uint32_t i = 0; i < pushes; i++)
+    {
+        Httpload_Command(payload, sizeof(payload), i);
+        int64_t start = esp_timer_get_time();
+        const char *relays = Httpload_Post(&command, payload, body, sizeof(body)) ? strstr(body, "\"relays\":") : NULL;
+        if (relays == NULL)
+        {
+            continue;
+        }
+        snprintf(expected, sizeof(expected), "%.*s", (int)strcspn(relays + 10, "\"") + 11, relays);
+        while (Httpload_WsReceive(&watcher, frame, sizeof(frame)))
+        {
+            if (strstr(frame, expected) != NULL)
+            {
+                result->latency[result->ok++] = (uint32_t)(esp_timer_get_time() - start);
+                break;
+            }
+        }
+    }
+    close(command.fd);
+    close(watcher.fd);
+}
+
+int main(int argc, char **argv)
+{
+    const char *nvsPath = "okta_httpload.nvs";
+    uint32_t commands = HTTPLOAD_DEFAULT_COMMANDS;
+    uint32_t pushes = HTTPLOAD_DEFAULT_PUSHES;
+    httploadResult results[] = {{"http"}, {"ws"}, {"push"}};
+    bool failed = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:c:p:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            nvsPath = optarg;
+            break;
+        case 'c':
+            commands = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            pushes = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n nvs] [-c commands] [-p pushes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++)
+    {
+        results[i].latency = calloc(commands > pushes ? commands : pushes, sizeof(uint32_t));
+        if (results[i].latency == NULL)
+        {
+            return 1;
+        }
+    }
+
+    HostKit_Start(nvsPath, &httploadConfig);
+    for (int module = 0; module < LOG_MODULE_COUNT; module++)
+    {
+        LOG_SetLevel((logModule)module, ESP_LOG_WARN);
+    }
+    // Start from a known bank, so every command changes a relay
+    Relay_SetGroup(false);
+
+    Httpload_RunHttp(&results[0], commands);
+    Httpload_RunWs(&results[1], commands);
+    Httpload_RunPush(&results[2], pushes);
+
+    for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++)
+    {
+        Httpload_Print(&results[i]);
+        failed |= results[i].ok != results[i].sent;
+    }
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,280 @@
+/******************************************************************************
+ * @file        loadgen_main.c
+ * @brief       Host load generator and soak test of the relay command path.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Boots a simulated kit on the in-process broker and publishes relay commands to
+ * its relay topic at each requested rate, for a fixed duration per step. Every
+ * command carries an id; the matching ack is observed on the broker, which gives the
+ * end-to-end latency from publish to ack. A step ends when the kit has handled every
+ * queued message, and prints one JSON line:
+ * {"rate":r,"mix":"m","seconds":s,"sent":n,"acked":a,"lost":l,"dropped":d,
+ *  "throughput":t,"p50_us":x,"p90_us":x,"p99_us":x,"max_us":x,"heap_min":b,"heap_drift":b}
+ * lost counts commands without an ack, dropped the part of them the broker dropped
+ * because the kit inbox was full. A soak test is a single rate with a long duration.
+ *
+ * Before the first step a short warm-up sends every kind of command of the mix, after
+ * which the free heap is taken as the steady-state baseline. heap_drift is the free
+ * heap lost since then; the program exits with status 2 when it exceeds
+ * LOADGEN_HEAP_DRIFT_LIMIT, so a soak run fails on a leak or on allocations that
+ * the command path keeps.
+ *
+ * Usage: okta_loadgen [-n nvs] [-r rate,rate,...] [-d seconds] [-m set|group|mixed]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "okta_fakes.h"
+#include "DataHandle.h"
+#include "LOG_module.h"
+#include "Command_module.h"
+#include "MQTT_module.h"
+#include "Topic_module.h"
+#include "host_kit.h"
+
+#define LOADGEN_DEFAULT_TOPIC "okta/relay"   // Relay topic of an unprovisioned kit
+#define LOADGEN_DEFAULT_RATES "100,500,1000,2000,5000"
+#define LOADGEN_MAX_COMMANDS 1000000         // Commands tracked per step
+#define LOADGEN_DRAIN_TIMEOUT_US 5000000     // Wait for late acks after a step
+#define LOADGEN_WARMUP_COMMANDS 100          // Commands sent before the heap baseline
+#define LOADGEN_HEAP_DRIFT_LIMIT 0           // Free heap the steady state may lose, in bytes
+
+typedef enum
+{
+    LOADGEN_MIX_SET,   // Single relay commands
+    LOADGEN_MIX_GROUP, // All-relay commands, one write of the whole bank each
+    LOADGEN_MIX_MIXED, // 80% single, 10% group, 10% invalid relay numbers
+} loadgenMix;
+
+static const char *const loadgenMixNames[] = {"set", "group", "mixed"};
+
+static credentialConfig loadgenConfig;
+static const char *loadgenTopic;           // Relay topic of the kit
+static int64_t *loadgenSendTime;           // Publish time of each command id
+static uint32_t *loadgenLatency;           // Latencies of the acks of this step
+static _Atomic uint32_t loadgenAcked;      // Acks received in this step
+static _Atomic int32_t loadgenFirstId;     // First id of this step
+static size_t loadgenBaselineHeap;         // Free heap after the warm-up
+
+// Ack observer, runs on the kit MQTT task when it publishes the ack
+static void Loadgen_OnAck(const char *topic, const char *data, int dataLength, void *context)
+{
+    int64_t now = esp_timer_get_time();
+    char buffer[32];
+    const char *field;
+
+    snprintf(buffer, sizeof(buffer), "%.*s", dataLength < 31 ? dataLength : 31, data);
+    field = strstr(buffer, "\"id\":");
+    if (field == NULL)
+    {
+        return;
+    }
+
+    int32_t index = (int32_t)strtol(field + 5, NULL, 10) - atomic_load(&loadgenFirstId);
+    if (index >= 0 && index < LOADGEN_MAX_COMMANDS && loadgenSendTime[index] != 0)
+    {
+        uint32_t slot = atomic_fetch_add(&loadgenAcked, 1);
+        loadgenLatency[slot] = (uint32_t)(now - loadgenSendTime[index]);
+        loadgenSendTime[index] = 0; // Count duplicates once
+    }
+}
+
+static int Loadgen_CompareLatency(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a, right = *(const uint32_t *)b;
+    return (left > right) - (left < right);
+}
+
+// Nearest-rank percentile of the sorted latencies
+static uint32_t Loadgen_Percentile(const uint32_t *sorted, uint32_t count, uint32_t percentile)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)count * percentile + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Build command 'sequence' of the mix, always with its id
+static int Loadgen_Command(char *payload, size_t payloadSize, loadgenMix mix, uint32_t sequence, int32_t id)
+{
+    uint32_t pick = sequence % 10;
+    int32_t relay = (int32_t)(sequence % 8) + 1;
+    int32_t state = (int32_t)((sequence / 8) & 1);
+
+    if (mix == LOADGEN_MIX_GROUP || (mix == LOADGEN_MIX_MIXED && pick == 8))
+    {
+        relay = 16;
+    }
+    else if (mix == LOADGEN_MIX_MIXED && pick == 9)
+    {
+        relay = 42; // Rejected by the kit, still acked
+    }
+    return snprintf(payload, payloadSize, "{\"relayNo\":%ld,\"state\":%ld,\"id\":%ld}", (long)relay, (long)state, (long)id);
+}
+
+// Send one command of each kind of the mix and set the heap baseline
+static void Loadgen_WarmUp(loadgenMix mix, int32_t *nextId)
+{
+    char payload[COMMAND_PAYLOAD_LENGTH];
+
+    for (uint32_t i = 0; i < LOADGEN_WARMUP_COMMANDS; i++)
+    {
+        int length = Loadgen_Command(payload, sizeof(payload), mix, i, (*nextId)++);
+        FakeBroker_Publish(loadgenTopic, payload, length);
+        HostKit_WaitIdle();
+    }
+    loadgenBaselineHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+// Run one step at a fixed rate and print its line, returns the heap drift
+static long Loadgen_Step(uint32_t rate, uint32_t seconds, loadgenMix mix, int32_t *nextId)
+{
+    char payload[COMMAND_PAYLOAD_LENGTH];
+    uint64_t planned = (uint64_t)rate * seconds;
+    uint32_t total = planned < LOADGEN_MAX_COMMANDS ? (uint32_t)planned : LOADGEN_MAX_COMMANDS;
+    uint32_t droppedBefore = FakeBroker_GetDroppedCount();
+
+    memset(loadgenSendTime, 0, LOADGEN_MAX_COMMANDS * sizeof(loadgenSendTime[0]));
+    atomic_store(&loadgenAcked, 0);
+    atomic_store(&loadgenFirstId, *nextId);
+
+    // Open-loop pacing: command i is due at start + i / rate, late sends are not skipped
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < total; i++)
+    {
+        int64_t due = start + (int64_t)i * 1000000 / rate;
+        int64_t now = esp_timer_get_time();
+        if (due > now)
+        {
+            usleep((useconds_t)(due - now));
+        }
+
+        int length = Loadgen_Command(payload, sizeof(payload), mix, i, *nextId + (int32_t)i);
+        loadgenSendTime[i] = esp_timer_get_time();
+        if (FakeBroker_Publish(loadgenTopic, payload, length) <= 0)
+        {
+            loadgenSendTime[i] = 0; // Dropped by the broker, never acked
+        }
+    }
+    int64_t sendEnd = esp_timer_get_time();
+
+    // Let the kit catch up before counting losses
+    while (FakeBroker_GetPendingCount() != 0 && esp_timer_get_time() - sendEnd < LOADGEN_DRAIN_TIMEOUT_US)
+    {
+        vTaskDelay(1);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    *nextId += (int32_t)total;
+
+    uint32_t acked = atomic_load(&loadgenAcked);
+    long drift = (long)loadgenBaselineHeap - (long)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    qsort(loadgenLatency, acked, sizeof(loadgenLatency[0]), Loadgen_CompareLatency);
+
+    printf("{\"rate\":%lu,\"mix\":\"%s\",\"seconds\":%.2f,\"sent\":%lu,\"acked\":%lu,\"lost\":%lu,\"dropped\":%lu,"
+           "\"throughput\":%.1f,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu,\"heap_min\":%lu,\"heap_drift\":%ld}\n",
+           (unsigned long)rate, loadgenMixNames[mix], elapsed / 1e6, (unsigned long)total, (unsigned long)acked,
+           (unsigned long)(total - acked), (unsigned long)(FakeBroker_GetDroppedCount() - droppedBefore),
+           acked * 1e6 / elapsed, (unsigned long)Loadgen_Percentile(loadgenLatency, acked, 50),
+           (unsigned long)Loadgen_Percentile(loadgenLatency, acked, 90),
+           (unsigned long)Loadgen_Percentile(loadgenLatency, acked, 99),
+           (unsigned long)(acked ? loadgenLatency[acked - 1] : 0),
+           (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), drift);
+    fflush(stdout);
+    return drift;
+}
+
+int main(int argc, char **argv)
+{
+    const char *nvsPath = "okta_loadgen.nvs";
+    char rates[256] = LOADGEN_DEFAULT_RATES;
+    uint32_t seconds = 5;
+    loadgenMix mix = LOADGEN_MIX_SET;
+    int32_t nextId = 1;
+    long worstDrift = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:r:d:m:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            nvsPath = optarg;
+            break;
+        case 'r':
+            snprintf(rates, sizeof(rates), "%s", optarg);
+            break;
+        case 'd':
+            seconds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            mix = strcmp(optarg, "group") == 0 ? LOADGEN_MIX_GROUP : strcmp(optarg, "mixed") == 0 ? LOADGEN_MIX_MIXED : LOADGEN_MIX_SET;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n nvs] [-r rate,rate,...] [-d seconds] [-m set|group|mixed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    loadgenSendTime = calloc(LOADGEN_MAX_COMMANDS, sizeof(loadgenSendTime[0]));
+    loadgenLatency = calloc(LOADGEN_MAX_COMMANDS, sizeof(loadgenLatency[0]));
+    if (loadgenSendTime == NULL || loadgenLatency == NULL || seconds == 0)
+    {
+        return 1;
+    }
+
+    HostKit_Start(nvsPath, &loadgenConfig);
+
+    // An unprovisioned kit listens on the default topic, which is not stored
+    if (Topic_Get(TOPIC_RELAY_TYPE)[0] == '\0')
+    {
+        Topic_Stage();
+        Topic_StageSet(TOPIC_RELAY_TYPE, LOADGEN_DEFAULT_TOPIC);
+        Topic_Activate();
+        MQTT_Subscribe(LOADGEN_DEFAULT_TOPIC);
+        HostKit_WaitIdle();
+    }
+    loadgenTopic = Topic_Get(TOPIC_RELAY_TYPE);
+    for (int module = 0; module < LOG_MODULE_COUNT; module++)
+    {
+        LOG_SetLevel((logModule)module, ESP_LOG_WARN);
+    }
+
+    char ackTopic[TOPIC_MAX_LENGTH + sizeof(ACK_TOPIC_SUFFIX)];
+    snprintf(ackTopic, sizeof(ackTopic), "%s" ACK_TOPIC_SUFFIX, loadgenTopic);
+    FakeBroker_Observe(ackTopic, Loadgen_OnAck, NULL);
+    Loadgen_WarmUp(mix, &nextId);
+
+    for (char *rate = strtok(rates, ","); rate != NULL; rate = strtok(NULL, ","))
+    {
+        uint32_t value = (uint32_t)strtoul(rate, NULL, 10);
+        if (value != 0)
+        {
+            long drift = Loadgen_Step(value, seconds, mix, &nextId);
+            worstDrift = drift > worstDrift ? drift : worstDrift;
+        }
+    }
+
+    if (worstDrift > LOADGEN_HEAP_DRIFT_LIMIT)
+    {
+        fprintf(stderr, "heap not flat: %ld bytes lost after the warm-up (limit %d)\n", worstDrift, LOADGEN_HEAP_DRIFT_LIMIT);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * @file        sim_main.c
+ * @brief       Host simulator of the kit: application modules over the host fakes.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Boots the same modules as app_main, minus BLE and Wi-Fi, against the fake GPIO,
+ * NVS and MQTT broker, then reads commands from stdin:
+ *   pub <topic> <payload>   publish as a remote client
+ *   config <json>           apply a provisioning message, as received over BLE
+ *   relays                  show the relay state mask and the GPIO register model
+ *   diag                    print the latest diagnostics report
+ *   quit                    exit, the NVS file keeps the committed state
+ * The first argument selects the NVS file, so several kits can be simulated side by
+ * side and a restart is simply running the simulator again.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "okta_fakes.h"
+#include "DataHandle.h"
+#include "Relay_module.h"
+#include "LOG_module.h"
+#include "DIAG_module.h"
+#include "host_kit.h"
+
+#define SIM_LINE_LENGTH 1024
+
+static credentialConfig simConfig;
+
+static const gpio_num_t simRelayPins[] = BOARD_RELAY_PINS;
+
+// Print what goes over the broker, both directions
+static void Sim_Observe(const char *topic, const char *data, int dataLength, void *context)
+{
+    printf("> %s %.*s\n", topic, dataLength, data);
+}
+
+static void Sim_PrintRelays(void)
+{
+    printf("mask=0x%02lx gpio=0x%016llx\n", (unsigned long)Relay_GetStateMask(), (unsigned long long)FakeGpio_GetOutputs());
+    for (size_t i = 0; i < sizeof(simRelayPins) / sizeof(simRelayPins[0]); i++)
+    {
+        printf("relay %u pin %d level %d edges %lu\n", (unsigned)(i + 1), simRelayPins[i], gpio_get_level(simRelayPins[i]),
+               (unsigned long)FakeGpio_GetEdgeCount(simRelayPins[i]));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static char line[SIM_LINE_LENGTH];
+    static char report[DIAG_REPORT_LENGTH];
+
+    HostKit_Start(argc > 1 ? argv[1] : FAKE_NVS_DEFAULT_PATH, &simConfig);
+    FakeBroker_Observe("#", Sim_Observe, NULL);
+
+    printf("relay topic \"%s\", commands: pub, config, relays, diag, quit\n", Topic_Get(TOPIC_RELAY_TYPE));
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (strncmp(line, "pub ", 4) == 0)
+        {
+            char *topic = line + 4;
+            char *payload = strchr(topic, ' ');
+            payload = (payload != NULL) ? (*payload++ = '\0', payload) : "";
+            FakeBroker_Publish(topic, payload, (int)strlen(payload));
+            HostKit_WaitIdle();
+        }
+        else if (strncmp(line, "config ", 7) == 0)
+        {
+            credentialConfig staged = {0};
+            DataErrorHandle result = GetDataAtRunTime(line + 7, &staged);
+            DisplyGetError(result);
+            printf("config result %d\n", (int)result);
+        }
+        else if (strcmp(line, "relays") == 0)
+        {
+            Sim_PrintRelays();
+        }
+        else if (strcmp(line, "diag") == 0)
+        {
+            DIAG_GetReport(report, sizeof(report));
+            printf("%s\n", report);
+        }
+        else if (strcmp(line, "quit") == 0)
+        {
+            break;
+        }
+        else if (line[0] != '\0')
+        {
+            printf("unknown command\n");
+        }
+        fflush(stdout);
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(2 * LOG_DRAIN_PERIOD_MS)); // Let the log drain
+    return 0;
+}
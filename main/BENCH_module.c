@@ -0,0 +1,256 @@
+/******************************************************************************
+ * @file        BENCH_module.c
+ * @brief       Microbenchmarks of the configuration, JSON and relay command paths.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Each benchmark runs one warm-up call, then times a batch of calls with
+ * esp_timer and divides by the batch size. Heap allocations are counted by the
+ * ESP-IDF heap hooks, filtered to the benchmark task so Wi-Fi and MQTT traffic on
+ * other tasks does not leak into the figures; the host build calls the same hooks
+ * from its malloc wrappers. Flash commits come from the memory module counter.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "DataHandle.h"
+#include "JSON_module.h"
+#include "Memory_module.h"
+#include "Relay_module.h"
+#include "SensorRegistry_module.h"
+#include "Topic_module.h"
+#include "Rule_module.h"
+#include "BENCH_module.h"
+
+#define BENCH_PAYLOAD_LENGTH 576       // Largest generated configuration message
+#define BENCH_RULE_PAYLOAD_LENGTH 1536 // RULE_MAX_RULES generated rules
+
+static TaskHandle_t benchTask = NULL;     // Task whose allocations are counted
+static _Atomic uint32_t benchAllocations; // Allocations made by benchTask
+
+// Inputs of the benchmarks, prepared once from the stored configuration
+static credentialConfig benchConfig;
+static char benchWifiPayload[BENCH_PAYLOAD_LENGTH];
+static char benchMqttPayload[BENCH_PAYLOAD_LENGTH];
+static char benchTopicPayload[BENCH_PAYLOAD_LENGTH];
+static char benchBundlePayload[BENCH_PAYLOAD_LENGTH];
+static char benchPayload[BENCH_PAYLOAD_LENGTH]; // GetDataAtRunTime may modify its input
+static const char *benchSource;                 // Payload copied into benchPayload
+static uint32_t benchRelayMask;
+static bool benchRelayStates[RELAY_MAX_COUNT]; // Put back after the relay benchmarks
+static uint32_t benchRelayToggles;             // Every relay benchmark iteration is a change
+static char benchRulePayload[BENCH_RULE_PAYLOAD_LENGTH];
+static sensorReading benchReading;
+
+#if CONFIG_HEAP_USE_HOOKS
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    if (benchTask != NULL && xTaskGetCurrentTaskHandle() == benchTask)
+    {
+        atomic_fetch_add_explicit(&benchAllocations, 1, memory_order_relaxed);
+    }
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+}
+#endif
+
+static void BENCH_GetDataAtRunTime(void)
+{
+    credentialConfig config = benchConfig;
+
+    strcpy(benchPayload, benchSource);
+    GetDataAtRunTime(benchPayload, &config);
+}
+
+static void BENCH_ExtractString(void)
+{
+    char ssid[WIFI_CRED_LENGTH];
+    JSON_ExtractString(benchWifiPayload, "wifissid", ssid, sizeof(ssid));
+}
+
+static void BENCH_ExtractInt32(void)
+{
+    int32_t port;
+    JSON_ExtractInt32(benchMqttPayload, "mqttport", &port);
+}
+
+static void BENCH_RetrieveConfig(void)
+{
+    credentialConfig config;
+    RetrieveConfigFromStorage(&config);
+}
+
+static void BENCH_RelaySet(void)
+{
+    Relay_Set(1, ++benchRelayToggles & 1UL);
+}
+
+static void BENCH_RelaySetGroup(void)
+{
+    Relay_SetGroup(++benchRelayToggles & 1UL);
+}
+
+static void BENCH_RuleEvaluate(void)
+{
+    Rule_Evaluate(0, &benchReading);
+}
+
+// Compile RULE_MAX_RULES rules on the first sensor, all true and asking for the current state of relay 1
+static bool BENCH_PrepareRules(void)
+{
+    const sensorDriver *driver = SensorRegistry_Get(0);
+    int length = snprintf(benchRulePayload, sizeof(benchRulePayload), "{\"rules\":[");
+
+    if (driver == NULL)
+    {
+        return false;
+    }
+    for (int i = 0; i < RULE_MAX_RULES && length > 0 && (size_t)length < sizeof(benchRulePayload); i++)
+    {
+        length += snprintf(benchRulePayload + length, sizeof(benchRulePayload) - length,
+                           "%s{\"sensor\":\"%s\",\"op\":\">=\",\"value\":%d,\"hyst\":1,\"relayNo\":1,\"state\":%lu}",
+                           i ? "," : "", driver->name, -i, (unsigned long)(benchRelayMask & 1UL));
+    }
+    if (length <= 0 || (size_t)length + sizeof("]}") > sizeof(benchRulePayload))
+    {
+        return false;
+    }
+    strcpy(benchRulePayload + length, "]}");
+
+    // Activated only, the stored rules are reloaded afterwards
+    benchReading.value = 0;
+    return Rule_Apply(benchRulePayload);
+}
+
+// Format total / iterations with two decimals, without floating point printf
+static void BENCH_FormatRatio(char *out, size_t outSize, uint32_t total, uint32_t iterations)
+{
+    uint64_t hundredths = ((uint64_t)total * 100 + iterations / 2) / iterations;
+    snprintf(out, outSize, "%lu.%02lu", (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+// Time one operation and print its result line
+static void BENCH_Run(const char *name, void (*operation)(void), uint32_t iterations)
+{
+    char allocsPerOp[16] = "null";
+    char commitsPerOp[16];
+
+    operation(); // Warm-up: caches, NVS page lookups and first-use initialisation
+
+    uint32_t allocations = atomic_load_explicit(&benchAllocations, memory_order_relaxed);
+    uint32_t commits = Memory_GetCommitCount();
+    int64_t start = esp_timer_get_time();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        operation();
+    }
+
+    int64_t elapsed = esp_timer_get_time() - start;
+    allocations = atomic_load_explicit(&benchAllocations, memory_order_relaxed) - allocations;
+    commits = Memory_GetCommitCount() - commits;
+
+#if CONFIG_HEAP_USE_HOOKS
+    BENCH_FormatRatio(allocsPerOp, sizeof(allocsPerOp), allocations, iterations);
+#endif
+    BENCH_FormatRatio(commitsPerOp, sizeof(commitsPerOp), commits, iterations);
+
+    printf("{\"bench\":\"%s\",\"target\":\"%s\",\"iterations\":%lu,\"ns_per_op\":%llu,\"allocs_per_op\":%s,\"commits_per_op\":%s}\n",
+           name, CONFIG_IDF_TARGET, (unsigned long)iterations, (unsigned long long)(elapsed * 1000 / iterations),
+           allocsPerOp, commitsPerOp);
+}
+
+// Build configuration messages that carry the values already stored
+static void BENCH_PreparePayloads(void)
+{
+    memset(&benchConfig, 0, sizeof(benchConfig));
+    RetrieveConfigFromStorage(&benchConfig);
+
+    snprintf(benchWifiPayload, sizeof(benchWifiPayload),
+             "{\"configtype\":%d,\"wifissid\":\"%s\",\"wifipassword\":\"%s\"}",
+             WIFI_CONFIG_TYPE, benchConfig.wifiSSID, benchConfig.wifiPassword);
+    snprintf(benchMqttPayload, sizeof(benchMqttPayload),
+             "{\"configtype\":%d,\"mqttbroker\":\"%s\",\"mqttport\":%ld,\"mqttusername\":\"%s\",\"mqttpassword\":\"%s\"}",
+             MQTT_CONFIG_TYPE, benchConfig.mqttBroker, (long)benchConfig.mqttPort, benchConfig.mqttUsername,
+             benchConfig.mqttPassword);
+    snprintf(benchTopicPayload, sizeof(benchTopicPayload),
+             "{\"configtype\":%d,\"tconfigtype\":%d,\"relay_topic\":\"%s\"}",
+             TOPIC_CONFIG_TYPE, TOPIC_RELAY_TYPE, Topic_Get(TOPIC_RELAY_TYPE));
+    int length = snprintf(benchBundlePayload, sizeof(benchBundlePayload),
+                          "{\"configtype\":%d,\"wifissid\":\"%s\",\"wifipassword\":\"%s\",\"mqttbroker\":\"%s\",\"mqttport\":%ld,"
+                          "\"mqttusername\":\"%s\",\"mqttpassword\":\"%s\",\"relay_topic\":\"%s\",\"diag_topic\":\"%s\"",
+                          BUNDLE_CONFIG_TYPE, benchConfig.wifiSSID, benchConfig.wifiPassword, benchConfig.mqttBroker,
+                          (long)benchConfig.mqttPort, benchConfig.mqttUsername, benchConfig.mqttPassword, Topic_Get(TOPIC_RELAY_TYPE),
+                          Topic_Get(TOPIC_DIAG_TYPE));
+    for (size_t i = 0; i < SensorRegistry_Count() && length > 0 && (size_t)length < sizeof(benchBundlePayload); i++)
+    {
+        length += snprintf(benchBundlePayload + length, sizeof(benchBundlePayload) - length, ",\"%s\":\"%s\"",
+                           SensorRegistry_Get(i)->topicKey, Topic_Get((topicId)SensorRegistry_Get(i)->topicType));
+    }
+    if (length > 0 && (size_t)length < sizeof(benchBundlePayload))
+    {
+        snprintf(benchBundlePayload + length, sizeof(benchBundlePayload) - length, "}");
+    }
+
+    benchRelayMask = Relay_GetStateMask();
+    for (uint8_t relay = 1; relay <= Relay_GetCount(); relay++)
+    {
+        benchRelayStates[relay - 1] = Relay_Get(relay);
+    }
+}
+
+void BENCH_RunAll(void)
+{
+    const struct
+    {
+        const char *name;
+        const char *payload;
+    } configBenchmarks[] = {
+        {"config_wifi", benchWifiPayload},
+        {"config_mqtt", benchMqttPayload},
+        {"config_topic", benchTopicPayload},
+        {"config_bundle", benchBundlePayload},
+    };
+
+    BENCH_PreparePayloads();
+    benchTask = xTaskGetCurrentTaskHandle();
+
+    for (size_t i = 0; i < sizeof(configBenchmarks) / sizeof(configBenchmarks[0]); i++)
+    {
+        benchSource = configBenchmarks[i].payload;
+        BENCH_Run(configBenchmarks[i].name, BENCH_GetDataAtRunTime, BENCH_ITERATIONS);
+    }
+    BENCH_Run("json_extract_string", BENCH_ExtractString, BENCH_ITERATIONS);
+    BENCH_Run("json_extract_int32", BENCH_ExtractInt32, BENCH_ITERATIONS);
+    BENCH_Run("config_retrieve", BENCH_RetrieveConfig, BENCH_ITERATIONS);
+    BENCH_Run("relay_set", BENCH_RelaySet, BENCH_ITERATIONS);
+    BENCH_Run("relay_set_group", BENCH_RelaySetGroup, BENCH_ITERATIONS);
+    if (BENCH_PrepareRules())
+    {
+        BENCH_Run("rule_evaluate", BENCH_RuleEvaluate, BENCH_ITERATIONS * 10);
+        Rule_Load();
+    }
+
+    benchTask = NULL;
+
+    // Put back any relay the group benchmark switched
+    for (uint8_t relay = 1; relay <= Relay_GetCount(); relay++)
+    {
+        Relay_Set(relay, benchRelayStates[relay - 1]); // No write unless it changed
+    }
+}
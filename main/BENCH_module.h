@@ -0,0 +1,50 @@
+/******************************************************************************
+ * @file        BENCH_module.h
+ * @brief       Microbenchmarks of the configuration, JSON and relay command paths.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the benchmark suite shared by the firmware and the host
+ * build. Each benchmark prints one JSON line:
+ * {"bench":"name","target":"esp32","iterations":n,"ns_per_op":t,
+ *  "allocs_per_op":a,"commits_per_op":c}
+ * where allocs_per_op counts heap allocations made by the benchmark task and
+ * commits_per_op counts NVS commits, i.e. flash writes. allocs_per_op is null when
+ * the heap hooks are not enabled (CONFIG_HEAP_USE_HOOKS).
+ *
+ * rule_evaluate runs one reading of the first registered sensor through RULE_MAX_RULES
+ * rules, so the cost of a single rule is ns_per_op / RULE_MAX_RULES. The rules hold
+ * the state relay 1 already has, so no relay is switched.
+ ******************************************************************************/
+#ifndef BENCH_MODULE_H
+#define BENCH_MODULE_H
+
+#include <stdint.h>
+
+#define BENCH_RUN_AT_BOOT 0         // Run the suite from app_main, for bench kits only
+#define BENCH_DEVICE_ITERATIONS 20  // Flash-bound operations are slow on the device
+#define BENCH_HOST_ITERATIONS 2000  // Enough for stable figures on a workstation
+
+#if CONFIG_IDF_TARGET_LINUX
+#define BENCH_ITERATIONS BENCH_HOST_ITERATIONS
+#else
+#define BENCH_ITERATIONS BENCH_DEVICE_ITERATIONS
+#endif
+
+/**
+ * @brief Runs every benchmark on the calling task and prints the results.
+ *
+ * @details
+ * The configuration benchmarks write back the configuration currently stored, and
+ * the relay benchmarks write the current relay states, so the kit keeps its settings.
+ * Relay_SetGroup switches all relays to the state of relay 1 while it runs; the
+ * previous states are restored afterwards.
+ */
+void BENCH_RunAll(void);
+
+#endif // BENCH_MODULE_H
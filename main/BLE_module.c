@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"           // For the beacon spinlock
 #include "esp_event.h"                   // For event handling
 #include "nvs_flash.h"                   // For Non-Volatile Storage (NVS)
 #include "esp_log.h"                     // For logging
@@ -33,12 +34,72 @@
 #include "Memory_module.h"               // For memory operations
 #include "JSON_module.h"                 // For JSON parsing
 #include "DataHandle.h"                  // For handling configuration data
+#include "DIAG_module.h"                 // For the diagnostics report
 
 static const char *TAG = "BLE-Server"; // Logging tag for the BLE module
 uint8_t ble_addr_type;                 // BLE address type
 struct ble_gap_adv_params adv_params;  // Advertising parameters for BLE
 uint32_t BLE_PASSWORD = 0;             // Password for BLE access (initially 0)
-bool status = false;                   // Advertising status flag
+bool status = false;                   // Advertising status flag, set in configuration mode
+static bool bleSynced = false;         // Set once the host stack can accept advertising data
+static volatile bool bleConnected = false;   // A configuration client is connected
+static volatile bool bleConfigEnded = false; // The configuration client left, set by the GAP handler
+
+// Advertising outside configuration mode: scanners read the beacon without connecting
+static const struct ble_gap_adv_params beaconParams = {
+    .conn_mode = BLE_GAP_CONN_MODE_NON,
+    .disc_mode = BLE_GAP_DISC_MODE_GEN,
+};
+
+// Status beacon record and the lock guarding it against concurrent updates
+static bleBeaconRecord beaconRecord = {
+    .companyId = BLE_BEACON_COMPANY_ID,
+    .recordVersion = BLE_BEACON_RECORD_VERSION,
+    .firmwareVersion = BLE_BEACON_FW_VERSION,
+};
+static portMUX_TYPE beaconLock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t beaconConfigError = BLE_BEACON_ERROR_NONE; // Result of the last configuration message
+static uint8_t beaconFault = BLE_BEACON_ERROR_NONE;       // Hardware fault, kept for the rest of the run
+
+// Take a consistent copy of the beacon record
+static bleBeaconRecord BLE_BeaconSnapshot(void)
+{
+    bleBeaconRecord record;
+    taskENTER_CRITICAL(&beaconLock);
+    record = beaconRecord;
+    taskEXIT_CRITICAL(&beaconLock);
+    return record;
+}
+
+// Beacon error code of a configuration message result
+static uint8_t BLE_BeaconErrorCode(DataErrorHandle result)
+{
+    switch (result)
+    {
+    case ALL_IS_OK:
+        return BLE_BEACON_ERROR_NONE;
+    case JS_CONFIG_TYPE_ERROR:
+        return BLE_BEACON_ERROR_CONFIG_TYPE;
+    case JS_WIFI_CRD_ERROR:
+        return BLE_BEACON_ERROR_WIFI;
+    case JS_MQTT_CRD_ERROR:
+        return BLE_BEACON_ERROR_MQTT;
+    case JS_TOPIC_CONFIG_ERROR:
+        return BLE_BEACON_ERROR_TOPIC_CONFIG;
+    case JS_TOPIC_ERROR:
+        return BLE_BEACON_ERROR_TOPIC;
+    case JS_TOPIC_SENSOR_ERROR:
+        return BLE_BEACON_ERROR_SENSOR_TOPIC;
+    case JS_TOPIC_DIAG_ERROR:
+        return BLE_BEACON_ERROR_DIAG_TOPIC;
+    case JS_BUNDLE_STORAGE_ERROR:
+        return BLE_BEACON_ERROR_STORAGE;
+    case JS_RULES_ERROR:
+        return BLE_BEACON_ERROR_RULES;
+    default:
+        return BLE_BEACON_ERROR_OTHER;
+    }
+}
 
 // Structure to hold response status
 struct responseStatus
@@ -81,6 +142,7 @@ static int BLE_GetConfigData(uint16_t conn_handle, uint16_t attr_handle, struct
         resState.IsAccesable = true;
         getError = GetDataAtRunTime(data, &configBleData); // Extract and validate configuration data
         DisplyGetError(getError);                          // Display any errors from the data extraction
+        BLE_BeaconSetError(BLE_BeaconErrorCode(getError));
     }
 
     memset(data, 0, strlen(data)); // Clear the received data buffer
@@ -101,6 +163,23 @@ static int BLE_NotifyConfigData(uint16_t con_handle, uint16_t attr_handle, struc
     return 0;
 }
 
+// Function to send the latest diagnostics report to the client
+static int BLE_ReadDiagnostics(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    static char report[DIAG_BLE_LENGTH]; // Too large for the host task stack
+    size_t length = DIAG_GetReport(report, sizeof(report));
+
+    if (length == 0)
+    {
+        os_mbuf_append(ctxt->om, "{}", strlen("{}")); // No report sampled yet
+    }
+    else
+    {
+        os_mbuf_append(ctxt->om, report, length);
+    }
+    return 0;
+}
+
 // GATT service definition
 static const struct ble_gatt_svc_def gatt_svcs[] = {
     {.type = BLE_GATT_SVC_TYPE_PRIMARY,
@@ -124,6 +203,10 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
                                                     {.uuid = BLE_UUID16_DECLARE(WRITE_CHARA_UUID), // UUID for write characteristic
                                                      .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY,
                                                      .access_cb = BLE_GetConfigData}, // Callback for write
+
+                                                    {.uuid = BLE_UUID16_DECLARE(DIAG_READ_CHARA_UUID), // UUID for diagnostics characteristic
+                                                     .flags = BLE_GATT_CHR_F_READ,
+                                                     .access_cb = BLE_ReadDiagnostics}, // Callback for read
                                                     {0}}},
     {0}}; // End of service definitions
 
@@ -135,23 +218,23 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     {
     case BLE_GAP_EVENT_CONNECT: // Event for connection
         ESP_LOGI("GAP", "BLE GAP EVENT CONNECT %s", event->connect.status == 0 ? "OK!" : "FAILED!");
-        if (event->connect.status != 0)
-        {
-            ble_app_advertise(); // Restart advertising if connection fails
-        }
+        bleConnected = event->connect.status == 0; // On failure the BLE task keeps advertising
         break;
 
     case BLE_GAP_EVENT_DISCONNECT: // Event for disconnection
         ESP_LOGI("GAP", "BLE GAP EVENT DISCONNECTED");
-        if (event->connect.status != 0)
-        {
-            ble_app_advertise(); // Restart advertising after disconnection
-        }
+        bleConnected = false;
+        bleConfigEnded = status; // The BLE task goes back to the beacon
         break;
 
     case BLE_GAP_EVENT_ADV_COMPLETE: // Event when advertising completes
         ESP_LOGI("GAP", "BLE GAP EVENT");
-        ble_app_advertise(); // Restart advertising
+#if BLE_STATUS_BEACON_ENABLE
+        if (!status)
+        {
+            ble_app_advertise(&beaconParams); // Restart the beacon, configuration mode restarts in the BLE task
+        }
+#endif
         break;
 
     default:
@@ -160,8 +243,8 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     return 0;
 }
 
-// Function to start BLE advertising
-static void ble_app_advertise(void)
+// Function to set the advertising fields: the device name and the status record
+static void ble_app_set_fields(void)
 {
     struct ble_hs_adv_fields fields;
     const char *device_name;
@@ -172,16 +255,109 @@ static void ble_app_advertise(void)
     fields.name_len = strlen(device_name);
     fields.name_is_complete = 1; // Set the advertising name
 
+#if BLE_STATUS_BEACON_ENABLE
+    bleBeaconRecord record = BLE_BeaconSnapshot();
+
+    fields.mfg_data = (uint8_t *)&record; // Attach the status record
+    fields.mfg_data_len = sizeof(record);
+#endif
+
     ble_gap_adv_set_fields(&fields); // Set the advertising fields
+}
 
-    memset(&adv_params, 0, sizeof(adv_params)); // Clear advertising parameters
+// Function to start BLE advertising with the current fields
+static void ble_app_advertise(const struct ble_gap_adv_params *params)
+{
+    ble_app_set_fields();
+    ble_gap_adv_start(ble_addr_type, NULL, BLE_HS_FOREVER, params, ble_gap_event, NULL);
 }
 
 // BLE synchronization callback after BLE stack initialization
 void ble_app_on_sync(void)
 {
     ble_hs_id_infer_auto(0, &ble_addr_type); // Automatically infer BLE address type
-    ble_app_advertise();                     // Start advertising
+    bleSynced = true;
+#if BLE_STATUS_BEACON_ENABLE
+    if (!status)
+    {
+        ble_app_advertise(&beaconParams); // Beacon until configuration mode
+    }
+#else
+    ble_app_set_fields(); // Advertised in configuration mode only
+#endif
+}
+
+// Refresh the advertising data after a field of the beacon record changed
+static void BLE_BeaconRefresh(bool changed)
+{
+#if BLE_STATUS_BEACON_ENABLE
+    if (changed && bleSynced)
+    {
+        ble_app_set_fields(); // Advertising continues with the new record, in the same mode
+    }
+#else
+    (void)changed;
+#endif
+}
+
+// Each setter reads and writes its field inside the lock, so concurrent updates of
+// different fields from different tasks cannot undo each other
+void BLE_BeaconSetRelayMask(uint32_t relayMask)
+{
+    taskENTER_CRITICAL(&beaconLock);
+    bool changed = beaconRecord.relayMask != relayMask;
+    beaconRecord.relayMask = relayMask;
+    taskEXIT_CRITICAL(&beaconLock);
+    BLE_BeaconRefresh(changed);
+}
+
+void BLE_BeaconSetLinkState(uint8_t link, bool up)
+{
+    taskENTER_CRITICAL(&beaconLock);
+    uint8_t flags = up ? (beaconRecord.linkFlags | link) : (beaconRecord.linkFlags & (uint8_t)~link);
+    bool changed = beaconRecord.linkFlags != flags;
+    beaconRecord.linkFlags = flags;
+    taskEXIT_CRITICAL(&beaconLock);
+    BLE_BeaconRefresh(changed);
+}
+
+// Advertised error code, with beaconLock held: a fault outranks any configuration result
+static bool BLE_BeaconUpdateError(void)
+{
+    uint8_t errorCode = beaconFault != BLE_BEACON_ERROR_NONE ? beaconFault : beaconConfigError;
+    bool changed = beaconRecord.errorCode != errorCode;
+    beaconRecord.errorCode = errorCode;
+    return changed;
+}
+
+void BLE_BeaconSetError(uint8_t errorCode)
+{
+    taskENTER_CRITICAL(&beaconLock);
+    beaconConfigError = errorCode;
+    bool changed = BLE_BeaconUpdateError();
+    taskEXIT_CRITICAL(&beaconLock);
+    BLE_BeaconRefresh(changed);
+}
+
+void BLE_BeaconSetFault(uint8_t errorCode)
+{
+    taskENTER_CRITICAL(&beaconLock);
+    beaconFault = errorCode;
+    bool changed = BLE_BeaconUpdateError();
+    taskEXIT_CRITICAL(&beaconLock);
+    BLE_BeaconRefresh(changed);
+}
+
+// Leave configuration mode: stop the connectable advertising and go back to the beacon
+static void BLE_EndConfigMode(void)
+{
+    status = false;
+    bleConfigEnded = false;
+    ble_gap_adv_stop();
+#if BLE_STATUS_BEACON_ENABLE
+    ble_app_advertise(&beaconParams);
+#endif
+    ESP_LOGI(TAG, "Configuration mode ended");
 }
 
 // Host task to run NimBLE stack on FreeRTOS
@@ -215,6 +391,7 @@ void connect_ble(void)
 void BLE_Task()
 {
     int64_t m = esp_timer_get_time(); // Get the current time in microseconds
+    int64_t configStart = 0;          // Start of configuration mode in microseconds
 
     while (1)
     {
@@ -225,11 +402,15 @@ void BLE_Task()
             { // Check if button was pressed for long enough
                 ESP_LOGI("BOOT BUTTON:", "Button Pressed FOR 3 SECOND\n");
 
+                ble_gap_adv_stop(); // Leave the beacon, only one advertising set runs at a time
+
                 adv_params.conn_mode = BLE_GAP_CONN_MODE_UND; // Set connectable mode
                 adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN; // Set discoverable mode
 
-                ble_gap_adv_start(ble_addr_type, NULL, BLE_HS_FOREVER, &adv_params, ble_gap_event, NULL); // Start advertising
-                status = true;                                                                            // Set status to true (advertising started)
+                bleConfigEnded = false;
+                ble_app_advertise(&adv_params); // Start advertising
+                status = true;                  // Set status to true (advertising started)
+                configStart = esp_timer_get_time();
 
                 vTaskDelay(100);          // Short delay to debounce button press
                 m = esp_timer_get_time(); // Update timestamp
@@ -244,7 +425,15 @@ void BLE_Task()
 
         if (status)
         {
-            ble_gap_adv_start(ble_addr_type, NULL, BLE_HS_FOREVER, &adv_params, ble_gap_event, NULL); // Continue advertising
+            // Configuration ends when the client leaves, or when none connected in time
+            if (bleConfigEnded || (!bleConnected && (esp_timer_get_time() - configStart) / 1000 >= BLE_CONFIG_MODE_TIMEOUT))
+            {
+                BLE_EndConfigMode();
+            }
+            else if (!bleConnected)
+            {
+                ble_gap_adv_start(ble_addr_type, NULL, BLE_HS_FOREVER, &adv_params, ble_gap_event, NULL); // Continue advertising
+            }
         }
     }
 }
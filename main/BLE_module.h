@@ -19,11 +19,41 @@
 #ifndef BLE_MODULE_H
 #define BLE_MODULE_H
 
+#include "Board_module.h"
+
+struct ble_gap_adv_params; // NimBLE advertising parameters, host/ble_gap.h
+
 // BLE configuration constants
-#define BLE_CONFIG_GPIO GPIO_NUM_35 // GPIO pin for BLE configuration button
+#define BLE_CONFIG_GPIO BOARD_CONFIG_BUTTON_PIN // GPIO pin for BLE configuration button
 #define PRESSED_CONFIG_TIME 3000    // Minimum button press time in microseconds (3 seconds)
+#define BLE_CONFIG_MODE_TIMEOUT 120000 // Configuration mode without a client ends after 2 minutes (ms)
 #define BLE_NAME "OKTA-T"           // BLE device name
 
+// Status beacon carried in the manufacturer-specific advertising data
+#define BLE_STATUS_BEACON_ENABLE 1       // Set to 0 to advertise the device name only
+#define BLE_BEACON_COMPANY_ID 0xFFFF     // Bluetooth SIG "no company" ID reserved for testing
+#define BLE_BEACON_RECORD_VERSION 1      // Layout version of bleBeaconRecord
+#define BLE_BEACON_FW_VERSION 0x0001     // Firmware version reported by the beacon
+
+// Link state bits of the beacon record
+#define BLE_BEACON_LINK_WIFI (1 << 0)
+#define BLE_BEACON_LINK_MQTT (1 << 1)
+
+// Error codes of the beacon record. Scanners decode these, so a value keeps its meaning
+// for good: new codes are added at the end and retired ones are not reused.
+#define BLE_BEACON_ERROR_NONE 0           // Healthy
+#define BLE_BEACON_ERROR_CONFIG_TYPE 1    // Configuration message of an unknown type
+#define BLE_BEACON_ERROR_WIFI 2           // Invalid Wi-Fi credentials
+#define BLE_BEACON_ERROR_MQTT 3           // Invalid MQTT credentials
+#define BLE_BEACON_ERROR_TOPIC_CONFIG 4   // Invalid topic configuration type
+#define BLE_BEACON_ERROR_TOPIC 5          // Invalid relay topic
+#define BLE_BEACON_ERROR_SENSOR_TOPIC 6   // Invalid sensor topic
+#define BLE_BEACON_ERROR_DIAG_TOPIC 7     // Invalid diagnostics topic
+#define BLE_BEACON_ERROR_STORAGE 8        // Valid configuration that could not be stored
+#define BLE_BEACON_ERROR_RULES 9          // Invalid rules, or rules that could not be stored
+#define BLE_BEACON_ERROR_RELAYS 10        // Relay outputs failed to start, relays disabled
+#define BLE_BEACON_ERROR_OTHER 0xFF       // Any error without a code of its own
+
 // UUIDs for BLE services and characteristics
 #define PIN_SERVICE_UUID 0xD4C3
 #define PIN_READ_CHARA_UUID 0xD4C2
@@ -31,18 +61,47 @@
 #define SERVICE_UUID 0xA8F7
 #define READ_CHARA_UUID 0xA8F6
 #define WRITE_CHARA_UUID 0xA8F5
+#define DIAG_READ_CHARA_UUID 0xA8F4
+
+/**
+ * @brief Compact status record advertised as manufacturer-specific data.
+ *
+ * @details
+ * Scanners can read the state of every kit in range from this record without
+ * connecting. All multi-byte fields are little-endian.
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t companyId;       // BLE_BEACON_COMPANY_ID
+    uint8_t recordVersion;    // BLE_BEACON_RECORD_VERSION
+    uint32_t relayMask;       // Bit n set when relay n+1 is ON
+    uint8_t linkFlags;        // BLE_BEACON_LINK_* bits
+    uint16_t firmwareVersion; // BLE_BEACON_FW_VERSION
+    uint8_t errorCode;        // BLE_BEACON_ERROR_* fault, else the result of the last configuration message
+} bleBeaconRecord;
 
 // Function declarations
 
 /**
- * @brief Initializes BLE advertising.
+ * @brief Sets the BLE advertising fields.
  *
  * @details
- * This function configures the BLE advertising parameters for the ESP32 device.
- * It sets up the advertising fields (e.g., device name) and starts BLE advertising
- * to allow BLE clients to discover and connect to the ESP32 device.
+ * This function sets the advertising fields (device name and, with the status beacon,
+ * the beacon record) without touching the advertising mode, so it can be called from
+ * any task to refresh the data of the advertising in progress.
  */
-static void ble_app_advertise(void);
+static void ble_app_set_fields(void);
+
+/**
+ * @brief Sets the advertising fields and starts BLE advertising.
+ *
+ * @details
+ * The beacon parameters are non-connectable; the connectable parameters of
+ * configuration mode are only used by the BLE task.
+ *
+ * @param params (const struct ble_gap_adv_params *): Advertising mode.
+ */
+static void ble_app_advertise(const struct ble_gap_adv_params *params);
 
 /**
  * @brief Handles GAP (Generic Access Profile) events.
@@ -101,9 +160,55 @@ void connect_ble(void);
  * This function runs in a FreeRTOS task and monitors a specific GPIO pin (likely connected to a button).
  * If the button is pressed for at least the configured threshold time (e.g., 2 seconds), it triggers
  * BLE advertising. It ensures that BLE advertising persists and restarts if necessary.
+ * Configuration mode ends when the client disconnects, or after BLE_CONFIG_MODE_TIMEOUT
+ * without a client, and the kit goes back to the non-connectable status beacon.
  *
  * @return void: This function runs indefinitely, polling the GPIO state and handling BLE advertising.
  */
 void BLE_Task(void);
 
+/**
+ * @brief Updates the relay bitmask carried by the status beacon.
+ *
+ * @param relayMask (uint32_t): Bit n set when relay n+1 is ON.
+ *
+ * @details
+ * The advertising data is refreshed only when the value actually changes.
+ */
+void BLE_BeaconSetRelayMask(uint32_t relayMask);
+
+/**
+ * @brief Updates one link of the state carried by the status beacon.
+ *
+ * @param link (uint8_t): BLE_BEACON_LINK_WIFI or BLE_BEACON_LINK_MQTT.
+ * @param up (bool): true when the station holds an address, or the client is
+ * connected to the broker.
+ *
+ * @details
+ * The other link keeps its state, so each one can be reported by the task that
+ * sees it change.
+ */
+void BLE_BeaconSetLinkState(uint8_t link, bool up);
+
+/**
+ * @brief Updates the result of the last configuration message carried by the status beacon.
+ *
+ * @param errorCode (uint8_t): A BLE_BEACON_ERROR_* code.
+ *
+ * @details
+ * Advertised only while no fault is set with BLE_BeaconSetFault.
+ */
+void BLE_BeaconSetError(uint8_t errorCode);
+
+/**
+ * @brief Sets a hardware fault carried by the status beacon.
+ *
+ * @param errorCode (uint8_t): A BLE_BEACON_ERROR_* code, e.g. BLE_BEACON_ERROR_RELAYS.
+ *
+ * @details
+ * The fault outranks any configuration result, so a later successful configuration
+ * message does not report the kit as healthy.
+ */
+void BLE_BeaconSetFault(uint8_t errorCode);
+
 #endif // BLE_MODULE_H
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * @file        Board_module.h
+ * @brief       Pin, polarity and channel-count tables of the supported boards.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file holds one profile per board, selected with menuconfig under
+ * "OKTA-T Board". A profile gives the relay backend, the relay pins and which of them
+ * switch the relay on at the low level, the shift register chain, the configuration
+ * button and the sensor inputs. Everything is a constant, so the relay, sensor and BLE
+ * modules are compiled against the tables of one board: loops over the relay pins have
+ * a constant bound and polarity is a constant mask, with no lookup left at run time.
+ *
+ * A new board is one more choice in Kconfig.projbuild and one more block here.
+ ******************************************************************************/
+#ifndef BOARD_MODULE_H
+#define BOARD_MODULE_H
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "hal/adc_types.h"
+
+#if CONFIG_OKTA_BOARD_DEVKITC_4CH
+
+#define BOARD_NAME "DevKitC-4CH"
+#define BOARD_RELAY_SHIFT 0                  // Relays on GPIO
+#define BOARD_RELAY_PINS {GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19}
+#define BOARD_RELAY_ACTIVE_LOW 0x0F          // Bit n set when relay n+1 is on at the low level
+#define BOARD_SHIFT_CHIPS 1                  // Unused, no chain on this board
+#define BOARD_CONFIG_BUTTON_PIN GPIO_NUM_0   // BOOT button, low while pressed
+#define BOARD_TEMP_CHANNEL ADC_CHANNEL_0     // GPIO36 (VP)
+#define BOARD_LIGHT_CHANNEL ADC_CHANNEL_3    // GPIO39 (VN)
+#define BOARD_DOOR_PIN GPIO_NUM_27           // Reed contact to GND
+#define BOARD_DOOR_PULLUP 1                  // Internal pull-up, no resistor on the board
+
+#elif CONFIG_OKTA_BOARD_OKTA_T64
+
+#define BOARD_NAME "OKTA-T64"
+#define BOARD_RELAY_SHIFT 1                  // Relays on the expansion chain
+#define BOARD_RELAY_PINS {GPIO_NUM_19, GPIO_NUM_18, GPIO_NUM_2, GPIO_NUM_27, \
+                          GPIO_NUM_26, GPIO_NUM_25, GPIO_NUM_33, GPIO_NUM_32}
+#define BOARD_RELAY_ACTIVE_LOW 0x00
+#define BOARD_SHIFT_CHIPS CONFIG_OKTA_RELAY_SHIFT_CHIPS
+#define BOARD_CONFIG_BUTTON_PIN GPIO_NUM_35
+#define BOARD_TEMP_CHANNEL ADC_CHANNEL_0     // GPIO36
+#define BOARD_LIGHT_CHANNEL ADC_CHANNEL_3    // GPIO39
+#define BOARD_DOOR_PIN GPIO_NUM_34
+#define BOARD_DOOR_PULLUP 0                  // External pull-up, GPIO34 has none
+
+#else // OKTA-T
+
+#define BOARD_NAME "OKTA-T"
+#define BOARD_RELAY_SHIFT 0
+#define BOARD_RELAY_PINS {GPIO_NUM_19, GPIO_NUM_18, GPIO_NUM_2, GPIO_NUM_27, \
+                          GPIO_NUM_26, GPIO_NUM_25, GPIO_NUM_33, GPIO_NUM_32}
+#define BOARD_RELAY_ACTIVE_LOW 0x00
+#define BOARD_SHIFT_CHIPS 1                  // Unused, no chain on this board
+#define BOARD_CONFIG_BUTTON_PIN GPIO_NUM_35
+#define BOARD_TEMP_CHANNEL ADC_CHANNEL_0     // GPIO36
+#define BOARD_LIGHT_CHANNEL ADC_CHANNEL_3    // GPIO39
+#define BOARD_DOOR_PIN GPIO_NUM_34
+#define BOARD_DOOR_PULLUP 0                  // External pull-up, GPIO34 has none
+
+#endif
+
+#define BOARD_RELAY_GPIO_COUNT (sizeof((const gpio_num_t[])BOARD_RELAY_PINS) / sizeof(gpio_num_t))
+
+// Expansion header of the OKTA-T boards, also free on the DevKitC
+#define BOARD_SHIFT_MOSI_PIN GPIO_NUM_13     // SER of the first chip
+#define BOARD_SHIFT_SCLK_PIN GPIO_NUM_14     // SRCLK of every chip
+#define BOARD_SHIFT_LATCH_PIN GPIO_NUM_15    // RCLK of every chip, driven as the SPI CS
+#define BOARD_SHIFT_OE_PIN GPIO_NUM_4        // OE of every chip
+
+#endif // BOARD_MODULE_H
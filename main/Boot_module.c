@@ -0,0 +1,74 @@
+/******************************************************************************
+ * @file        Boot_module.c
+ * @brief       Startup phase timestamps and the boot summary.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Phases are marked from app_main, the BLE task, the event loop and the MQTT task,
+ * so each timestamp is claimed with a compare-and-swap from 0. The summary is built
+ * into a static buffer that outlives the deferred log record printing it.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "LOG_module.h"
+#include "Boot_module.h"
+
+static _Atomic uint32_t bootPhaseTime[BOOT_PHASE_COUNT]; // Milliseconds since boot, 0 until marked
+static char bootSummary[BOOT_SUMMARY_LENGTH];
+
+static const char *const bootPhaseNames[BOOT_PHASE_COUNT] = {
+    "nvs", "config", "wifi", "relays", "ble", "ip", "ready"};
+
+// Build and log the summary, phases that never completed are shown as '-'
+static void BOOT_LogSummary(void)
+{
+    size_t length = 0;
+
+    for (int phase = 0; phase < BOOT_PHASE_COUNT && length < sizeof(bootSummary); phase++)
+    {
+        uint32_t time = atomic_load(&bootPhaseTime[phase]);
+        char value[11] = "-"; // "4294967295"
+        if (time)
+        {
+            snprintf(value, sizeof(value), "%lu", (unsigned long)time);
+        }
+        int written = snprintf(bootSummary + length, sizeof(bootSummary) - length, "%s%s=%s", phase ? " " : "",
+                               bootPhaseNames[phase], value);
+        if (written < 0)
+        {
+            break;
+        }
+        length += (size_t)written;
+    }
+    LOG_I(LOG_MODULE_MAIN, "Boot phases (ms since boot): %s", LOG_STR(bootSummary));
+}
+
+void BOOT_Mark(bootPhase phase)
+{
+    uint32_t expected = 0;
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+    if (phase >= BOOT_PHASE_COUNT)
+    {
+        return;
+    }
+
+    // A phase completing in the first millisecond still counts as marked
+    if (atomic_compare_exchange_strong(&bootPhaseTime[phase], &expected, now ? now : 1) && phase == BOOT_PHASE_READY)
+    {
+        BOOT_LogSummary();
+    }
+}
+
+uint32_t BOOT_GetPhaseTime(bootPhase phase)
+{
+    return phase < BOOT_PHASE_COUNT ? atomic_load(&bootPhaseTime[phase]) : 0;
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * @file        Boot_module.h
+ * @brief       Startup phase timestamps and the boot summary.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the boot profiler. Each startup phase records the
+ * esp_timer time at which it completed, from whichever task completes it. Because
+ * independent phases run concurrently, the summary lists completion times since
+ * boot rather than durations. It is logged as a single line once the kit is ready
+ * to take its first command, that is when it has subscribed to its relay topic.
+ ******************************************************************************/
+#ifndef BOOT_MODULE_H
+#define BOOT_MODULE_H
+
+#include <stdint.h>
+
+#define BOOT_SUMMARY_LENGTH 160 // Summary line, one "name=ms" entry per phase
+
+/**
+ * @brief Startup phases, in the order of the summary.
+ */
+typedef enum
+{
+    BOOT_PHASE_NVS,        // NVS partition mounted
+    BOOT_PHASE_CONFIG,     // Configuration loaded from storage
+    BOOT_PHASE_WIFI_START, // Wi-Fi driver started, association runs in the background
+    BOOT_PHASE_RELAYS,     // Relay outputs restored to their saved states
+    BOOT_PHASE_BLE,        // NimBLE host stack initialized
+    BOOT_PHASE_IP,         // Station got an IP address
+    BOOT_PHASE_READY,      // Connected to the broker and subscribed to the relay topic
+    BOOT_PHASE_COUNT,
+} bootPhase;
+
+/**
+ * @brief Records the completion of a phase.
+ *
+ * @param phase (bootPhase): The phase that has just completed.
+ *
+ * @details
+ * Only the first completion of each phase is kept, so a reconnect does not move the
+ * boot figures. Marking BOOT_PHASE_READY logs the summary.
+ */
+void BOOT_Mark(bootPhase phase);
+
+/**
+ * @brief Returns the completion time of a phase.
+ *
+ * @param phase (bootPhase): The phase to read.
+ *
+ * @return uint32_t: Milliseconds since boot, 0 if the phase has not completed.
+ */
+uint32_t BOOT_GetPhaseTime(bootPhase phase);
+
+#endif // BOOT_MODULE_H
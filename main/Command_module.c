@@ -0,0 +1,343 @@
+/******************************************************************************
+ * @file        Command_module.c
+ * @brief       Relay command handling shared by the firmware and the host build.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * This file parses relay commands, applies them through the relay module, marks the
+ * trace stages of the command path and publishes the optional acknowledgement. A batch
+ * is read from the same parse as a single command: each item is checked and merged into
+ * a select mask and a state mask, which Relay_SetMany applies in one update.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "JSON_module.h"
+#include "Relay_module.h"
+#include "MQTT_module.h"
+#include "LOG_module.h"
+#include "TRACE_module.h"
+#include "Schedule_module.h"
+#include "Command_module.h"
+
+// A command must arrive in one MQTT data event to be parsed from a single copy
+_Static_assert(COMMAND_PAYLOAD_LENGTH <= MQTT_BUFFER_SIZE, "COMMAND_PAYLOAD_LENGTH exceeds the MQTT receive buffer");
+
+#define COMMAND_ITEMS_LENGTH (12 + 2 * COMMAND_BATCH_MAX) // ,"items":[...] of a full batch
+
+typedef struct
+{
+    int32_t relayNumber;
+    int32_t relayState;
+    int32_t correlationId;
+    int32_t pulseMs;
+    int32_t delayMs;
+    int32_t atEpoch;
+    int32_t everyMs;
+    int32_t cancel;
+    uint8_t relay; // relayNumber resolved against the bank
+    bool hasId, hasPulse, hasDelay, hasAt;
+    bool isBatch;                      // Carried a "relays" array, read into the fields below
+    bool batchValid;                   // Every item of the batch is valid
+    size_t batchCount;                 // Items visited
+    uint32_t batchSelect[RELAY_WORDS]; // Relays named by the batch
+    uint32_t batchStates[RELAY_WORDS]; // Their states, later items over earlier ones
+    uint8_t batchResults[COMMAND_BATCH_MAX];
+} relayCommand;
+
+// Validate one item of a batch and merge it into the batch masks
+static bool Command_ReadBatchItem(const jsonItem *item, size_t index, void *context)
+{
+    relayCommand *command = context;
+    int32_t relayNumber = 0;
+    int32_t state = 0;
+    int32_t unused;
+
+    if (index >= COMMAND_BATCH_MAX)
+    {
+        command->batchValid = false;
+        return false;
+    }
+
+    JSON_ItemInt32(item, "relayNo", &relayNumber);
+    uint8_t relay = Relay_Resolve(relayNumber);
+    if (relay == 0)
+    {
+        command->batchResults[index] = COMMAND_ITEM_BAD_RELAY;
+    }
+    else if (!JSON_ItemInt32(item, "state", &state))
+    {
+        command->batchResults[index] = COMMAND_ITEM_BAD_STATE;
+    }
+    else if (JSON_ItemInt32(item, "pulseMs", &unused) || JSON_ItemInt32(item, "delayMs", &unused) ||
+             JSON_ItemInt32(item, "at", &unused) || JSON_ItemInt32(item, "everyMs", &unused) ||
+             JSON_ItemInt32(item, "cancel", &unused))
+    {
+        command->batchResults[index] = COMMAND_ITEM_TIMED;
+    }
+    else
+    {
+        command->batchResults[index] = COMMAND_ITEM_OK;
+        for (size_t word = 0; word < RELAY_WORDS; word++)
+        {
+            // RELAY_ALL selects every bit, Relay_SetMany trims them to the bank
+            uint32_t bits = relay == RELAY_ALL ? UINT32_MAX : (relay - 1) / 32 == word ? 1UL << ((relay - 1) % 32) : 0;
+            command->batchSelect[word] |= bits;
+            command->batchStates[word] = state ? command->batchStates[word] | bits : command->batchStates[word] & ~bits;
+        }
+    }
+    command->batchValid &= command->batchResults[index] == COMMAND_ITEM_OK;
+    return true;
+}
+
+// Read every key of a command from a single parse
+static bool Command_ReadKeys(const jsonItem *item, size_t index, void *context)
+{
+    relayCommand *command = context;
+
+    if (command->relayNumber == 0)
+    {
+        JSON_ItemInt32(item, "relayNo", &command->relayNumber);
+    }
+    JSON_ItemInt32(item, "state", &command->relayState);
+    JSON_ItemInt32(item, "cancel", &command->cancel);
+    JSON_ItemInt32(item, "everyMs", &command->everyMs);
+    command->hasId = JSON_ItemInt32(item, "id", &command->correlationId);
+    command->hasPulse = JSON_ItemInt32(item, "pulseMs", &command->pulseMs);
+    command->hasDelay = JSON_ItemInt32(item, "delayMs", &command->delayMs);
+    command->hasAt = JSON_ItemInt32(item, "at", &command->atEpoch);
+
+    // A batch stopped at COMMAND_BATCH_MAX items is still a batch, rejected as a whole
+    command->batchValid = true;
+    command->isBatch = JSON_ItemArray(item, "relays", Command_ReadBatchItem, command, &command->batchCount) ||
+                       !command->batchValid;
+    return true;
+}
+
+// Hand the timed part of a command to the scheduler; the immediate part is done by the caller
+static bool Command_Schedule(const relayCommand *command)
+{
+    scheduleAction action = {
+        .relay = command->relay,
+        .state = command->relayState ? 1 : 0,
+        .everyMs = command->everyMs > 0 ? (uint32_t)command->everyMs : 0,
+        .pulseMs = command->hasPulse && command->pulseMs > 0 ? (uint32_t)command->pulseMs : 0,
+    };
+
+    if (command->cancel)
+    {
+        LOG_I(LOG_MODULE_RELAY, "Relay %ld: %d scheduled actions cancelled", (long)command->relayNumber,
+              Schedule_Cancel(action.relay));
+        return true;
+    }
+    if (command->hasAt || command->hasDelay)
+    {
+        if (command->delayMs < 0 || (command->hasAt && command->atEpoch <= 0))
+        {
+            return false;
+        }
+        action.atEpoch = command->hasAt ? (uint32_t)command->atEpoch : 0;
+        action.delayMs = (uint32_t)command->delayMs;
+        return Schedule_Add(&action);
+    }
+
+    // A plain pulse: the relay was just switched, switch it back at the end
+    action.state = !action.state;
+    action.delayMs = action.pulseMs;
+    action.pulseMs = 0;
+    action.everyMs = 0;
+    return Schedule_Add(&action);
+}
+
+// One result per batch item, e.g. ,"items":[0,0,1]; empty for a single command
+static void Command_FormatItems(const relayCommand *command, char *items, size_t size)
+{
+    size_t length = 0;
+
+    items[0] = '\0';
+    if (!command->isBatch)
+    {
+        return;
+    }
+    length = (size_t)snprintf(items, size, ",\"items\":[");
+    for (size_t i = 0; i < command->batchCount && i < COMMAND_BATCH_MAX; i++)
+    {
+        length += (size_t)snprintf(items + length, size - length, "%s%u", i ? "," : "", (unsigned)command->batchResults[i]);
+    }
+    snprintf(items + length, size - length, "]");
+}
+
+// Publish the acknowledgement of a command that carried a correlation id
+static void Command_PublishAck(topicId topic, bool applied, const relayCommand *command)
+{
+    traceRecord record;
+    char ackTopic[TOPIC_MAX_LENGTH + sizeof(ACK_TOPIC_SUFFIX)];
+    char items[COMMAND_ITEMS_LENGTH];
+    char ack[160 + sizeof(items)];
+
+    // Acks are optional: only commands with an "id" get one
+    if (!TRACE_Snapshot(&record) || record.correlationId < 0)
+    {
+        return;
+    }
+
+    Command_FormatItems(command, items, sizeof(items));
+    size_t length = Topic_Copy(topic, ackTopic, sizeof(ackTopic) - strlen(ACK_TOPIC_SUFFIX));
+    memcpy(ackTopic + length, ACK_TOPIC_SUFFIX, sizeof(ACK_TOPIC_SUFFIX));
+    snprintf(ack, sizeof(ack),
+             "{\"id\":%ld,\"ok\":%d%s,\"core\":%d,\"us\":{\"parse\":%lu,\"gpio\":%lu,\"nvs\":%lu,\"log\":%lu,\"total\":%lu}}",
+             (long)record.correlationId, applied ? 1 : 0, items, (int)xPortGetCoreID(),
+             (unsigned long)record.stageTime[TRACE_STAGE_PARSED], (unsigned long)record.stageTime[TRACE_STAGE_GPIO],
+             (unsigned long)record.stageTime[TRACE_STAGE_STORED], (unsigned long)record.stageTime[TRACE_STAGE_LOGGED],
+             (unsigned long)record.totalTime);
+    MQTT_Publish(ackTopic, ack, 0);
+}
+
+// Apply a batch once every item is valid, in one relay update
+static bool Command_ApplyBatch(topicId topic, relayCommand *command)
+{
+    if (topic != TOPIC_RELAY_TYPE || command->batchCount == 0 || !command->batchValid)
+    {
+        for (size_t i = 0; i < command->batchCount && i < COMMAND_BATCH_MAX; i++)
+        {
+            if (command->batchResults[i] == COMMAND_ITEM_OK)
+            {
+                command->batchResults[i] = COMMAND_ITEM_SKIPPED;
+            }
+        }
+        LOG_W(LOG_MODULE_RELAY, "Batch of %u items rejected", (unsigned)command->batchCount);
+        return false;
+    }
+
+    if (!Relay_SetMany(command->batchSelect, command->batchStates))
+    {
+        LOG_W(LOG_MODULE_RELAY, "Batch of %u items not applied, relays disabled", (unsigned)command->batchCount);
+        return false;
+    }
+    LOG_I(LOG_MODULE_RELAY, "Batch of %u items applied", (unsigned)command->batchCount);
+    return true;
+}
+
+// Apply a command for one relay or the whole bank
+static bool Command_ApplySingle(const relayCommand *command)
+{
+    bool applied = true;
+
+    // Set relay state based on received information; delayed and calendar actions only go to the scheduler
+    bool immediate = !command->cancel && !command->hasDelay && !command->hasAt;
+    if (command->relay != 0 && command->relay != RELAY_ALL)
+    {
+        if (immediate && !Relay_Set(command->relay, (bool)command->relayState))
+        {
+            LOG_W(LOG_MODULE_RELAY, "Relay %ld not switched, relays disabled", (long)command->relayNumber);
+            applied = false;
+        }
+        else if (immediate)
+        {
+            LOG_I(LOG_MODULE_RELAY, "Relay %ld is %s", (long)command->relayNumber, LOG_STR(command->relayState ? "ON" : "OFF"));
+        }
+    }
+    else if (command->relay == RELAY_ALL)
+    {
+        if (immediate && !Relay_SetGroup((bool)command->relayState))
+        {
+            LOG_W(LOG_MODULE_RELAY, "Relays not switched, relays disabled");
+            applied = false;
+        }
+        else if (immediate)
+        {
+            LOG_I(LOG_MODULE_RELAY, "All relays set to %s", LOG_STR(command->relayState ? "ON" : "OFF"));
+        }
+    }
+    else
+    {
+        LOG_W(LOG_MODULE_RELAY, "Invalid relay number: %ld", (long)command->relayNumber);
+        applied = false;
+    }
+    if (applied && (!immediate || command->hasPulse) && !Command_Schedule(command))
+    {
+        LOG_W(LOG_MODULE_RELAY, "Relay %ld: timed action rejected", (long)command->relayNumber);
+        applied = false;
+    }
+    return applied;
+}
+
+// Parse a command and apply it; the caller owns the trace, if any
+static bool Command_Run(topicId topic, const char *data, int dataLength, relayCommand *command)
+{
+    char payload[COMMAND_PAYLOAD_LENGTH];
+
+    // The event data is not null-terminated, parse a bounded copy
+    if (data == NULL || dataLength <= 0 || dataLength >= (int)sizeof(payload))
+    {
+        LOG_W(LOG_MODULE_MQTT, "Command of %d bytes ignored", dataLength);
+        return false;
+    }
+    memcpy(payload, data, dataLength);
+    payload[dataLength] = '\0';
+
+    // Extract relay information from JSON message; a relay topic names its relay
+    if (topic > TOPIC_RELAY_CHANNEL(0) && topic <= TOPIC_RELAY_CHANNEL(TOPIC_RELAY_CHANNELS))
+    {
+        command->relayNumber = topic - TOPIC_RELAY_CHANNEL(0);
+    }
+    JSON_ReadObject(payload, Command_ReadKeys, command);
+    if (command->hasId)
+    {
+        TRACE_SetCorrelationId(command->correlationId);
+    }
+    command->relay = Relay_Resolve(command->relayNumber);
+    TRACE_Mark(TRACE_STAGE_PARSED);
+
+    return command->isBatch ? Command_ApplyBatch(topic, command) : Command_ApplySingle(command);
+}
+
+bool Command_HandleRelayMessage(topicId topic, const char *data, int dataLength)
+{
+    relayCommand command = {0};
+    bool applied = Command_Run(topic, data, dataLength, &command);
+
+    TRACE_Mark(TRACE_STAGE_LOGGED);
+    Command_PublishAck(topic, applied, &command);
+    TRACE_Mark(TRACE_STAGE_ACKED);
+    TRACE_End(NULL);
+
+    return applied;
+}
+
+bool Command_HandleLocal(const char *data, int dataLength, char *reply, size_t replySize)
+{
+    relayCommand command = {0};
+    char items[COMMAND_ITEMS_LENGTH];
+    char id[24] = ""; // "id":-2147483648,
+    char relays[RELAY_HEX_LENGTH];
+    uint32_t shadow[RELAY_WORDS];
+    int64_t start = esp_timer_get_time();
+
+    // No trace: the trace belongs to the MQTT task, and the caller times the request itself
+    bool applied = Command_Run(TOPIC_RELAY_TYPE, data, dataLength, &command);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    if (reply != NULL && replySize > 0)
+    {
+        Command_FormatItems(&command, items, sizeof(items));
+        if (command.hasId)
+        {
+            snprintf(id, sizeof(id), "\"id\":%ld,", (long)command.correlationId);
+        }
+        Relay_GetShadow(shadow);
+        Relay_FormatHex(shadow, Relay_GetCount(), relays, sizeof(relays));
+        snprintf(reply, replySize, "{%s\"ok\":%d%s,\"relays\":\"%s\",\"us\":%lu}", id, applied ? 1 : 0, items, relays,
+                 (unsigned long)elapsed);
+    }
+    return applied;
+}
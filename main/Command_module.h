@@ -0,0 +1,96 @@
+/******************************************************************************
+ * @file        Command_module.h
+ * @brief       Command module header for handling relay commands received over MQTT.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the API that turns a relay command payload into relay
+ * actions, trace points and an optional acknowledgement. It depends only on the
+ * relay, schedule, JSON, trace and MQTT modules, so the command path can be built and
+ * exercised on the host as well as on the ESP32.
+ ******************************************************************************/
+#ifndef COMMAND_MODULE_H
+#define COMMAND_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "Topic_module.h"
+
+#define COMMAND_PAYLOAD_LENGTH 512 // Largest relay command accepted, fits a full batch
+#define COMMAND_BATCH_MAX 16       // Items of a batch command
+#define ACK_TOPIC_SUFFIX "/ack"    // Acks go to the relay topic with this suffix
+#define COMMAND_REPLY_LENGTH 128   // Largest result of Command_HandleLocal
+
+/**
+ * @brief Result of one item of a batch command, as reported in the ack.
+ */
+typedef enum
+{
+    COMMAND_ITEM_OK = 0,        // Applied
+    COMMAND_ITEM_BAD_RELAY = 1, // relayNo missing or not a relay of the bank
+    COMMAND_ITEM_BAD_STATE = 2, // state missing
+    COMMAND_ITEM_TIMED = 3,     // Timing keys are not accepted in a batch
+    COMMAND_ITEM_SKIPPED = 4,   // Valid, not applied because another item was not
+} commandItemResult;
+
+/**
+ * @brief Handles one relay command.
+ *
+ * @param topic (topicId): Topic the command arrived on, TOPIC_RELAY_TYPE or a relay channel.
+ * @param data (const char *): Command payload, not necessarily null-terminated.
+ * @param dataLength (int): Length of the payload in bytes.
+ *
+ * @return bool: true if the command was valid and applied.
+ *
+ * @details
+ * On the relay topic the payload is {"relayNo":n,"state":0|1} with n from 1 to the
+ * relay count, or 255 for all relays (also 16 on banks of fewer than 16 relays); on
+ * the topic of a single relay it is {"state":0|1}. Optional timing keys hand the
+ * action to the scheduler:
+ * - "pulseMs": switch now and back to !state after this many ms.
+ * - "delayMs" or "at" (UTC seconds): switch later instead of now, with "pulseMs" and a
+ *   repeat period "everyMs" allowed, e.g. {"relayNo":2,"state":1,"at":1790000000,
+ *   "pulseMs":1800000,"everyMs":86400000} for 30 minutes every day.
+ * - "cancel":1: drop the pending actions of the relay (16: of every relay).
+ *
+ * On the relay topic a batch {"relays":[{"relayNo":1,"state":1},{"relayNo":3,"state":0}]}
+ * switches up to COMMAND_BATCH_MAX relays at once. The batch is validated as a whole:
+ * if any item is invalid none is applied; otherwise the items are merged in order
+ * (so {"relayNo":255,"state":0} followed by single relays sets a scene) and the relays
+ * switch in one output update and one NVS commit. The ack of a batch carries an
+ * "items" array with one commandItemResult per item.
+ *
+ * A timed command that cannot be scheduled is not applied. When it also carries
+ * an "id", an ack with the id, the core that handled the command and the per-stage
+ * timings of the active trace is published to the command topic followed by
+ * ACK_TOPIC_SUFFIX. The caller is expected
+ * to have started the trace (the MQTT module does so for every data event); this
+ * function closes it.
+ */
+bool Command_HandleRelayMessage(topicId topic, const char *data, int dataLength);
+
+/**
+ * @brief Handles one relay command from a local client (HTTP or WebSocket).
+ *
+ * @param data (const char *): Command payload, as on the relay topic.
+ * @param dataLength (int): Length of the payload in bytes.
+ * @param reply (char *): Receives the null-terminated result, may be NULL.
+ * @param replySize (size_t): Size of reply, COMMAND_REPLY_LENGTH holds any result.
+ *
+ * @return bool: true if the command was valid and applied.
+ *
+ * @details
+ * Accepts the same commands as the relay topic, batches included. The result is
+ * {"id":n,"ok":0|1,"items":[...],"relays":"hex","us":t} where id and items appear as
+ * in the ack, relays is the bank after the command in the shadow format and us is the
+ * time taken to parse and apply it. Nothing is published and no trace is used.
+ */
+bool Command_HandleLocal(const char *data, int dataLength, char *reply, size_t replySize);
+
+#endif // COMMAND_MODULE_H
@@ -0,0 +1,274 @@
+/******************************************************************************
+ * @file        DIAG_module.c
+ * @brief       Periodic runtime diagnostics published over MQTT and BLE.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The diagnostics task takes a snapshot of all tasks with uxTaskGetSystemState,
+ * which provides the same run-time counters as vTaskGetRunTimeStats without the
+ * text formatting. CPU load is computed from the counter deltas between two
+ * snapshots, so each report describes the last period rather than the time since
+ * boot. Heap figures come from the ESP-IDF heap_caps API; fragmentation is the
+ * share of free memory that is not part of the largest free block. The command
+ * latency percentiles kept by the trace module are included as well.
+ *
+ * All buffers are static, so sampling does not allocate from the heap it measures.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "LOG_module.h"
+#include "MQTT_module.h"
+#include "JSON_module.h"
+#include "TRACE_module.h"
+#include "Rule_module.h"
+#include "Schedule_module.h"
+#include "Reconfig_module.h"
+#include "Relay_module.h"
+#include "DIAG_module.h"
+#include "Task_module.h"
+
+static topicId diagTopic;                           // Destination of the report
+static char diagReport[DIAG_REPORT_LENGTH];         // Last complete report
+static char diagScratch[DIAG_REPORT_LENGTH];        // Report being built
+static SemaphoreHandle_t diagLock = NULL;           // Guards diagReport
+static StaticSemaphore_t diagLockBuffer;
+static uint32_t diagReportCount = 0;                // Reports sampled since start
+static size_t diagBaselineHeap = 0;                 // Free heap once boot has settled
+static size_t diagEntryEnd[DIAG_MAX_TASKS + 1];     // End of the "tasks" opening and of each entry in diagReport
+static size_t diagEntryCount = 0;                   // Task entries in diagReport
+static size_t diagScratchEnd[DIAG_MAX_TASKS + 1];   // Same for diagScratch
+static size_t diagScratchCount = 0;
+
+_Static_assert(DIAG_REPORT_LENGTH + TOPIC_MAX_LENGTH + 8 <= MQTT_OUT_BUFFER_SIZE,
+               "The diagnostics report does not fit the MQTT transmit buffer");
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+static TaskStatus_t diagTasks[DIAG_MAX_TASKS];      // Current snapshot
+
+// Run-time counter of each task at the previous snapshot
+static struct
+{
+    UBaseType_t taskNumber;
+    uint32_t runTime;
+} diagPrevious[DIAG_MAX_TASKS];
+static UBaseType_t diagPreviousCount = 0;
+static uint32_t diagPreviousTotal = 0;
+
+// Find the counter a task had at the previous snapshot
+static uint32_t DIAG_PreviousRunTime(UBaseType_t taskNumber)
+{
+    for (UBaseType_t i = 0; i < diagPreviousCount; i++)
+    {
+        if (diagPrevious[i].taskNumber == taskNumber)
+        {
+            return diagPrevious[i].runTime;
+        }
+    }
+    return 0; // New task, all of its run time belongs to this period
+}
+#endif
+
+// Append formatted text to the scratch report, returns false once it is full
+static bool DIAG_Append(size_t *length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(diagScratch + *length, sizeof(diagScratch) - *length, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= sizeof(diagScratch) - *length)
+    {
+        diagScratch[*length] = '\0'; // Drop the partial entry
+        return false;
+    }
+    *length += (size_t)written;
+    return true;
+}
+
+// Build one report into diagScratch
+static size_t DIAG_Sample(void)
+{
+    size_t length = 0;
+    size_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t minHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    size_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    unsigned fragmentation = freeHeap ? (unsigned)(100 - (largestBlock * 100) / freeHeap) : 0;
+    jsonPoolStats jsonStats;
+    JSON_GetPoolStats(&jsonStats);
+    ruleStats rules;
+    Rule_GetStats(&rules);
+    uint32_t nsPerCheck = rules.checks ? (uint32_t)((uint64_t)rules.totalUs * 1000 / rules.checks) : 0;
+    scheduleStats schedule;
+    Schedule_GetStats(&schedule);
+    uint32_t avgLateUs = schedule.fired ? schedule.totalLateUs / schedule.fired : 0;
+    reconfigStats reconfig;
+    Reconfig_GetStats(&reconfig);
+
+    // Steady state starts once the connections made at boot are up
+    if (++diagReportCount == DIAG_BASELINE_REPORT)
+    {
+        diagBaselineHeap = freeHeap;
+    }
+    long drift = diagBaselineHeap ? (long)diagBaselineHeap - (long)freeHeap : 0;
+
+    DIAG_Append(&length, "{\"up\":%lu,\"heap\":%u,\"min\":%u,\"blk\":%u,\"frag\":%u,\"drift\":%ld,\"json\":[%lu,%lu],"
+                "\"rules\":[%lu,%lu,%lu,%lu],\"sched\":[%lu,%lu,%lu],\"reconf\":[%lu,%lu,%lu],\"rsave\":%lu,\"lat\":{",
+                (unsigned long)(esp_timer_get_time() / 1000000), (unsigned)freeHeap, (unsigned)minHeap,
+                (unsigned)largestBlock, fragmentation, drift, (unsigned long)jsonStats.peakBytes,
+                (unsigned long)jsonStats.fallbacks, (unsigned long)rules.checks, (unsigned long)nsPerCheck,
+                (unsigned long)rules.maxUs, (unsigned long)rules.fired, (unsigned long)schedule.fired,
+                (unsigned long)avgLateUs, (unsigned long)schedule.maxLateUs, (unsigned long)reconfig.applied,
+                (unsigned long)reconfig.failed, (unsigned long)reconfig.lastMs,
+                (unsigned long)Relay_GetSaveFailures());
+
+    // Command path p50/p99 in microseconds, per stage and end to end
+    for (int stage = TRACE_STAGE_PARSED; stage <= TRACE_TOTAL; stage++)
+    {
+        DIAG_Append(&length, "%s\"%s\":[%lu,%lu]", stage == TRACE_STAGE_PARSED ? "" : ",", TRACE_StageName(stage),
+                    (unsigned long)TRACE_GetPercentile(stage, 50), (unsigned long)TRACE_GetPercentile(stage, 99));
+    }
+    UBaseType_t running = uxTaskGetNumberOfTasks();
+    DIAG_Append(&length, "},\"ntask\":%u,\"tasks\":[", (unsigned)running);
+    diagScratchEnd[0] = length;
+    diagScratchCount = 0;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    uint32_t totalRunTime = 0;
+    UBaseType_t taskCount = uxTaskGetSystemState(diagTasks, DIAG_MAX_TASKS, &totalRunTime); // 0 if more are running
+    uint32_t periodRunTime = totalRunTime - diagPreviousTotal;
+    size_t closed = length;
+
+    for (UBaseType_t i = 0; i < taskCount; i++)
+    {
+        uint32_t taskRunTime = diagTasks[i].ulRunTimeCounter - DIAG_PreviousRunTime(diagTasks[i].xTaskNumber);
+        unsigned cpu = periodRunTime ? (unsigned)(((uint64_t)taskRunTime * 100) / periodRunTime) : 0;
+
+        // Each entry must leave room for the closing brackets
+        if (!DIAG_Append(&length, "%s[\"%s\",%u,%u]", i ? "," : "", diagTasks[i].pcTaskName, cpu,
+                         (unsigned)diagTasks[i].usStackHighWaterMark) ||
+            length + sizeof("]}") > sizeof(diagScratch))
+        {
+            diagScratch[closed] = '\0';
+            break; // Report full, the remaining tasks are left out
+        }
+        closed = length;
+        diagScratchEnd[++diagScratchCount] = length;
+    }
+    length = closed;
+    if (diagScratchCount < running)
+    {
+        LOG_W(LOG_MODULE_MAIN, "Diagnostics list %u of %u tasks", (unsigned)diagScratchCount, (unsigned)running);
+    }
+
+    // Remember this snapshot for the next period
+    for (UBaseType_t i = 0; i < taskCount; i++)
+    {
+        diagPrevious[i].taskNumber = diagTasks[i].xTaskNumber;
+        diagPrevious[i].runTime = diagTasks[i].ulRunTimeCounter;
+    }
+    diagPreviousCount = taskCount;
+    diagPreviousTotal = totalRunTime;
+#endif
+
+    DIAG_Append(&length, "]}");
+    return length;
+}
+
+// Diagnostics task: sample, keep the report for BLE and publish it
+static void Task_Diagnostics(void *param)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (1)
+    {
+        size_t length = DIAG_Sample();
+
+        xSemaphoreTake(diagLock, portMAX_DELAY);
+        memcpy(diagReport, diagScratch, length + 1);
+        memcpy(diagEntryEnd, diagScratchEnd, sizeof(diagEntryEnd));
+        diagEntryCount = diagScratchCount;
+        xSemaphoreGive(diagLock);
+
+        char topic[TOPIC_MAX_LENGTH + 1];
+        if (length && Topic_Copy(diagTopic, topic, sizeof(topic)) > 0)
+        {
+            MQTT_Publish(topic, diagScratch, 0);
+        }
+        LOG_D(LOG_MODULE_MAIN, "Diagnostics report of %u bytes", (unsigned)length);
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DIAG_PERIOD_MS));
+    }
+}
+
+void DIAG_Start(topicId topic)
+{
+    if (diagLock != NULL)
+    {
+        return; // Already running
+    }
+
+    diagTopic = topic;
+    diagLock = xSemaphoreCreateMutexStatic(&diagLockBuffer);
+    Task_Start(TASK_DIAG, Task_Diagnostics, NULL);
+}
+
+size_t DIAG_GetReport(char *report, size_t reportSize)
+{
+    size_t length = 0;
+
+    if (report == NULL || reportSize == 0)
+    {
+        return 0;
+    }
+    report[0] = '\0';
+    if (diagLock == NULL)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(diagLock, portMAX_DELAY);
+    length = strnlen(diagReport, sizeof(diagReport));
+    if (length < reportSize)
+    {
+        memcpy(report, diagReport, length + 1);
+    }
+    else
+    {
+        // Keep the task entries that fit with the closing brackets
+        size_t entries = diagEntryCount;
+        while (entries > 0 && diagEntryEnd[entries] + sizeof("]}") > reportSize)
+        {
+            entries--;
+        }
+        length = diagEntryEnd[entries];
+        if (length + sizeof("]}") > reportSize)
+        {
+            length = 0; // Not even the header fits
+        }
+        else
+        {
+            memcpy(report, diagReport, length);
+            memcpy(report + length, "]}", sizeof("]}"));
+            length += strlen("]}");
+        }
+        report[length] = '\0';
+    }
+    xSemaphoreGive(diagLock);
+
+    return length;
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * @file        DIAG_module.h
+ * @brief       Runtime diagnostics: task CPU load, stack margins and heap health.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the APIs of the diagnostics module. A low-priority task
+ * periodically samples the run time and stack high-water mark of every FreeRTOS task,
+ * together with the free, minimum-ever and largest free heap block. The result is
+ * kept as a compact JSON report that is published to an MQTT diagnostics topic and
+ * can be read over BLE.
+ ******************************************************************************/
+#ifndef DIAG_MODULE_H
+#define DIAG_MODULE_H
+
+#include <stddef.h>
+#include "Topic_module.h"
+
+#define DIAG_PERIOD_MS 30000       // Sampling and publishing period
+#define DIAG_MAX_TASKS 32          // Tasks sampled per report, the kit runs about 24
+#define DIAG_TASK_ENTRY_LENGTH 32  // Longest task entry: 15-character name, load and stack
+#define DIAG_HEADER_LENGTH 512     // Longest report without its task entries
+#define DIAG_REPORT_LENGTH (DIAG_HEADER_LENGTH + DIAG_MAX_TASKS * DIAG_TASK_ENTRY_LENGTH) // Report buffer
+#define DIAG_BLE_LENGTH 512        // Largest BLE attribute, see DIAG_GetReport
+#define DIAG_STACK_SIZE 3072       // Diagnostics task stack size
+#define DIAG_TASK_PRIORITY 2       // Below the application tasks
+#define DIAG_BASELINE_REPORT 2     // Report whose free heap is the drift baseline
+
+/**
+ * @brief Starts the diagnostics task.
+ *
+ * @param topic (topicId): Topic the report is published to. It is looked up for every
+ * report, so a new topic applies from the next one; an unset topic disables publishing.
+ *
+ * @details
+ * The report format is:
+ * {"up":s,"heap":b,"min":b,"blk":b,"frag":%,"drift":b,"json":[peak,fallbacks],
+ *  "rules":[checks,ns,maxUs,fired],"sched":[fired,avgLateUs,maxLateUs],
+ *  "reconf":[applied,failed,lastMs],"rsave":n,"lat":{"stage":[p50,p99],...},"ntask":n,
+ *  "tasks":[["name",cpu%,stackFree],...]}
+ * - drift: free heap lost since report DIAG_BASELINE_REPORT, 0 while the steady
+ *   state does not allocate.
+ * - json: JSON pool peak usage in bytes and heap fallbacks.
+ * - rules: conditions evaluated since boot, their average cost in ns, the longest
+ *   evaluation of one reading in us and the rules fired.
+ * - sched: scheduled actions switched, their average and largest lateness in us.
+ * - reconf: changes applied live, those whose link did not come back in time and
+ *   the switchover time of the last one in ms.
+ * - rsave: relay changes switched but not stored, which a reboot would undo.
+ * - lat: command path percentiles in us.
+ * - ntask: tasks running. "tasks" lists at most DIAG_MAX_TASKS of them, none if
+ *   more are running, and fewer in a copy cut by DIAG_GetReport; a list shorter
+ *   than ntask is incomplete.
+ * - cpu%: share of one core used by the task during the last period; stackFree:
+ *   stack high-water mark in bytes.
+ */
+void DIAG_Start(topicId topic);
+
+/**
+ * @brief Copies the most recent report.
+ *
+ * @param report (char *): Output buffer.
+ * @param reportSize (size_t): Size of the output buffer.
+ *
+ * @return size_t: Length of the copied report, 0 if no report exists yet.
+ *
+ * @details
+ * A report longer than the buffer loses its last task entries rather than being cut
+ * mid-entry, so the copy stays valid JSON; give at least DIAG_HEADER_LENGTH bytes.
+ * BLE reads use DIAG_BLE_LENGTH.
+ */
+size_t DIAG_GetReport(char *report, size_t reportSize);
+
+#endif // DIAG_MODULE_H
@@ -0,0 +1,137 @@
+/******************************************************************************
+ * @file        DSP_module.c
+ * @brief       Integer filter and calibration stages of the sensor pipeline.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The median uses quickselect with a median-of-three pivot, linear on average, on
+ * the caller's block so no scratch buffer is needed. The moving average keeps a
+ * running sum and is exact: the sample leaving the window is subtracted, never
+ * approximated by a decay.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "DSP_module.h"
+
+static void DSP_Swap(uint16_t *a, uint16_t *b)
+{
+    uint16_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+uint16_t DSP_Median(uint16_t *samples, size_t count)
+{
+    if (samples == NULL || count == 0 || count > DSP_MAX_BLOCK)
+    {
+        return 0;
+    }
+
+    size_t target = (count - 1) / 2;
+    size_t low = 0, high = count - 1;
+
+    while (low < high)
+    {
+        // Median of three as pivot, moved to the end of the range
+        size_t middle = low + (high - low) / 2;
+        if (samples[middle] < samples[low])
+        {
+            DSP_Swap(&samples[middle], &samples[low]);
+        }
+        if (samples[high] < samples[low])
+        {
+            DSP_Swap(&samples[high], &samples[low]);
+        }
+        if (samples[middle] < samples[high])
+        {
+            DSP_Swap(&samples[middle], &samples[high]);
+        }
+        uint16_t pivot = samples[high];
+
+        // Lomuto partition: smaller samples before store, pivot placed at store
+        size_t store = low;
+        for (size_t i = low; i < high; i++)
+        {
+            if (samples[i] < pivot)
+            {
+                DSP_Swap(&samples[i], &samples[store]);
+                store++;
+            }
+        }
+        DSP_Swap(&samples[store], &samples[high]);
+
+        if (store == target)
+        {
+            return samples[store];
+        }
+        if (store < target)
+        {
+            low = store + 1;
+        }
+        else
+        {
+            high = store - 1;
+        }
+    }
+    return samples[target];
+}
+
+void DSP_MovingAverageInit(dspMovingAverage *filter, uint8_t size)
+{
+    if (filter == NULL)
+    {
+        return;
+    }
+    filter->size = size == 0 ? 1 : size > DSP_MAX_AVERAGE_WINDOW ? DSP_MAX_AVERAGE_WINDOW : size;
+    filter->count = 0;
+    filter->next = 0;
+    filter->sum = 0;
+}
+
+int32_t DSP_MovingAverageUpdate(dspMovingAverage *filter, int32_t sample)
+{
+    if (filter->count == filter->size)
+    {
+        filter->sum -= filter->window[filter->next]; // Oldest sample leaves the window
+    }
+    else
+    {
+        filter->count++;
+    }
+    filter->window[filter->next] = sample;
+    filter->sum += sample;
+    filter->next = (uint8_t)((filter->next + 1) % filter->size);
+
+    // Rounded mean in fixed point
+    int64_t scaled = filter->sum * (1 << DSP_AVERAGE_FRACTION_BITS);
+    int64_t half = filter->count / 2;
+    return (int32_t)(scaled >= 0 ? (scaled + half) / filter->count : (scaled - half) / filter->count);
+}
+
+int32_t DSP_Calibrate(const dspCalibration *calibration, int32_t input)
+{
+    int64_t inputSpan = (int64_t)calibration->inputHigh - calibration->inputLow;
+    int64_t outputSpan = (int64_t)calibration->outputHigh - calibration->outputLow;
+
+    if (inputSpan == 0)
+    {
+        return calibration->outputLow;
+    }
+
+    // Round to nearest with the sign of the quotient
+    int64_t numerator = ((int64_t)input - calibration->inputLow) * outputSpan;
+    if (inputSpan < 0)
+    {
+        numerator = -numerator;
+        inputSpan = -inputSpan;
+    }
+    int64_t offset = numerator >= 0 ? (numerator + inputSpan / 2) / inputSpan : (numerator - inputSpan / 2) / inputSpan;
+    return (int32_t)(calibration->outputLow + offset);
+}
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * @file        DSP_module.h
+ * @brief       Integer filter and calibration stages of the sensor pipeline.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the signal processing stages applied to ADC samples:
+ * a median over each oversampled block, which removes impulse noise such as relay
+ * switching spikes, a moving average over the block medians, and a two-point
+ * linear calibration to engineering units. The stages use integer arithmetic only
+ * and depend on no ESP-IDF header, so the host build can feed them synthetic
+ * sample streams.
+ ******************************************************************************/
+#ifndef DSP_MODULE_H
+#define DSP_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DSP_MAX_BLOCK 128         // Largest oversampled block passed to DSP_Median
+#define DSP_MAX_AVERAGE_WINDOW 32 // Largest moving average window
+#define DSP_AVERAGE_FRACTION_BITS 4 // Fractional bits kept by the moving average output
+
+/**
+ * @brief Moving average over the last samples, with a running sum.
+ */
+typedef struct
+{
+    int32_t window[DSP_MAX_AVERAGE_WINDOW];
+    int64_t sum;   // Sum of the samples in the window
+    uint8_t size;  // Window length
+    uint8_t count; // Samples in the window, up to size
+    uint8_t next;  // Slot of the next sample
+} dspMovingAverage;
+
+/**
+ * @brief Linear map from a measured input to engineering units.
+ *
+ * @details
+ * value = outputLow + (input - inputLow) * (outputHigh - outputLow) / (inputHigh - inputLow)
+ */
+typedef struct
+{
+    int32_t inputLow;   // Input measured at the low reference point
+    int32_t inputHigh;  // Input measured at the high reference point
+    int32_t outputLow;  // Value of the low reference point
+    int32_t outputHigh; // Value of the high reference point
+} dspCalibration;
+
+/**
+ * @brief Returns the median of a block of samples.
+ *
+ * @param samples (uint16_t *): Block of samples, reordered by the call.
+ * @param count (size_t): Number of samples, 1 to DSP_MAX_BLOCK.
+ *
+ * @return uint16_t: The median; the lower middle sample for even counts, 0 for an
+ * empty or oversized block.
+ */
+uint16_t DSP_Median(uint16_t *samples, size_t count);
+
+/**
+ * @brief Prepares a moving average.
+ *
+ * @param filter (dspMovingAverage *): Filter to initialize.
+ * @param size (uint8_t): Window length, clamped to 1..DSP_MAX_AVERAGE_WINDOW.
+ */
+void DSP_MovingAverageInit(dspMovingAverage *filter, uint8_t size);
+
+/**
+ * @brief Adds a sample to a moving average.
+ *
+ * @param filter (dspMovingAverage *): Filter to update.
+ * @param sample (int32_t): New sample.
+ *
+ * @return int32_t: Mean of the samples in the window, with DSP_AVERAGE_FRACTION_BITS
+ * fractional bits. Until the window is full the mean covers the samples seen so far.
+ */
+int32_t DSP_MovingAverageUpdate(dspMovingAverage *filter, int32_t sample);
+
+/**
+ * @brief Applies a two-point calibration.
+ *
+ * @param calibration (const dspCalibration *): Reference points.
+ * @param input (int32_t): Measured input.
+ *
+ * @return int32_t: Calibrated value, rounded to nearest. Inputs outside the
+ * reference points are extrapolated; a calibration with equal inputs returns
+ * outputLow.
+ */
+int32_t DSP_Calibrate(const dspCalibration *calibration, int32_t input);
+
+#endif // DSP_MODULE_H
@@ -18,15 +18,177 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"       // Logging
 #include "esp_mac.h"       // MAC address handling
 #include "driver/gpio.h"   // GPIO control for ESP32
 #include "Memory_module.h" // For saving and retrieving configuration data
 #include "JSON_module.h"   // For parsing JSON
+#include "SensorRegistry_module.h" // Sensor drivers and their topic keys
+#include "Topic_module.h"  // Topic table
+#include "Rule_module.h"   // Rules engine
+#include "Event_module.h"  // Configuration change event
 #include "DataHandle.h"    // Header for this module
 
 static const char *DATA_HANDLE_TAG = "DATA_HANDLE"; // Tag for logging
 
+static _Atomic uint32_t configVersion = 0; // Read by the shadow task
+
+// Topic keys shared by single-topic and bundled configuration: relay, relay channels, sensors, diagnostics and rules
+#define TOPIC_MAP_SIZE (3 + TOPIC_RELAY_CHANNELS + SENSOR_REGISTRY_MAX)
+
+typedef struct
+{
+    topicId id;
+    const char *jsonKey;
+    DataErrorHandle errorCode;
+    bool optional; // May be left out of a bundle
+} topicMapEntry;
+
+static const char *const relayChannelKeys[TOPIC_RELAY_CHANNELS] = {
+    "relay1_topic", "relay2_topic", "relay3_topic", "relay4_topic",
+    "relay5_topic", "relay6_topic", "relay7_topic", "relay8_topic"};
+
+// Fill the topic key table, return its size
+static size_t BuildTopicMap(topicMapEntry topicConfigMap[TOPIC_MAP_SIZE])
+{
+    size_t count = 0;
+
+    topicConfigMap[count++] = (topicMapEntry){TOPIC_RELAY_TYPE, "relay_topic", JS_TOPIC_ERROR, false};
+    for (uint8_t relay = 1; relay <= TOPIC_RELAY_CHANNELS; relay++)
+    {
+        topicConfigMap[count++] = (topicMapEntry){TOPIC_RELAY_CHANNEL(relay), relayChannelKeys[relay - 1], JS_TOPIC_ERROR, true};
+    }
+    for (size_t i = 0; i < SensorRegistry_Count(); i++)
+    {
+        const sensorDriver *driver = SensorRegistry_Get(i);
+        topicConfigMap[count++] = (topicMapEntry){(topicId)driver->topicType, driver->topicKey, JS_TOPIC_SENSOR_ERROR, false};
+    }
+    topicConfigMap[count++] = (topicMapEntry){TOPIC_DIAG_TYPE, "diag_topic", JS_TOPIC_DIAG_ERROR, true};
+    topicConfigMap[count++] = (topicMapEntry){TOPIC_RULES_TYPE, "rules_topic", JS_TOPIC_ERROR, true};
+    return count;
+}
+
+// Extract one topic and set it in the staged topic table
+static DataErrorHandle StageTopic(const char *js_string, const char *jsonKey, topicId id, DataErrorHandle errorCode)
+{
+    char topic[TOPIC_MAX_LENGTH + 2]; // One extra character, so an overlong topic is rejected rather than cut
+
+    if (!JSON_ExtractString(js_string, jsonKey, topic, sizeof(topic)) || !Topic_StageSet(id, topic))
+    {
+        return errorCode;
+    }
+    return ALL_IS_OK;
+}
+
+// Extract the topic of a topic message into the staged topic table
+static DataErrorHandle StageTopicMessage(const char *js_string, int32_t topicConfigType)
+{
+    topicMapEntry topicConfigMap[TOPIC_MAP_SIZE];
+    int32_t relayNumber;
+
+    // Per-relay topic: {"relayNo":n,"topic":"..."}
+    if (topicConfigType == TOPIC_RELAY_CHANNEL_TYPE)
+    {
+        if (!JSON_ExtractInt32(js_string, "relayNo", &relayNumber) || relayNumber < 1 || relayNumber > TOPIC_RELAY_CHANNELS)
+        {
+            return JS_TOPIC_ERROR;
+        }
+        return StageTopic(js_string, "topic", TOPIC_RELAY_CHANNEL(relayNumber), JS_TOPIC_ERROR);
+    }
+
+    size_t topicCount = BuildTopicMap(topicConfigMap);
+    for (size_t i = 0; i < topicCount; i++)
+    {
+        if (topicConfigMap[i].id == topicConfigType)
+        {
+            return StageTopic(js_string, topicConfigMap[i].jsonKey, topicConfigMap[i].id, topicConfigMap[i].errorCode);
+        }
+    }
+    return ALL_IS_OK; // Unknown topic types are ignored
+}
+
+// Extract the Wi-Fi section of a configuration message
+static bool ExtractWifiConfig(const char *js_string, credentialConfig *config)
+{
+    return JSON_ExtractString(js_string, "wifissid", config->wifiSSID, sizeof(config->wifiSSID)) &&
+           JSON_ExtractString(js_string, "wifipassword", config->wifiPassword, sizeof(config->wifiPassword));
+}
+
+// Extract the MQTT section of a configuration message
+static bool ExtractMqttConfig(const char *js_string, credentialConfig *config)
+{
+    return JSON_ExtractString(js_string, "mqttbroker", config->mqttBroker, sizeof(config->mqttBroker)) &&
+           JSON_ExtractInt32(js_string, "mqttport", &config->mqttPort) &&
+           JSON_ExtractString(js_string, "mqttusername", config->mqttUsername, sizeof(config->mqttUsername)) &&
+           JSON_ExtractString(js_string, "mqttpassword", config->mqttPassword, sizeof(config->mqttPassword));
+}
+
+// Validate every section of a bundle first, then store all of it in one transaction
+static DataErrorHandle GetBundleAtRunTime(const char *js_string, credentialConfig *config)
+{
+    credentialConfig staged = *config;
+    topicMapEntry topicConfigMap[TOPIC_MAP_SIZE];
+    char topic[TOPIC_MAX_LENGTH + 2]; // One extra character, so an overlong topic is rejected rather than cut
+    size_t blobLength;
+
+    if (!ExtractWifiConfig(js_string, &staged))
+    {
+        return JS_WIFI_CRD_ERROR;
+    }
+    if (!ExtractMqttConfig(js_string, &staged))
+    {
+        return JS_MQTT_CRD_ERROR;
+    }
+
+    memoryEntry entries[MEMORY_BATCH_MAX_ENTRIES] = {
+        {"ssid", MEMORY_TYPE_STRING, staged.wifiSSID, 0},
+        {"password", MEMORY_TYPE_STRING, staged.wifiPassword, 0},
+        {"mqttbroker", MEMORY_TYPE_STRING, staged.mqttBroker, 0},
+        {"mqttport", MEMORY_TYPE_INT32, NULL, staged.mqttPort},
+        {"mqttusername", MEMORY_TYPE_STRING, staged.mqttUsername, 0},
+        {"mqttpassword", MEMORY_TYPE_STRING, staged.mqttPassword, 0},
+    };
+    size_t entryCount = 6;
+
+    // Topics are staged in the topic table and stored with the credentials as one blob
+    Topic_Stage();
+    size_t topicCount = BuildTopicMap(topicConfigMap);
+    for (size_t i = 0; i < topicCount; i++)
+    {
+        bool found = topicConfigMap[i].optional ? JSON_ExtractOptionalString(js_string, topicConfigMap[i].jsonKey, topic, sizeof(topic))
+                                                : JSON_ExtractString(js_string, topicConfigMap[i].jsonKey, topic, sizeof(topic));
+        if (!found)
+        {
+            if (topicConfigMap[i].optional)
+            {
+                continue; // Keep the current value
+            }
+            return topicConfigMap[i].errorCode;
+        }
+        if (!Topic_StageSet(topicConfigMap[i].id, topic))
+        {
+            return topicConfigMap[i].errorCode;
+        }
+    }
+    const uint8_t *blob = Topic_StageBlob(&blobLength);
+    entries[entryCount++] = (memoryEntry){TOPIC_BLOB_KEY, MEMORY_TYPE_BLOB, NULL, 0, blob, blobLength};
+    entries[entryCount++] = (memoryEntry){CONFIG_VERSION_KEY, MEMORY_TYPE_INT32, NULL, (int32_t)(atomic_load(&configVersion) + 1)};
+
+    // Nothing has been written so far; commit the whole bundle at once
+    if (!Memory_SaveBatch("storage", entries, entryCount))
+    {
+        return JS_BUNDLE_STORAGE_ERROR;
+    }
+
+    *config = staged;
+    Topic_Activate();
+    atomic_fetch_add(&configVersion, 1);
+    Event_Publish(&(appEvent){.type = EVENT_CONFIG_CHANGED, .configChanged = {.configType = BUNDLE_CONFIG_TYPE}});
+    return ALL_IS_OK;
+}
+
 // Function to process runtime JSON configuration and update the credentialConfig struct
 DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config)
 {
@@ -40,9 +202,7 @@ DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config)
     switch (config->configType)
     {
     case WIFI_CONFIG_TYPE:
-        if (!(
-                JSON_ExtractString(js_string, "wifissid", config->wifiSSID, sizeof(config->wifiSSID)) &&
-                JSON_ExtractString(js_string, "wifipassword", config->wifiPassword, sizeof(config->wifiPassword))))
+        if (!ExtractWifiConfig(js_string, config))
         {
             return JS_WIFI_CRD_ERROR;
         }
@@ -52,11 +212,7 @@ DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config)
         break;
 
     case MQTT_CONFIG_TYPE:
-        if (!(
-                JSON_ExtractString(js_string, "mqttbroker", config->mqttBroker, sizeof(config->mqttBroker)) &&
-                JSON_ExtractInt32(js_string, "mqttport", &config->mqttPort) &&
-                JSON_ExtractString(js_string, "mqttusername", config->mqttUsername, sizeof(config->mqttUsername)) &&
-                JSON_ExtractString(js_string, "mqttpassword", config->mqttPassword, sizeof(config->mqttPassword))))
+        if (!ExtractMqttConfig(js_string, config))
         {
             return JS_MQTT_CRD_ERROR;
         }
@@ -73,31 +229,30 @@ DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config)
             return JS_TOPIC_CONFIG_ERROR;
         }
 
-        const struct
+        Topic_Stage();
+        DataErrorHandle err = StageTopicMessage(js_string, config->topicConfigType);
+        if (err != ALL_IS_OK)
         {
-            int topicType;
-            const char *jsonKey;
-            char *storage;
-            size_t storageSize;
-            DataErrorHandle errorCode;
-        } topicConfigMap[] = {
-            {TOPIC_RELAY_TYPE, "relay_topic", config->relay, sizeof(config->relay), JS_TOPIC_ERROR},
-            {TOPIC_TEMP_TYPE, "temp_topic", config->tempSensor, sizeof(config->tempSensor), JS_TOPIC_TEMP_ERROR},
-            {TOPIC_LIGHT_TYPE, "light_topic", config->lightSensor, sizeof(config->lightSensor), JS_TOPIC_LIGHT_ERROR},
-            {TOPIC_DOOR_TYPE, "door_topic", config->doorSensor, sizeof(config->doorSensor), JS_TOPIC_DOOR_ERROR},
-        };
-
-        for (size_t i = 0; i < sizeof(topicConfigMap) / sizeof(topicConfigMap[0]); i++)
+            return err;
+        }
+
+        // Store the whole table, then switch to it
+        size_t blobLength;
+        const uint8_t *blob = Topic_StageBlob(&blobLength);
+        if (!Memory_SaveBlob("storage", TOPIC_BLOB_KEY, blob, blobLength))
         {
-            if (topicConfigMap[i].topicType == config->topicConfigType)
-            {
-                if (!JSON_ExtractString(js_string, topicConfigMap[i].jsonKey, topicConfigMap[i].storage, topicConfigMap[i].storageSize))
-                {
-                    return topicConfigMap[i].errorCode;
-                }
-                Memory_SaveString("storage", topicConfigMap[i].jsonKey, topicConfigMap[i].storage);
-                break;
-            }
+            return JS_BUNDLE_STORAGE_ERROR;
+        }
+        Topic_Activate();
+        break;
+
+    case BUNDLE_CONFIG_TYPE:
+        return GetBundleAtRunTime(js_string, config);
+
+    case RULES_CONFIG_TYPE:
+        if (!Rule_Configure(js_string))
+        {
+            return JS_RULES_ERROR;
         }
         break;
 
@@ -105,6 +260,9 @@ DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config)
         return ALL_IS_OK; // Return success for unsupported configType
     }
 
+    // One version per stored message
+    Memory_SaveInt32("storage", CONFIG_VERSION_KEY, (int32_t)atomic_fetch_add(&configVersion, 1) + 1);
+    Event_Publish(&(appEvent){.type = EVENT_CONFIG_CHANGED, .configChanged = {.configType = config->configType}});
     return ALL_IS_OK;
 }
 
@@ -122,9 +280,10 @@ void DisplyGetError(DataErrorHandle getError)
         {JS_MQTT_CRD_ERROR, "JS_MQTT_CRD_ERROR"},
         {JS_TOPIC_CONFIG_ERROR, "JS_TOPIC_CONFIG_ERROR"},
         {JS_TOPIC_ERROR, "JS_TOPIC_ERROR"},
-        {JS_TOPIC_TEMP_ERROR, "JS_TOPIC_TEMP_ERROR"},
-        {JS_TOPIC_LIGHT_ERROR, "JS_TOPIC_LIGHT_ERROR"},
-        {JS_TOPIC_DOOR_ERROR, "JS_TOPIC_DOOR_ERROR"}};
+        {JS_TOPIC_SENSOR_ERROR, "JS_TOPIC_SENSOR_ERROR"},
+        {JS_TOPIC_DIAG_ERROR, "JS_TOPIC_DIAG_ERROR"},
+        {JS_BUNDLE_STORAGE_ERROR, "JS_BUNDLE_STORAGE_ERROR"},
+        {JS_RULES_ERROR, "JS_RULES_ERROR"}};
 
     // Find and log the error message
     for (size_t i = 0; i < sizeof(errorMap) / sizeof(errorMap[0]); i++)
@@ -140,8 +299,8 @@ void DisplyGetError(DataErrorHandle getError)
     ESP_LOGI(DATA_HANDLE_TAG, "ALL_IS_OK");
 }
 
-// Function to retrieve configuration data from non-volatile storage
-void RetrieveConfigFromStorage(credentialConfig *config)
+// Function to retrieve the Wi-Fi and MQTT credentials from non-volatile storage
+void RetrieveCredentialsFromStorage(credentialConfig *config)
 {
     // Define a mapping of storage keys to config structure members
     const struct
@@ -154,11 +313,7 @@ void RetrieveConfigFromStorage(credentialConfig *config)
         {"password", config->wifiPassword, sizeof(config->wifiPassword)},
         {"mqttbroker", config->mqttBroker, sizeof(config->mqttBroker)},
         {"mqttusername", config->mqttUsername, sizeof(config->mqttUsername)},
-        {"mqttpassword", config->mqttPassword, sizeof(config->mqttPassword)},
-        {"relay_topic", config->relay, sizeof(config->relay)},
-        {"temp_topic", config->tempSensor, sizeof(config->tempSensor)},
-        {"light_topic", config->lightSensor, sizeof(config->lightSensor)},
-        {"door_topic", config->doorSensor, sizeof(config->doorSensor)}};
+        {"mqttpassword", config->mqttPassword, sizeof(config->mqttPassword)}};
 
     // Load all string values into the config structure
     for (size_t i = 0; i < sizeof(stringMappings) / sizeof(stringMappings[0]); i++)
@@ -169,3 +324,21 @@ void RetrieveConfigFromStorage(credentialConfig *config)
     // Load integer values separately
     Memory_LoadInt32("storage", "mqttport", &config->mqttPort);
 }
+
+// Function to retrieve configuration data from non-volatile storage
+void RetrieveConfigFromStorage(credentialConfig *config)
+{
+    RetrieveCredentialsFromStorage(config);
+
+    // Topics are kept in the topic table
+    Topic_Load();
+
+    int32_t version = 0;
+    Memory_LoadInt32("storage", CONFIG_VERSION_KEY, &version);
+    atomic_store(&configVersion, (uint32_t)version);
+}
+
+uint32_t GetConfigVersion(void)
+{
+    return atomic_load(&configVersion);
+}
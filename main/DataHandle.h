@@ -18,29 +18,29 @@
 #ifndef DATAHANDLE_H
 #define DATAHANDLE_H
 
+#include <stdint.h>
+#include "Topic_module.h" // Topic identifiers and the topic table
+
 // Definitions for configuration lengths
 #define WIFI_CRED_LENGTH 32  // Maximum length for Wi-Fi credentials (SSID and password)
 #define MQTT_CRED_LENGTH 32  // Maximum length for MQTT credentials (broker, username, password)
-#define MQTT_TOPIC_LENGTH 16 // Maximum length for MQTT topic names
 
 // Configuration type identifiers
 #define WIFI_CONFIG_TYPE 0
 #define MQTT_CONFIG_TYPE 1
 #define TOPIC_CONFIG_TYPE 2
+#define BUNDLE_CONFIG_TYPE 3 // Wi-Fi, MQTT and every topic in a single message
+#define RULES_CONFIG_TYPE 4  // Local automation rules, see Rule_module.h
 
-// Topic type identifiers
-#define TOPIC_RELAY_TYPE 1
-#define TOPIC_TEMP_TYPE 9
-#define TOPIC_LIGHT_TYPE 10
-#define TOPIC_DOOR_TYPE 11
+#define CONFIG_VERSION_KEY "cfgver" // NVS key of the configuration version
 
 /**
- * @brief Structure to hold configuration data for Wi-Fi, MQTT, and relay topics.
+ * @brief Structure to hold configuration data for Wi-Fi and MQTT.
  *
  * @details
- * This structure holds all configuration data required for setting up the system, including
- * Wi-Fi credentials, MQTT credentials, and topic configurations for relays and sensors.
+ * This structure holds the Wi-Fi and MQTT credentials required for setting up the system.
  * Each field in this structure corresponds to a specific configuration value used by the system.
+ * Topics are kept in the topic table (Topic_module.h) rather than in fixed fields.
  */
 typedef struct Configuration
 {
@@ -53,11 +53,6 @@ typedef struct Configuration
     char mqttUsername[MQTT_CRED_LENGTH]; // MQTT username
     char mqttPassword[MQTT_CRED_LENGTH]; // MQTT password
     char mqttBroker[MQTT_CRED_LENGTH];   // MQTT broker URI
-
-    char relay[MQTT_TOPIC_LENGTH];      // Relay 1 topic
-    char lightSensor[MQTT_TOPIC_LENGTH]; // Light sensor topic
-    char tempSensor[MQTT_TOPIC_LENGTH];  // Temperature sensor topic
-    char doorSensor[MQTT_TOPIC_LENGTH];  // Door sensor topic
 } credentialConfig;
 
 /**
@@ -74,9 +69,10 @@ typedef enum DATA_ERROR_HANDLING
     JS_MQTT_CRD_ERROR,     // Error: Invalid MQTT credentials
     JS_TOPIC_CONFIG_ERROR, // Error: Invalid topic configuration
     JS_TOPIC_ERROR,      // Error: Invalid topic for relay
-    JS_TOPIC_TEMP_ERROR,   // Error: Invalid topic for temperature sensor
-    JS_TOPIC_LIGHT_ERROR,  // Error: Invalid topic for light sensor
-    JS_TOPIC_DOOR_ERROR,   // Error: Invalid topic for door sensor
+    JS_TOPIC_SENSOR_ERROR, // Error: Invalid topic for a registered sensor
+    JS_TOPIC_DIAG_ERROR,   // Error: Invalid topic for diagnostics reports
+    JS_BUNDLE_STORAGE_ERROR, // Error: Bundle was valid but could not be stored
+    JS_RULES_ERROR,        // Error: Invalid rules, or rules that could not be stored
     ALL_IS_OK,             // No errors, all data is valid
 } DataErrorHandle;
 
@@ -92,6 +88,18 @@ typedef enum DATA_ERROR_HANDLING
  * This function processes a JSON string representing runtime configuration for Wi-Fi,
  * MQTT, and topics. It updates the provided configuration structure with the extracted data.
  * If an error occurs during data extraction, the function returns the appropriate error code.
+ *
+ * Topics go to the topic table. Sensor topics are those of the drivers in the sensor
+ * registry: each driver brings its topic key and tconfigtype, so the drivers must be
+ * registered before any configuration is handled. A topic message with tconfigtype 2
+ * sets the topic of one relay: {"relayNo":n,"topic":"..."}.
+ *
+ * A bundle message (configtype 3) carries the keys of every section at once (the
+ * diagnostics and rules topics and relay1_topic to relay8_topic are optional). All of them
+ * are validated before anything is stored, and the whole bundle is then written in a single
+ * storage transaction, so the kit is either fully provisioned or left untouched.
+ *
+ * Each stored message is published as EVENT_CONFIG_CHANGED, on the calling task.
  */
 DataErrorHandle GetDataAtRunTime(char *js_string, credentialConfig *config);
 
@@ -114,9 +122,30 @@ void DisplyGetError(DataErrorHandle getError);
  *
  * @details
  * This function loads the stored configuration data (such as Wi-Fi credentials, MQTT
- * settings, and relay topics) from non-volatile storage and updates the provided configuration
+ * settings, and the topic table) from non-volatile storage and updates the provided configuration
  * structure with the retrieved values.
  */
 void RetrieveConfigFromStorage(credentialConfig *config);
 
+/**
+ * @brief Retrieves only the Wi-Fi and MQTT credentials from persistent storage.
+ *
+ * @param config (credentialConfig *): Pointer to the configuration structure to be updated.
+ *
+ * @details
+ * Fields missing from storage are left unchanged. Unlike RetrieveConfigFromStorage
+ * it leaves the topic table and the configuration version alone, so it can be used
+ * at run time to compare the stored credentials with the ones in use.
+ */
+void RetrieveCredentialsFromStorage(credentialConfig *config);
+
+/**
+ * @brief Returns the configuration version.
+ *
+ * @return uint32_t: Number of configuration messages stored since the kit was first
+ * provisioned. It is kept in NVS and goes up by one with every message that changed
+ * the stored configuration, in the same commit as a bundle.
+ */
+uint32_t GetConfigVersion(void);
+
 #endif // DATAHANDLE_H
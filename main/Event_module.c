@@ -0,0 +1,94 @@
+/******************************************************************************
+ * @file        Event_module.c
+ * @brief       Internal event bus with typed payloads and several subscribers.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Each event type has a fixed table of subscriber slots. A subscription claims the
+ * next slot with an atomic increment, fills it and then marks it ready, so
+ * publishers, which only read, never wait for a lock and never see a half-written
+ * slot. Slots are never released, which keeps the table consistent without any
+ * reclamation scheme. Each channel also remembers whether it has published yet, so
+ * a subscription that arrives too late to see every event is reported.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "LOG_module.h"
+#include "Event_module.h"
+
+typedef struct
+{
+    eventHandler handler;
+    void *context;
+    _Atomic bool ready; // Set once handler and context are written
+} eventSubscriber;
+
+typedef struct
+{
+    _Atomic uint32_t claimed; // Slots handed out, may exceed EVENT_MAX_SUBSCRIBERS
+    _Atomic bool published;   // Set by the first publication of the type
+    eventSubscriber subscribers[EVENT_MAX_SUBSCRIBERS];
+} eventChannel;
+
+static eventChannel eventChannels[EVENT_COUNT];
+
+bool Event_Subscribe(eventType type, eventHandler handler, void *context)
+{
+    if ((unsigned)type >= EVENT_COUNT || handler == NULL)
+    {
+        return false;
+    }
+
+    eventChannel *channel = &eventChannels[type];
+    uint32_t slot = atomic_fetch_add(&channel->claimed, 1);
+    if (slot >= EVENT_MAX_SUBSCRIBERS)
+    {
+        LOG_E(LOG_MODULE_MAIN, "No subscriber slot left for event %d", (int)type);
+        return false;
+    }
+    channel->subscribers[slot].handler = handler;
+    channel->subscribers[slot].context = context;
+    atomic_store_explicit(&channel->subscribers[slot].ready, true, memory_order_release);
+
+    if (atomic_load_explicit(&channel->published, memory_order_relaxed))
+    {
+        LOG_W(LOG_MODULE_MAIN, "Event %d subscribed after its publisher started, earlier events were missed", (int)type);
+    }
+    return true;
+}
+
+void Event_Publish(const appEvent *event)
+{
+    if (event == NULL || (unsigned)event->type >= EVENT_COUNT)
+    {
+        return;
+    }
+
+    eventChannel *channel = &eventChannels[event->type];
+    if (!atomic_load_explicit(&channel->published, memory_order_relaxed))
+    {
+        atomic_store_explicit(&channel->published, true, memory_order_relaxed);
+    }
+    uint32_t count = atomic_load_explicit(&channel->claimed, memory_order_acquire);
+    if (count > EVENT_MAX_SUBSCRIBERS)
+    {
+        count = EVENT_MAX_SUBSCRIBERS;
+    }
+    for (uint32_t slot = 0; slot < count; slot++)
+    {
+        eventSubscriber *subscriber = &channel->subscribers[slot];
+        if (atomic_load_explicit(&subscriber->ready, memory_order_acquire))
+        {
+            subscriber->handler(event, subscriber->context);
+        }
+    }
+}
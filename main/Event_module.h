@@ -0,0 +1,120 @@
+/******************************************************************************
+ * @file        Event_module.h
+ * @brief       Internal event bus with typed payloads and several subscribers.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the events the modules exchange. A module publishes an
+ * event with its payload and every handler subscribed to that event type runs, in
+ * the order they subscribed, on the publishing task and before Event_Publish
+ * returns. Publishers do not know their subscribers, and an event without any
+ * subscriber is simply not delivered. Nothing is queued, so no event can be dropped
+ * and the payload may point into the publisher's buffers; a handler that needs the
+ * data later copies it.
+ *
+ * Because nothing is queued, an event published before its handler subscribed is
+ * lost for that handler. The contract is therefore that every subscription is made
+ * during boot, before the module that publishes the event type is started: app_main
+ * starts the subscribers first, then the publishers. A subscription made after an
+ * event of its type was published is reported with a warning.
+ ******************************************************************************/
+#ifndef EVENT_MODULE_H
+#define EVENT_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_MAX_SUBSCRIBERS 4 // Handlers per event type
+
+/**
+ * @brief Event types.
+ */
+typedef enum
+{
+    EVENT_MQTT_CONNECTED,    // Connected to the broker, payload mqttConnected
+    EVENT_MQTT_DATA,         // Message received, payload mqttData
+    EVENT_MQTT_DISCONNECTED, // Connection lost or closed, no payload
+    EVENT_CONFIG_CHANGED,    // Configuration message stored, payload configChanged
+    EVENT_RELAY_CHANGED,     // Relay outputs switched, payload relayChanged
+    EVENT_SHADOW_CHANGED,    // Shadow has a new sequence number, payload shadowChanged
+    EVENT_WIFI_CHANGED,      // Station gained or lost its address, payload wifiChanged
+    EVENT_COUNT,
+} eventType;
+
+/**
+ * @brief An event and its payload, the member named after the type.
+ */
+typedef struct
+{
+    eventType type;
+    union
+    {
+        struct
+        {
+            uint32_t connects; // Connections since boot, this one included
+        } mqttConnected;
+        struct
+        {
+            const char *topic; // Not null-terminated
+            int topicLength;
+            const char *data; // Not null-terminated
+            int dataLength;
+        } mqttData;
+        struct
+        {
+            int32_t configType; // configtype of the stored message
+        } configChanged;
+        struct
+        {
+            const uint32_t *shadow;  // New relay states, RELAY_WORDS words, relay 1 in bit 0
+            const uint32_t *changed; // Relays switched, same layout
+        } relayChanged;
+        struct
+        {
+            uint32_t sequence; // Sequence number of the new shadow
+        } shadowChanged;
+        struct
+        {
+            bool up; // true once the station holds an address
+        } wifiChanged;
+    };
+} appEvent;
+
+/**
+ * @brief Handles one event.
+ *
+ * @param event (const appEvent *): The event, valid only during the call.
+ * @param context (void *): Context given to Event_Subscribe.
+ */
+typedef void (*eventHandler)(const appEvent *event, void *context);
+
+/**
+ * @brief Subscribes a handler to an event type for the rest of the run.
+ *
+ * @param type (eventType): Event type.
+ * @param handler (eventHandler): Runs on the publishing task; see each publisher for
+ * what the handler may do there.
+ * @param context (void *): Passed back to the handler.
+ *
+ * @return bool: false if the type is invalid or already has EVENT_MAX_SUBSCRIBERS handlers.
+ *
+ * @details
+ * Call it before the publishers of the type are started; events published earlier
+ * are not replayed. Lock-free, so it may be called from any task; a handler
+ * subscribed while an event is being published may or may not receive that event.
+ */
+bool Event_Subscribe(eventType type, eventHandler handler, void *context);
+
+/**
+ * @brief Runs the handlers subscribed to the type of the event.
+ *
+ * @param event (const appEvent *): Event and payload.
+ */
+void Event_Publish(const appEvent *event);
+
+#endif // EVENT_MODULE_H
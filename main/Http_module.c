@@ -0,0 +1,229 @@
+/******************************************************************************
+ * @file        Http_module.c
+ * @brief       Local HTTP and WebSocket API of the relays, without the broker hop.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Everything runs on the esp_http_server task: the handlers, and the pushes, which
+ * the shadow event handler hands over with httpd_queue_work. The handler queues at most
+ * one push at a time; the push reads the shadow when it runs, so changes made while
+ * it was queued are in it. Request bodies and frames are read into fixed buffers of
+ * COMMAND_PAYLOAD_LENGTH, larger ones are refused without being read.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "LOG_module.h"
+#include "Command_module.h"
+#include "Shadow_module.h"
+#include "Task_module.h"
+#include "Event_module.h"
+#include "Http_module.h"
+
+#if HTTP_ENABLE
+#include "esp_http_server.h"
+
+static httpd_handle_t httpServer = NULL;
+static atomic_bool httpPushPending = false;
+
+// Send a text frame to one WebSocket client, from the server task
+static void Http_SendText(int fd, const char *text, size_t length)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = length,
+    };
+
+    if (httpd_ws_send_frame_async(httpServer, fd, &frame) != ESP_OK)
+    {
+        LOG_D(LOG_MODULE_HTTP, "Push to socket %d failed", fd);
+    }
+}
+
+// Work item: send the current shadow to every WebSocket client
+static void Http_PushWork(void *arg)
+{
+    char message[SHADOW_LENGTH];
+    int clients[HTTP_MAX_CLIENTS];
+    size_t count = HTTP_MAX_CLIENTS;
+
+    atomic_store(&httpPushPending, false); // A change from now on queues another push
+    size_t length = Shadow_Get(message, sizeof(message));
+    if (length == 0 || httpd_get_client_list(httpServer, &count, clients) != ESP_OK)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (httpd_ws_get_fd_info(httpServer, clients[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+        {
+            Http_SendText(clients[i], message, length);
+        }
+    }
+}
+
+// Work item: send the current shadow to a client that just connected
+static void Http_GreetWork(void *arg)
+{
+    char message[SHADOW_LENGTH];
+    size_t length = Shadow_Get(message, sizeof(message));
+
+    if (length > 0)
+    {
+        Http_SendText((int)(intptr_t)arg, message, length);
+    }
+}
+
+// EVENT_SHADOW_CHANGED, runs on the shadow task
+static void Http_ShadowChanged(const appEvent *event, void *context)
+{
+    if (!atomic_exchange(&httpPushPending, true) && httpd_queue_work(httpServer, Http_PushWork, NULL) != ESP_OK)
+    {
+        atomic_store(&httpPushPending, false);
+    }
+}
+
+// GET /relays: the current shadow
+static esp_err_t Http_GetRelays(httpd_req_t *req)
+{
+    char message[SHADOW_LENGTH];
+    size_t length = Shadow_Get(message, sizeof(message));
+
+    if (length == 0)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No shadow yet");
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, message, length);
+}
+
+// POST /relays: one relay command
+static esp_err_t Http_PostRelays(httpd_req_t *req)
+{
+    char payload[COMMAND_PAYLOAD_LENGTH];
+    char reply[COMMAND_REPLY_LENGTH];
+    size_t received = 0;
+
+    if (req->content_len == 0 || req->content_len >= sizeof(payload))
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Command too long or empty");
+    }
+    while (received < req->content_len)
+    {
+        int length = httpd_req_recv(req, payload + received, req->content_len - received);
+        if (length == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            continue;
+        }
+        if (length <= 0)
+        {
+            return ESP_FAIL; // Connection lost, the server closes the socket
+        }
+        received += (size_t)length;
+    }
+
+    if (!Command_HandleLocal(payload, (int)received, reply, sizeof(reply)))
+    {
+        httpd_resp_set_status(req, "400 Bad Request");
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, reply, HTTPD_RESP_USE_STRLEN);
+}
+
+// /ws: called once for the handshake, then once per received frame
+static esp_err_t Http_WebSocket(httpd_req_t *req)
+{
+    uint8_t payload[COMMAND_PAYLOAD_LENGTH];
+    char reply[COMMAND_REPLY_LENGTH];
+    httpd_ws_frame_t frame = {0};
+
+    if (req->method == HTTP_GET)
+    {
+        // The handshake reply is out, greet the client once the handler has returned
+        httpd_queue_work(req->handle, Http_GreetWork, (void *)(intptr_t)httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    // Read the length first, so a frame that does not fit is refused, not cut
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    if (frame.type != HTTPD_WS_TYPE_TEXT)
+    {
+        return ESP_OK; // Control frames are handled by the server
+    }
+    if (frame.len == 0 || frame.len >= sizeof(payload))
+    {
+        LOG_W(LOG_MODULE_HTTP, "Frame of %u bytes refused", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+    frame.payload = payload;
+    if (httpd_ws_recv_frame(req, &frame, sizeof(payload)) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    Command_HandleLocal((const char *)payload, (int)frame.len, reply, sizeof(reply));
+    frame = (httpd_ws_frame_t){
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)reply,
+        .len = strlen(reply),
+    };
+    return httpd_ws_send_frame(req, &frame);
+}
+
+static const httpd_uri_t httpRoutes[] = {
+    {.uri = HTTP_RELAY_URI, .method = HTTP_GET, .handler = Http_GetRelays},
+    {.uri = HTTP_RELAY_URI, .method = HTTP_POST, .handler = Http_PostRelays},
+    {.uri = HTTP_WS_URI, .method = HTTP_GET, .handler = Http_WebSocket, .is_websocket = true},
+};
+
+void Http_Start(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+    if (httpServer != NULL)
+    {
+        return; // Already running
+    }
+
+    config.server_port = HTTP_PORT;
+    config.max_open_sockets = HTTP_MAX_CLIENTS;
+    config.lru_purge_enable = true;
+    config.stack_size = HTTP_STACK_SIZE;
+    config.task_priority = TASK_APP_PRIORITY;
+    config.core_id = TASK_ACTUATION_CORE; // Beside the other relay command handling
+
+    if (httpd_start(&httpServer, &config) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_HTTP, "Local API not started on port %u", (unsigned)HTTP_PORT);
+        httpServer = NULL;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(httpRoutes) / sizeof(httpRoutes[0]); i++)
+    {
+        httpd_register_uri_handler(httpServer, &httpRoutes[i]);
+    }
+    Event_Subscribe(EVENT_SHADOW_CHANGED, Http_ShadowChanged, NULL);
+    LOG_I(LOG_MODULE_HTTP, "Local API on port %u", (unsigned)HTTP_PORT);
+}
+
+#else
+
+void Http_Start(void)
+{
+}
+
+#endif // HTTP_ENABLE
@@ -0,0 +1,52 @@
+/******************************************************************************
+ * @file        Http_module.h
+ * @brief       Local HTTP and WebSocket API of the relays, without the broker hop.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the local API, built when CONFIG_OKTA_LOCAL_API is set.
+ * A client on the same network reads and switches the relays directly:
+ * - GET /relays returns the current shadow (see Shadow_module.h).
+ * - POST /relays takes a relay command, single or batch, as on the relay topic, and
+ *   returns the result of Command_HandleLocal; the status is 400 if it was not applied.
+ * - /ws is a WebSocket. The current shadow is sent on connection and after every
+ *   change; each text frame received is a relay command, answered by its result.
+ *
+ * Commands are handled on the server task, so a command costs one local round trip
+ * instead of two broker hops. Pushes follow the shadow, SHADOW_SETTLE_MS after the
+ * change, so a burst of changes is one frame.
+ ******************************************************************************/
+#ifndef HTTP_MODULE_H
+#define HTTP_MODULE_H
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_OKTA_LOCAL_API
+#define HTTP_ENABLE 1                        // Local API built in
+#define HTTP_PORT CONFIG_OKTA_LOCAL_API_PORT // TCP port of the local API
+#else
+#define HTTP_ENABLE 0
+#define HTTP_PORT 80
+#endif
+
+#define HTTP_MAX_CLIENTS 7         // Open sockets, HTTP and WebSocket together
+#define HTTP_STACK_SIZE 4096       // Server task stack size
+#define HTTP_RELAY_URI "/relays"   // State and control
+#define HTTP_WS_URI "/ws"          // State pushes and control
+
+/**
+ * @brief Starts the local API server, after the network interface is up.
+ *
+ * @details
+ * Call it before Shadow_Start, so the first EVENT_SHADOW_CHANGED is pushed. Does
+ * nothing when the local API is not built in or already running. Sockets are
+ * recycled least recently used first, so idle clients cannot lock out new ones.
+ */
+void Http_Start(void);
+
+#endif // HTTP_MODULE_H
@@ -14,31 +14,125 @@
  * and extract specific data types (string and integer values).
  * These functions are designed to simplify the process of retrieving key-value pairs from JSON data in embedded systems,
  * ensuring robust error handling and efficient memory management.
-
+ *
+ * cJSON allocates every node, key and string of a document separately. These
+ * allocations are served from a static pool with a bump pointer while a document is
+ * parsed; frees inside the pool are ignored and the whole pool is reset when the
+ * document is released. A mutex gives the pool to one task per document. Requests
+ * that do not fit fall back to the heap and are counted, so JSON_POOL_SIZE can be
+ * tuned from the diagnostics report.
  ******************************************************************************/
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdint.h>
-#include "esp_log.h"
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
+#include "LOG_module.h"
 #include "JSON_module.h"
 
-static const char *JSON_TAG = "JSON";
+#define JSON_POOL_ALIGN 8 // Enough for the doubles held by cJSON nodes
 
-bool JSON_ExtractString(const char *json_str, const char *key, char *string, size_t max_len)
+static uint8_t jsonPool[JSON_POOL_SIZE] __attribute__((aligned(JSON_POOL_ALIGN)));
+static size_t jsonPoolUsed = 0;             // Bump pointer of the current document
+static TaskHandle_t jsonPoolOwner = NULL;   // Task parsing from the pool
+static SemaphoreHandle_t jsonPoolLock = NULL;
+static StaticSemaphore_t jsonPoolLockBuffer;
+static jsonPoolStats jsonStats;
+
+// cJSON malloc hook: the pool for the owner task, the heap for everybody else
+static void *JSON_PoolMalloc(size_t size)
+{
+    if (jsonPoolOwner != NULL && jsonPoolOwner == xTaskGetCurrentTaskHandle())
+    {
+        size_t aligned = (size + JSON_POOL_ALIGN - 1) & ~(size_t)(JSON_POOL_ALIGN - 1);
+        if (aligned <= JSON_POOL_SIZE - jsonPoolUsed)
+        {
+            void *block = &jsonPool[jsonPoolUsed];
+            jsonPoolUsed += aligned;
+            if (jsonPoolUsed > jsonStats.peakBytes)
+            {
+                jsonStats.peakBytes = (uint32_t)jsonPoolUsed;
+            }
+            return block;
+        }
+        jsonStats.fallbacks++;
+    }
+    return malloc(size);
+}
+
+// cJSON free hook: pool blocks are released with their document
+static void JSON_PoolFree(void *ptr)
+{
+    if ((uint8_t *)ptr >= jsonPool && (uint8_t *)ptr < jsonPool + JSON_POOL_SIZE)
+    {
+        return;
+    }
+    free(ptr);
+}
+
+// Take the pool and parse a document into it; always pair with JSON_ReleaseDocument
+static cJSON *JSON_ParseDocument(const char *json_str)
+{
+    if (jsonPoolLock == NULL)
+    {
+        return cJSON_Parse(json_str); // JSON_Init not called yet, use the heap
+    }
+    xSemaphoreTake(jsonPoolLock, portMAX_DELAY);
+    jsonPoolUsed = 0;
+    jsonPoolOwner = xTaskGetCurrentTaskHandle();
+    return cJSON_Parse(json_str);
+}
+
+// Free the document and hand the pool back
+static void JSON_ReleaseDocument(cJSON *json)
+{
+    cJSON_Delete(json); // Returns fallback blocks to the heap
+    if (jsonPoolLock == NULL)
+    {
+        return;
+    }
+    jsonPoolOwner = NULL;
+    jsonPoolUsed = 0;
+    jsonStats.documents++;
+    xSemaphoreGive(jsonPoolLock);
+}
+
+void JSON_Init(void)
+{
+    if (jsonPoolLock != NULL)
+    {
+        return;
+    }
+
+    cJSON_Hooks hooks = {.malloc_fn = JSON_PoolMalloc, .free_fn = JSON_PoolFree};
+    jsonPoolLock = xSemaphoreCreateMutexStatic(&jsonPoolLockBuffer);
+    cJSON_InitHooks(&hooks);
+}
+
+void JSON_GetPoolStats(jsonPoolStats *stats)
+{
+    *stats = jsonStats;
+}
+
+// Shared string extraction, a missing key is only reported when it is required
+static bool JSON_ReadString(const char *json_str, const char *key, char *string, size_t max_len, bool required)
 {
     if (json_str == NULL || key == NULL || string == NULL || max_len == 0)
     {
-        ESP_LOGE(JSON_TAG, "Invalid Arguments");
+        LOG_E(LOG_MODULE_JSON, "Invalid Arguments");
         return false;
     }
 
     // Parse the JSON string
-    cJSON *json = cJSON_Parse(json_str);
+    cJSON *json = JSON_ParseDocument(json_str);
     if (json == NULL)
     {
-        ESP_LOGE(JSON_TAG, "Failed to Parse JSON");
+        LOG_E(LOG_MODULE_JSON, "Failed to Parse JSON");
+        JSON_ReleaseDocument(json);
         return false;
     }
 
@@ -46,37 +140,49 @@ bool JSON_ExtractString(const char *json_str, const char *key, char *string, siz
     cJSON *item = cJSON_GetObjectItem(json, key);
     if (!cJSON_IsString(item))
     {
-        ESP_LOGE(JSON_TAG, "Invalid Or Missing Key '%s' In JSON", key);
-        cJSON_Delete(json);
+        if (required || item != NULL)
+        {
+            LOG_KEY_E(LOG_MODULE_JSON, key, "Invalid Or Missing Key In JSON");
+        }
+        JSON_ReleaseDocument(json);
         return false;
     }
 
     // Copy the value to the output buffer
     strncpy(string, item->valuestring, max_len - 1);
     string[max_len - 1] = '\0'; // Ensure null-termination
-    ESP_LOGI(JSON_TAG, "{ %s : %s }", key, string);
+    LOG_KEY_D(LOG_MODULE_JSON, key, "String of %u chars", (unsigned)strlen(string)); // Values may be secrets
 
     // Clean up
-    cJSON_Delete(json);
+    JSON_ReleaseDocument(json);
     return true;
 }
 
+bool JSON_ExtractString(const char *json_str, const char *key, char *string, size_t max_len)
+{
+    return JSON_ReadString(json_str, key, string, max_len, true);
+}
 
+bool JSON_ExtractOptionalString(const char *json_str, const char *key, char *string, size_t max_len)
+{
+    return JSON_ReadString(json_str, key, string, max_len, false);
+}
 
-
-bool JSON_ExtractInt32(const char *json_str, const char *key, int32_t *value)
+// Shared integer extraction, a missing key is only reported when it is required
+static bool JSON_ReadInt32(const char *json_str, const char *key, int32_t *value, bool required)
 {
     if (json_str == NULL || key == NULL || value == NULL)
     {
-        ESP_LOGE(JSON_TAG, "Invalid Arguments");
+        LOG_E(LOG_MODULE_JSON, "Invalid Arguments");
         return false;
     }
 
     // Parse the JSON string
-    cJSON *json = cJSON_Parse(json_str);
+    cJSON *json = JSON_ParseDocument(json_str);
     if (json == NULL)
     {
-        ESP_LOGE(JSON_TAG, "Failed to Parse JSON");
+        LOG_E(LOG_MODULE_JSON, "Failed to Parse JSON");
+        JSON_ReleaseDocument(json);
         return false;
     }
 
@@ -84,16 +190,156 @@ bool JSON_ExtractInt32(const char *json_str, const char *key, int32_t *value)
     cJSON *item = cJSON_GetObjectItem(json, key);
     if (!cJSON_IsNumber(item))
     {
-        ESP_LOGE(JSON_TAG, "Invalid Or Missing Key '%s' In JSON", key);
-        cJSON_Delete(json);
+        if (required || item != NULL)
+        {
+            LOG_KEY_E(LOG_MODULE_JSON, key, "Invalid Or Missing Key In JSON");
+        }
+        JSON_ReleaseDocument(json);
         return false;
     }
 
     // Retrieve the value
     *value = (int32_t)item->valueint;
-    ESP_LOGI(JSON_TAG, "{ %s : %ld }", key, *value);
+    LOG_KEY_D(LOG_MODULE_JSON, key, "%ld", (long)*value);
 
     // Clean up
-    cJSON_Delete(json);
+    JSON_ReleaseDocument(json);
     return true;
 }
+
+bool JSON_ExtractInt32(const char *json_str, const char *key, int32_t *value)
+{
+    return JSON_ReadInt32(json_str, key, value, true);
+}
+
+bool JSON_ExtractOptionalInt32(const char *json_str, const char *key, int32_t *value)
+{
+    return JSON_ReadInt32(json_str, key, value, false);
+}
+
+bool JSON_ReadObject(const char *json_str, jsonItemCallback callback, void *context)
+{
+    if (json_str == NULL || callback == NULL)
+    {
+        LOG_E(LOG_MODULE_JSON, "Invalid Arguments");
+        return false;
+    }
+
+    // Parse the JSON string
+    cJSON *json = JSON_ParseDocument(json_str);
+    if (!cJSON_IsObject(json))
+    {
+        LOG_E(LOG_MODULE_JSON, "Failed to Parse JSON");
+        JSON_ReleaseDocument(json);
+        return false;
+    }
+
+    // Read the members while the document is held
+    bool result = callback(json, 0, context);
+
+    JSON_ReleaseDocument(json);
+    return result;
+}
+
+bool JSON_ForEachArrayItem(const char *json_str, const char *key, jsonItemCallback callback, void *context, size_t *count)
+{
+    size_t index = 0;
+    bool complete = true;
+
+    if (count != NULL)
+    {
+        *count = 0;
+    }
+    if (json_str == NULL || key == NULL || callback == NULL)
+    {
+        LOG_E(LOG_MODULE_JSON, "Invalid Arguments");
+        return false;
+    }
+
+    // Parse the JSON string
+    cJSON *json = JSON_ParseDocument(json_str);
+    if (json == NULL)
+    {
+        LOG_E(LOG_MODULE_JSON, "Failed to Parse JSON");
+        JSON_ReleaseDocument(json);
+        return false;
+    }
+
+    // Get the array associated with the key
+    cJSON *array = cJSON_GetObjectItem(json, key);
+    if (!cJSON_IsArray(array))
+    {
+        LOG_KEY_E(LOG_MODULE_JSON, key, "Invalid Or Missing Key In JSON");
+        JSON_ReleaseDocument(json);
+        return false;
+    }
+
+    // Visit the elements while the document is held
+    const cJSON *item;
+    cJSON_ArrayForEach(item, array)
+    {
+        if (!callback(item, index, context))
+        {
+            complete = false;
+            break;
+        }
+        index++;
+    }
+
+    if (count != NULL)
+    {
+        *count = index;
+    }
+    JSON_ReleaseDocument(json);
+    return complete;
+}
+
+bool JSON_ItemString(const jsonItem *item, const char *key, char *string, size_t max_len)
+{
+    const cJSON *member = cJSON_GetObjectItem(item, key);
+
+    if (!cJSON_IsString(member) || string == NULL || strlen(member->valuestring) >= max_len)
+    {
+        return false;
+    }
+    strcpy(string, member->valuestring);
+    return true;
+}
+
+bool JSON_ItemInt32(const jsonItem *item, const char *key, int32_t *value)
+{
+    const cJSON *member = cJSON_GetObjectItem(item, key);
+
+    if (!cJSON_IsNumber(member) || value == NULL)
+    {
+        return false;
+    }
+    *value = (int32_t)member->valueint;
+    return true;
+}
+
+bool JSON_ItemArray(const jsonItem *item, const char *key, jsonItemCallback callback, void *context, size_t *count)
+{
+    const cJSON *array = cJSON_GetObjectItem(item, key);
+    const cJSON *element;
+    size_t index = 0;
+    bool complete = cJSON_IsArray(array) && callback != NULL;
+
+    if (complete)
+    {
+        cJSON_ArrayForEach(element, array)
+        {
+            if (!callback(element, index, context))
+            {
+                complete = false;
+                break;
+            }
+            index++;
+        }
+    }
+    if (count != NULL)
+    {
+        *count = index;
+    }
+    return complete;
+}
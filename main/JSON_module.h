@@ -12,10 +12,59 @@
  * This header file declares the APIs for extracting string and integer values
  * from a JSON-formatted string. It provides functions to retrieve values based
  * on a specified key, supporting both string and integer data types.
+ *
+ * The cJSON tree of each document is allocated from a fixed pool owned by one task
+ * at a time and released all at once when the document is done, so parsing never
+ * leaves holes in the general heap.
  ******************************************************************************/
 #ifndef JSON_MODULE_H
 #define JSON_MODULE_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_POOL_SIZE 3072 // Bytes for the cJSON tree of one document
+
+typedef struct cJSON jsonItem; // One element of an array, see JSON_ForEachArrayItem
+
+/**
+ * @brief Receives each element of an array.
+ *
+ * @param item (const jsonItem *): The element, valid during the call only.
+ * @param index (size_t): Position of the element in the array.
+ * @param context (void *): Context given to JSON_ForEachArrayItem.
+ *
+ * @return bool: false to stop the iteration.
+ */
+typedef bool (*jsonItemCallback)(const jsonItem *item, size_t index, void *context);
+
+/**
+ * @brief Usage counters of the document pool.
+ */
+typedef struct
+{
+    uint32_t documents; // Documents parsed from the pool
+    uint32_t peakBytes; // Largest pool usage of a single document
+    uint32_t fallbacks; // Allocations that did not fit and went to the heap
+} jsonPoolStats;
+
+/**
+ * @brief Routes cJSON allocations through the document pool.
+ *
+ * @details
+ * Must be called once at startup, before any JSON is parsed. cJSON allocations made
+ * outside of this module (by tasks that do not hold the pool) still use the heap.
+ */
+void JSON_Init(void);
+
+/**
+ * @brief Copies the pool counters.
+ *
+ * @param stats (jsonPoolStats *): Receives the counters.
+ */
+void JSON_GetPoolStats(jsonPoolStats *stats);
+
 /**
  * @brief This function extracts a string value associated with
  * a given key from a JSON-formatted string and stores it in the provided buffer.
@@ -31,7 +80,19 @@
  */
 bool JSON_ExtractString(const char *json_str, const char *key, char *string, size_t max_len);
 
-
+/**
+ * @brief Same as JSON_ExtractString for keys that may be left out.
+ *
+ * @param json_str (const char *): The JSON-formatted string input.
+ * @param key (const char *): The key whose corresponding string value needs to be extracted.
+ * @param output_string (char *): Receives the value, untouched when the key is absent.
+ * @param output_size (size_t): The size of the output_string buffer to prevent buffer overflows.
+ *
+ * @return bool
+ * - Returns true if the value is present and is a string.
+ * - Returns false otherwise. A missing key is not logged as an error.
+ */
+bool JSON_ExtractOptionalString(const char *json_str, const char *key, char *string, size_t max_len);
 
 /**
  * @brief This function extracts an integer value associated with
@@ -47,4 +108,94 @@ bool JSON_ExtractString(const char *json_str, const char *key, char *string, siz
  */
 bool JSON_ExtractInt32(const char *json_str, const char *key, int32_t *value);
 
+/**
+ * @brief Same as JSON_ExtractInt32 for keys that may be left out.
+ *
+ * @param json_str (const char *): The JSON string input.
+ * @param key (const char *): The key whose corresponding integer value needs to be extracted.
+ * @param output_value (int32_t *): Receives the value, untouched when the key is absent.
+ *
+ * @return bool
+ * - Returns true if the value is present and is a number.
+ * - Returns false otherwise. A missing key is not logged as an error.
+ */
+bool JSON_ExtractOptionalInt32(const char *json_str, const char *key, int32_t *value);
+
+/**
+ * @brief Parses a document once and passes its root object to a function.
+ *
+ * @param json_str (const char *): The JSON string input.
+ * @param callback (jsonItemCallback): Called once with the root object and index 0;
+ * members are read with JSON_ItemString and JSON_ItemInt32.
+ * @param context (void *): Passed to the callback.
+ *
+ * @return bool
+ * - Returns the result of the callback.
+ * - Returns false if the JSON is invalid or is not an object.
+ *
+ * @details
+ * Reading several keys this way costs one parse instead of one per key. The document
+ * holds the pool during the call, so the callback must not parse another document.
+ */
+bool JSON_ReadObject(const char *json_str, jsonItemCallback callback, void *context);
+
+/**
+ * @brief Calls a function for each element of an array.
+ *
+ * @param json_str (const char *): The JSON string input.
+ * @param key (const char *): The key of the array.
+ * @param callback (jsonItemCallback): Called for each element, in order.
+ * @param context (void *): Passed to the callback.
+ * @param count (size_t *): Receives the number of elements visited, may be NULL.
+ *
+ * @return bool
+ * - Returns true if the array was visited to its end.
+ * - Returns false if the JSON is invalid, the key is missing or not an array, or the
+ *   callback stopped the iteration.
+ *
+ * @details
+ * The document holds the pool until the iteration ends, so the callback must not
+ * parse another document.
+ */
+bool JSON_ForEachArrayItem(const char *json_str, const char *key, jsonItemCallback callback, void *context, size_t *count);
+
+/**
+ * @brief Extracts a string member of an array element.
+ *
+ * @param item (const jsonItem *): The element.
+ * @param key (const char *): The member key.
+ * @param string (char *): Receives the value, null-terminated.
+ * @param max_len (size_t): The size of the string buffer.
+ *
+ * @return bool: false if the member is missing, is not a string or does not fit.
+ * Nothing is logged; the caller knows which element was wrong.
+ */
+bool JSON_ItemString(const jsonItem *item, const char *key, char *string, size_t max_len);
+
+/**
+ * @brief Extracts an integer member of an array element.
+ *
+ * @param item (const jsonItem *): The element.
+ * @param key (const char *): The member key.
+ * @param value (int32_t *): Receives the value, untouched when the member is absent.
+ *
+ * @return bool: false if the member is missing or is not a number. Nothing is logged.
+ */
+bool JSON_ItemInt32(const jsonItem *item, const char *key, int32_t *value);
+
+/**
+ * @brief Calls a function for each element of an array member, without parsing again.
+ *
+ * @param item (const jsonItem *): The object holding the array, e.g. the root given by
+ * JSON_ReadObject.
+ * @param key (const char *): The member key.
+ * @param callback (jsonItemCallback): Called for each element, in order.
+ * @param context (void *): Passed to the callback.
+ * @param count (size_t *): Receives the number of elements visited, may be NULL.
+ *
+ * @return bool: false if the member is missing or is not an array, or the callback
+ * stopped the iteration. Nothing is logged.
+ */
+bool JSON_ItemArray(const jsonItem *item, const char *key, jsonItemCallback callback, void *context, size_t *count);
+
 #endif // JSON_MODULE_H
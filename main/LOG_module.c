@@ -0,0 +1,344 @@
+/******************************************************************************
+ * @file        LOG_module.c
+ * @brief       Asynchronous ring-buffered logging with deferred formatting.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Producers claim a slot of a bounded multi-producer ring with a single atomic
+ * compare-and-swap and publish it through a per-slot sequence number, so no task
+ * ever blocks on a lock or on the UART. The drain task is the only consumer: it
+ * copies each ready record out of the ring, releases the slot and formats the
+ * record one conversion at a time, each argument cast back to the type its
+ * conversion expects, so printf never reads an argument of the wrong type. When
+ * the ring is full the record is dropped and counted; the drain task reports the
+ * count the next time it runs.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "LOG_module.h"
+#include "Task_module.h"
+
+// One binary log record
+typedef struct
+{
+    _Atomic uint32_t sequence; // Slot state: position to write, position + 1 once readable
+    uint32_t timestamp;        // Milliseconds since boot
+    const char *format;        // Format string, also serves as the format id
+    uint8_t module;            // logModule
+    uint8_t level;             // esp_log_level_t
+    uint8_t argCount;          // Number of valid args
+    char key[LOG_KEY_LENGTH];  // Optional copied key, empty when unused
+    uintptr_t args[LOG_MAX_ARGS];
+} logRecord;
+
+static logRecord logRing[LOG_RING_SIZE];
+static _Atomic uint32_t logHead;     // Next position claimed by a producer
+static uint32_t logTail;             // Next position read by the drain task
+static _Atomic uint32_t logDropped;  // Records lost because the ring was full
+static bool logReady = false;        // Set once the ring has been initialized
+
+// Runtime level of each module
+static uint8_t logLevels[LOG_MODULE_COUNT] = {[0 ... LOG_MODULE_COUNT - 1] = LOG_DEFAULT_LEVEL};
+
+// Tags printed for each module, in logModule order
+static const char *const logModuleTags[LOG_MODULE_COUNT] = {
+    "MAIN", "MQTT", "JSON", "MEMORY", "RELAY", "DATA_HANDLE", "BLE-Server", "WIFI", "SENSOR", "RULE", "HTTP"};
+
+// Level letters in esp_log_level_t order
+static const char logLevelLetters[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+// Format one conversion of the record format, with the argument converted back to the
+// type the conversion expects. Returns false for a conversion the records cannot carry.
+static bool LOG_FormatArg(char *text, size_t size, const char *spec, const char *length, char conversion, uintptr_t value)
+{
+    bool isLong = strcmp(length, "l") == 0;
+    bool isSize = strcmp(length, "z") == 0 || strcmp(length, "t") == 0;
+    bool isShort = strcmp(length, "h") == 0 || strcmp(length, "hh") == 0 || length[0] == '\0';
+
+    switch (conversion)
+    {
+    case 'd':
+    case 'i':
+        if (isLong)
+        {
+            snprintf(text, size, spec, (long)(intptr_t)value);
+        }
+        else if (isSize)
+        {
+            snprintf(text, size, spec, (ptrdiff_t)(intptr_t)value);
+        }
+        else if (isShort)
+        {
+            snprintf(text, size, spec, (int)(intptr_t)value);
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        if (isLong)
+        {
+            snprintf(text, size, spec, (unsigned long)value);
+        }
+        else if (isSize)
+        {
+            snprintf(text, size, spec, (size_t)value);
+        }
+        else if (isShort)
+        {
+            snprintf(text, size, spec, (unsigned)value);
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    case 'c':
+        snprintf(text, size, spec, (int)value);
+        return length[0] == '\0';
+    case 's':
+        snprintf(text, size, spec, value != 0 ? (const char *)value : "(null)");
+        return length[0] == '\0';
+    case 'p':
+        snprintf(text, size, spec, (void *)value);
+        return length[0] == '\0';
+    default:
+        return false;
+    }
+}
+
+// Format the message of a record into text, one conversion at a time
+static void LOG_FormatMessage(const logRecord *record, char *text, size_t size)
+{
+    const char *format = record->format;
+    size_t used = 0;
+    uint8_t arg = 0;
+
+    text[0] = '\0';
+    while (*format != '\0' && used < size - 1)
+    {
+        if (*format != '%')
+        {
+            text[used++] = *format++;
+            text[used] = '\0';
+            continue;
+        }
+        if (format[1] == '%')
+        {
+            text[used++] = '%';
+            text[used] = '\0';
+            format += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, without '*'
+        const char *start = format++;
+        format += strspn(format, "-+ #0");
+        format += strspn(format, "0123456789");
+        if (*format == '.')
+        {
+            format++;
+            format += strspn(format, "0123456789");
+        }
+        const char *lengthStart = format;
+        format += strspn(format, "hlzt");
+        char conversion = *format;
+        if (conversion != '\0')
+        {
+            format++;
+        }
+
+        char spec[LOG_SPEC_LENGTH];
+        char length[3];
+        size_t specLength = (size_t)(format - start);
+        size_t lengthLength = (size_t)(format - lengthStart) - (conversion != '\0');
+        bool valid = specLength < sizeof(spec) && lengthLength < sizeof(length) && arg < record->argCount;
+        if (valid)
+        {
+            memcpy(spec, start, specLength);
+            spec[specLength] = '\0';
+            memcpy(length, lengthStart, lengthLength);
+            length[lengthLength] = '\0';
+            valid = LOG_FormatArg(&text[used], size - used, spec, length, conversion, record->args[arg]);
+        }
+        if (!valid)
+        {
+            // Print the conversion itself rather than guess at an argument
+            snprintf(&text[used], size - used, "%.*s", (int)(format - start), start);
+        }
+        arg++;
+        used += strlen(&text[used]);
+    }
+}
+
+// Format and print one record in the usual ESP-IDF log layout
+static void LOG_Print(const logRecord *record)
+{
+    char message[LOG_LINE_LENGTH];
+    LOG_FormatMessage(record, message, sizeof(message));
+
+    printf("%c (%lu) %s: ", logLevelLetters[record->level], (unsigned long)record->timestamp, logModuleTags[record->module]);
+    if (record->key[0] != '\0')
+    {
+        printf("[%s] ", record->key);
+    }
+    printf("%s\n", message);
+}
+
+// Fill a record from the caller's arguments
+static void LOG_Fill(logRecord *record, logModule module, esp_log_level_t level, const char *key, const char *format, const uintptr_t *args, uint8_t argCount)
+{
+    record->timestamp = esp_log_timestamp();
+    record->format = format;
+    record->module = (uint8_t)module;
+    record->level = (uint8_t)level;
+    record->argCount = argCount;
+
+    memset(record->args, 0, sizeof(record->args));
+    memcpy(record->args, args, argCount * sizeof(uintptr_t));
+
+    if (key != NULL)
+    {
+        strncpy(record->key, key, sizeof(record->key) - 1);
+        record->key[sizeof(record->key) - 1] = '\0';
+    }
+    else
+    {
+        record->key[0] = '\0';
+    }
+}
+
+// Low-priority task that formats and prints the queued records
+static void LOG_DrainTask(void *param)
+{
+    uint32_t reportedDrops = 0;
+
+    while (1)
+    {
+        while (1)
+        {
+            logRecord *slot = &logRing[logTail & (LOG_RING_SIZE - 1)];
+            uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+            if (sequence != logTail + 1)
+            {
+                break; // Nothing ready yet
+            }
+
+            // Copy out and hand the slot back before the slow formatting
+            logRecord record;
+            memcpy(&record, slot, sizeof(record));
+            atomic_store_explicit(&slot->sequence, logTail + LOG_RING_SIZE, memory_order_release);
+            logTail++;
+
+            LOG_Print(&record);
+        }
+
+        uint32_t dropped = atomic_load_explicit(&logDropped, memory_order_relaxed);
+        if (dropped != reportedDrops)
+        {
+            printf("W (%lu) LOG: %lu records dropped (ring full)\n", (unsigned long)esp_log_timestamp(), (unsigned long)(dropped - reportedDrops));
+            reportedDrops = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+
+void LOG_Init(void)
+{
+    if (logReady)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++)
+    {
+        atomic_store_explicit(&logRing[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&logHead, 0, memory_order_relaxed);
+    logTail = 0;
+
+    logReady = true;
+    Task_Start(TASK_LOG_DRAIN, LOG_DrainTask, NULL);
+}
+
+void LOG_SetLevel(logModule module, esp_log_level_t level)
+{
+    if (module < LOG_MODULE_COUNT)
+    {
+        logLevels[module] = (uint8_t)level;
+    }
+}
+
+bool LOG_IsEnabled(logModule module, esp_log_level_t level)
+{
+    return level <= logLevels[module];
+}
+
+void LOG_Write(logModule module, esp_log_level_t level, const char *key, const char *format, const uintptr_t *args, uint8_t argCount)
+{
+    if (argCount > LOG_MAX_ARGS)
+    {
+        argCount = LOG_MAX_ARGS;
+    }
+
+    // Before the ring exists there is nobody to drain it, print right away
+    if (!logReady)
+    {
+        logRecord record;
+        LOG_Fill(&record, module, level, key, format, args, argCount);
+        LOG_Print(&record);
+        return;
+    }
+
+    uint32_t position = atomic_load_explicit(&logHead, memory_order_relaxed);
+    while (1)
+    {
+        logRecord *slot = &logRing[position & (LOG_RING_SIZE - 1)];
+        uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int32_t difference = (int32_t)(sequence - position);
+
+        if (difference == 0)
+        {
+            // Slot is free for this lap, try to claim the position
+            if (atomic_compare_exchange_weak_explicit(&logHead, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                LOG_Fill(slot, module, level, key, format, args, argCount);
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                return;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Slot still holds an unread record from the previous lap: ring is full
+            atomic_fetch_add_explicit(&logDropped, 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = atomic_load_explicit(&logHead, memory_order_relaxed);
+        }
+    }
+}
+
+uint32_t LOG_GetDroppedCount(void)
+{
+    return atomic_load_explicit(&logDropped, memory_order_relaxed);
+}
@@ -0,0 +1,168 @@
+/******************************************************************************
+ * @file        LOG_module.h
+ * @brief       Asynchronous ring-buffered logging for hot paths.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares a logging layer that keeps formatting and UART output
+ * off the calling task. A log call only stores a compact binary record (format
+ * pointer, up to four integer arguments and an optional short key) into a lock-free
+ * ring. A low-priority drain task formats and prints the records later. Each module
+ * has its own runtime level, and records that do not fit in the ring are counted
+ * as dropped instead of blocking the caller.
+ *
+ * Because formatting is deferred, every format string and every string passed with
+ * LOG_STR() must stay valid for the life of the program (string literals or const
+ * tables). Transient strings such as NVS keys built on the stack go through the
+ * LOG_KEY_* macros, which copy up to LOG_KEY_LENGTH - 1 characters into the record.
+ *
+ * Arguments are stored as uintptr_t, so only integers up to the width of a pointer
+ * (%d, %i, %u, %x, %X, %o, %c with no length modifier or with l, h, hh, z, t) and
+ * LOG_STR() strings (%s) or pointers (%p) can be recorded. The compiler checks every
+ * format against its arguments as it would for printf, and the drain converts each
+ * stored argument back to the type its conversion expects before printing it.
+ ******************************************************************************/
+#ifndef LOG_MODULE_H
+#define LOG_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+#define LOG_RING_SIZE 64            // Number of records in the ring (power of two)
+#define LOG_MAX_ARGS 4              // Maximum integer arguments per record
+#define LOG_KEY_LENGTH 16           // Copied key buffer, fits any NVS key
+#define LOG_LINE_LENGTH 192         // Formatted message, longer ones are cut
+#define LOG_SPEC_LENGTH 16          // One conversion with its flags, width and precision
+#define LOG_DRAIN_PERIOD_MS 20      // Drain task polling period
+#define LOG_DRAIN_STACK_SIZE 2560   // Drain task stack size
+#define LOG_DRAIN_TASK_PRIORITY 1   // Just above idle
+#define LOG_DEFAULT_LEVEL ESP_LOG_INFO
+
+/**
+ * @brief Modules that own a runtime log level.
+ */
+typedef enum
+{
+    LOG_MODULE_MAIN,
+    LOG_MODULE_MQTT,
+    LOG_MODULE_JSON,
+    LOG_MODULE_MEMORY,
+    LOG_MODULE_RELAY,
+    LOG_MODULE_DATA,
+    LOG_MODULE_BLE,
+    LOG_MODULE_WIFI,
+    LOG_MODULE_SENSOR,
+    LOG_MODULE_RULE,
+    LOG_MODULE_HTTP,
+    LOG_MODULE_COUNT,
+} logModule;
+
+/**
+ * @brief Marks a string argument whose storage outlives the record (e.g. a literal).
+ */
+#define LOG_STR(string) ((const char *)(string))
+
+// Count the variadic arguments (0 to LOG_MAX_ARGS)
+#define LOG_ARG_COUNT(...) LOG_ARG_COUNT_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_ARG_COUNT_(_0, _1, _2, _3, _4, N, ...) N
+
+// Store one argument, refusing at compile time anything wider than a pointer
+#define LOG_ARG(arg) ((void)sizeof(char[sizeof(arg) <= sizeof(uintptr_t) ? 1 : -1]), (uintptr_t)(arg))
+
+// Store each variadic argument, after the leading zero of the argument array
+#define LOG_ARGS(...) LOG_ARGS_N(LOG_ARG_COUNT(__VA_ARGS__), ##__VA_ARGS__)
+#define LOG_ARGS_N(count, ...) LOG_ARGS_N_(count, ##__VA_ARGS__)
+#define LOG_ARGS_N_(count, ...) LOG_ARGS_##count(__VA_ARGS__)
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a) , LOG_ARG(a)
+#define LOG_ARGS_2(a, b) , LOG_ARG(a), LOG_ARG(b)
+#define LOG_ARGS_3(a, b, c) , LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)
+#define LOG_ARGS_4(a, b, c, d) , LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)
+
+/**
+ * @brief Never called: lets the compiler check a record format against its arguments.
+ */
+static inline void __attribute__((format(printf, 1, 2))) LOG_CheckFormat(const char *format, ...)
+{
+    (void)format;
+}
+
+#define LOG_RECORD(module, level, key, format, ...)                                            \
+    do                                                                                         \
+    {                                                                                          \
+        if (0)                                                                                 \
+        {                                                                                      \
+            LOG_CheckFormat(format, ##__VA_ARGS__);                                            \
+        }                                                                                      \
+        if (LOG_IsEnabled(module, level))                                                      \
+        {                                                                                      \
+            const uintptr_t logArgs_[LOG_MAX_ARGS + 1] = {0 LOG_ARGS(__VA_ARGS__)};            \
+            LOG_Write(module, level, key, format, &logArgs_[1], LOG_ARG_COUNT(__VA_ARGS__));   \
+        }                                                                                      \
+    } while (0)
+
+// Records with integer or LOG_STR() arguments only
+#define LOG_E(module, format, ...) LOG_RECORD(module, ESP_LOG_ERROR, NULL, format, ##__VA_ARGS__)
+#define LOG_W(module, format, ...) LOG_RECORD(module, ESP_LOG_WARN, NULL, format, ##__VA_ARGS__)
+#define LOG_I(module, format, ...) LOG_RECORD(module, ESP_LOG_INFO, NULL, format, ##__VA_ARGS__)
+#define LOG_D(module, format, ...) LOG_RECORD(module, ESP_LOG_DEBUG, NULL, format, ##__VA_ARGS__)
+
+// Records prefixed with a copied key, printed as "[key] message"
+#define LOG_KEY_E(module, key, format, ...) LOG_RECORD(module, ESP_LOG_ERROR, key, format, ##__VA_ARGS__)
+#define LOG_KEY_W(module, key, format, ...) LOG_RECORD(module, ESP_LOG_WARN, key, format, ##__VA_ARGS__)
+#define LOG_KEY_I(module, key, format, ...) LOG_RECORD(module, ESP_LOG_INFO, key, format, ##__VA_ARGS__)
+#define LOG_KEY_D(module, key, format, ...) LOG_RECORD(module, ESP_LOG_DEBUG, key, format, ##__VA_ARGS__)
+
+/**
+ * @brief Prepares the ring and starts the drain task.
+ *
+ * @details
+ * Should be the first call in app_main. Records written before this call are
+ * formatted and printed synchronously.
+ */
+void LOG_Init(void);
+
+/**
+ * @brief Sets the runtime level of a module.
+ *
+ * @param module (logModule): The module to configure.
+ * @param level (esp_log_level_t): Most verbose level that is still recorded.
+ */
+void LOG_SetLevel(logModule module, esp_log_level_t level);
+
+/**
+ * @brief Checks whether a record of the given level would be kept.
+ *
+ * @param module (logModule): The module issuing the record.
+ * @param level (esp_log_level_t): Level of the record.
+ *
+ * @return bool: true if the module level lets the record through.
+ */
+bool LOG_IsEnabled(logModule module, esp_log_level_t level);
+
+/**
+ * @brief Stores one record in the ring. Use the LOG_* macros instead of calling this directly.
+ *
+ * @param module (logModule): The module issuing the record.
+ * @param level (esp_log_level_t): Level of the record.
+ * @param key (const char *): Optional string copied into the record, or NULL.
+ * @param format (const char *): printf format with static lifetime.
+ * @param args (const uintptr_t *): Integer arguments of the format.
+ * @param argCount (uint8_t): Number of arguments (at most LOG_MAX_ARGS).
+ */
+void LOG_Write(logModule module, esp_log_level_t level, const char *key, const char *format, const uintptr_t *args, uint8_t argCount);
+
+/**
+ * @brief Returns the number of records dropped because the ring was full.
+ *
+ * @return uint32_t: Dropped record count since boot.
+ */
+uint32_t LOG_GetDroppedCount(void);
+
+#endif // LOG_MODULE_H
@@ -13,13 +13,12 @@
  * This file implements the MQTT client functionality for the ESP32 using the ESP-IDF framework.
  * The module provides functions to connect to an MQTT broker, subscribe to topics, publish
  * messages, and handle various MQTT events such as connection, data reception, disconnection,
- * and unsubscription. It also allows users to register callback functions that are triggered
- * during specific MQTT events, making it a flexible solution for interacting with MQTT brokers.
+ * and unsubscription. Connection, message and disconnection events are published on the
+ * event bus, so any number of modules can subscribe to them.
  *
  * The module handles the following tasks:
  * - Initializes the MQTT client with specified configuration (broker URI, port, credentials).
- * - Registers callback functions to handle events such as connection, data reception,
- *   disconnection, and unsubscription.
+ * - Publishes the connection, data reception and disconnection events on the event bus.
  * - Handles MQTT events through an event-driven approach with the ESP32 event loop.
  * - Provides functionality to publish messages to MQTT topics and subscribe to topics for data
  *   reception.
@@ -29,6 +28,7 @@
  ******************************************************************************/
 #include <stdio.h>                 // Standard input/output functions
 #include <stdbool.h>               // Standard boolean type
+#include <stdatomic.h>             // Link counters read by other tasks
 #include "freertos/FreeRTOS.h"     // FreeRTOS core definitions
 #include "freertos/task.h"         // FreeRTOS task management
 #include "freertos/event_groups.h" // FreeRTOS event group management
@@ -36,56 +36,27 @@
 #include "esp_event.h"             // Event handling in ESP-IDF
 #include "esp_log.h"               // Logging module for ESP-IDF
 #include "cJSON.h"                 // JSON parsing library
+#include "TRACE_module.h"          // Command latency trace points
+#include "Event_module.h"          // Connection and message events
 #include "MQTT_module.h"           // Custom MQTT module header (if any)
 
-/// Callback function pointers for MQTT events
-void static (*Connected_CallBack)(void);    // Called when MQTT connection is established
-void static (*Data_Callback)(void);         // Called when MQTT data is received
-void static (*Unsubscribe_callback)(void);  // Called when unsubscribed from a topic
-void static (*Disconnected_callback)(void); // Called when MQTT connection is disconnected
+static _Atomic bool mqttConnected = false;   // Between the connected and disconnected events
+static _Atomic uint32_t mqttConnects = 0;     // Connections since boot
 
 esp_mqtt_client_handle_t client;       // MQTT client handle
-esp_mqtt_event_handle_t General_event; // General MQTT event handle
 static const char *MQTT_TAG = "MQTT";  // Logging tag for MQTT module
 
-/**
- * @brief Set the callback for MQTT connection established event
- * @param Callback Function pointer for the event
- */
-void MQTT_EventConnectedCallback(void (*Callback)(void))
-{
-    Connected_CallBack = Callback;
-}
-
-/**
- * @brief Set the callback for MQTT data reception event
- * @param Callback Function pointer for the event
- */
-void MQTT_EventDataActionCallback(void (*Callback)(void))
-{
-    Data_Callback = Callback;
-}
-
-/**
- * @brief Set the callback for MQTT topic unsubscription event
- * @param callback Function pointer for the event
- */
-void MQTT_EventUnsubscribedCallback(void (*callback)(void))
+// Report a lost connection, once per connection
+static void MQTT_Disconnected(void)
 {
-    Unsubscribe_callback = callback;
-}
-
-/**
- * @brief Set the callback for MQTT disconnection event
- * @param callback Function pointer for the event
- */
-void MQTT_EventDisconnectedCallback(void (*callback)(void))
-{
-    Disconnected_callback = callback;
+    if (atomic_exchange(&mqttConnected, false))
+    {
+        Event_Publish(&(appEvent){.type = EVENT_MQTT_DISCONNECTED});
+    }
 }
 
 /**
- * @brief MQTT event handler to process events and invoke appropriate callbacks
+ * @brief MQTT event handler to process events and publish them on the event bus
  * @param handler_args Arguments for the handler
  * @param base Event base
  * @param event_id ID of the event
@@ -94,23 +65,33 @@ void MQTT_EventDisconnectedCallback(void (*callback)(void))
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
     esp_mqtt_event_handle_t event = event_data;
-    General_event = event_data; // Store the general event for potential use
+    appEvent published;
+
     switch (event_id)
     {
     case MQTT_EVENT_CONNECTED: // MQTT connection established
-        Connected_CallBack();  // Invoke the connection callback
+        atomic_store(&mqttConnected, true);
+        published.type = EVENT_MQTT_CONNECTED;
+        published.mqttConnected.connects = atomic_fetch_add(&mqttConnects, 1) + 1;
+        Event_Publish(&published);
         break;
 
     case MQTT_EVENT_DATA: // MQTT data received
-        Data_Callback();  // Invoke the data callback
+        TRACE_Begin();    // Command path timing starts here
+        published.type = EVENT_MQTT_DATA;
+        published.mqttData.topic = event->topic;
+        published.mqttData.topicLength = event->topic_len;
+        published.mqttData.data = event->data;
+        published.mqttData.dataLength = event->data_len;
+        Event_Publish(&published);
         break;
 
     case MQTT_EVENT_UNSUBSCRIBED: // MQTT topic unsubscription
-        Unsubscribe_callback();   // Invoke the unsubscription callback
+        ESP_LOGD(MQTT_TAG, "Unsubscribe acknowledged, message %d", event->msg_id);
         break;
 
     case MQTT_EVENT_DISCONNECTED: // MQTT connection disconnected
-        Disconnected_callback();  // Invoke the disconnection callback
+        MQTT_Disconnected();      // MQTT_Reconfigure may have reported it already
         break;
 
     default: // Any other MQTT event
@@ -118,33 +99,66 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     }
 }
 
-/**
- * @brief Connect to an MQTT broker with specified parameters
- * @param MQTT_Saved_Broker Broker URI (e.g., "mqtt://example.com")
- * @param MQTT_Saved_Port Pointer to the port number
- * @param MQTT_Username Username for authentication
- * @param MQTT_Saved_Password Password for authentication
- */
-void MQTT_Connect(char *MQTT_Saved_Broker, int32_t *MQTT_Saved_Port, char *MQTT_Username, char *MQTT_Saved_Password)
+// Client configuration shared by the first connection and a reconfiguration
+static esp_mqtt_client_config_t MQTT_Config(char *broker, int32_t port, char *username, char *password)
 {
-    // MQTT configuration struct with broker URI, port, and credentials
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker = {
             .address = {
-                .uri = MQTT_Saved_Broker,          // MQTT broker URI
-                .port = (uint32_t)MQTT_Saved_Port, // MQTT broker port
+                .uri = broker,            // MQTT broker URI
+                .port = (uint32_t)port,   // MQTT broker port
             }},
-        .credentials = {.username = MQTT_Username, // MQTT username
+        .credentials = {.username = username, // MQTT username
                         .authentication = {
-                            .password = MQTT_Saved_Password, // MQTT password
+                            .password = password, // MQTT password
                         }},
+        .task = {.priority = MQTT_TASK_PRIORITY, .stack_size = MQTT_TASK_STACK_SIZE},
+        .buffer = {.size = MQTT_BUFFER_SIZE, .out_size = MQTT_OUT_BUFFER_SIZE},
+        .outbox = {.limit = MQTT_OUTBOX_LIMIT}, // Bounds the only allocation made per publish
     };
+    return mqtt_cfg;
+}
+
+/**
+ * @brief Connect to an MQTT broker with specified parameters
+ * @param MQTT_Saved_Broker Broker URI (e.g., "mqtt://example.com")
+ * @param MQTT_Saved_Port Port number
+ * @param MQTT_Username Username for authentication
+ * @param MQTT_Saved_Password Password for authentication
+ */
+void MQTT_Connect(char *MQTT_Saved_Broker, int32_t MQTT_Saved_Port, char *MQTT_Username, char *MQTT_Saved_Password)
+{
+    esp_mqtt_client_config_t mqtt_cfg = MQTT_Config(MQTT_Saved_Broker, MQTT_Saved_Port, MQTT_Username, MQTT_Saved_Password);
 
     client = esp_mqtt_client_init(&mqtt_cfg);                                           // Initialize MQTT client
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL); // Register event handler
     esp_mqtt_client_start(client);                                                      // Start the MQTT client
 }
 
+/**
+ * @brief Restart the client on a new broker or with new credentials
+ * @param broker Broker URI
+ * @param port Port number
+ * @param username Username for authentication
+ * @param password Password for authentication
+ */
+void MQTT_Reconfigure(char *broker, int32_t port, char *username, char *password)
+{
+    esp_mqtt_client_config_t mqtt_cfg = MQTT_Config(broker, port, username, password);
+
+    if (client == NULL)
+    {
+        MQTT_Connect(broker, port, username, password);
+        return;
+    }
+
+    // The client keeps its task and buffers; only the connection is replaced
+    esp_mqtt_client_stop(client);
+    MQTT_Disconnected(); // Stopping does not always report the disconnection
+    esp_mqtt_set_config(client, &mqtt_cfg); // Copies the strings
+    esp_mqtt_client_start(client);
+}
+
 /**
  * @brief Publish a message to a specific MQTT topic
  * @param topic_Name Name of the topic
@@ -157,6 +171,26 @@ void MQTT_Publish(char *topic_Name, char *msg, uint32_t durationTime_InSec)
     vTaskDelay(pdMS_TO_TICKS((uint32_t)(durationTime_InSec * 1000))); // Delay for the specified duration
 }
 
+/**
+ * @brief Publish a retained message at QoS 1
+ * @param topic_Name Name of the topic
+ * @param msg Message to publish
+ */
+int MQTT_PublishRetained(const char *topic_Name, const char *msg)
+{
+    return esp_mqtt_client_publish(client, topic_Name, msg, 0, 1, 1);
+}
+
+bool MQTT_IsConnected(void)
+{
+    return atomic_load(&mqttConnected);
+}
+
+uint32_t MQTT_GetConnectCount(void)
+{
+    return atomic_load(&mqttConnects);
+}
+
 /**
  * @brief Subscribe to an MQTT topic
  * @param topic_Name Name of the topic to subscribe to
@@ -166,3 +200,13 @@ void MQTT_Subscribe(char *topic_Name)
     esp_mqtt_client_subscribe(client, topic_Name, 0);          // Subscribe to the topic
     ESP_LOGI(MQTT_TAG, "Subscribed to topic: %s", topic_Name); // Log the subscription
 }
+
+/**
+ * @brief Unsubscribe from an MQTT topic
+ * @param topic_Name Name of the topic to unsubscribe from
+ */
+void MQTT_Unsubscribe(char *topic_Name)
+{
+    esp_mqtt_client_unsubscribe(client, topic_Name);
+    ESP_LOGI(MQTT_TAG, "Unsubscribed from topic: %s", topic_Name);
+}
@@ -12,57 +12,75 @@
  * This header file declares the APIs for managing MQTT connections, publishing,
  * subscribing, and handling MQTT events on an ESP32 device. It provides a simple
  * interface for establishing MQTT connections, subscribing to topics, publishing
- * messages, and handling various MQTT events via callback functions.
+ * messages. Connection, message and disconnection events are published on the event
+ * bus (Event_module.h) from the esp-mqtt task: EVENT_MQTT_CONNECTED, EVENT_MQTT_DATA
+ * and EVENT_MQTT_DISCONNECTED.
  ******************************************************************************/
 #ifndef MQTT_MODULE_H
 #define MQTT_MODULE_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "mqtt_client.h"
+
+// The client allocates these once in MQTT_Connect and keeps them for its lifetime
+#define MQTT_BUFFER_SIZE 1024        // Receive buffer, larger messages arrive in chunks
+#define MQTT_OUT_BUFFER_SIZE 2048    // Transmit buffer, holds a full diagnostics report
+#define MQTT_TASK_STACK_SIZE 6144    // esp-mqtt task stack
+#define MQTT_TASK_PRIORITY 5         // esp-mqtt task priority
+#define MQTT_OUTBOX_LIMIT 4096       // Bytes of unacknowledged QoS 1 messages kept for resend
+
 /**
- * @brief Registers a callback function to handle the MQTT connection established event.
+ * @brief Connects to an MQTT broker with specified connection parameters.
  *
- * @param Callback Function pointer to the callback function to execute upon connection.
+ * @param MQTT_Saved_Broker The URI of the MQTT broker to connect to (e.g., "mqtt://broker.example.com").
+ * @param MQTT_Saved_Port The port number to use for the connection.
+ * @param MQTT_Username Username for MQTT authentication.
+ * @param MQTT_Saved_Password Password for MQTT authentication.
  */
-void MQTT_EventConnectedCallback(void (*Callback)(void));
+void MQTT_Connect(char *MQTT_Saved_Broker, int32_t MQTT_Saved_Port, char *MQTT_Username, char *MQTT_Saved_Password);
 
 /**
- * @brief Registers a callback function to handle MQTT data reception events.
- *
- * @param Callback Function pointer to the callback function to execute upon receiving data.
+ * @brief Moves the client to a new broker or new credentials without a reboot.
+ * @param broker The URI of the MQTT broker.
+ * @param port The port number to use for the connection.
+ * @param username Username for MQTT authentication.
+ * @param password Password for MQTT authentication.
+ * @details
+ * Stops the client, reports the disconnection if the client has not, gives the
+ * client the new configuration and starts it again; EVENT_MQTT_CONNECTED follows once
+ * the new broker accepts it. Must not be called from an MQTT event handler.
  */
-void MQTT_EventDataActionCallback(void (*Callback)(void));
+void MQTT_Reconfigure(char *broker, int32_t port, char *username, char *password);
 
 /**
- * @brief Registers a callback function to handle MQTT topic unsubscription events.
+ * @brief Publishes a message to a specified MQTT topic.
  *
- * @param callback Function pointer to the callback function to execute upon unsubscription.
+ * @param topic_Name The name of the MQTT topic to publish to.
+ * @param msg The message to publish.
+ * @param durationTime_InSec The delay in seconds after publishing the message.
  */
-void MQTT_EventUnsubscribedCallback(void (*callback)(void));
+void MQTT_Publish(char *topic_Name, char *msg, uint32_t durationTime_InSec);
 
 /**
- * @brief Registers a callback function to handle MQTT disconnection events.
+ * @brief Publishes a message the broker keeps as the current value of its topic.
+ *
+ * @param topic_Name The name of the MQTT topic to publish to.
+ * @param msg The message to publish, null-terminated.
  *
- * @param callback Function pointer to the callback function to execute upon disconnection.
+ * @return int: Message id (QoS 1), -1 if the client is not started or refused it.
  */
-void MQTT_EventDisconnectedCallback(void (*callback)(void));
+int MQTT_PublishRetained(const char *topic_Name, const char *msg);
 
 /**
- * @brief Connects to an MQTT broker with specified connection parameters.
- *
- * @param MQTT_Saved_Broker The URI of the MQTT broker to connect to (e.g., "mqtt://broker.example.com").
- * @param MQTT_Saved_Port Pointer to the port number to use for the connection.
- * @param MQTT_Username Username for MQTT authentication.
- * @param MQTT_Saved_Password Password for MQTT authentication.
+ * @brief Tells whether the client is connected to the broker.
  */
-void MQTT_Connect(char *MQTT_Saved_Broker, int32_t *MQTT_Saved_Port, char *MQTT_Username, char *MQTT_Saved_Password);
+bool MQTT_IsConnected(void);
 
 /**
- * @brief Publishes a message to a specified MQTT topic.
- *
- * @param topic_Name The name of the MQTT topic to publish to.
- * @param msg The message to publish.
- * @param durationTime_InSec The delay in seconds after publishing the message.
+ * @brief Returns the number of connections to the broker since boot.
  */
-void MQTT_Publish(char *topic_Name, char *msg, uint32_t durationTime_InSec);
+uint32_t MQTT_GetConnectCount(void);
 
 /**
  * @brief Subscribes to a specified MQTT topic.
@@ -71,4 +89,10 @@ void MQTT_Publish(char *topic_Name, char *msg, uint32_t durationTime_InSec);
  */
 void MQTT_Subscribe(char *topic_Name);
 
+/**
+ * @brief Unsubscribes from a specified MQTT topic.
+ * @param topic_Name The name of the MQTT topic to unsubscribe from.
+ */
+void MQTT_Unsubscribe(char *topic_Name);
+
 #endif // MQTT_MODULE_H
@@ -16,13 +16,27 @@
 
  ******************************************************************************/
 
-#include <stdio.h>     // For printf and basic input/output functions
 #include <stdint.h>    // For standard integer types like int32_t
+#include <stdatomic.h> // Lock-free commit counter
 #include "esp_err.h"   // For ESP32 error codes and error handling
 #include "nvs_flash.h" // For initializing and managing the NVS subsystem
 #include "nvs.h"       // For working with NVS handles and API functions
+#include "LOG_module.h"  // Deferred logging off the caller
 #include "Memory_module.h"
 
+static _Atomic uint32_t memoryCommits; // Successful nvs_commit calls since boot
+
+// Commit a handle and count the commits that reached the flash
+static esp_err_t Memory_Commit(nvs_handle_t handle)
+{
+    esp_err_t err = nvs_commit(handle);
+    if (err == ESP_OK)
+    {
+        atomic_fetch_add_explicit(&memoryCommits, 1, memory_order_relaxed);
+    }
+    return err;
+}
+
 void Memory_SaveString(const char * nameSpace, const char * key,const char *string)
 {
 
@@ -34,27 +48,27 @@ void Memory_SaveString(const char * nameSpace, const char * key,const char *stri
     if (err != ESP_OK)
     {
         // Log error if the namespace cannot be opened
-        printf("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
         return;
     }
     
     else
     {
-        printf("Saving (%s) credentials...\n", string);
+        LOG_KEY_D(LOG_MODULE_MEMORY, key, "Saving string...");
         // Write the string to NVS using the specified key
         err = nvs_set_str(Store_Handle, key, string);
         if (err != ESP_OK)
         {
-            printf("Failed to write (%s) to NVS!\n", string);
+            LOG_KEY_E(LOG_MODULE_MEMORY, key, "Failed to write to NVS!");
         }
 
         // Commit changes to NVS to ensure data is stored
-        err = nvs_commit(Store_Handle);
+        err = Memory_Commit(Store_Handle);
         if (err != ESP_OK)
         {
-            printf("Failed to commit changes!\n");
+            LOG_KEY_E(LOG_MODULE_MEMORY, key, "Failed to commit changes!");
         }
-        printf("String saved.\n");
+        LOG_KEY_D(LOG_MODULE_MEMORY, key, "String saved.");
 
         // Close the NVS handle to free resources
         nvs_close(Store_Handle);
@@ -71,18 +85,18 @@ void Memory_LoadString(const char *nameSpace, const char * key , char *stringOut
     if (err != ESP_OK)
     {
         // Log error if the namespace cannot be opened
-        printf("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
         return;
     }
 
     else
     {
-        printf("Loading (%s) data...\n", key);
+        LOG_KEY_D(LOG_MODULE_MEMORY, key, "Loading data...");
         // Retrieve the string from NVS using the specified key
         err = nvs_get_str(Ret_handle, key, stringOut, &stringSize);
         if (err != ESP_OK)
         {
-            printf("Failed to read (%s) from NVS!\n", key);
+            LOG_KEY_W(LOG_MODULE_MEMORY, key, "Failed to read from NVS!");
         }
         // Close the NVS handle to free resources
         nvs_close(Ret_handle);
@@ -100,33 +114,33 @@ void Memory_SaveInt32(const char *nameSpace, const char *key, int32_t value)
     if (err != ESP_OK)
     {
         // Log error if the namespace cannot be opened
-        printf("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
         return;
     }
     else
     {
         // Log saving process
-        printf("Saving integer (%ld) under key (%s)...\n", value, key);
+        LOG_KEY_D(LOG_MODULE_MEMORY, key, "Saving integer (%ld)...", (long)value);
 
         // Write the int32_t value to NVS using the specified key
         err = nvs_set_i32(Store_Handle, key, value);
         if (err != ESP_OK)
         {
             // Log error if writing to NVS fails
-            printf("Failed to write (%ld) to NVS under key (%s)!\n", value, key);
+            LOG_KEY_E(LOG_MODULE_MEMORY, key, "Failed to write (%ld) to NVS!", (long)value);
         }
 
         // Commit changes to NVS to ensure data is stored
-        err = nvs_commit(Store_Handle);
+        err = Memory_Commit(Store_Handle);
         if (err != ESP_OK)
         {
             // Log error if committing changes fails
-            printf("Failed to commit changes!\n");
+            LOG_KEY_E(LOG_MODULE_MEMORY, key, "Failed to commit changes!");
         }
         else
         {
             // Log success message
-            printf("Integer saved.\n");
+            LOG_KEY_D(LOG_MODULE_MEMORY, key, "Integer saved.");
         }
 
         // Close the NVS handle to free resources
@@ -145,28 +159,230 @@ void Memory_LoadInt32(const char *nameSpace, const char *key, int32_t *valueOut)
     if (err != ESP_OK)
     {
         // Log error if the namespace cannot be opened
-        printf("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
         return;
     }
     else
     {
         // Log loading process
-        printf("Loading integer data for key (%s)...\n", key);
+        LOG_KEY_D(LOG_MODULE_MEMORY, key, "Loading integer data...");
 
         // Retrieve the int32_t value from NVS using the specified key
         err = nvs_get_i32(Ret_handle, key, valueOut);
         if (err != ESP_OK)
         {
             // Log error if reading from NVS fails
-            printf("Failed to read integer value for key (%s) from NVS!\n", key);
+            LOG_KEY_W(LOG_MODULE_MEMORY, key, "Failed to read integer value from NVS!");
         }
         else
         {
             // Log success message
-            printf("Integer loaded: %ld\n", *valueOut);
+            LOG_KEY_D(LOG_MODULE_MEMORY, key, "Integer loaded: %ld", (long)*valueOut);
         }
 
         // Close the NVS handle to free resources
         nvs_close(Ret_handle);
     }
 }
+
+
+bool Memory_SaveBlob(const char *nameSpace, const char *key, const void *blob, size_t length)
+{
+    nvs_handle_t Store_Handle;
+    esp_err_t err = nvs_open(nameSpace, NVS_READWRITE, &Store_Handle);
+
+    if (err != ESP_OK)
+    {
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
+        return false;
+    }
+
+    // Write and commit the blob
+    err = nvs_set_blob(Store_Handle, key, blob, length);
+    if (err == ESP_OK)
+    {
+        err = Memory_Commit(Store_Handle);
+    }
+    if (err != ESP_OK)
+    {
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Failed to save blob of (%u) bytes!", (unsigned)length);
+    }
+
+    nvs_close(Store_Handle);
+    return err == ESP_OK;
+}
+
+
+bool Memory_LoadBlob(const char *nameSpace, const char *key, void *blobOut, size_t *length)
+{
+    nvs_handle_t Ret_handle;
+    esp_err_t err = nvs_open(nameSpace, NVS_READONLY, &Ret_handle);
+
+    if (err != ESP_OK)
+    {
+        LOG_KEY_E(LOG_MODULE_MEMORY, key, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
+        return false;
+    }
+
+    // Retrieve the blob, which fails if it is larger than the buffer
+    err = nvs_get_blob(Ret_handle, key, blobOut, length);
+    if (err != ESP_OK)
+    {
+        LOG_KEY_W(LOG_MODULE_MEMORY, key, "Failed to read blob from NVS!");
+    }
+
+    nvs_close(Ret_handle);
+    return err == ESP_OK;
+}
+
+
+// Previous value of a key, kept so a failed batch can be rolled back
+typedef struct
+{
+    bool existed;
+    char string[MEMORY_BATCH_STRING_LENGTH];
+    int32_t value;
+} memoryBackup;
+
+static uint8_t memoryBlobBackup[MEMORY_BATCH_BLOB_LENGTH]; // Previous value of the blob of a batch
+static size_t memoryBlobBackupLength;
+
+// Read the current value of an entry into its backup
+static esp_err_t Memory_Backup(nvs_handle_t handle, const memoryEntry *entry, memoryBackup *backup)
+{
+    size_t length = sizeof(backup->string);
+
+    switch (entry->type)
+    {
+    case MEMORY_TYPE_STRING:
+        return nvs_get_str(handle, entry->key, backup->string, &length);
+    case MEMORY_TYPE_INT32:
+        return nvs_get_i32(handle, entry->key, &backup->value);
+    default:
+        memoryBlobBackupLength = sizeof(memoryBlobBackup);
+        return nvs_get_blob(handle, entry->key, memoryBlobBackup, &memoryBlobBackupLength);
+    }
+}
+
+// Write the new value of an entry
+static esp_err_t Memory_WriteEntry(nvs_handle_t handle, const memoryEntry *entry)
+{
+    switch (entry->type)
+    {
+    case MEMORY_TYPE_STRING:
+        return nvs_set_str(handle, entry->key, entry->string);
+    case MEMORY_TYPE_INT32:
+        return nvs_set_i32(handle, entry->key, entry->value);
+    default:
+        return nvs_set_blob(handle, entry->key, entry->blob, entry->blobLength);
+    }
+}
+
+// Put back the values saved in the backup for the first 'count' entries
+static void Memory_Rollback(nvs_handle_t handle, const memoryEntry *entries, const memoryBackup *backup, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!backup[i].existed)
+        {
+            nvs_erase_key(handle, entries[i].key);
+        }
+        else if (entries[i].type == MEMORY_TYPE_STRING)
+        {
+            nvs_set_str(handle, entries[i].key, backup[i].string);
+        }
+        else if (entries[i].type == MEMORY_TYPE_INT32)
+        {
+            nvs_set_i32(handle, entries[i].key, backup[i].value);
+        }
+        else
+        {
+            nvs_set_blob(handle, entries[i].key, memoryBlobBackup, memoryBlobBackupLength);
+        }
+    }
+    Memory_Commit(handle);
+}
+
+bool Memory_SaveBatch(const char *nameSpace, const memoryEntry *entries, size_t count)
+{
+    memoryBackup backup[MEMORY_BATCH_MAX_ENTRIES];
+    nvs_handle_t Store_Handle;
+    esp_err_t err;
+
+    size_t blobs = 0;
+
+    if (entries != NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            blobs += (entries[i].type == MEMORY_TYPE_BLOB) ? 1 : 0;
+        }
+    }
+    if (entries == NULL || count == 0 || count > MEMORY_BATCH_MAX_ENTRIES || blobs > 1)
+    {
+        LOG_E(LOG_MODULE_MEMORY, "Invalid batch of (%u) entries!", (unsigned)count);
+        return false;
+    }
+
+    // Open the NVS storage with the specified namespace in read/write mode
+    err = nvs_open(nameSpace, NVS_READWRITE, &Store_Handle);
+    if (err != ESP_OK)
+    {
+        LOG_KEY_E(LOG_MODULE_MEMORY, nameSpace, "Error (%s) opening NVS handle!", LOG_STR(esp_err_to_name(err)));
+        return false;
+    }
+
+    // Keep the current values aside before anything is overwritten
+    for (size_t i = 0; i < count; i++)
+    {
+        err = Memory_Backup(Store_Handle, &entries[i], &backup[i]);
+
+        if (err == ESP_ERR_NVS_NOT_FOUND)
+        {
+            backup[i].existed = false;
+        }
+        else if (err == ESP_OK)
+        {
+            backup[i].existed = true;
+        }
+        else
+        {
+            LOG_KEY_E(LOG_MODULE_MEMORY, entries[i].key, "Failed to back up key, batch aborted!");
+            nvs_close(Store_Handle);
+            return false;
+        }
+    }
+
+    // Write every entry through the same handle
+    LOG_D(LOG_MODULE_MEMORY, "Saving batch of (%u) entries...", (unsigned)count);
+    for (size_t i = 0; i < count; i++)
+    {
+        err = Memory_WriteEntry(Store_Handle, &entries[i]);
+        if (err != ESP_OK)
+        {
+            LOG_KEY_E(LOG_MODULE_MEMORY, entries[i].key, "Failed to write key, rolling back!");
+            Memory_Rollback(Store_Handle, entries, backup, i);
+            nvs_close(Store_Handle);
+            return false;
+        }
+    }
+
+    // A single commit for the whole batch
+    err = Memory_Commit(Store_Handle);
+    if (err != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_MEMORY, "Failed to commit batch, rolling back!");
+        Memory_Rollback(Store_Handle, entries, backup, count);
+        nvs_close(Store_Handle);
+        return false;
+    }
+
+    LOG_D(LOG_MODULE_MEMORY, "Batch saved.");
+    nvs_close(Store_Handle);
+    return true;
+}
+
+uint32_t Memory_GetCommitCount(void)
+{
+    return atomic_load_explicit(&memoryCommits, memory_order_relaxed);
+}
@@ -18,6 +18,37 @@
 #ifndef MEMORY_MODULE_H
 #define MEMORY_MODULE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define MEMORY_BATCH_MAX_ENTRIES 12    // Maximum number of keys written by one batch
+#define MEMORY_BATCH_STRING_LENGTH 48  // Largest string value a batch can roll back
+#define MEMORY_BATCH_BLOB_LENGTH 1120  // Largest blob value a batch can roll back, one per batch
+
+/**
+ * @brief Value types that can be written by a batched save.
+ */
+typedef enum
+{
+    MEMORY_TYPE_STRING, // Null-terminated string value
+    MEMORY_TYPE_INT32,  // int32_t value
+    MEMORY_TYPE_BLOB,   // Byte array
+} memoryEntryType;
+
+/**
+ * @brief One key/value pair of a batched save.
+ */
+typedef struct
+{
+    const char *key;      // NVS key
+    memoryEntryType type; // Which of the value fields is used
+    const char *string;   // Value for MEMORY_TYPE_STRING
+    int32_t value;        // Value for MEMORY_TYPE_INT32
+    const void *blob;     // Value for MEMORY_TYPE_BLOB
+    size_t blobLength;    // Length of the blob in bytes
+} memoryEntry;
+
 /**
  * @brief Saves a text to the NVS (Non-Volatile Storage) under a given namespace and key.
  *
@@ -55,6 +86,57 @@ void Memory_SaveInt32(const char *nameSpace, const char *key, int32_t value);
  */
 void Memory_LoadInt32(const char *nameSpace, const char *key, int32_t *valueOut);
 
+/**
+ * @brief Saves a byte array to the NVS under a given namespace and key.
+ *
+ * @param nameSpace The namespace under which the data will be stored.
+ * @param key The key associated with the blob to save.
+ * @param blob The bytes to save.
+ * @param length Number of bytes.
+ *
+ * @return bool Returns true if the blob was written and committed.
+ */
+bool Memory_SaveBlob(const char *nameSpace, const char *key, const void *blob, size_t length);
+
+/**
+ * @brief Loads a byte array from the NVS using a given namespace and key.
+ *
+ * @param nameSpace The namespace under which the data is stored.
+ * @param key The key associated with the blob to retrieve.
+ * @param blobOut The output buffer.
+ * @param length In: size of the output buffer. Out: length of the blob.
+ *
+ * @return bool Returns false if the key does not exist or the blob does not fit.
+ */
+bool Memory_LoadBlob(const char *nameSpace, const char *key, void *blobOut, size_t *length);
+
+/**
+ * @brief Saves several values to the NVS as one transaction.
+ *
+ * @param nameSpace The namespace under which the data will be stored.
+ * @param entries The key/value pairs to save.
+ * @param count Number of entries.
+ *
+ * @return bool
+ * - Returns true if every entry was written and committed.
+ * - Returns false if any write failed; the previous values are restored in that case.
+ *
+ * @details
+ * All entries are written through a single handle and committed once. The values present
+ * before the call are kept aside so a failed write can roll the namespace back. A batch
+ * may hold one blob of at most MEMORY_BATCH_BLOB_LENGTH bytes.
+ */
+bool Memory_SaveBatch(const char *nameSpace, const memoryEntry *entries, size_t count);
+
+/**
+ * @brief Returns the number of successful NVS commits since boot.
+ *
+ * @details
+ * Every commit is a flash write, so the count is used to measure the flash cost of
+ * the configuration and relay paths.
+ */
+uint32_t Memory_GetCommitCount(void);
+
 
 
 
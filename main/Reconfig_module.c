@@ -0,0 +1,302 @@
+/******************************************************************************
+ * @file        Reconfig_module.c
+ * @brief       Applies a stored configuration change to the running links.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The stored configuration is the reference: the task reads it back rather than
+ * taking the parsed message, so whatever a message stored is what runs, whichever
+ * sections it carried. Wi-Fi goes first, since the broker is reached through it, and
+ * a new Wi-Fi also restarts the MQTT client, whose connection died with the old
+ * association. The client subscribes on connection, which gives the end of the
+ * switchover. Changes stored before the first connection only update the active
+ * configuration, which Reconfig_Connect then connects with. Topic changes on a
+ * connected client are applied as set differences between the remembered
+ * subscriptions and the active table, so a topic moving from one relay to another
+ * stays subscribed.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "LOG_module.h"
+#include "MQTT_module.h"
+#include "Topic_module.h"
+#include "Task_module.h"
+#include "Event_module.h"
+#include "Reconfig_module.h"
+
+#define RECONFIG_TOPIC_COUNT (2 + TOPIC_RELAY_CHANNELS) // Relay, relay channels and rules topics
+
+static credentialConfig *reconfigActive = NULL;
+static reconfigWifiApply reconfigApplyWifi = NULL;
+static SemaphoreHandle_t reconfigWake = NULL;
+static StaticSemaphore_t reconfigWakeBuffer;
+static SemaphoreHandle_t reconfigSubscribed = NULL; // Given on each connection, once subscribed
+static StaticSemaphore_t reconfigSubscribedBuffer;
+static SemaphoreHandle_t reconfigLock = NULL;       // Subscriptions and statistics
+static StaticSemaphore_t reconfigLockBuffer;
+static SemaphoreHandle_t reconfigClientLock = NULL; // MQTT credentials of the active configuration and client start
+static StaticSemaphore_t reconfigClientLockBuffer;
+static bool reconfigClientStarted = false;          // Set by Reconfig_Connect
+static char reconfigTopics[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1]; // Subscribed, "" if none
+static reconfigStats reconfigCounters;
+
+// Command topic of a subscription slot
+static topicId Reconfig_TopicId(size_t slot)
+{
+    if (slot == 0)
+    {
+        return TOPIC_RELAY_TYPE;
+    }
+    if (slot <= TOPIC_RELAY_CHANNELS)
+    {
+        return TOPIC_RELAY_CHANNEL(slot);
+    }
+    return TOPIC_RULES_TYPE;
+}
+
+// Tells whether a topic is in a subscription list
+static bool Reconfig_Contains(char topics[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1], const char *topic)
+{
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        if (strcmp(topics[slot], topic) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Move the subscriptions of a connected client to the active table, true if any changed. The
+// lists are worked out under the lock and the client is called after it is released, as the
+// esp-mqtt task takes the lock in Reconfig_SubscribeAll while holding the client's own lock
+static bool Reconfig_ApplyTopics(void)
+{
+    // Reconfiguration task only
+    static char wanted[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1];
+    static char added[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1];
+    static char removed[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1];
+    bool changed = false;
+
+    if (!MQTT_IsConnected())
+    {
+        return false; // The next connection subscribes to the active table
+    }
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        Topic_Copy(Reconfig_TopicId(slot), wanted[slot], sizeof(wanted[slot]));
+    }
+
+    xSemaphoreTake(reconfigLock, portMAX_DELAY);
+    memset(added, 0, sizeof(added));
+    memset(removed, 0, sizeof(removed));
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        if (wanted[slot][0] != '\0' && !Reconfig_Contains(reconfigTopics, wanted[slot]) && !Reconfig_Contains(added, wanted[slot]))
+        {
+            memcpy(added[slot], wanted[slot], sizeof(added[slot]));
+            changed = true;
+        }
+        if (reconfigTopics[slot][0] != '\0' && !Reconfig_Contains(wanted, reconfigTopics[slot]) &&
+            !Reconfig_Contains(removed, reconfigTopics[slot]))
+        {
+            memcpy(removed[slot], reconfigTopics[slot], sizeof(removed[slot]));
+            changed = true;
+        }
+    }
+    memcpy(reconfigTopics, wanted, sizeof(reconfigTopics));
+    xSemaphoreGive(reconfigLock);
+
+    // New topics first, then the old ones that are no longer wanted
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        if (added[slot][0] != '\0')
+        {
+            MQTT_Subscribe(added[slot]);
+        }
+    }
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        if (removed[slot][0] != '\0')
+        {
+            MQTT_Unsubscribe(removed[slot]);
+        }
+    }
+
+    return changed;
+}
+
+// Reconfiguration task: apply the stored configuration each time a change is stored
+static void Task_Reconfig(void *param)
+{
+    credentialConfig stored;
+
+    while (1)
+    {
+        xSemaphoreTake(reconfigWake, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        uint32_t wifiMs = 0;
+        uint8_t sections = 0;
+        bool linked = true;
+
+        stored = *reconfigActive;
+        RetrieveCredentialsFromStorage(&stored);
+        bool wifiChanged = strcmp(stored.wifiSSID, reconfigActive->wifiSSID) != 0 ||
+                           strcmp(stored.wifiPassword, reconfigActive->wifiPassword) != 0;
+        bool mqttChanged = strcmp(stored.mqttBroker, reconfigActive->mqttBroker) != 0 || stored.mqttPort != reconfigActive->mqttPort ||
+                           strcmp(stored.mqttUsername, reconfigActive->mqttUsername) != 0 ||
+                           strcmp(stored.mqttPassword, reconfigActive->mqttPassword) != 0;
+
+        if (wifiChanged && reconfigApplyWifi == NULL)
+        {
+            LOG_W(LOG_MODULE_WIFI, "No station, the new Wi-Fi applies at the next boot");
+        }
+        else if (wifiChanged)
+        {
+            sections |= RECONFIG_WIFI;
+            memcpy(reconfigActive->wifiSSID, stored.wifiSSID, sizeof(stored.wifiSSID));
+            memcpy(reconfigActive->wifiPassword, stored.wifiPassword, sizeof(stored.wifiPassword));
+            linked = reconfigApplyWifi(stored.wifiSSID, stored.wifiPassword, pdMS_TO_TICKS(RECONFIG_WIFI_TIMEOUT_MS));
+            wifiMs = (uint32_t)((esp_timer_get_time() - start) / 1000);
+            if (!linked)
+            {
+                LOG_W(LOG_MODULE_WIFI, "No address from the new access point after %lu ms", (unsigned long)wifiMs);
+            }
+        }
+
+        if (mqttChanged || (sections & RECONFIG_WIFI))
+        {
+            sections |= RECONFIG_MQTT;
+            xSemaphoreTake(reconfigClientLock, portMAX_DELAY);
+            memcpy(reconfigActive->mqttBroker, stored.mqttBroker, sizeof(stored.mqttBroker));
+            memcpy(reconfigActive->mqttUsername, stored.mqttUsername, sizeof(stored.mqttUsername));
+            memcpy(reconfigActive->mqttPassword, stored.mqttPassword, sizeof(stored.mqttPassword));
+            reconfigActive->mqttPort = stored.mqttPort;
+            bool started = reconfigClientStarted; // Not yet: Reconfig_Connect starts with the new broker
+            if (started)
+            {
+                xSemaphoreTake(reconfigSubscribed, 0); // Only a connection from now on counts
+                MQTT_Reconfigure(reconfigActive->mqttBroker, reconfigActive->mqttPort, reconfigActive->mqttUsername,
+                                 reconfigActive->mqttPassword);
+            }
+            xSemaphoreGive(reconfigClientLock);
+
+            if (started && xSemaphoreTake(reconfigSubscribed, pdMS_TO_TICKS(RECONFIG_MQTT_TIMEOUT_MS)) != pdTRUE)
+            {
+                linked = false;
+                LOG_W(LOG_MODULE_MQTT, "Broker not reached %d ms after the change", RECONFIG_MQTT_TIMEOUT_MS);
+            }
+        }
+        else if (Reconfig_ApplyTopics())
+        {
+            sections |= RECONFIG_TOPICS;
+        }
+
+        if (sections == 0)
+        {
+            continue; // Nothing the links use changed, e.g. rules
+        }
+
+        uint32_t elapsedMs = (uint32_t)((esp_timer_get_time() - start) / 1000);
+        xSemaphoreTake(reconfigLock, portMAX_DELAY);
+        reconfigCounters.applied++;
+        reconfigCounters.failed += linked ? 0 : 1;
+        reconfigCounters.lastMs = elapsedMs;
+        reconfigCounters.lastSections = sections;
+        xSemaphoreGive(reconfigLock);
+        LOG_I(LOG_MODULE_MAIN, "Configuration applied in %lu ms (sections 0x%x, Wi-Fi %lu ms)", (unsigned long)elapsedMs,
+              (unsigned)sections, (unsigned long)wifiMs);
+    }
+}
+
+// EVENT_CONFIG_CHANGED, may come from the BLE host task: only wakes the task
+static void Reconfig_Request(const appEvent *event, void *context)
+{
+    xSemaphoreGive(reconfigWake);
+}
+
+// EVENT_MQTT_CONNECTED, on the esp-mqtt task: remember the active table, then subscribe to it
+// outside the lock
+static void Reconfig_SubscribeAll(const appEvent *event, void *context)
+{
+    static char topics[RECONFIG_TOPIC_COUNT][TOPIC_MAX_LENGTH + 1]; // esp-mqtt task only
+
+    xSemaphoreTake(reconfigLock, portMAX_DELAY);
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        Topic_Copy(Reconfig_TopicId(slot), reconfigTopics[slot], sizeof(reconfigTopics[slot]));
+    }
+    memcpy(topics, reconfigTopics, sizeof(topics));
+    xSemaphoreGive(reconfigLock);
+
+    for (size_t slot = 0; slot < RECONFIG_TOPIC_COUNT; slot++)
+    {
+        bool repeated = false;
+        for (size_t earlier = 0; earlier < slot && !repeated; earlier++)
+        {
+            repeated = strcmp(topics[earlier], topics[slot]) == 0;
+        }
+        if (topics[slot][0] != '\0' && !repeated)
+        {
+            MQTT_Subscribe(topics[slot]);
+        }
+    }
+    xSemaphoreGive(reconfigSubscribed);
+}
+
+void Reconfig_Start(credentialConfig *active, reconfigWifiApply applyWifi)
+{
+    if (reconfigWake != NULL)
+    {
+        return; // Already running
+    }
+
+    reconfigActive = active;
+    reconfigApplyWifi = applyWifi;
+    reconfigLock = xSemaphoreCreateMutexStatic(&reconfigLockBuffer);
+    reconfigClientLock = xSemaphoreCreateMutexStatic(&reconfigClientLockBuffer);
+    reconfigSubscribed = xSemaphoreCreateBinaryStatic(&reconfigSubscribedBuffer);
+    reconfigWake = xSemaphoreCreateBinaryStatic(&reconfigWakeBuffer);
+    Task_Start(TASK_RECONFIG, Task_Reconfig, NULL);
+    Event_Subscribe(EVENT_CONFIG_CHANGED, Reconfig_Request, NULL);
+    Event_Subscribe(EVENT_MQTT_CONNECTED, Reconfig_SubscribeAll, NULL);
+}
+
+void Reconfig_Connect(void)
+{
+    if (reconfigClientLock == NULL)
+    {
+        return; // Not started
+    }
+    xSemaphoreTake(reconfigClientLock, portMAX_DELAY);
+    if (!reconfigClientStarted)
+    {
+        MQTT_Connect(reconfigActive->mqttBroker, reconfigActive->mqttPort, reconfigActive->mqttUsername,
+                     reconfigActive->mqttPassword);
+        reconfigClientStarted = true;
+    }
+    xSemaphoreGive(reconfigClientLock);
+}
+
+void Reconfig_GetStats(reconfigStats *stats)
+{
+    if (reconfigLock == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(reconfigLock, portMAX_DELAY);
+    *stats = reconfigCounters;
+    xSemaphoreGive(reconfigLock);
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+ * @file        Reconfig_module.h
+ * @brief       Applies a stored configuration change to the running links.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the configuration change pipeline. Each EVENT_CONFIG_CHANGED
+ * wakes the reconfiguration task, which reads the stored configuration back and
+ * compares it with the one the links run on:
+ * - New Wi-Fi credentials reconnect the station to the new access point.
+ * - A new broker or MQTT credentials, or a new Wi-Fi, stop the MQTT client, give it
+ *   the new configuration and start it again; it subscribes on connection.
+ * - New topics, on a client that stays connected, are subscribed to before the old
+ *   ones are unsubscribed, so no command is missed in between.
+ * On each EVENT_MQTT_CONNECTED the module subscribes to the command topics of the
+ * active table (the relay topic, the topic of each relay that has one and the rules
+ * topic) and remembers them, so a later topic change knows what to unsubscribe.
+ * Nothing restarts and the relays keep their state. The switchover time, from the
+ * event to the relay topic being subscribed again, is logged and kept for the
+ * diagnostics report. Events that come while a change is being applied are merged
+ * into one more pass.
+ ******************************************************************************/
+#ifndef RECONFIG_MODULE_H
+#define RECONFIG_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "DataHandle.h"
+
+#define RECONFIG_WIFI_TIMEOUT_MS 20000 // Longest wait for an address from a new access point
+#define RECONFIG_MQTT_TIMEOUT_MS 10000 // Longest wait for the broker after a restart of the client
+
+// Sections of a change, in reconfigStats.lastSections
+#define RECONFIG_WIFI (1 << 0)
+#define RECONFIG_MQTT (1 << 1)
+#define RECONFIG_TOPICS (1 << 2)
+
+/**
+ * @brief Switches the station to new Wi-Fi credentials.
+ *
+ * @param ssid (const char *): SSID of the new access point.
+ * @param password (const char *): Its password.
+ * @param timeout (TickType_t): Longest wait for an address.
+ *
+ * @return bool: true once the station holds an address on the new access point.
+ */
+typedef bool (*reconfigWifiApply)(const char *ssid, const char *password, TickType_t timeout);
+
+/**
+ * @brief Counters of the applied changes.
+ */
+typedef struct
+{
+    uint32_t applied;     // Changes applied since boot
+    uint32_t failed;      // Changes whose link was not back within its timeout
+    uint32_t lastMs;      // Switchover time of the last change
+    uint8_t lastSections; // RECONFIG_WIFI, RECONFIG_MQTT and RECONFIG_TOPICS of the last change
+} reconfigStats;
+
+/**
+ * @brief Starts the reconfiguration task and subscribes it to the events it needs.
+ *
+ * @param active (credentialConfig *): Configuration the links were started with. The
+ * task updates it as changes are applied; nothing else may write it.
+ * @param applyWifi (reconfigWifiApply): Switches the station. May be NULL, for builds
+ * without Wi-Fi; new Wi-Fi credentials are then kept for the next boot.
+ *
+ * @details
+ * Call it before anything can store a configuration (the BLE task) and before waiting
+ * for the network, so a kit whose stored Wi-Fi is wrong can be corrected over BLE: the
+ * station is switched while the boot still waits for its address. The MQTT client is
+ * owned by the module from then on and started by Reconfig_Connect.
+ */
+void Reconfig_Start(credentialConfig *active, reconfigWifiApply applyWifi);
+
+/**
+ * @brief Makes the first connection to the broker of the active configuration.
+ *
+ * @details
+ * Call it once the station holds an address. Later calls do nothing; broker changes
+ * restart the client from the reconfiguration task.
+ */
+void Reconfig_Connect(void);
+
+/**
+ * @brief Copies the counters of the applied changes.
+ */
+void Reconfig_GetStats(reconfigStats *stats);
+
+#endif // RECONFIG_MODULE_H
@@ -0,0 +1,172 @@
+/******************************************************************************
+ * @file        RelayBackend_module.c
+ * @brief       Output drivers of the relay bank: GPIO, 74HC595 chain and mock.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Only the backend RELAY_BACKEND selects is compiled, so the relay module calls it
+ * directly. The shift backend sends BOARD_SHIFT_CHIPS bytes per write, last chip first, since
+ * the first byte shifted in ends up in the chip farthest from the ESP32. The frame is
+ * in DMA-capable memory and the transaction is polled: for a few bytes polling avoids
+ * the interrupt and task switch of a queued transaction. OE is held high from init to
+ * the first write so the chain does not show its power-up contents on the relays.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_attr.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "LOG_module.h"
+#include "RelayBackend_module.h"
+
+#if RELAY_BACKEND == RELAY_BACKEND_GPIO
+
+// ---- GPIO ----------------------------------------------------------------------
+
+static const gpio_num_t relayGpioPins[BOARD_RELAY_GPIO_COUNT] = BOARD_RELAY_PINS;
+
+bool RelayBackend_Init(void)
+{
+    // Drive every relay off before the pin becomes an output, so none pulses at boot
+    for (size_t i = 0; i < BOARD_RELAY_GPIO_COUNT; i++)
+    {
+        gpio_set_level(relayGpioPins[i], (BOARD_RELAY_ACTIVE_LOW >> i) & 1UL ? TURN_ON : TURN_OFF);
+        gpio_set_direction(relayGpioPins[i], GPIO_MODE_OUTPUT);
+    }
+    return true;
+}
+
+void RelayBackend_Write(const uint32_t shadow[RELAY_WORDS], const uint32_t changed[RELAY_WORDS])
+{
+    uint32_t levels = shadow[0] ^ BOARD_RELAY_ACTIVE_LOW; // Pin levels, polarity applied
+
+    for (size_t i = 0; i < BOARD_RELAY_GPIO_COUNT; i++)
+    {
+        if ((changed[0] >> i) & 1UL)
+        {
+            gpio_set_level(relayGpioPins[i], (levels >> i) & 1UL ? TURN_ON : TURN_OFF);
+        }
+    }
+}
+
+#elif RELAY_BACKEND == RELAY_BACKEND_SHIFT
+
+// ---- 74HC595 chain -------------------------------------------------------------
+
+_Static_assert(BOARD_SHIFT_CHIPS * 8 <= RELAY_MAX_COUNT, "The chain has more outputs than the shadow");
+
+static spi_device_handle_t relayShiftDevice = NULL;
+static DMA_ATTR uint8_t relayShiftFrame[BOARD_SHIFT_CHIPS] __attribute__((aligned(4)));
+static bool relayShiftEnabled = false; // OE released after the first write
+
+bool RelayBackend_Init(void)
+{
+    const spi_bus_config_t bus = {
+        .mosi_io_num = BOARD_SHIFT_MOSI_PIN,
+        .miso_io_num = -1,
+        .sclk_io_num = BOARD_SHIFT_SCLK_PIN,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = BOARD_SHIFT_CHIPS,
+    };
+    const spi_device_interface_config_t device = {
+        .mode = 0,
+        .clock_speed_hz = RELAY_SHIFT_CLOCK_HZ,
+        .spics_io_num = BOARD_SHIFT_LATCH_PIN, // Rises at the end of the frame: the latch edge
+        .queue_size = 1,
+    };
+
+    gpio_set_direction(BOARD_SHIFT_OE_PIN, GPIO_MODE_OUTPUT);
+    gpio_set_level(BOARD_SHIFT_OE_PIN, 1);
+    relayShiftEnabled = false;
+
+    if (spi_bus_initialize(RELAY_SHIFT_SPI_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK ||
+        spi_bus_add_device(RELAY_SHIFT_SPI_HOST, &device, &relayShiftDevice) != ESP_OK)
+    {
+        relayShiftDevice = NULL;
+        return false;
+    }
+    return true;
+}
+
+void RelayBackend_Write(const uint32_t shadow[RELAY_WORDS], const uint32_t changed[RELAY_WORDS])
+{
+    spi_transaction_t transaction = {
+        .length = BOARD_SHIFT_CHIPS * 8, // In bits
+        .tx_buffer = relayShiftFrame,
+    };
+
+    if (relayShiftDevice == NULL)
+    {
+        return;
+    }
+
+    // Chip c holds relays 8c+1 to 8c+8, relay 8c+1 on QA
+    for (size_t chip = 0; chip < BOARD_SHIFT_CHIPS; chip++)
+    {
+        relayShiftFrame[BOARD_SHIFT_CHIPS - 1 - chip] = (uint8_t)(shadow[chip / 4] >> (8 * (chip % 4)));
+    }
+    if (spi_device_polling_transmit(relayShiftDevice, &transaction) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_RELAY, "Relay chain write failed");
+        return;
+    }
+
+    if (!relayShiftEnabled)
+    {
+        gpio_set_level(BOARD_SHIFT_OE_PIN, 0);
+        relayShiftEnabled = true;
+    }
+}
+
+#elif RELAY_BACKEND == RELAY_BACKEND_MOCK
+
+// ---- Mock ----------------------------------------------------------------------
+
+static _Atomic uint32_t relayMockOutputs[RELAY_WORDS];
+static _Atomic uint32_t relayMockWrites = 0;
+
+bool RelayBackend_Init(void)
+{
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        atomic_store(&relayMockOutputs[word], 0);
+    }
+    atomic_store(&relayMockWrites, 0);
+    return true;
+}
+
+void RelayBackend_Write(const uint32_t shadow[RELAY_WORDS], const uint32_t changed[RELAY_WORDS])
+{
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        atomic_store(&relayMockOutputs[word], shadow[word]);
+    }
+    atomic_fetch_add(&relayMockWrites, 1);
+}
+
+uint32_t RelayMock_GetWriteCount(void)
+{
+    return atomic_load(&relayMockWrites);
+}
+
+bool RelayMock_Get(uint8_t relayNumber)
+{
+    if (relayNumber < 1 || relayNumber > RELAY_MAX_COUNT)
+    {
+        return false;
+    }
+    return (atomic_load(&relayMockOutputs[(relayNumber - 1) / 32]) >> ((relayNumber - 1) % 32)) & 1UL;
+}
+
+#else
+#error "Unknown RELAY_BACKEND"
+#endif
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * @file        RelayBackend_module.h
+ * @brief       Output drivers of the relay bank: GPIO, 74HC595 chain and mock.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the driver of the relay outputs. One backend is compiled
+ * in, the one RELAY_BACKEND selects:
+ * - RELAY_BACKEND_GPIO drives one GPIO per relay and writes only the pins that changed.
+ * - RELAY_BACKEND_SHIFT shifts the whole shadow into a chain of BOARD_SHIFT_CHIPS
+ *   74HC595 in one SPI transaction; the chip select is wired to RCLK, so every output
+ *   of the chain changes on the same latch edge, however many relays changed.
+ * - RELAY_BACKEND_MOCK drives nothing and keeps the last shadow and the number of
+ *   writes, for the host build and for boards without relays.
+ ******************************************************************************/
+#ifndef RELAY_BACKEND_MODULE_H
+#define RELAY_BACKEND_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Relay_module.h"
+
+/**
+ * @brief Prepares the outputs.
+ *
+ * @return bool: false if they could not be started.
+ */
+bool RelayBackend_Init(void);
+
+/**
+ * @brief Drives the outputs to a shadow.
+ *
+ * @param shadow (const uint32_t[RELAY_WORDS]): The whole shadow, bit n of word n / 32
+ * standing for relay n + 1.
+ * @param changed (const uint32_t[RELAY_WORDS]): Bits that changed since the previous
+ * write, same layout; the first write after init marks every relay as changed.
+ *
+ * @details
+ * Called with the relay lock held, from one task at a time.
+ */
+void RelayBackend_Write(const uint32_t shadow[RELAY_WORDS], const uint32_t changed[RELAY_WORDS]);
+
+#if RELAY_BACKEND == RELAY_BACKEND_MOCK
+/**
+ * @brief Returns the number of writes the mock backend received since its init.
+ */
+uint32_t RelayMock_GetWriteCount(void);
+
+/**
+ * @brief Returns the state the mock backend was last given for a relay.
+ *
+ * @param relayNumber (uint8_t): Relay 1 to RELAY_MAX_COUNT.
+ */
+bool RelayMock_Get(uint8_t relayNumber);
+#endif
+
+#endif // RELAY_BACKEND_MODULE_H
@@ -10,98 +10,355 @@
  * @copyright   © 2024 Smart Egat. All rights reserved.
  *
  * @details
- * This module provides functions to initialize and control up to 8 relays connected
- * to the ESP32. It supports setting individual or group relay states and retrieves
+ * This module provides functions to initialize and control the relay bank through
+ * its backend. It supports setting individual or group relay states and retrieves
  * the last saved states from non-volatile storage.
+ *
+ * Relays are switched from the command, rule and schedule tasks. A change of the
+ * shadow, the backend write and the store are done under one lock so the outputs and
+ * the stored blob always follow the order of the changes; readers load the shadow
+ * words atomically without the lock.
+ *
+ * Stored layout: version, relay count, then the shadow as one bit per relay, relay 1
+ * in bit 0 of the first byte.
  ******************************************************************************/
 
 #include <stdio.h>
 #include <stdbool.h>
-#include "esp_event.h"
-#include "nvs_flash.h"
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
-#include "driver/gpio.h"
 #include "Memory_module.h"
-#include "JSON_module.h"
+#include "LOG_module.h"
+#include "TRACE_module.h"
+#include "Event_module.h"
+#include "RelayBackend_module.h"
 #include "Relay_module.h"
 
-void Relay_Init()
+#define RELAY_BLOB_SIZE (2 + RELAY_MAX_COUNT / 8) // Largest stored shadow
+#define RELAY_LEGACY_COUNT 8                      // Relays stored under one key each by earlier firmware
+
+static _Atomic uint32_t relayShadow[RELAY_WORDS]; // Bit n of word n / 32 mirrors relay n + 1, written under relayLock
+static SemaphoreHandle_t relayLock = NULL;
+static StaticSemaphore_t relayLockBuffer;
+static uint8_t relayBlob[RELAY_BLOB_SIZE];
+static bool relayReady = false; // Set once the backend started, the lock exists from then on
+static _Atomic uint32_t relaySaveFailures; // States switched but not stored
+
+// Bits of the relays of the bank
+static void Relay_BankMask(uint32_t mask[RELAY_WORDS])
+{
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        size_t first = word * 32;
+        mask[word] = RELAY_COUNT >= first + 32 ? UINT32_MAX : RELAY_COUNT > first ? (1UL << (RELAY_COUNT - first)) - 1 : 0;
+    }
+}
+
+// Apply a new shadow through the backend and return the bits that changed; called with the lock held
+static bool Relay_Write(const uint32_t next[RELAY_WORDS], bool force, uint32_t changed[RELAY_WORDS])
+{
+    bool any = force;
+
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        changed[word] = force ? UINT32_MAX : next[word] ^ atomic_load(&relayShadow[word]);
+        any |= changed[word] != 0;
+    }
+    if (!any)
+    {
+        return false; // Already in that state
+    }
+
+    RelayBackend_Write(next, changed);
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        atomic_store(&relayShadow[word], next[word]);
+    }
+    return true;
+}
+
+// Publish a change written by Relay_Write; called after the lock is released, so the
+// handlers may take their own locks or switch relays themselves
+static void Relay_Publish(const uint32_t shadow[RELAY_WORDS], const uint32_t changed[RELAY_WORDS])
+{
+    Event_Publish(&(appEvent){.type = EVENT_RELAY_CHANGED, .relayChanged = {.shadow = shadow, .changed = changed}});
+}
+
+// Store the shadow; called with the lock held. A failure is counted, the outputs have
+// switched already and stay switched until the next reboot
+static bool Relay_Save(void)
+{
+    size_t length = 2 + (RELAY_COUNT + 7) / 8;
+
+    memset(relayBlob, 0, sizeof(relayBlob));
+    relayBlob[0] = RELAY_BLOB_VERSION;
+    relayBlob[1] = RELAY_COUNT;
+    for (size_t i = 0; i < RELAY_COUNT; i++)
+    {
+        if ((atomic_load(&relayShadow[i / 32]) >> (i % 32)) & 1UL)
+        {
+            relayBlob[2 + i / 8] |= 1U << (i % 8);
+        }
+    }
+    if (!Memory_SaveBlob("storage", RELAY_BLOB_KEY, relayBlob, length))
+    {
+        atomic_fetch_add(&relaySaveFailures, 1);
+        LOG_W(LOG_MODULE_RELAY, "Relay states not stored, they will not survive a reboot");
+        return false;
+    }
+    return true;
+}
+
+bool Relay_Init()
+{
+    if (relayReady)
+    {
+        return true; // Already running
+    }
+    if (!RelayBackend_Init())
+    {
+        LOG_E(LOG_MODULE_RELAY, "Relay backend %s failed to start, relays disabled", LOG_STR(RELAY_BACKEND_NAME));
+        return false;
+    }
+    relayLock = xSemaphoreCreateMutexStatic(&relayLockBuffer);
+    relayReady = true;
+    LOG_I(LOG_MODULE_RELAY, "Board %s, %u relays on %s", LOG_STR(BOARD_NAME), (unsigned)RELAY_COUNT,
+          LOG_STR(RELAY_BACKEND_NAME));
+    return true;
+}
+
+uint32_t Relay_GetSaveFailures(void)
 {
-    // Define an array of relay pins
-    const gpio_num_t relayPins[] = {
-        RELAY_1_PIN, RELAY_2_PIN, RELAY_3_PIN, RELAY_4_PIN,
-        RELAY_5_PIN, RELAY_6_PIN, RELAY_7_PIN, RELAY_8_PIN};
+    return atomic_load(&relaySaveFailures);
+}
 
-    // Iterate through the array and set each pin as output
-    for (size_t i = 0; i < sizeof(relayPins) / sizeof(relayPins[0]); i++)
+uint8_t Relay_GetCount()
+{
+    return RELAY_COUNT;
+}
+
+uint8_t Relay_Resolve(int32_t relayNo)
+{
+    if (relayNo >= 1 && relayNo <= RELAY_COUNT)
+    {
+        return (uint8_t)relayNo;
+    }
+    if (relayNo == RELAY_ALL || (relayNo == RELAY_ALL_LEGACY && RELAY_COUNT < RELAY_ALL_LEGACY))
     {
-        gpio_set_direction(relayPins[i], GPIO_MODE_OUTPUT);
+        return RELAY_ALL;
     }
+    return 0;
 }
 
-void Relay_Set(uint8_t relayNumber, bool State)
+bool Relay_Set(uint8_t relayNumber, bool State)
 {
-    // Define an array of relay pins
-    const gpio_num_t relayPins[] = {
-        RELAY_1_PIN, RELAY_2_PIN, RELAY_3_PIN, RELAY_4_PIN,
-        RELAY_5_PIN, RELAY_6_PIN, RELAY_7_PIN, RELAY_8_PIN};
+    uint32_t next[RELAY_WORDS];
+    uint32_t changedBits[RELAY_WORDS];
 
     // Ensure the relay number is within valid range
-    if (relayNumber < 1 || relayNumber > sizeof(relayPins) / sizeof(relayPins[0]))
+    if (relayNumber < 1 || relayNumber > RELAY_COUNT || !relayReady)
     {
-        return; // Invalid relay number
+        return false; // Invalid relay number, or no outputs
     }
 
-    // Set the GPIO level
-    gpio_set_level(relayPins[relayNumber - 1], State ? TURN_ON : TURN_OFF);
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        next[word] = atomic_load(&relayShadow[word]);
+    }
+    if (State)
+    {
+        next[(relayNumber - 1) / 32] |= 1UL << ((relayNumber - 1) % 32);
+    }
+    else
+    {
+        next[(relayNumber - 1) / 32] &= ~(1UL << ((relayNumber - 1) % 32));
+    }
 
-    // Construct the storage key dynamically
-    char storageKey[4];
-    snprintf(storageKey, sizeof(storageKey), "R%u", relayNumber);
+    // Drive the outputs, then save the state to storage if it changed
+    bool changed = Relay_Write(next, false, changedBits);
+    TRACE_Mark(TRACE_STAGE_GPIO);
+    if (changed)
+    {
+        Relay_Save();
+    }
+    TRACE_Mark(TRACE_STAGE_STORED);
+    xSemaphoreGive(relayLock);
 
-    // Save the state to storage
-    Memory_SaveInt32("storage", storageKey, State);
+    if (changed)
+    {
+        Relay_Publish(next, changedBits);
+    }
+    return true;
 }
 
-void Relay_SetGroup(bool State)
+bool Relay_SetGroup(bool State)
 {
-    // Define an array of relay pins
-    const gpio_num_t relayPins[] = {
-        RELAY_1_PIN, RELAY_2_PIN, RELAY_3_PIN, RELAY_4_PIN,
-        RELAY_5_PIN, RELAY_6_PIN, RELAY_7_PIN, RELAY_8_PIN};
+    uint32_t next[RELAY_WORDS];
+    uint32_t changedBits[RELAY_WORDS];
 
-    // Iterate through the relay pins and set the level for each
-    for (size_t i = 0; i < sizeof(relayPins) / sizeof(relayPins[0]); i++)
+    if (!relayReady)
+    {
+        return false;
+    }
+    Relay_BankMask(next);
+    if (!State)
     {
-        gpio_set_level(relayPins[i], State ? TURN_ON : TURN_OFF);
+        memset(next, 0, sizeof(next));
+    }
 
-        // Dynamically construct the storage key for each relay
-        char storageKey[4];
-        snprintf(storageKey, sizeof(storageKey), "R%zu", i + 1);
+    // Every relay changes in one backend write, and the bank is saved in one commit
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    bool changed = Relay_Write(next, false, changedBits);
+    TRACE_Mark(TRACE_STAGE_GPIO);
+    if (changed)
+    {
+        Relay_Save();
+    }
+    TRACE_Mark(TRACE_STAGE_STORED);
+    xSemaphoreGive(relayLock);
 
-        // Save the state to storage
-        Memory_SaveInt32("storage", storageKey, State);
+    if (changed)
+    {
+        Relay_Publish(next, changedBits);
     }
+    return true;
+}
+
+bool Relay_SetMany(const uint32_t select[RELAY_WORDS], const uint32_t states[RELAY_WORDS])
+{
+    uint32_t bank[RELAY_WORDS];
+    uint32_t next[RELAY_WORDS];
+    uint32_t changedBits[RELAY_WORDS];
+
+    if (!relayReady || select == NULL || states == NULL)
+    {
+        return false;
+    }
+    Relay_BankMask(bank);
+
+    // Merge the selected bits into the shadow, so the whole set goes out in one write
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        uint32_t mask = select[word] & bank[word];
+        next[word] = (atomic_load(&relayShadow[word]) & ~mask) | (states[word] & mask);
+    }
+    bool changed = Relay_Write(next, false, changedBits);
+    TRACE_Mark(TRACE_STAGE_GPIO);
+    if (changed)
+    {
+        Relay_Save();
+    }
+    TRACE_Mark(TRACE_STAGE_STORED);
+    xSemaphoreGive(relayLock);
+
+    if (changed)
+    {
+        Relay_Publish(next, changedBits);
+    }
+    return true;
 }
 
 void Relay_RetDataState()
 {
-    const gpio_num_t relayPins[] = {
-        RELAY_1_PIN, RELAY_2_PIN, RELAY_3_PIN, RELAY_4_PIN,
-        RELAY_5_PIN, RELAY_6_PIN, RELAY_7_PIN, RELAY_8_PIN};
+    uint32_t next[RELAY_WORDS] = {0}; // Relays without a saved state stay OFF
+    uint32_t changedBits[RELAY_WORDS];
+    size_t length = sizeof(relayBlob);
 
-    int32_t state[8];
-    char storageKey[4];
+    if (!relayReady)
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < sizeof(relayPins) / sizeof(relayPins[0]); i++)
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    if (Memory_LoadBlob("storage", RELAY_BLOB_KEY, relayBlob, &length) && length >= 2 &&
+        relayBlob[0] == RELAY_BLOB_VERSION && length == 2 + ((size_t)relayBlob[1] + 7) / 8)
     {
-        // Construct the storage key dynamically
-        snprintf(storageKey, sizeof(storageKey), "R%zu", i + 1);
+        // A bank of another size keeps the relays both sizes have
+        for (size_t i = 0; i < RELAY_COUNT && i < relayBlob[1]; i++)
+        {
+            if ((relayBlob[2 + i / 8] >> (i % 8)) & 1U)
+            {
+                next[i / 32] |= 1UL << (i % 32);
+            }
+        }
+        Relay_Write(next, true, changedBits);
+    }
+    else
+    {
+        // First boot of this firmware: import the per-relay keys once
+        char storageKey[4];
+        for (size_t i = 0; i < RELAY_LEGACY_COUNT && i < RELAY_COUNT; i++)
+        {
+            int32_t state = 0;
+            snprintf(storageKey, sizeof(storageKey), "R%zu", i + 1);
+            Memory_LoadInt32("storage", storageKey, &state);
+            if (state)
+            {
+                next[0] |= 1UL << i;
+            }
+        }
+        Relay_Write(next, true, changedBits);
+        Relay_Save();
+    }
+    xSemaphoreGive(relayLock);
+    Relay_Publish(next, changedBits);
+}
+
+bool Relay_Get(uint8_t relayNumber)
+{
+    if (relayNumber < 1 || relayNumber > RELAY_COUNT)
+    {
+        return false;
+    }
+    return (atomic_load(&relayShadow[(relayNumber - 1) / 32]) >> ((relayNumber - 1) % 32)) & 1UL;
+}
+
+bool Relay_GroupIs(bool State)
+{
+    uint32_t mask[RELAY_WORDS];
+
+    Relay_BankMask(mask);
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        if ((atomic_load(&relayShadow[word]) & mask[word]) != (State ? mask[word] : 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-        // Load the relay state from memory
-        Memory_LoadInt32("storage", storageKey, &state[i]);
+void Relay_GetShadow(uint32_t shadow[RELAY_WORDS])
+{
+    for (size_t word = 0; word < RELAY_WORDS; word++)
+    {
+        shadow[word] = atomic_load(&relayShadow[word]);
+    }
+}
 
-        // Set the relay pin level
-        gpio_set_level(relayPins[i], state[i]);
+size_t Relay_FormatHex(const uint32_t shadow[RELAY_WORDS], uint8_t count, char *text, size_t size)
+{
+    size_t digits = ((size_t)(count < RELAY_MAX_COUNT ? count : RELAY_MAX_COUNT) + 3) / 4;
+
+    if (text == NULL || size <= digits)
+    {
+        return 0;
     }
-}
\ No newline at end of file
+    for (size_t i = 0; i < digits; i++)
+    {
+        size_t nibble = digits - 1 - i;
+        text[i] = "0123456789abcdef"[(shadow[nibble / 8] >> (4 * (nibble % 8))) & 0xF];
+    }
+    text[digits] = '\0';
+    return digits;
+}
+
+uint32_t Relay_GetStateMask()
+{
+    return atomic_load(&relayShadow[0]);
+}
@@ -12,7 +12,19 @@
  * This header file declares the APIs for controlling relay states using GPIO pins.
  * It provides functions for initializing the GPIO pins, controlling individual and
  * grouped relay states, and restoring relay states from non-volatile storage.
- * This module is intended for use with the ESP32 platform.
+ * This module is intended for use with the ESP32 platform. Pins, polarity and the
+ * backend come from the board profile in Board_module.h.
+ *
+ * The relay states live in a shadow bitmap. Every change updates the shadow and hands
+ * it to the relay backend, which drives the outputs: the relay GPIOs (the default),
+ * a chain of 74HC595 shift registers written in one SPI transaction, or a mock that
+ * only records what it was given. The backend is chosen at build time with
+ * RELAY_BACKEND, from the board profile unless the build overrides it, and sets the
+ * number of relays, RELAY_COUNT. The shadow is stored in NVS as a single blob, so
+ * switching the whole bank costs one commit. Each change is published as
+ * EVENT_RELAY_CHANGED from the task that switched the relays, after the relay lock is
+ * released; changes from two tasks may be delivered in either order, so a handler
+ * that needs the current states reads them with Relay_GetShadow.
  *
  * @copyright
  * © 2024 Smart Egat. All rights reserved.
@@ -20,41 +32,98 @@
 #ifndef RELAY_MODULE_H
 #define RELAY_MODULE_H
 
-#define RELAY_1_PIN         GPIO_NUM_19
-#define RELAY_2_PIN         GPIO_NUM_18
-#define RELAY_3_PIN         GPIO_NUM_2
-#define RELAY_4_PIN         GPIO_NUM_27
-#define RELAY_5_PIN         GPIO_NUM_26
-#define RELAY_6_PIN         GPIO_NUM_25
-#define RELAY_7_PIN         GPIO_NUM_33
-#define RELAY_8_PIN         GPIO_NUM_32
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "Board_module.h"
 
 #define TURN_ON             1
 #define TURN_OFF            0
 
+#define RELAY_BACKEND_GPIO 0  // One GPIO per relay, the pins of the board profile
+#define RELAY_BACKEND_SHIFT 1 // 74HC595 chain on SPI, 8 relays per chip
+#define RELAY_BACKEND_MOCK 2  // Records the shadow, drives nothing
+#ifndef RELAY_BACKEND
+#define RELAY_BACKEND (BOARD_RELAY_SHIFT ? RELAY_BACKEND_SHIFT : RELAY_BACKEND_GPIO) // Unless the build sets one
+#endif
+
+#define RELAY_MAX_COUNT 64                       // Largest relay bank, size of the shadow
+#if RELAY_BACKEND == RELAY_BACKEND_SHIFT
+#define RELAY_COUNT (BOARD_SHIFT_CHIPS * 8)      // Relays of the bank, 8 per chip
+#define RELAY_BACKEND_NAME "shift"
+#elif RELAY_BACKEND == RELAY_BACKEND_MOCK
+#define RELAY_COUNT RELAY_MAX_COUNT
+#define RELAY_BACKEND_NAME "mock"
+#else
+#define RELAY_COUNT BOARD_RELAY_GPIO_COUNT
+#define RELAY_BACKEND_NAME "gpio"
+#endif
+#define RELAY_WORDS ((RELAY_MAX_COUNT + 31) / 32) // 32-bit words of the shadow
+#define RELAY_ALL 255                            // Relay number of the whole bank
+#define RELAY_ALL_LEGACY 16                      // relayNo of the whole bank in messages, while the bank is smaller
+#define RELAY_BLOB_KEY "relays"                  // NVS key of the stored shadow
+#define RELAY_BLOB_VERSION 1                     // Layout of the stored shadow
+#define RELAY_HEX_LENGTH (RELAY_MAX_COUNT / 4 + 1) // Text of a shadow, see Relay_FormatHex
+
+#define RELAY_SHIFT_SPI_HOST SPI2_HOST         // SPI peripheral of the chain
+#define RELAY_SHIFT_CLOCK_HZ (5 * 1000 * 1000) // SPI clock, kept low for boards with long chains
+
+_Static_assert(BOARD_RELAY_GPIO_COUNT <= 32, "The GPIO backend drives the first shadow word only");
+_Static_assert(RELAY_MAX_COUNT < RELAY_ALL, "Relay numbers must stay below RELAY_ALL");
+_Static_assert(RELAY_COUNT <= RELAY_MAX_COUNT, "The bank has more relays than the shadow");
+
 /**
- * @brief Initializes the GPIO pins for relay control.
+ * @brief Initializes the outputs of the relay bank.
+ *
+ * @return bool: false if the backend could not be started. The bank then stays
+ * stopped: every relay reads OFF and Relay_Set, Relay_SetGroup and Relay_SetMany fail.
  *
  * @details
- * Configures the GPIO pins connected to relays as output pins. This function
- * should be called during the system initialization to prepare the relays for
- * control operations.
+ * Prepares the outputs of the backend, e.g. configures the relay GPIOs as outputs.
+ * This function should be called during the system initialization, before any
+ * other relay function.
+ */
+bool Relay_Init();
+
+/**
+ * @brief Returns the number of relay changes that could not be stored.
+ *
+ * @return uint32_t: Failed saves since boot. The outputs of those changes did switch,
+ * but restore to the last stored state after a reboot.
+ */
+uint32_t Relay_GetSaveFailures(void);
+
+/**
+ * @brief Returns the number of relays of the bank, RELAY_COUNT.
  */
-void Relay_Init();
+uint8_t Relay_GetCount();
+
+/**
+ * @brief Turns a relay number from a message into a relay of the bank.
+ *
+ * @param relayNo (int32_t): Relay number as received.
+ *
+ * @return uint8_t: 1 to Relay_GetCount(), RELAY_ALL for RELAY_ALL or, on banks of fewer
+ * than 16 relays, RELAY_ALL_LEGACY, and 0 if the number is invalid.
+ */
+uint8_t Relay_Resolve(int32_t relayNo);
 
 /**
  * @brief Sets the state of a specific relay.
  *
- * @param relayNumber (uint8_t): The relay number (1-8) to control.
+ * @param relayNumber (uint8_t): The relay number (1 to Relay_GetCount()) to control.
  * @param State (bool): The desired state of the relay.
  * - `true` to turn the relay ON.
  * - `false` to turn the relay OFF.
  *
+ * @return bool: false if the relay number is invalid or the bank did not start. A
+ * state switched but not stored still returns true and counts in Relay_GetSaveFailures.
+ *
  * @details
  * Changes the state of the specified relay and saves the new state to
  * non-volatile storage for persistence across system reboots.
  */
-void Relay_Set(uint8_t relayNumber, bool State);
+bool Relay_Set(uint8_t relayNumber, bool State);
 
 /**
  * @brief Sets the state of all relays as a group.
@@ -63,11 +132,28 @@ void Relay_Set(uint8_t relayNumber, bool State);
  * - `true` to turn all relays ON.
  * - `false` to turn all relays OFF.
  *
+ * @return bool: false if the bank did not start; see Relay_Set for storage failures.
+ *
  * @details
  * Controls the state of all relays simultaneously and saves the group
  * state to non-volatile storage.
  */
-void Relay_SetGroup(bool State);
+bool Relay_SetGroup(bool State);
+
+/**
+ * @brief Sets the state of several relays in one update.
+ *
+ * @param select (const uint32_t[RELAY_WORDS]): Bit n of word n / 32 set for each relay
+ * n + 1 to change; bits beyond the bank are ignored.
+ * @param states (const uint32_t[RELAY_WORDS]): The state of each selected relay, same layout.
+ *
+ * @return bool: false if the bank did not start; see Relay_Set for storage failures.
+ *
+ * @details
+ * The selected relays switch in one backend write and the bank is saved in one commit,
+ * whatever the number of relays; nothing is written or saved if none changes.
+ */
+bool Relay_SetMany(const uint32_t select[RELAY_WORDS], const uint32_t states[RELAY_WORDS]);
 
 /**
  * @brief Restores the state of all relays from non-volatile storage.
@@ -75,8 +161,59 @@ void Relay_SetGroup(bool State);
  * @details
  * Retrieves the saved state of each relay from non-volatile storage and
  * applies the states to the corresponding GPIO pins. This function ensures
- * that the relay states are consistent after a system restart.
+ * that the relay states are consistent after a system restart. States stored by
+ * earlier firmware under one key per relay are imported once.
  */
 void Relay_RetDataState();
 
+/**
+ * @brief Returns the state of one relay.
+ *
+ * @param relayNumber (uint8_t): The relay number (1 to Relay_GetCount()).
+ *
+ * @return bool: true if the relay is ON, false if it is OFF or does not exist.
+ */
+bool Relay_Get(uint8_t relayNumber);
+
+/**
+ * @brief Tells whether every relay of the bank is in a state.
+ *
+ * @param State (bool): The state.
+ *
+ * @return bool: true if no relay would change under Relay_SetGroup(State).
+ */
+bool Relay_GroupIs(bool State);
+
+/**
+ * @brief Copies the shadow of the whole bank.
+ *
+ * @param shadow (uint32_t[RELAY_WORDS]): Receives bit n of word n / 32 set when relay
+ * n + 1 is ON.
+ */
+void Relay_GetShadow(uint32_t shadow[RELAY_WORDS]);
+
+/**
+ * @brief Writes a shadow as hexadecimal text, highest relay first.
+ *
+ * @param shadow (const uint32_t[RELAY_WORDS]): The shadow.
+ * @param count (uint8_t): Relays to write; (count + 3) / 4 digits are written.
+ * @param text (char *): Receives the null-terminated digits, relay 1 in the lowest bit
+ * of the last one.
+ * @param size (size_t): Size of text, RELAY_HEX_LENGTH holds any bank.
+ *
+ * @return size_t: Number of digits written, 0 if text is too small.
+ */
+size_t Relay_FormatHex(const uint32_t shadow[RELAY_WORDS], uint8_t count, char *text, size_t size);
+
+/**
+ * @brief Returns the current state of all relays as a bitmask.
+ *
+ * @return uint32_t: Bit n is set when relay n+1 is ON, for the first 32 relays.
+ *
+ * @details
+ * The mask mirrors the last level written to each relay pin, so it can be read
+ * cheaply by status reporters without touching GPIO or storage.
+ */
+uint32_t Relay_GetStateMask();
+
 #endif // RELAY_MODULE_H
@@ -0,0 +1,455 @@
+/******************************************************************************
+ * @file        Rule_module.c
+ * @brief       On-device automation rules evaluated on every sensor reading.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * A rule compiles to a 12-byte entry: the registry index of its sensor, a comparison
+ * code, the threshold, the release threshold (the threshold moved by the hysteresis)
+ * and the action. Each table also keeps one bit mask of rules per sensor, so a reading
+ * only visits the rules of its own sensor. A rule whose condition holds is latched and
+ * compared with its release threshold instead, which gives both the edge trigger and
+ * the hysteresis with a single comparison.
+ *
+ * As in the topic table, two tables alternate: the scheduler task evaluates the active
+ * one while a rule message is compiled into the other, and an atomic index switches
+ * them. Changes are serialized by a mutex, and each table counts the evaluations
+ * running on it: a change waits until the table it is about to refill has no
+ * evaluation left, so back-to-back changes never overwrite a table still being read.
+ * The latches are only touched by the evaluating task.
+ *
+ * Stored layout: version, count, then per rule the tconfigtype of its sensor (little
+ * endian), the comparison, the relay, the state, the threshold and the release
+ * threshold (little endian), so the table survives a change of registry order.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "LOG_module.h"
+#include "JSON_module.h"
+#include "Memory_module.h"
+#include "Relay_module.h"
+#include "Rule_module.h"
+
+_Static_assert(RULE_MAX_RULES <= 16, "Per-sensor rule masks are 16-bit");
+_Static_assert(SENSOR_REGISTRY_MAX < 256, "Sensor index overflows a byte");
+_Static_assert(RULE_BLOB_SIZE <= MEMORY_BATCH_BLOB_LENGTH, "The stored table must fit a blob");
+
+#define RULE_NAME_LENGTH 16  // Longest sensor name in a rule message
+#define RULE_OP_LENGTH 3     // Longest comparison, terminator included
+
+typedef enum
+{
+    RULE_OP_LT,
+    RULE_OP_LE,
+    RULE_OP_GT,
+    RULE_OP_GE,
+    RULE_OP_EQ,
+    RULE_OP_NE,
+    RULE_OP_COUNT,
+} ruleOp;
+
+static const char *const ruleOpNames[RULE_OP_COUNT] = {"<", "<=", ">", ">=", "==", "!="};
+
+typedef struct
+{
+    int32_t threshold; // Condition while the rule is not latched
+    int32_t release;   // Condition while it is latched
+    uint8_t sensor;    // Registry index
+    uint8_t op;        // ruleOp
+    uint8_t relay;     // 1 to Relay_GetCount(), or RELAY_ALL
+    uint8_t state;
+} ruleEntry;
+
+typedef struct
+{
+    ruleEntry entries[RULE_MAX_RULES];
+    uint8_t count;
+    uint16_t sensorRules[SENSOR_REGISTRY_MAX]; // Bit n set when rule n reads the sensor
+    uint16_t latched;                          // Bit n set while the condition of rule n holds
+} ruleTable;
+
+static ruleTable ruleTables[2];
+static _Atomic uint8_t ruleActive = 0;     // Index of the table the scheduler evaluates
+static _Atomic uint8_t ruleReaders[2];     // Evaluations running on each table
+static SemaphoreHandle_t ruleLock = NULL;  // Serializes changes, staged table and ruleBlob
+static StaticSemaphore_t ruleLockBuffer;
+static uint8_t ruleBlob[RULE_BLOB_SIZE];
+static ruleStats ruleCounters;             // Written by the scheduler task only
+
+static ruleTable *Rule_Active(void)
+{
+    return &ruleTables[atomic_load(&ruleActive)];
+}
+
+static ruleTable *Rule_Staged(void)
+{
+    return &ruleTables[atomic_load(&ruleActive) ^ 1];
+}
+
+// Take the change lock; created by the first change, which Rule_Load makes at boot
+static void Rule_Lock(void)
+{
+    if (ruleLock == NULL)
+    {
+        ruleLock = xSemaphoreCreateMutexStatic(&ruleLockBuffer);
+    }
+    xSemaphoreTake(ruleLock, portMAX_DELAY);
+}
+
+static void Rule_Unlock(void)
+{
+    xSemaphoreGive(ruleLock);
+}
+
+// Empty staged table, once the last evaluation has left it; called with the lock held
+static ruleTable *Rule_ClaimStaged(void)
+{
+    uint8_t staged = atomic_load(&ruleActive) ^ 1;
+
+    while (atomic_load(&ruleReaders[staged]) != 0)
+    {
+        vTaskDelay(1); // An evaluation that started before the last switch, at most one reading
+    }
+    memset(&ruleTables[staged], 0, sizeof(ruleTable));
+    return &ruleTables[staged];
+}
+
+// Switch to the staged table; called with the lock held
+static void Rule_Activate(void)
+{
+    Rule_Staged()->latched = 0;
+    atomic_fetch_xor(&ruleActive, 1);
+}
+
+// Enter the active table for one evaluation, returns its index
+static uint8_t Rule_Enter(void)
+{
+    while (1)
+    {
+        uint8_t index = atomic_load(&ruleActive);
+        atomic_fetch_add(&ruleReaders[index], 1);
+        if (atomic_load(&ruleActive) == index)
+        {
+            return index; // Still active after being counted, so no change can claim it now
+        }
+        atomic_fetch_sub(&ruleReaders[index], 1);
+    }
+}
+
+// Registry index of the driver with the given name or tconfigtype, -1 if none
+static int Rule_FindSensor(const char *name, int32_t topicType)
+{
+    for (size_t i = 0; i < SensorRegistry_Count(); i++)
+    {
+        const sensorDriver *driver = SensorRegistry_Get(i);
+        if ((name != NULL && strcmp(driver->name, name) == 0) || (name == NULL && driver->topicType == topicType))
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static bool Rule_Compare(ruleOp op, int32_t value, int32_t threshold)
+{
+    switch (op)
+    {
+    case RULE_OP_LT:
+        return value < threshold;
+    case RULE_OP_LE:
+        return value <= threshold;
+    case RULE_OP_GT:
+        return value > threshold;
+    case RULE_OP_GE:
+        return value >= threshold;
+    case RULE_OP_EQ:
+        return value == threshold;
+    default:
+        return value != threshold;
+    }
+}
+
+// Add a checked rule to a table
+static void Rule_Append(ruleTable *table, const ruleEntry *entry)
+{
+    table->sensorRules[entry->sensor] |= (uint16_t)(1u << table->count);
+    table->entries[table->count++] = *entry;
+}
+
+// Compile one element of the rules array into the staged table
+static bool Rule_CompileItem(const jsonItem *item, size_t index, void *context)
+{
+    ruleTable *table = (ruleTable *)context;
+    char name[RULE_NAME_LENGTH];
+    char opName[RULE_OP_LENGTH];
+    int32_t threshold, relay, state, hysteresis = 0;
+    ruleEntry entry;
+
+    if (table->count == RULE_MAX_RULES)
+    {
+        LOG_E(LOG_MODULE_RULE, "More than %d rules", RULE_MAX_RULES);
+        return false;
+    }
+    if (!JSON_ItemString(item, "sensor", name, sizeof(name)) || !JSON_ItemString(item, "op", opName, sizeof(opName)) ||
+        !JSON_ItemInt32(item, "value", &threshold) || !JSON_ItemInt32(item, "relayNo", &relay) ||
+        !JSON_ItemInt32(item, "state", &state))
+    {
+        LOG_E(LOG_MODULE_RULE, "Rule %u is missing a key", (unsigned)index);
+        return false;
+    }
+    JSON_ItemInt32(item, "hyst", &hysteresis);
+
+    int sensor = Rule_FindSensor(name, 0);
+    entry.op = RULE_OP_COUNT;
+    for (uint8_t op = 0; op < RULE_OP_COUNT; op++)
+    {
+        if (strcmp(opName, ruleOpNames[op]) == 0)
+        {
+            entry.op = op;
+        }
+    }
+    entry.relay = Relay_Resolve(relay);
+    if (sensor < 0 || entry.op == RULE_OP_COUNT || hysteresis < 0 || entry.relay == 0)
+    {
+        LOG_E(LOG_MODULE_RULE, "Rule %u is invalid", (unsigned)index);
+        return false;
+    }
+
+    // Hold a latched condition until the value is back past the threshold by the hysteresis
+    entry.sensor = (uint8_t)sensor;
+    entry.state = state ? 1 : 0;
+    entry.threshold = threshold;
+    entry.release = threshold;
+    if (entry.op == RULE_OP_LT || entry.op == RULE_OP_LE)
+    {
+        entry.release = threshold + hysteresis;
+    }
+    else if (entry.op == RULE_OP_GT || entry.op == RULE_OP_GE)
+    {
+        entry.release = threshold - hysteresis;
+    }
+
+    Rule_Append(table, &entry);
+    return true;
+}
+
+static void Rule_PutInt32(uint8_t *out, int32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (uint8_t)((uint32_t)value >> (8 * i));
+    }
+}
+
+static int32_t Rule_GetInt32(const uint8_t *in)
+{
+    return (int32_t)((uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24);
+}
+
+// Serialize the staged table
+static const uint8_t *Rule_StageBlob(size_t *length)
+{
+    const ruleTable *table = Rule_Staged();
+    size_t position = 2;
+
+    ruleBlob[0] = RULE_BLOB_VERSION;
+    ruleBlob[1] = table->count;
+    for (uint8_t i = 0; i < table->count; i++)
+    {
+        const ruleEntry *entry = &table->entries[i];
+        int32_t topicType = SensorRegistry_Get(entry->sensor)->topicType;
+
+        ruleBlob[position++] = (uint8_t)(topicType & 0xff);
+        ruleBlob[position++] = (uint8_t)((topicType >> 8) & 0xff);
+        ruleBlob[position++] = entry->op;
+        ruleBlob[position++] = entry->relay;
+        ruleBlob[position++] = entry->state;
+        Rule_PutInt32(&ruleBlob[position], entry->threshold);
+        Rule_PutInt32(&ruleBlob[position + 4], entry->release);
+        position += 8;
+    }
+
+    *length = position;
+    return ruleBlob;
+}
+
+// Rebuild the staged table from a stored blob, false if the blob is malformed
+static bool Rule_Parse(const uint8_t *blob, size_t length)
+{
+    ruleTable *table = Rule_ClaimStaged();
+
+    if (length < 2 || blob[0] != RULE_BLOB_VERSION || blob[1] > RULE_MAX_RULES || length != 2 + (size_t)blob[1] * 13)
+    {
+        return false;
+    }
+
+    for (size_t position = 2; position < length; position += 13)
+    {
+        ruleEntry entry;
+        int sensor = Rule_FindSensor(NULL, blob[position] | blob[position + 1] << 8);
+
+        entry.relay = Relay_Resolve(blob[position + 3]); // Tables stored before larger banks hold 16 for all
+        if (sensor < 0 || blob[position + 2] >= RULE_OP_COUNT || entry.relay == 0)
+        {
+            LOG_W(LOG_MODULE_RULE, "Stored rule of an unknown sensor or relay dropped");
+            continue;
+        }
+        entry.sensor = (uint8_t)sensor;
+        entry.op = blob[position + 2];
+        entry.state = blob[position + 4];
+        entry.threshold = Rule_GetInt32(&blob[position + 5]);
+        entry.release = Rule_GetInt32(&blob[position + 9]);
+        Rule_Append(table, &entry);
+    }
+    return true;
+}
+
+// Switch the relay of a rule, false if it was already in the requested state
+static bool Rule_Act(const ruleEntry *entry)
+{
+    if (entry->relay == RELAY_ALL)
+    {
+        if (Relay_GroupIs(entry->state))
+        {
+            return false;
+        }
+        Relay_SetGroup(entry->state);
+    }
+    else
+    {
+        if (Relay_Get(entry->relay) == entry->state)
+        {
+            return false;
+        }
+        Relay_Set(entry->relay, entry->state);
+    }
+    LOG_I(LOG_MODULE_RULE, "Rule switched relay %u %s", (unsigned)entry->relay, LOG_STR(entry->state ? "ON" : "OFF"));
+    return true;
+}
+
+// Compile a rule message into the staged table; called with the lock held
+static bool Rule_Compile(const char *json)
+{
+    return JSON_ForEachArrayItem(json, "rules", Rule_CompileItem, Rule_ClaimStaged(), NULL);
+}
+
+void Rule_Load(void)
+{
+    size_t length = sizeof(ruleBlob);
+
+    Rule_Lock();
+    if (Memory_LoadBlob("storage", RULE_BLOB_KEY, ruleBlob, &length) && Rule_Parse(ruleBlob, length))
+    {
+        LOG_I(LOG_MODULE_RULE, "Loaded (%u) rules", (unsigned)Rule_Staged()->count);
+    }
+    else
+    {
+        Rule_ClaimStaged(); // No rules
+    }
+    Rule_Activate();
+    Rule_Unlock();
+}
+
+bool Rule_Apply(const char *json)
+{
+    Rule_Lock();
+    bool compiled = Rule_Compile(json);
+    if (compiled)
+    {
+        Rule_Activate();
+    }
+    Rule_Unlock();
+    return compiled;
+}
+
+bool Rule_Configure(const char *json)
+{
+    size_t length;
+    bool stored = false;
+
+    Rule_Lock();
+    if (Rule_Compile(json))
+    {
+        const uint8_t *blob = Rule_StageBlob(&length);
+        stored = Memory_SaveBlob("storage", RULE_BLOB_KEY, blob, length);
+    }
+    if (stored)
+    {
+        Rule_Activate();
+        LOG_I(LOG_MODULE_RULE, "Activated (%u) rules", (unsigned)Rule_Active()->count);
+    }
+    Rule_Unlock();
+    return stored;
+}
+
+bool Rule_Evaluate(int sensor, const sensorReading *reading)
+{
+    uint16_t fire = 0;
+    bool switched = false;
+
+    if (sensor < 0 || sensor >= SENSOR_REGISTRY_MAX || reading == NULL)
+    {
+        return false;
+    }
+    uint8_t index = Rule_Enter();
+    ruleTable *table = &ruleTables[index];
+    if (table->sensorRules[sensor] == 0)
+    {
+        atomic_fetch_sub(&ruleReaders[index], 1);
+        return false;
+    }
+
+    // Conditions first, timed on their own
+    int64_t start = esp_timer_get_time();
+    for (uint16_t rules = table->sensorRules[sensor]; rules != 0; rules &= rules - 1)
+    {
+        int rule = __builtin_ctz(rules);
+        const ruleEntry *entry = &table->entries[rule];
+        uint16_t bit = (uint16_t)(1u << rule);
+        bool latched = (table->latched & bit) != 0;
+        bool holds = Rule_Compare(entry->op, reading->value, latched ? entry->release : entry->threshold);
+
+        if (holds && !latched)
+        {
+            fire |= bit;
+        }
+        table->latched = holds ? (table->latched | bit) : (table->latched & ~bit);
+        ruleCounters.checks++;
+    }
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    ruleCounters.readings++;
+    ruleCounters.totalUs += elapsed;
+    if (elapsed > ruleCounters.maxUs)
+    {
+        ruleCounters.maxUs = elapsed;
+    }
+
+    // Then the actions, in rule order
+    for (; fire != 0; fire &= fire - 1)
+    {
+        int rule = __builtin_ctz(fire);
+        ruleCounters.fired++;
+        switched |= Rule_Act(&table->entries[rule]);
+    }
+    atomic_fetch_sub(&ruleReaders[index], 1);
+    return switched;
+}
+
+void Rule_GetStats(ruleStats *stats)
+{
+    *stats = ruleCounters;
+}
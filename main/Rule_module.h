@@ -0,0 +1,112 @@
+/******************************************************************************
+ * @file        Rule_module.h
+ * @brief       On-device automation rules evaluated on every sensor reading.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the rules engine. A rule compares the value of one
+ * registered sensor with a threshold and switches a relay, or all of them, when the
+ * comparison becomes true, without a round trip through the broker:
+ * {"rules":[{"sensor":"light","op":"<","value":300,"hyst":20,"relayNo":3,"state":1},
+ *           {"sensor":"door","op":"==","value":1,"relayNo":16,"state":0}]}
+ * op is one of <, <=, >, >=, == and !=, hyst is optional and relayNo 255 (16 on banks
+ * of fewer than 16 relays) is the whole group, as in relay commands. An empty array
+ * removes every rule.
+ *
+ * Rules arrive over BLE (configtype 4) or on the rules topic, are compiled into a
+ * fixed table on the device and stored in NVS, so they keep working while the uplink
+ * is down. A rule fires once each time its condition becomes true; with hysteresis the
+ * condition only clears once the value is back past the threshold by hyst.
+ ******************************************************************************/
+#ifndef RULE_MODULE_H
+#define RULE_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "SensorRegistry_module.h"
+
+#define RULE_MAX_RULES 16          // Rules in the table, one bit each in the per-sensor masks
+#define RULE_PAYLOAD_LENGTH 1024   // Largest rule message
+#define RULE_BLOB_KEY "rules"      // NVS key of the compiled table
+#define RULE_BLOB_VERSION 1        // Layout of the stored table
+#define RULE_BLOB_SIZE (2 + RULE_MAX_RULES * 13) // Largest stored table
+
+/**
+ * @brief Evaluation counters, for the diagnostics report.
+ */
+typedef struct
+{
+    uint32_t readings; // Readings evaluated
+    uint32_t checks;   // Rule conditions evaluated
+    uint32_t fired;    // Rules whose condition became true
+    uint32_t totalUs;  // Time spent evaluating, actions excluded
+    uint32_t maxUs;    // Longest evaluation of a single reading
+} ruleStats;
+
+/**
+ * @brief Loads the stored rules.
+ *
+ * @details
+ * Rules refer to sensors by driver, so the drivers must be registered first. Rules of
+ * a sensor that is no longer registered are dropped. Call it at boot, before the
+ * tasks that evaluate or change rules start.
+ */
+void Rule_Load(void);
+
+/**
+ * @brief Compiles a rule message and activates it without storing it.
+ *
+ * @param json (const char *): Rule message.
+ *
+ * @return bool: false if the message or any of its rules is invalid; the active rules
+ * are then unchanged.
+ *
+ * @details
+ * For the benchmarks; Rule_Load puts the stored rules back. Every rule starts with
+ * its condition cleared, so a condition that already holds fires on the next reading
+ * of its sensor.
+ */
+bool Rule_Apply(const char *json);
+
+/**
+ * @brief Compiles a rule message, stores it and activates it.
+ *
+ * @param json (const char *): Rule message.
+ *
+ * @return bool: false if the message was rejected or could not be stored; the active
+ * rules are then unchanged.
+ *
+ * @details
+ * Safe from any task: changes are serialized, and a change waits for the evaluation
+ * still reading the table it replaces, so it may block for one reading.
+ */
+bool Rule_Configure(const char *json);
+
+/**
+ * @brief Evaluates the rules of one sensor against a new reading.
+ *
+ * @param sensor (int): Registry index of the sensor.
+ * @param reading (const sensorReading *): The reading.
+ *
+ * @return bool: true if a relay was switched.
+ *
+ * @details
+ * Called from the sensor scheduler task for every reading. Only the rules of the
+ * sensor are visited, and a relay already in the requested state is not written.
+ */
+bool Rule_Evaluate(int sensor, const sensorReading *reading);
+
+/**
+ * @brief Copies the evaluation counters.
+ *
+ * @param stats (ruleStats *): Receives the counters.
+ */
+void Rule_GetStats(ruleStats *stats);
+
+#endif // RULE_MODULE_H
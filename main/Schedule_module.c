@@ -0,0 +1,465 @@
+/******************************************************************************
+ * @file        Schedule_module.c
+ * @brief       Timed relay actions: pulses, delayed actions and calendars on one timer.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The heap is a fixed array in esp_timer time, guarded by a mutex. An entry keeps the
+ * start of its current occurrence next to its due time: a pulse entry is due at the
+ * start to switch the relay and again at start + pulse to switch it back, and a
+ * repeating entry then moves its start by whole periods, so the period never drifts
+ * with the lateness of the task. Calendar entries wait at SCHEDULE_PARKED, after every
+ * real due time, until the clock is set.
+ *
+ * The timer callback only gives a semaphore; relays are switched by the schedule task
+ * on the actuation core, outside the lock, since a relay write also writes NVS.
+ *
+ * Stored layout: version, count, then per entry the relay, the state, the phase, the
+ * wall-clock start, the time left until due in ms, the period and the pulse length
+ * (little endian).
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "LOG_module.h"
+#include "Memory_module.h"
+#include "Relay_module.h"
+#include "Task_module.h"
+#include "Schedule_module.h"
+
+_Static_assert(SCHEDULE_BLOB_SIZE <= MEMORY_BATCH_BLOB_LENGTH, "The stored table must fit a blob");
+
+#define SCHEDULE_PARKED INT64_MAX // Due time of a calendar entry while the clock is not set
+
+typedef struct
+{
+    int64_t due;   // esp_timer time of the next switch
+    int64_t start; // esp_timer time of the current occurrence
+    scheduleAction action;
+    uint8_t phase; // 0: switch to state next, 1: switch back at the end of the pulse
+} scheduleEntry;
+
+static scheduleEntry scheduleHeap[SCHEDULE_MAX_ENTRIES]; // Min-heap on due
+static size_t scheduleCount = 0;
+static SemaphoreHandle_t scheduleLock = NULL;
+static StaticSemaphore_t scheduleLockBuffer;
+static SemaphoreHandle_t scheduleWake = NULL; // Given by the timer
+static StaticSemaphore_t scheduleWakeBuffer;
+static esp_timer_handle_t scheduleTimer = NULL;
+static uint8_t scheduleBlob[SCHEDULE_BLOB_SIZE];
+static scheduleStats scheduleCounters; // Written by the schedule task only
+
+static void Schedule_Swap(size_t a, size_t b)
+{
+    scheduleEntry entry = scheduleHeap[a];
+    scheduleHeap[a] = scheduleHeap[b];
+    scheduleHeap[b] = entry;
+}
+
+static void Schedule_SiftUp(size_t index)
+{
+    while (index > 0 && scheduleHeap[(index - 1) / 2].due > scheduleHeap[index].due)
+    {
+        Schedule_Swap(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+}
+
+static void Schedule_SiftDown(size_t index)
+{
+    while (1)
+    {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+
+        if (left < scheduleCount && scheduleHeap[left].due < scheduleHeap[smallest].due)
+        {
+            smallest = left;
+        }
+        if (right < scheduleCount && scheduleHeap[right].due < scheduleHeap[smallest].due)
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            return;
+        }
+        Schedule_Swap(index, smallest);
+        index = smallest;
+    }
+}
+
+static void Schedule_Push(const scheduleEntry *entry)
+{
+    scheduleHeap[scheduleCount] = *entry;
+    Schedule_SiftUp(scheduleCount++);
+}
+
+static void Schedule_RemoveAt(size_t index)
+{
+    scheduleHeap[index] = scheduleHeap[--scheduleCount];
+    if (index < scheduleCount)
+    {
+        Schedule_SiftUp(index);
+        Schedule_SiftDown(index);
+    }
+}
+
+// Wall-clock time in ms, 0 while the clock is not set
+static int64_t Schedule_WallMs(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec < SCHEDULE_CLOCK_VALID ? 0 : (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+// Start of the next occurrence of a calendar action, SCHEDULE_PARKED while the clock is not set
+static int64_t Schedule_CalendarStart(const scheduleAction *action, int64_t now)
+{
+    int64_t wallMs = Schedule_WallMs();
+
+    if (wallMs == 0)
+    {
+        return SCHEDULE_PARKED;
+    }
+
+    int64_t aheadMs = (int64_t)action->atEpoch * 1000 - wallMs;
+    if (aheadMs < 0 && action->everyMs != 0)
+    {
+        aheadMs += ((-aheadMs + action->everyMs - 1) / action->everyMs) * action->everyMs; // Skip past occurrences
+    }
+    return now + (aheadMs > 0 ? aheadMs * 1000 : 0);
+}
+
+// Arm the timer for the earliest entry; called with the lock held
+static void Schedule_Arm(void)
+{
+    esp_timer_stop(scheduleTimer); // Fails harmlessly when it is not running
+    if (scheduleCount == 0 || scheduleHeap[0].due == SCHEDULE_PARKED)
+    {
+        return;
+    }
+
+    int64_t wait = scheduleHeap[0].due - esp_timer_get_time();
+    esp_timer_start_once(scheduleTimer, wait > 0 ? (uint64_t)wait : 1);
+}
+
+static void Schedule_PutUint32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t Schedule_GetUint32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+// Store the table; called with the lock held
+static bool Schedule_Save(void)
+{
+    int64_t now = esp_timer_get_time();
+    size_t position = 2;
+
+    scheduleBlob[0] = SCHEDULE_BLOB_VERSION;
+    scheduleBlob[1] = (uint8_t)scheduleCount;
+    for (size_t i = 0; i < scheduleCount; i++)
+    {
+        const scheduleEntry *entry = &scheduleHeap[i];
+        int64_t leftMs = entry->due == SCHEDULE_PARKED ? 0 : (entry->due - now) / 1000;
+
+        scheduleBlob[position++] = entry->action.relay;
+        scheduleBlob[position++] = entry->action.state;
+        scheduleBlob[position++] = entry->phase;
+        Schedule_PutUint32(&scheduleBlob[position], entry->action.atEpoch);
+        Schedule_PutUint32(&scheduleBlob[position + 4], leftMs > 0 ? (uint32_t)leftMs : 0);
+        Schedule_PutUint32(&scheduleBlob[position + 8], entry->action.everyMs);
+        Schedule_PutUint32(&scheduleBlob[position + 12], entry->action.pulseMs);
+        position += 16;
+    }
+    return Memory_SaveBlob("storage", SCHEDULE_BLOB_KEY, scheduleBlob, position);
+}
+
+// Rebuild the heap from the stored table
+static void Schedule_Load(void)
+{
+    size_t length = sizeof(scheduleBlob);
+    int64_t now = esp_timer_get_time();
+
+    if (!Memory_LoadBlob("storage", SCHEDULE_BLOB_KEY, scheduleBlob, &length) || length < 2 ||
+        scheduleBlob[0] != SCHEDULE_BLOB_VERSION || scheduleBlob[1] > SCHEDULE_MAX_ENTRIES ||
+        length != 2 + (size_t)scheduleBlob[1] * 19)
+    {
+        return;
+    }
+
+    for (size_t position = 2; position < length; position += 19)
+    {
+        scheduleEntry entry = {0};
+        uint32_t leftMs = Schedule_GetUint32(&scheduleBlob[position + 7]);
+
+        entry.action.relay = Relay_Resolve(scheduleBlob[position]);
+        if (entry.action.relay == 0)
+        {
+            continue; // The relay bank shrank
+        }
+        entry.action.state = scheduleBlob[position + 1];
+        entry.phase = scheduleBlob[position + 2] ? 1 : 0;
+        entry.action.atEpoch = Schedule_GetUint32(&scheduleBlob[position + 3]);
+        entry.action.everyMs = Schedule_GetUint32(&scheduleBlob[position + 11]);
+        entry.action.pulseMs = Schedule_GetUint32(&scheduleBlob[position + 15]);
+
+        // A pulse or a delay resumes with the time it had left; a calendar start comes from the clock
+        if (entry.phase == 0 && entry.action.atEpoch != 0)
+        {
+            entry.start = entry.due = Schedule_CalendarStart(&entry.action, now);
+        }
+        else
+        {
+            entry.due = now + (int64_t)leftMs * 1000;
+            entry.start = entry.phase ? entry.due - (int64_t)entry.action.pulseMs * 1000 : entry.due;
+        }
+        Schedule_Push(&entry);
+    }
+    LOG_I(LOG_MODULE_RELAY, "Restored (%u) scheduled actions", (unsigned)scheduleCount);
+}
+
+// Switch the relay of an action
+static void Schedule_Switch(uint8_t relay, bool state)
+{
+    if (relay == RELAY_ALL)
+    {
+        Relay_SetGroup(state);
+    }
+    else
+    {
+        Relay_Set(relay, state);
+    }
+}
+
+// Pop every entry that is due, advance or drop it, and return the switches to make
+static size_t Schedule_TakeDue(scheduleEntry due[SCHEDULE_MAX_ENTRIES], bool *changed)
+{
+    int64_t now = esp_timer_get_time();
+    size_t count = 0;
+
+    while (scheduleCount > 0 && scheduleHeap[0].due <= now && count < SCHEDULE_MAX_ENTRIES)
+    {
+        scheduleEntry entry = scheduleHeap[0];
+        Schedule_RemoveAt(0);
+        due[count++] = entry;
+
+        if (entry.phase == 0 && entry.action.pulseMs != 0)
+        {
+            entry.phase = 1; // Switch back at the end of the pulse
+            entry.due = entry.start + (int64_t)entry.action.pulseMs * 1000;
+            *changed = true;
+        }
+        else if (entry.action.everyMs != 0)
+        {
+            int64_t period = (int64_t)entry.action.everyMs * 1000;
+            entry.start += period;
+            if (entry.start <= now)
+            {
+                entry.start += ((now - entry.start) / period + 1) * period; // Missed occurrences are skipped
+            }
+            *changed |= entry.phase != 0;
+            entry.phase = 0;
+            entry.due = entry.start;
+        }
+        else
+        {
+            *changed = true; // Done
+            continue;
+        }
+        Schedule_Push(&entry);
+    }
+    return count;
+}
+
+static void Schedule_TimerExpired(void *arg)
+{
+    xSemaphoreGive(scheduleWake);
+}
+
+// Schedule task: switch what is due, then re-arm the timer
+static void Task_Schedule(void *param)
+{
+    static scheduleEntry due[SCHEDULE_MAX_ENTRIES];
+
+    while (1)
+    {
+        bool changed = false;
+
+        xSemaphoreTake(scheduleWake, portMAX_DELAY);
+        xSemaphoreTake(scheduleLock, portMAX_DELAY);
+        size_t count = Schedule_TakeDue(due, &changed);
+        Schedule_Arm();
+        xSemaphoreGive(scheduleLock);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            bool state = due[i].phase ? !due[i].action.state : due[i].action.state;
+            Schedule_Switch(due[i].action.relay, state);
+
+            uint32_t late = (uint32_t)(esp_timer_get_time() - due[i].due);
+            scheduleCounters.fired++;
+            scheduleCounters.totalLateUs += late;
+            if (late > scheduleCounters.maxLateUs)
+            {
+                scheduleCounters.maxLateUs = late;
+            }
+            LOG_D(LOG_MODULE_RELAY, "Scheduled relay %u %s, %lu us late", (unsigned)due[i].action.relay,
+                  LOG_STR(state ? "ON" : "OFF"), (unsigned long)late);
+        }
+
+        if (changed)
+        {
+            xSemaphoreTake(scheduleLock, portMAX_DELAY);
+            Schedule_Save();
+            xSemaphoreGive(scheduleLock);
+        }
+    }
+}
+
+void Schedule_Start(void)
+{
+    if (scheduleLock != NULL)
+    {
+        return; // Already running
+    }
+
+    const esp_timer_create_args_t timerArgs = {
+        .callback = Schedule_TimerExpired,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "relay_sched",
+        .skip_unhandled_events = true,
+    };
+    scheduleLock = xSemaphoreCreateMutexStatic(&scheduleLockBuffer);
+    scheduleWake = xSemaphoreCreateBinaryStatic(&scheduleWakeBuffer);
+    if (esp_timer_create(&timerArgs, &scheduleTimer) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_RELAY, "Relay schedule timer could not be created");
+        return;
+    }
+
+    xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    Schedule_Load();
+    Schedule_Arm();
+    xSemaphoreGive(scheduleLock);
+    Task_Start(TASK_SCHEDULE, Task_Schedule, NULL);
+}
+
+bool Schedule_Add(const scheduleAction *action)
+{
+    scheduleEntry entry = {0};
+    bool added = false;
+
+    if (action == NULL || scheduleTimer == NULL ||
+        Relay_Resolve(action->relay) != action->relay ||
+        (action->atEpoch != 0 && action->atEpoch < SCHEDULE_CLOCK_VALID))
+    {
+        return false;
+    }
+
+    entry.action = *action;
+    entry.action.state = action->state ? 1 : 0;
+    entry.action.delayMs = 0; // Only used to compute the first start
+
+    xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    if (scheduleCount < SCHEDULE_MAX_ENTRIES)
+    {
+        int64_t now = esp_timer_get_time();
+        entry.start = entry.due = action->atEpoch ? Schedule_CalendarStart(action, now) : now + (int64_t)action->delayMs * 1000;
+        Schedule_Push(&entry);
+        added = Schedule_Save();
+        for (size_t i = 0; !added && i < scheduleCount; i++)
+        {
+            if (memcmp(&scheduleHeap[i], &entry, sizeof(entry)) == 0)
+            {
+                Schedule_RemoveAt(i); // Not kept unless it survives a reboot
+                break;
+            }
+        }
+        Schedule_Arm();
+    }
+    xSemaphoreGive(scheduleLock);
+
+    if (!added)
+    {
+        LOG_W(LOG_MODULE_RELAY, "Relay action not scheduled (%u pending)", (unsigned)scheduleCount);
+    }
+    return added;
+}
+
+int Schedule_Cancel(uint8_t relay)
+{
+    int removed = 0;
+
+    if (scheduleLock == NULL)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    for (size_t i = scheduleCount; i-- > 0;)
+    {
+        if (relay == RELAY_ALL || scheduleHeap[i].action.relay == relay)
+        {
+            Schedule_RemoveAt(i);
+            removed++;
+        }
+    }
+    if (removed)
+    {
+        Schedule_Save();
+        Schedule_Arm();
+    }
+    xSemaphoreGive(scheduleLock);
+    return removed;
+}
+
+void Schedule_ClockSynced(void)
+{
+    if (scheduleLock == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < scheduleCount; i++)
+    {
+        if (scheduleHeap[i].action.atEpoch != 0 && scheduleHeap[i].phase == 0)
+        {
+            scheduleHeap[i].start = scheduleHeap[i].due = Schedule_CalendarStart(&scheduleHeap[i].action, now);
+        }
+    }
+    for (size_t i = scheduleCount / 2; i-- > 0;)
+    {
+        Schedule_SiftDown(i); // Heapify after the changes
+    }
+    Schedule_Arm();
+    xSemaphoreGive(scheduleLock);
+}
+
+void Schedule_GetStats(scheduleStats *stats)
+{
+    *stats = scheduleCounters;
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+ * @file        Schedule_module.h
+ * @brief       Timed relay actions: pulses, delayed actions and calendars on one timer.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the relay scheduler. Every pending action sits in a
+ * min-heap ordered by due time, and a single one-shot esp_timer is armed for the
+ * earliest one, so any number of schedules costs one timer and no polling. When it
+ * expires the schedule task switches the relays that are due and re-arms the timer.
+ *
+ * An action runs after a delay or at a wall-clock time, may repeat with a fixed
+ * period, and may switch the relay back after a pulse length, which makes "on at
+ * 07:00 for 30 minutes every day" a single entry. Calendar actions wait for the clock
+ * to be set by SNTP. The table is stored in NVS whenever an entry is added, removed
+ * or reaches the end of its pulse; after a reboot pending delays resume with the time
+ * they had left when last stored, and calendar actions are recomputed from the clock.
+ *
+ * The lateness of every action (time switched minus time due) is recorded for the
+ * diagnostics report.
+ ******************************************************************************/
+#ifndef SCHEDULE_MODULE_H
+#define SCHEDULE_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHEDULE_MAX_ENTRIES 16          // Pending actions
+#define SCHEDULE_CLOCK_VALID 1700000000  // Wall-clock seconds below which the clock is not set
+#define SCHEDULE_BLOB_KEY "sched"        // NVS key of the stored table
+#define SCHEDULE_BLOB_VERSION 1          // Layout of the stored table
+#define SCHEDULE_BLOB_SIZE (2 + SCHEDULE_MAX_ENTRIES * 19) // Largest stored table
+
+/**
+ * @brief One scheduled relay action.
+ */
+typedef struct
+{
+    uint8_t relay;    // 1 to Relay_GetCount(), or RELAY_ALL
+    uint8_t state;    // State switched to when due
+    uint32_t delayMs; // Delay from now, used when atEpoch is 0
+    uint32_t atEpoch; // Wall-clock time in seconds since 1970 (UTC), 0 for a delay
+    uint32_t everyMs; // Repeat period, 0 for a single action
+    uint32_t pulseMs; // Switch back to !state after this long, 0 to stay
+} scheduleAction;
+
+/**
+ * @brief Timing counters, for the diagnostics report.
+ */
+typedef struct
+{
+    uint32_t fired;       // Actions switched
+    uint32_t totalLateUs; // Sum of the lateness of all actions
+    uint32_t maxLateUs;   // Largest lateness
+} scheduleStats;
+
+/**
+ * @brief Loads the stored table, creates the timer and starts the schedule task.
+ */
+void Schedule_Start(void);
+
+/**
+ * @brief Adds an action.
+ *
+ * @param action (const scheduleAction *): The action.
+ *
+ * @return bool: false if the action is invalid, the table is full or it could not be
+ * stored.
+ */
+bool Schedule_Add(const scheduleAction *action);
+
+/**
+ * @brief Removes the pending actions of a relay.
+ *
+ * @param relay (uint8_t): Relay 1 to Relay_GetCount(), or RELAY_ALL for every action.
+ *
+ * @return int: Number of actions removed. A pulse in progress is cancelled without
+ * switching the relay back.
+ */
+int Schedule_Cancel(uint8_t relay);
+
+/**
+ * @brief Recomputes the due times of calendar actions after the clock was set.
+ *
+ * @details
+ * Called from the SNTP sync callback; also corrects the drift of the esp_timer
+ * clock against wall time at every resync.
+ */
+void Schedule_ClockSynced(void);
+
+/**
+ * @brief Copies the timing counters.
+ *
+ * @param stats (scheduleStats *): Receives the counters.
+ */
+void Schedule_GetStats(scheduleStats *stats);
+
+#endif // SCHEDULE_MODULE_H
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * @file        SensorRegistry_module.c
+ * @brief       Registry of sensor drivers and the task that samples and publishes them.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The scheduler keeps the tick at which each driver is due and blocks on the post
+ * queue until the nearest one, so it wakes only to sample or to publish a posted
+ * reading. Due ticks advance by whole periods, so a late wake-up does not shift the
+ * following samples; a driver that fell more than a period behind restarts from now.
+ * The registry, the queue storage and the payload buffer are static.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "LOG_module.h"
+#include "Task_module.h"
+#include "SensorRegistry_module.h"
+
+// Reading posted by an event-driven driver
+typedef struct
+{
+    int sensor;
+    sensorReading reading;
+} sensorPost;
+
+static const sensorDriver *registryDrivers[SENSOR_REGISTRY_MAX];
+static size_t registryCount = 0;
+static TickType_t registryDue[SENSOR_REGISTRY_MAX]; // Tick of the next sample, scheduler task only
+static sensorPublishCallback registryPublish = NULL;
+static char registryPayload[SENSOR_REGISTRY_PAYLOAD_LENGTH]; // Scheduler task only
+
+static QueueHandle_t registryQueue = NULL;
+static StaticQueue_t registryQueueBuffer;
+static uint8_t registryQueueStorage[SENSOR_REGISTRY_QUEUE_LENGTH * sizeof(sensorPost)];
+
+// Sampling period of a driver in ticks, 0 for a driver that only posts
+static TickType_t SensorRegistry_Period(int sensor)
+{
+    uint32_t periodMs = registryDrivers[sensor]->periodMs;
+    TickType_t period = pdMS_TO_TICKS(periodMs);
+    return (periodMs != 0 && period == 0) ? 1 : period;
+}
+
+// Encode a reading and hand both to the publish callback
+static void SensorRegistry_Publish(int sensor, const sensorReading *reading)
+{
+    int length = registryDrivers[sensor]->encode(reading, registryPayload, sizeof(registryPayload));
+
+    if (length <= 0)
+    {
+        LOG_W(LOG_MODULE_SENSOR, "Sensor %s could not be encoded", LOG_STR(registryDrivers[sensor]->name));
+        length = 0; // The reading itself is still valid
+    }
+    if (registryPublish != NULL)
+    {
+        registryPublish(sensor, reading, registryPayload, length);
+    }
+}
+
+// Sample every due driver and return the ticks until the next one is due
+static TickType_t SensorRegistry_RunDue(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = portMAX_DELAY;
+    sensorReading reading;
+
+    for (size_t i = 0; i < registryCount; i++)
+    {
+        TickType_t period = SensorRegistry_Period(i);
+        if (period == 0)
+        {
+            continue;
+        }
+
+        if ((int32_t)(registryDue[i] - now) <= 0)
+        {
+            if (registryDrivers[i]->sample(&reading))
+            {
+                SensorRegistry_Publish(i, &reading);
+            }
+            registryDue[i] += period;
+            if ((int32_t)(registryDue[i] - now) <= 0)
+            {
+                registryDue[i] = now + period; // More than a period behind
+            }
+        }
+
+        TickType_t remaining = registryDue[i] - now;
+        if (remaining < wait)
+        {
+            wait = remaining;
+        }
+    }
+    return wait;
+}
+
+// Scheduler task: periodic samples and posted readings, in one place
+static void Task_SensorScheduler(void *param)
+{
+    TickType_t now = xTaskGetTickCount();
+    sensorPost post;
+
+    for (size_t i = 0; i < registryCount; i++)
+    {
+        registryDue[i] = now; // First sample right away
+    }
+
+    while (1)
+    {
+        TickType_t wait = SensorRegistry_RunDue();
+
+        if (xQueueReceive(registryQueue, &post, wait) == pdTRUE)
+        {
+            SensorRegistry_Publish(post.sensor, &post.reading);
+            registryDue[post.sensor] = xTaskGetTickCount() + SensorRegistry_Period(post.sensor); // Heartbeat restarts
+        }
+    }
+}
+
+int SensorRegistry_Register(const sensorDriver *driver)
+{
+    if (driver == NULL || driver->sample == NULL || driver->encode == NULL)
+    {
+        return -1;
+    }
+    if (registryCount == SENSOR_REGISTRY_MAX)
+    {
+        LOG_E(LOG_MODULE_SENSOR, "Sensor registry full, %s not registered", LOG_STR(driver->name));
+        return -1;
+    }
+
+    registryDrivers[registryCount] = driver;
+    return (int)registryCount++;
+}
+
+size_t SensorRegistry_Count(void)
+{
+    return registryCount;
+}
+
+const sensorDriver *SensorRegistry_Get(int sensor)
+{
+    return (sensor >= 0 && (size_t)sensor < registryCount) ? registryDrivers[sensor] : NULL;
+}
+
+void SensorRegistry_Init(void)
+{
+    if (registryQueue == NULL)
+    {
+        registryQueue = xQueueCreateStatic(SENSOR_REGISTRY_QUEUE_LENGTH, sizeof(sensorPost), registryQueueStorage, &registryQueueBuffer);
+    }
+
+    for (size_t i = 0; i < registryCount; i++)
+    {
+        if (registryDrivers[i]->init != NULL && !registryDrivers[i]->init())
+        {
+            LOG_W(LOG_MODULE_SENSOR, "Sensor %s failed to initialize", LOG_STR(registryDrivers[i]->name));
+        }
+    }
+}
+
+void SensorRegistry_Start(sensorPublishCallback publish)
+{
+    if (registryQueue == NULL)
+    {
+        SensorRegistry_Init();
+    }
+    registryPublish = publish;
+    Task_Start(TASK_SENSOR_SCHEDULER, Task_SensorScheduler, NULL);
+}
+
+bool SensorRegistry_Post(int sensor, const sensorReading *reading)
+{
+    sensorPost post;
+
+    if (registryQueue == NULL || SensorRegistry_Get(sensor) == NULL || reading == NULL)
+    {
+        return false;
+    }
+
+    post.sensor = sensor;
+    post.reading = *reading;
+    return xQueueSend(registryQueue, &post, 0) == pdTRUE;
+}
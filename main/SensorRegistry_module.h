@@ -0,0 +1,132 @@
+/******************************************************************************
+ * @file        SensorRegistry_module.h
+ * @brief       Registry of sensor drivers and the task that samples and publishes them.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the sensor registry. A driver describes one published
+ * sensor: the configuration key and topic type of its MQTT topic, a sampling period
+ * and init, sample and encode callbacks. The configuration and storage code builds
+ * its sensor topics from the registered drivers, and a single scheduler task samples
+ * every driver at its own period and hands the encoded payload to the publish
+ * callback, so adding a sensor means registering one more driver.
+ *
+ * Drivers whose values change on events rather than over time post readings with
+ * SensorRegistry_Post; they are published at once and the periodic sample then acts
+ * as a heartbeat.
+ ******************************************************************************/
+#ifndef SENSOR_REGISTRY_MODULE_H
+#define SENSOR_REGISTRY_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SENSOR_REGISTRY_MAX 6             // Registered drivers, one topic each
+#define SENSOR_REGISTRY_QUEUE_LENGTH 8    // Posted readings waiting to be published
+#define SENSOR_REGISTRY_PAYLOAD_LENGTH 96 // Encoded payload of one reading
+
+/**
+ * @brief One result of a sensor.
+ */
+typedef struct
+{
+    int32_t value;     // Calibrated value in the unit of the sensor
+    int32_t raw;       // Raw measurement, such as a filtered ADC code or a pin level
+    int32_t millivolt; // Input voltage, 0 for digital inputs
+    int64_t timestamp; // esp_timer time of the result
+} sensorReading;
+
+/**
+ * @brief Description and callbacks of a sensor driver.
+ *
+ * @details
+ * init is called once from SensorRegistry_Init and may be shared by drivers of the
+ * same hardware. sample returns false while the driver has no reading yet, and encode
+ * returns the payload length, 0 if the reading cannot be encoded.
+ */
+typedef struct
+{
+    const char *name;     // Short name used in logs
+    const char *topicKey; // JSON and storage key of the topic, such as "temp_topic"
+    int32_t topicType;    // tconfigtype selecting the topic in a topic message
+    uint32_t periodMs;    // Sampling period; the heartbeat period of event-driven drivers
+    bool (*init)(void);
+    bool (*sample)(sensorReading *reading);
+    int (*encode)(const sensorReading *reading, char *payload, size_t payloadSize);
+} sensorDriver;
+
+/**
+ * @brief Receives every reading with its encoded payload.
+ *
+ * @param sensor (int): Registry index of the driver.
+ * @param reading (const sensorReading *): The reading, for local use such as rules.
+ * @param payload (const char *): Encoded reading.
+ * @param length (int): Length of the payload, 0 if the reading could not be encoded.
+ */
+typedef void (*sensorPublishCallback)(int sensor, const sensorReading *reading, const char *payload, int length);
+
+/**
+ * @brief Adds a driver to the registry.
+ *
+ * @param driver (const sensorDriver *): Driver, kept by reference.
+ *
+ * @return int: Registry index of the driver, -1 if the registry is full.
+ *
+ * @details
+ * Drivers are registered before the configuration is loaded, since the registry
+ * defines which sensor topics the configuration holds.
+ */
+int SensorRegistry_Register(const sensorDriver *driver);
+
+/**
+ * @brief Returns the number of registered drivers.
+ */
+size_t SensorRegistry_Count(void);
+
+/**
+ * @brief Returns a registered driver.
+ *
+ * @param sensor (int): Registry index.
+ *
+ * @return const sensorDriver *: The driver, NULL for an unused index.
+ */
+const sensorDriver *SensorRegistry_Get(int sensor);
+
+/**
+ * @brief Calls the init callback of every registered driver.
+ *
+ * @details
+ * Called early so the drivers have readings by the time the scheduler starts. A
+ * driver whose init fails is still scheduled; its sample simply returns false.
+ */
+void SensorRegistry_Init(void);
+
+/**
+ * @brief Starts the scheduler task.
+ *
+ * @param publish (sensorPublishCallback): Called from the scheduler task with each
+ * reading and its encoded payload.
+ */
+void SensorRegistry_Start(sensorPublishCallback publish);
+
+/**
+ * @brief Queues a reading of an event-driven driver for immediate publishing.
+ *
+ * @param sensor (int): Registry index of the driver.
+ * @param reading (const sensorReading *): Reading to publish.
+ *
+ * @return bool: false if the queue is full or the registry is not initialized.
+ *
+ * @details
+ * Callable from any task. Readings are published in order, and the periodic sample
+ * of the driver is postponed by a full period after each one.
+ */
+bool SensorRegistry_Post(int sensor, const sensorReading *reading);
+
+#endif // SENSOR_REGISTRY_MODULE_H
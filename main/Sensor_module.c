@@ -0,0 +1,374 @@
+/******************************************************************************
+ * @file        Sensor_module.c
+ * @brief       Sensor acquisition with the ADC continuous driver and latest-value slots.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The ESP32 digital controller scans the channel pattern at SENSOR_SAMPLE_RATE_HZ and
+ * emits TYPE1 results (channel and 12-bit code). Each slot has a single writer, the
+ * sensor task for the analog inputs and the door debounce timer for the door: it
+ * makes the sequence odd, writes the reading and makes it even again. Readers copy
+ * the reading between two loads of the sequence and retry if it changed or was odd,
+ * so neither side ever waits for the other.
+ *
+ * The door interrupt disables itself and arms the debounce timer, keeping the time of
+ * the first edge. The timer callback re-enables the interrupt before it reads the
+ * pin, so an edge during the read arms the timer again instead of being lost.
+ *
+ * Frames, blocks and filters are static; the driver allocates its DMA pool once in
+ * Sensor_Init.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "driver/gpio.h"
+#include "LOG_module.h"
+#include "DSP_module.h"
+#include "Task_module.h"
+#include "Sensor_module.h"
+
+#define SENSOR_ADC_CHANNELS 2 // Temperature and light, in pattern order
+
+_Static_assert(SENSOR_OVERSAMPLE <= DSP_MAX_BLOCK, "SENSOR_OVERSAMPLE exceeds DSP_MAX_BLOCK");
+_Static_assert(SENSOR_AVERAGE_WINDOW <= DSP_MAX_AVERAGE_WINDOW, "SENSOR_AVERAGE_WINDOW exceeds DSP_MAX_AVERAGE_WINDOW");
+
+// Latest-value slot: even sequence when stable, odd while the sensor task writes
+typedef struct
+{
+    _Atomic uint32_t sequence;
+    sensorReading reading;
+} sensorSlot;
+
+// State of one ADC input between frames
+typedef struct
+{
+    adc_channel_t channel;
+    sensorId sensor;
+    dspCalibration calibration;
+    dspMovingAverage average;
+    uint16_t block[SENSOR_OVERSAMPLE];
+    size_t blockCount;
+} sensorInput;
+
+static sensorSlot sensorSlots[SENSOR_COUNT];
+static sensorInput sensorInputs[SENSOR_ADC_CHANNELS] = {
+    {.channel = SENSOR_TEMP_CHANNEL, .sensor = SENSOR_TEMPERATURE, .calibration = SENSOR_TEMP_CALIBRATION},
+    {.channel = SENSOR_LIGHT_CHANNEL, .sensor = SENSOR_LIGHT, .calibration = SENSOR_LIGHT_CALIBRATION},
+};
+static uint8_t sensorFrame[SENSOR_FRAME_SIZE];
+static adc_continuous_handle_t sensorAdc = NULL;
+static adc_cali_handle_t sensorCali = NULL; // NULL when the eFuse holds no calibration
+static bool sensorStarted = false;          // Sensor_Init has run
+static bool sensorRunning = false;          // ADC sampling started
+
+static esp_timer_handle_t doorDebounceTimer = NULL;
+static volatile int64_t doorEdgeTime = 0;   // First edge since the last debounced read, 0 if none
+static int32_t doorLevel = -1;              // Last debounced level, -1 before the first read
+static int sensorRegistryIndex[SENSOR_COUNT] = {-1, -1, -1}; // Registry index of each driver
+
+// Publish a reading to its slot, from the single writer of that slot
+static void Sensor_Store(sensorId sensor, const sensorReading *reading)
+{
+    sensorSlot *slot = &sensorSlots[sensor];
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->reading = *reading;
+    atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+}
+
+// Reduce a full block of one input to a reading
+static void Sensor_ProcessBlock(sensorInput *input)
+{
+    sensorReading reading;
+    int millivolt = 0;
+
+    uint16_t median = DSP_Median(input->block, input->blockCount);
+    int32_t average = DSP_MovingAverageUpdate(&input->average, median);
+    int32_t raw = (average + (1 << (DSP_AVERAGE_FRACTION_BITS - 1))) >> DSP_AVERAGE_FRACTION_BITS;
+    input->blockCount = 0;
+
+    if (sensorCali == NULL || adc_cali_raw_to_voltage(sensorCali, raw, &millivolt) != ESP_OK)
+    {
+        millivolt = (int)((raw * SENSOR_FULL_SCALE_MV) / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1));
+    }
+
+    reading.raw = raw;
+    reading.millivolt = millivolt;
+    reading.value = DSP_Calibrate(&input->calibration, millivolt);
+    reading.timestamp = esp_timer_get_time();
+    Sensor_Store(input->sensor, &reading);
+}
+
+// Door edge: mask further edges and let the timer read the pin once it is quiet
+static void IRAM_ATTR Sensor_DoorIsr(void *arg)
+{
+    gpio_intr_disable(SENSOR_DOOR_PIN);
+    if (doorEdgeTime == 0)
+    {
+        doorEdgeTime = esp_timer_get_time();
+    }
+    esp_timer_start_once(doorDebounceTimer, SENSOR_DOOR_DEBOUNCE_MS * 1000);
+}
+
+// Debounce timer: store and post the door level if it changed
+static void Sensor_DoorDebounced(void *arg)
+{
+    sensorReading reading = {0};
+    int64_t edgeTime = doorEdgeTime;
+
+    doorEdgeTime = 0;
+    gpio_intr_enable(SENSOR_DOOR_PIN); // Before the read, so no later edge is missed
+    reading.raw = gpio_get_level(SENSOR_DOOR_PIN);
+    if (reading.raw == doorLevel)
+    {
+        return; // Bounced back to the previous state
+    }
+
+    reading.value = reading.raw; // Pull-up: high while the contact is open
+    reading.timestamp = edgeTime != 0 ? edgeTime : esp_timer_get_time();
+    Sensor_Store(SENSOR_DOOR, &reading);
+
+    if (doorLevel >= 0 && !SensorRegistry_Post(sensorRegistryIndex[SENSOR_DOOR], &reading))
+    {
+        LOG_W(LOG_MODULE_SENSOR, "Door change not posted");
+    }
+    doorLevel = reading.raw;
+}
+
+// Door input with an interrupt on both edges, and its initial level
+static bool Sensor_InitDoor(void)
+{
+    const esp_timer_create_args_t timerArgs = {
+        .callback = Sensor_DoorDebounced,
+        .name = "door_debounce",
+    };
+    gpio_config_t config = {
+        .pin_bit_mask = 1ULL << SENSOR_DOOR_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = BOARD_DOOR_PULLUP ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+
+    if (esp_timer_create(&timerArgs, &doorDebounceTimer) != ESP_OK ||
+        gpio_config(&config) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_SENSOR, "Door input could not be configured");
+        return false;
+    }
+    Sensor_DoorDebounced(NULL); // Initial level, not queued as a change
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if ((err != ESP_OK && err != ESP_ERR_INVALID_STATE) || // INVALID_STATE: already installed
+        gpio_isr_handler_add(SENSOR_DOOR_PIN, Sensor_DoorIsr, NULL) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_SENSOR, "Door interrupt could not be installed");
+        return false;
+    }
+    return true;
+}
+
+// Sensor task: split DMA frames by channel and process every full block
+static void Task_Sensor(void *param)
+{
+    while (1)
+    {
+        uint32_t length = 0;
+        esp_err_t err = adc_continuous_read(sensorAdc, sensorFrame, sizeof(sensorFrame), &length, SENSOR_READ_TIMEOUT_MS);
+
+        if (err == ESP_OK)
+        {
+            for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES)
+            {
+                const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&sensorFrame[offset];
+
+                for (int i = 0; i < SENSOR_ADC_CHANNELS; i++)
+                {
+                    sensorInput *input = &sensorInputs[i];
+                    if (result->type1.channel == input->channel)
+                    {
+                        input->block[input->blockCount++] = result->type1.data;
+                        if (input->blockCount == SENSOR_OVERSAMPLE)
+                        {
+                            Sensor_ProcessBlock(input);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+        else if (err != ESP_ERR_TIMEOUT)
+        {
+            LOG_W(LOG_MODULE_SENSOR, "ADC read failed: %d", err);
+            vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_TIMEOUT_MS));
+        }
+    }
+}
+
+// Create the eFuse-based calibration, if this chip has one
+static void Sensor_InitCalibration(void)
+{
+#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = SENSOR_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    if (adc_cali_create_scheme_line_fitting(&config, &sensorCali) != ESP_OK)
+    {
+        sensorCali = NULL;
+        LOG_W(LOG_MODULE_SENSOR, "No ADC calibration in eFuse, using a nominal full scale");
+    }
+#endif
+}
+
+bool Sensor_Init(void)
+{
+    adc_continuous_handle_cfg_t handleConfig = {
+        .max_store_buf_size = SENSOR_POOL_SIZE,
+        .conv_frame_size = SENSOR_FRAME_SIZE,
+    };
+    adc_digi_pattern_config_t pattern[SENSOR_ADC_CHANNELS];
+    adc_continuous_config_t config = {
+        .pattern_num = SENSOR_ADC_CHANNELS,
+        .adc_pattern = pattern,
+        .sample_freq_hz = SENSOR_SAMPLE_RATE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+
+    if (sensorStarted)
+    {
+        return sensorRunning; // Shared by the analog drivers, started once
+    }
+    sensorStarted = true;
+
+    for (int i = 0; i < SENSOR_ADC_CHANNELS; i++)
+    {
+        pattern[i].atten = SENSOR_ADC_ATTEN;
+        pattern[i].channel = sensorInputs[i].channel;
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        DSP_MovingAverageInit(&sensorInputs[i].average, SENSOR_AVERAGE_WINDOW);
+    }
+
+    Sensor_InitCalibration();
+
+    if (adc_continuous_new_handle(&handleConfig, &sensorAdc) != ESP_OK ||
+        adc_continuous_config(sensorAdc, &config) != ESP_OK ||
+        adc_continuous_start(sensorAdc) != ESP_OK)
+    {
+        LOG_E(LOG_MODULE_SENSOR, "ADC continuous driver could not be started");
+        return false;
+    }
+
+    sensorRunning = Task_Start(TASK_SENSOR, Task_Sensor, NULL) != NULL;
+    return sensorRunning;
+}
+
+bool Sensor_GetLatest(sensorId sensor, sensorReading *reading)
+{
+    uint32_t before, after;
+
+    if (sensor >= SENSOR_COUNT || reading == NULL)
+    {
+        return false;
+    }
+
+    sensorSlot *slot = &sensorSlots[sensor];
+    do
+    {
+        before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        *reading = slot->reading;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    } while (before != after || (before & 1));
+
+    return before != 0; // Sequence 0: never written
+}
+
+// Encode a reading of one of the sensors of this module
+static int Sensor_Format(sensorId sensor, const sensorReading *reading, char *payload, size_t payloadSize)
+{
+    unsigned long long timestamp = (unsigned long long)(reading->timestamp / 1000);
+    unsigned long age = (unsigned long)((esp_timer_get_time() - reading->timestamp) / 1000);
+    int length;
+
+    if (sensor == SENSOR_DOOR)
+    {
+        length = snprintf(payload, payloadSize, "{\"value\":%ld,\"raw\":%ld,\"ts_ms\":%llu,\"age_ms\":%lu}",
+                          (long)reading->value, (long)reading->raw, timestamp, age);
+    }
+    else
+    {
+        long magnitude = reading->value < 0 ? -(long)reading->value : (long)reading->value;
+        length = snprintf(payload, payloadSize, "{\"value\":%s%ld.%02ld,\"raw\":%ld,\"ts_ms\":%llu,\"age_ms\":%lu}",
+                          reading->value < 0 ? "-" : "", magnitude / 100, magnitude % 100, (long)reading->raw, timestamp, age);
+    }
+    return (length > 0 && (size_t)length < payloadSize) ? length : 0;
+}
+
+// Registry callbacks of the three drivers
+static bool Sensor_SampleTemperature(sensorReading *reading)
+{
+    return Sensor_GetLatest(SENSOR_TEMPERATURE, reading);
+}
+
+static bool Sensor_SampleLight(sensorReading *reading)
+{
+    return Sensor_GetLatest(SENSOR_LIGHT, reading);
+}
+
+static bool Sensor_SampleDoor(sensorReading *reading)
+{
+    return Sensor_GetLatest(SENSOR_DOOR, reading);
+}
+
+static int Sensor_EncodeTemperature(const sensorReading *reading, char *payload, size_t payloadSize)
+{
+    return Sensor_Format(SENSOR_TEMPERATURE, reading, payload, payloadSize);
+}
+
+static int Sensor_EncodeLight(const sensorReading *reading, char *payload, size_t payloadSize)
+{
+    return Sensor_Format(SENSOR_LIGHT, reading, payload, payloadSize);
+}
+
+static int Sensor_EncodeDoor(const sensorReading *reading, char *payload, size_t payloadSize)
+{
+    return Sensor_Format(SENSOR_DOOR, reading, payload, payloadSize);
+}
+
+static const sensorDriver sensorDrivers[SENSOR_COUNT] = {
+    [SENSOR_TEMPERATURE] = {"temperature", "temp_topic", SENSOR_TEMP_TOPIC_TYPE, SENSOR_TEMP_PERIOD_MS,
+                            Sensor_Init, Sensor_SampleTemperature, Sensor_EncodeTemperature},
+    [SENSOR_LIGHT] = {"light", "light_topic", SENSOR_LIGHT_TOPIC_TYPE, SENSOR_LIGHT_PERIOD_MS,
+                      Sensor_Init, Sensor_SampleLight, Sensor_EncodeLight},
+    [SENSOR_DOOR] = {"door", "door_topic", SENSOR_DOOR_TOPIC_TYPE, SENSOR_DOOR_HEARTBEAT_MS,
+                     Sensor_InitDoor, Sensor_SampleDoor, Sensor_EncodeDoor},
+};
+
+void Sensor_RegisterDrivers(void)
+{
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensorRegistryIndex[i] = SensorRegistry_Register(&sensorDrivers[i]);
+    }
+}
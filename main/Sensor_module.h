@@ -0,0 +1,110 @@
+/******************************************************************************
+ * @file        Sensor_module.h
+ * @brief       Sensor acquisition with the ADC continuous driver and latest-value slots.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the sensor subsystem. The temperature and light inputs
+ * are sampled by the ADC continuous driver, which fills DMA frames without CPU
+ * involvement. The sensor task splits each frame by channel, reduces every block of
+ * SENSOR_OVERSAMPLE samples to its median, smooths the medians with a moving
+ * average, converts the result to millivolts with the eFuse calibration and then to
+ * engineering units. The door contact raises a GPIO interrupt on every edge; a
+ * one-shot timer reads the pin once it has been quiet for SENSOR_DOOR_DEBOUNCE_MS and
+ * posts each debounced change to the sensor registry for immediate publishing. Each
+ * result is also stored in a lock-free latest-value slot that the registry samples
+ * without blocking the writer.
+ ******************************************************************************/
+#ifndef SENSOR_MODULE_H
+#define SENSOR_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal/adc_types.h"
+#include "driver/gpio.h"
+#include "Board_module.h"
+#include "SensorRegistry_module.h"
+
+#define SENSOR_SAMPLE_RATE_HZ 20000         // Conversions per second across all channels, the ESP32 minimum
+#define SENSOR_FRAME_SIZE 256               // Bytes per DMA conversion frame
+#define SENSOR_POOL_SIZE 1024               // Bytes of frames buffered by the driver
+#define SENSOR_READ_TIMEOUT_MS 100          // Wait for a frame before checking the driver again
+#define SENSOR_OVERSAMPLE 64                // Samples per channel reduced to one median
+#define SENSOR_AVERAGE_WINDOW 16            // Medians in the moving average
+#define SENSOR_FULL_SCALE_MV 3100           // Used when the eFuse holds no ADC calibration
+#define SENSOR_ADC_ATTEN ADC_ATTEN_DB_12    // Input range up to ~3.1 V
+
+#define SENSOR_TEMP_CHANNEL BOARD_TEMP_CHANNEL   // Analog temperature sensor
+#define SENSOR_LIGHT_CHANNEL BOARD_LIGHT_CHANNEL // Light dependent resistor divider
+#define SENSOR_DOOR_PIN BOARD_DOOR_PIN           // Reed contact to GND, pulled up
+#define SENSOR_DOOR_DEBOUNCE_MS 50          // Quiet time after the last edge before the pin is read
+
+// Two-point calibrations from millivolts, {mV low, mV high, value low, value high}
+#define SENSOR_TEMP_CALIBRATION {0, 1000, 0, 10000}    // 10 mV/°C, value in 0.01 °C
+#define SENSOR_LIGHT_CALIBRATION {100, 3000, 0, 10000} // Dark to full light, value in 0.01 %
+
+// Registry entries: publishing period, and the topic key and tconfigtype of the topic
+#define SENSOR_TEMP_PERIOD_MS 10000         // Temperature publishing period
+#define SENSOR_LIGHT_PERIOD_MS 5000         // Light publishing period
+#define SENSOR_DOOR_HEARTBEAT_MS 600000     // Door state republished after this long without a change
+#define SENSOR_TEMP_TOPIC_TYPE 9
+#define SENSOR_LIGHT_TOPIC_TYPE 10
+#define SENSOR_DOOR_TOPIC_TYPE 11
+
+/**
+ * @brief Sensors with a latest-value slot.
+ */
+typedef enum
+{
+    SENSOR_TEMPERATURE, // 0.01 °C
+    SENSOR_LIGHT,       // 0.01 %
+    SENSOR_DOOR,        // 1 open, 0 closed
+    SENSOR_COUNT,
+} sensorId;
+
+/**
+ * @brief Configures the ADC and its calibration and starts sampling.
+ *
+ * @return bool: false if the ADC driver could not be started; the temperature and
+ * light slots then stay empty.
+ *
+ * @details
+ * Init callback of the temperature and light drivers; the ADC is started once.
+ */
+bool Sensor_Init(void);
+
+/**
+ * @brief Copies the latest reading of a sensor.
+ *
+ * @param sensor (sensorId): Sensor to read.
+ * @param reading (sensorReading *): Receives the reading.
+ *
+ * @return bool: false if the sensor has produced no reading yet.
+ *
+ * @details
+ * Never blocks: each slot is a sequence lock with a single writer, the sensor task
+ * or the door debounce timer, and a read that overlaps a write is simply retried.
+ */
+bool Sensor_GetLatest(sensorId sensor, sensorReading *reading);
+
+/**
+ * @brief Registers the temperature, light and door drivers with the sensor registry.
+ *
+ * @details
+ * Called before the configuration is loaded. The analog drivers share Sensor_Init
+ * and the door driver configures its input and interrupt. The drivers sample
+ * the latest-value slots and encode {"value":v,"raw":r,"ts_ms":t,"age_ms":a}, with the
+ * temperature and light values in their units to two decimals and the door as 0 or
+ * 1. ts_ms is the time of the reading in milliseconds since boot and age_ms its age
+ * when encoded. Door changes are posted as they happen; the periodic door sample is
+ * a heartbeat.
+ */
+void Sensor_RegisterDrivers(void);
+
+#endif // SENSOR_MODULE_H
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * @file        Shadow_module.c
+ * @brief       Retained device shadow: relay states, config version and link metrics.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The shadow task samples the state into a zeroed structure and compares it with the
+ * current one. Only a different state gets the next sequence number, is encoded and
+ * is published as EVENT_SHADOW_CHANGED, so an idle kit sends nothing. Publishing to
+ * the broker is tracked by sequence number: a publication that fails (broker
+ * disconnected) is retried at the next wake with the latest shadow.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "LOG_module.h"
+#include "MQTT_module.h"
+#include "Relay_module.h"
+#include "DataHandle.h"
+#include "Task_module.h"
+#include "Event_module.h"
+#include "Shadow_module.h"
+
+typedef struct
+{
+    uint32_t relays[RELAY_WORDS];
+    uint32_t configVersion;
+    uint32_t wifiDrops;
+    uint32_t mqttConnects;
+    uint8_t relayCount;
+    int8_t rssi; // Rounded to SHADOW_RSSI_STEP
+} shadowState;
+
+static topicId shadowTopic;
+static shadowLinkReader shadowReadLink = NULL;
+static SemaphoreHandle_t shadowWake = NULL;
+static StaticSemaphore_t shadowWakeBuffer;
+static shadowState shadowCurrent;      // Written by the shadow task only
+static uint32_t shadowPublished = 0;   // Sequence on the broker, shadow task only
+static _Atomic uint32_t shadowSequence = 0;
+static char shadowMessage[SHADOW_LENGTH]; // Encoded shadowCurrent, under shadowLock
+static SemaphoreHandle_t shadowLock = NULL;
+static StaticSemaphore_t shadowLockBuffer;
+
+// Sample the current state; the structure is zeroed so it compares with memcmp
+static void Shadow_Sample(shadowState *state)
+{
+    shadowLink link = {0};
+
+    memset(state, 0, sizeof(*state));
+    state->relayCount = Relay_GetCount();
+    Relay_GetShadow(state->relays);
+    state->configVersion = GetConfigVersion();
+    state->mqttConnects = MQTT_GetConnectCount();
+
+    if (shadowReadLink != NULL)
+    {
+        shadowReadLink(&link);
+    }
+    state->wifiDrops = link.wifiDrops;
+    // Round towards zero to a multiple of the step, so -61 and -64 both read -60
+    state->rssi = (int8_t)(link.rssi / SHADOW_RSSI_STEP * SHADOW_RSSI_STEP);
+}
+
+// Encode a state as the current shadow message
+static void Shadow_Encode(const shadowState *state, uint32_t sequence)
+{
+    char relays[RELAY_HEX_LENGTH];
+
+    Relay_FormatHex(state->relays, state->relayCount, relays, sizeof(relays));
+    xSemaphoreTake(shadowLock, portMAX_DELAY);
+    snprintf(shadowMessage, sizeof(shadowMessage), "{\"seq\":%lu,\"relays\":\"%s\",\"n\":%u,\"cfg\":%lu,\"link\":[%d,%lu,%lu]}",
+             (unsigned long)sequence, relays, (unsigned)state->relayCount, (unsigned long)state->configVersion,
+             (int)state->rssi, (unsigned long)state->wifiDrops, (unsigned long)state->mqttConnects);
+    xSemaphoreGive(shadowLock);
+}
+
+// Publish the current shadow as the retained message, true if the client took it
+static bool Shadow_Publish(void)
+{
+    char topic[TOPIC_MAX_LENGTH + sizeof(SHADOW_TOPIC_SUFFIX)];
+    char message[SHADOW_LENGTH];
+
+    size_t length = Topic_Copy(shadowTopic, topic, sizeof(topic) - strlen(SHADOW_TOPIC_SUFFIX));
+    if (length == 0 || !MQTT_IsConnected())
+    {
+        return false;
+    }
+    Shadow_Get(message, sizeof(message));
+    memcpy(topic + length, SHADOW_TOPIC_SUFFIX, sizeof(SHADOW_TOPIC_SUFFIX));
+    return MQTT_PublishRetained(topic, message) >= 0;
+}
+
+// Shadow task: give a changed state the next sequence number, and keep the broker up to date
+static void Task_Shadow(void *param)
+{
+    shadowState state;
+
+    while (1)
+    {
+        // A wake is usually one relay change of several; let the rest land first
+        if (xSemaphoreTake(shadowWake, pdMS_TO_TICKS(SHADOW_SAMPLE_PERIOD_MS)) == pdTRUE)
+        {
+            vTaskDelay(pdMS_TO_TICKS(SHADOW_SETTLE_MS));
+            xSemaphoreTake(shadowWake, 0);
+        }
+
+        Shadow_Sample(&state);
+        if (memcmp(&state, &shadowCurrent, sizeof(state)) != 0)
+        {
+            uint32_t sequence = atomic_load(&shadowSequence) + 1;
+            shadowCurrent = state;
+            Shadow_Encode(&state, sequence);
+            atomic_store(&shadowSequence, sequence);
+            Event_Publish(&(appEvent){.type = EVENT_SHADOW_CHANGED, .shadowChanged = {.sequence = sequence}});
+        }
+
+        uint32_t sequence = atomic_load(&shadowSequence);
+        if (sequence != shadowPublished && Shadow_Publish())
+        {
+            shadowPublished = sequence;
+            LOG_D(LOG_MODULE_MQTT, "Shadow %lu published", (unsigned long)sequence);
+        }
+    }
+}
+
+// Events that may change the shadow; runs on the publishing task, so it only wakes the shadow task
+static void Shadow_Changed(const appEvent *event, void *context)
+{
+    Shadow_Notify();
+}
+
+void Shadow_Start(topicId topic, shadowLinkReader readLink)
+{
+    if (shadowWake != NULL)
+    {
+        return; // Already running
+    }
+
+    shadowTopic = topic;
+    shadowReadLink = readLink;
+    shadowWake = xSemaphoreCreateBinaryStatic(&shadowWakeBuffer);
+    shadowLock = xSemaphoreCreateMutexStatic(&shadowLockBuffer);
+    xSemaphoreGive(shadowWake); // First sample at once, a boot with every relay off raises no event
+    memset(&shadowCurrent, 0, sizeof(shadowCurrent));
+    Event_Subscribe(EVENT_RELAY_CHANGED, Shadow_Changed, NULL);
+    Event_Subscribe(EVENT_CONFIG_CHANGED, Shadow_Changed, NULL); // New configuration version
+    Event_Subscribe(EVENT_MQTT_CONNECTED, Shadow_Changed, NULL); // Changes made while offline, and the connection count
+    Task_Start(TASK_SHADOW, Task_Shadow, NULL);
+}
+
+void Shadow_Notify(void)
+{
+    if (shadowWake != NULL)
+    {
+        xSemaphoreGive(shadowWake);
+    }
+}
+
+size_t Shadow_Get(char *message, size_t size)
+{
+    size_t length = 0;
+
+    if (shadowLock == NULL || message == NULL || size == 0)
+    {
+        return 0;
+    }
+    xSemaphoreTake(shadowLock, portMAX_DELAY);
+    length = strlen(shadowMessage);
+    if (length >= size)
+    {
+        length = 0; // Never a cut message
+    }
+    memcpy(message, shadowMessage, length);
+    message[length] = '\0';
+    xSemaphoreGive(shadowLock);
+    return length;
+}
+
+uint32_t Shadow_GetSequence(void)
+{
+    return atomic_load(&shadowSequence);
+}
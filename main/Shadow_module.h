@@ -0,0 +1,99 @@
+/******************************************************************************
+ * @file        Shadow_module.h
+ * @brief       Retained device shadow: relay states, config version and link metrics.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the device shadow. The shadow is a short retained message
+ * holding the current relay states, the configuration version and the link metrics.
+ * It is published to the relay topic followed by SHADOW_TOPIC_SUFFIX. The broker keeps
+ * the last one, so any number of dashboards read the current state on subscribe
+ * without asking the device, including after a restart of either side.
+ *
+ * The shadow gets the next sequence number only when its content changed, and is
+ * published then; a publication missed while the broker was away is sent on
+ * reconnection. Local clients read the same message with Shadow_Get and are told of
+ * each new one by EVENT_SHADOW_CHANGED, published from the shadow task. Relay
+ * changes, configuration changes and connections to the broker wake the shadow task
+ * at once. The configuration version and link metrics are
+ * sampled every SHADOW_SAMPLE_PERIOD_MS. The RSSI is rounded to SHADOW_RSSI_STEP, so
+ * normal signal noise does not republish it.
+ ******************************************************************************/
+#ifndef SHADOW_MODULE_H
+#define SHADOW_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "Topic_module.h"
+
+#define SHADOW_TOPIC_SUFFIX "/shadow"    // Shadow goes to the relay topic with this suffix
+#define SHADOW_SAMPLE_PERIOD_MS 10000    // Sampling of the link metrics and config version
+#define SHADOW_SETTLE_MS 50              // A burst of relay changes becomes one publication
+#define SHADOW_RSSI_STEP 6               // dB, RSSI changes smaller than this are not published
+#define SHADOW_LENGTH 128                // Largest shadow message
+
+/**
+ * @brief Link metrics of the shadow.
+ */
+typedef struct
+{
+    int8_t rssi;         // Signal of the access point in dBm, 0 while not associated
+    uint32_t wifiDrops;  // Associations lost since boot
+} shadowLink;
+
+/**
+ * @brief Reads the Wi-Fi link metrics, for the shadow.
+ *
+ * @param link (shadowLink *): Receives the metrics.
+ */
+typedef void (*shadowLinkReader)(shadowLink *link);
+
+/**
+ * @brief Subscribes to the events that change the shadow and starts the shadow task.
+ *
+ * @param topic (topicId): Topic the suffix is appended to. It is looked up for every
+ * publication; an unset topic disables publishing.
+ * @param readLink (shadowLinkReader): Reads the Wi-Fi metrics. May be NULL, for
+ * builds without Wi-Fi; the metrics are then reported as 0.
+ *
+ * @details
+ * Call it before the relays, the configuration and the broker connection are
+ * started, so none of their events is missed, and after Http_Start, whose pushes
+ * follow EVENT_SHADOW_CHANGED. The shadow format is:
+ * {"seq":n,"relays":"hex","n":count,"cfg":version,"link":[rssi,wifiDrops,mqttConnects]}
+ * where relays holds one bit per relay, relay 1 in the lowest bit, as (n + 3) / 4 hex
+ * digits, and seq restarts from 1 at boot.
+ */
+void Shadow_Start(topicId topic, shadowLinkReader readLink);
+
+/**
+ * @brief Wakes the shadow task to compare and publish the shadow now.
+ *
+ * @details
+ * Cheap and safe from any task: it only gives a semaphore. The events that change
+ * the shadow call it already; call it for changes that raise no event.
+ */
+void Shadow_Notify(void);
+
+/**
+ * @brief Copies the current shadow message.
+ *
+ * @param message (char *): Receives the null-terminated message.
+ * @param size (size_t): Size of the buffer, SHADOW_LENGTH holds any shadow.
+ *
+ * @return size_t: Length of the message, 0 before the first sample or if it does not fit.
+ */
+size_t Shadow_Get(char *message, size_t size);
+
+/**
+ * @brief Returns the sequence number of the current shadow, 0 before the first sample.
+ */
+uint32_t Shadow_GetSequence(void);
+
+#endif // SHADOW_MODULE_H
@@ -0,0 +1,190 @@
+/******************************************************************************
+ * @file        TRACE_module.c
+ * @brief       Command path trace points, trace ring and latency histograms.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * A trace is a set of esp_timer timestamps, one per stage, owned by the task that
+ * started it. Marking a stage is a timestamp read and a store, cheap enough to leave
+ * enabled in production. When the trace ends, the stage durations are stored in a
+ * fixed ring and added to log-linear histograms: each power of two is split into
+ * four buckets, which bounds the percentile error to a quarter of an octave with
+ * fewer than a hundred counters per stage.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "TRACE_module.h"
+
+#define TRACE_HISTOGRAM_STEPS (1 << TRACE_HISTOGRAM_STEP_BITS)
+#define TRACE_HISTOGRAM_BUCKETS (TRACE_HISTOGRAM_OCTAVES * TRACE_HISTOGRAM_STEPS)
+
+// Trace being recorded
+static struct
+{
+    TaskHandle_t owner;                 // Task allowed to mark, NULL when idle
+    int32_t correlationId;
+    int64_t markTime[TRACE_STAGE_COUNT]; // 0 for stages not reached
+} traceActive;
+
+static traceRecord traceRing[TRACE_RING_SIZE]; // Last completed traces
+static uint32_t traceRingNext = 0;             // Next ring slot to fill
+
+// One histogram per stage plus one for the end-to-end duration
+static uint32_t traceHistogram[TRACE_STAGE_COUNT + 1][TRACE_HISTOGRAM_BUCKETS];
+static uint32_t traceSamples[TRACE_STAGE_COUNT + 1];
+
+static const char *const traceStageNames[TRACE_STAGE_COUNT + 1] = {
+    "received", "parse", "gpio", "nvs", "log", "ack", "total"};
+
+// Map a duration to its log-linear bucket
+static uint32_t TRACE_Bucket(uint32_t value)
+{
+    if (value < TRACE_HISTOGRAM_STEPS)
+    {
+        return value; // Small values are counted exactly
+    }
+
+    uint32_t msb = 31 - __builtin_clz(value);
+    uint32_t step = (value >> (msb - TRACE_HISTOGRAM_STEP_BITS)) & (TRACE_HISTOGRAM_STEPS - 1);
+    uint32_t bucket = (msb - TRACE_HISTOGRAM_STEP_BITS + 1) * TRACE_HISTOGRAM_STEPS + step;
+
+    return bucket < TRACE_HISTOGRAM_BUCKETS ? bucket : TRACE_HISTOGRAM_BUCKETS - 1;
+}
+
+// Largest duration that falls into a bucket
+static uint32_t TRACE_BucketUpperBound(uint32_t bucket)
+{
+    if (bucket < TRACE_HISTOGRAM_STEPS)
+    {
+        return bucket;
+    }
+
+    uint32_t msb = bucket / TRACE_HISTOGRAM_STEPS + TRACE_HISTOGRAM_STEP_BITS - 1;
+    uint32_t step = bucket % TRACE_HISTOGRAM_STEPS;
+    uint32_t width = 1UL << (msb - TRACE_HISTOGRAM_STEP_BITS);
+
+    return ((TRACE_HISTOGRAM_STEPS + step) << (msb - TRACE_HISTOGRAM_STEP_BITS)) + width - 1;
+}
+
+// True when the calling task owns the active trace
+static bool TRACE_IsOwner(void)
+{
+    return traceActive.owner != NULL && traceActive.owner == xTaskGetCurrentTaskHandle();
+}
+
+void TRACE_Begin(void)
+{
+    memset(&traceActive, 0, sizeof(traceActive));
+    traceActive.correlationId = -1;
+    traceActive.markTime[TRACE_STAGE_RECEIVED] = esp_timer_get_time();
+    traceActive.owner = xTaskGetCurrentTaskHandle();
+}
+
+void TRACE_Mark(traceStage stage)
+{
+    if (stage < TRACE_STAGE_COUNT && TRACE_IsOwner())
+    {
+        traceActive.markTime[stage] = esp_timer_get_time();
+    }
+}
+
+void TRACE_SetCorrelationId(int32_t correlationId)
+{
+    if (TRACE_IsOwner())
+    {
+        traceActive.correlationId = correlationId;
+    }
+}
+
+bool TRACE_Snapshot(traceRecord *record)
+{
+    if (record == NULL || !TRACE_IsOwner())
+    {
+        return false;
+    }
+
+    memset(record, 0, sizeof(*record));
+    record->correlationId = traceActive.correlationId;
+    record->startTime = traceActive.markTime[TRACE_STAGE_RECEIVED];
+
+    // Each stage is measured from the last stage that was actually reached
+    int64_t previous = record->startTime;
+    for (int stage = TRACE_STAGE_RECEIVED + 1; stage < TRACE_STAGE_COUNT; stage++)
+    {
+        if (traceActive.markTime[stage] != 0)
+        {
+            record->stageTime[stage] = (uint32_t)(traceActive.markTime[stage] - previous);
+            previous = traceActive.markTime[stage];
+        }
+    }
+    record->totalTime = (uint32_t)(previous - record->startTime);
+    return true;
+}
+
+bool TRACE_End(traceRecord *record)
+{
+    traceRecord completed;
+
+    if (!TRACE_Snapshot(&completed))
+    {
+        return false;
+    }
+    traceActive.owner = NULL;
+
+    traceRing[traceRingNext] = completed;
+    traceRingNext = (traceRingNext + 1) % TRACE_RING_SIZE;
+
+    for (int stage = TRACE_STAGE_RECEIVED + 1; stage < TRACE_STAGE_COUNT; stage++)
+    {
+        if (traceActive.markTime[stage] != 0)
+        {
+            traceHistogram[stage][TRACE_Bucket(completed.stageTime[stage])]++;
+            traceSamples[stage]++;
+        }
+    }
+    traceHistogram[TRACE_TOTAL][TRACE_Bucket(completed.totalTime)]++;
+    traceSamples[TRACE_TOTAL]++;
+
+    if (record != NULL)
+    {
+        *record = completed;
+    }
+    return true;
+}
+
+uint32_t TRACE_GetPercentile(int stage, uint8_t percentile)
+{
+    if (stage < 0 || stage > TRACE_TOTAL || percentile == 0 || percentile > 100 || traceSamples[stage] == 0)
+    {
+        return 0;
+    }
+
+    // Smallest bucket whose cumulative count reaches the requested rank
+    uint64_t rank = ((uint64_t)traceSamples[stage] * percentile + 99) / 100;
+    uint64_t cumulative = 0;
+    for (uint32_t bucket = 0; bucket < TRACE_HISTOGRAM_BUCKETS; bucket++)
+    {
+        cumulative += traceHistogram[stage][bucket];
+        if (cumulative >= rank)
+        {
+            return TRACE_BucketUpperBound(bucket);
+        }
+    }
+    return TRACE_BucketUpperBound(TRACE_HISTOGRAM_BUCKETS - 1);
+}
+
+const char *TRACE_StageName(int stage)
+{
+    return (stage >= 0 && stage <= TRACE_TOTAL) ? traceStageNames[stage] : "?";
+}
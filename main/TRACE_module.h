@@ -0,0 +1,121 @@
+/******************************************************************************
+ * @file        TRACE_module.h
+ * @brief       Lightweight latency tracing of the relay command path.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares trace points for the command path, from the MQTT data
+ * event to the GPIO edge, the storage commit and the acknowledgement. Each trace
+ * point stores an esp_timer timestamp. Completed traces are kept in a fixed ring and
+ * their per-stage durations feed on-device histograms, from which p50/p99 values are
+ * read without keeping individual samples.
+ ******************************************************************************/
+#ifndef TRACE_MODULE_H
+#define TRACE_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_RING_SIZE 16          // Completed traces kept for inspection
+#define TRACE_HISTOGRAM_OCTAVES 20  // Powers of two covered, 1 us to ~1 s
+#define TRACE_HISTOGRAM_STEP_BITS 2 // 4 sub-buckets per power of two
+
+/**
+ * @brief Stages of the command path, in the order they are reached.
+ */
+typedef enum
+{
+    TRACE_STAGE_RECEIVED, // MQTT data event entered the handler
+    TRACE_STAGE_PARSED,   // Command fields extracted from the JSON payload
+    TRACE_STAGE_GPIO,     // Relay pin levels written
+    TRACE_STAGE_STORED,   // Relay state committed to NVS
+    TRACE_STAGE_LOGGED,   // Command logged
+    TRACE_STAGE_ACKED,    // Acknowledgement handed to the MQTT client
+    TRACE_STAGE_COUNT,
+} traceStage;
+
+// Histogram index of the end-to-end duration, next to the per-stage ones
+#define TRACE_TOTAL TRACE_STAGE_COUNT
+
+/**
+ * @brief One completed trace.
+ *
+ * @details
+ * stageTime[s] is the time spent reaching stage s from the previous stage that was
+ * marked, in microseconds. Stages that were not reached are 0.
+ */
+typedef struct
+{
+    int32_t correlationId;                 // Request id, -1 when the command had none
+    int64_t startTime;                     // esp_timer time of TRACE_STAGE_RECEIVED
+    uint32_t stageTime[TRACE_STAGE_COUNT]; // Per-stage durations in microseconds
+    uint32_t totalTime;                    // Received to last marked stage
+} traceRecord;
+
+/**
+ * @brief Starts a trace on the calling task, marking TRACE_STAGE_RECEIVED.
+ *
+ * @details
+ * Only the task that started the trace can add marks to it, so shared code such as
+ * Relay_Set can carry trace points without polluting traces from other callers.
+ */
+void TRACE_Begin(void);
+
+/**
+ * @brief Records the time a stage is reached by the active trace.
+ *
+ * @param stage (traceStage): The stage that has just been completed.
+ */
+void TRACE_Mark(traceStage stage);
+
+/**
+ * @brief Attaches the request correlation id to the active trace.
+ *
+ * @param correlationId (int32_t): Id carried by the command.
+ */
+void TRACE_SetCorrelationId(int32_t correlationId);
+
+/**
+ * @brief Computes the stage durations of the active trace without closing it.
+ *
+ * @param record (traceRecord *): Receives the durations measured so far.
+ *
+ * @return bool: false if the calling task has no active trace.
+ */
+bool TRACE_Snapshot(traceRecord *record);
+
+/**
+ * @brief Closes the active trace, stores it in the ring and updates the histograms.
+ *
+ * @param record (traceRecord *): Optional copy of the completed trace, may be NULL.
+ *
+ * @return bool: false if the calling task has no active trace.
+ */
+bool TRACE_End(traceRecord *record);
+
+/**
+ * @brief Reads a percentile from a stage histogram.
+ *
+ * @param stage (int): A traceStage, or TRACE_TOTAL for the end-to-end duration.
+ * @param percentile (uint8_t): Percentile to read, 1 to 100.
+ *
+ * @return uint32_t: Upper bound of the bucket holding the percentile, in microseconds
+ * (within a quarter of an octave), or 0 when no samples exist.
+ */
+uint32_t TRACE_GetPercentile(int stage, uint8_t percentile);
+
+/**
+ * @brief Returns the name of a stage, "total" for TRACE_TOTAL.
+ *
+ * @param stage (int): A traceStage or TRACE_TOTAL.
+ *
+ * @return const char *: Static stage name.
+ */
+const char *TRACE_StageName(int stage);
+
+#endif // TRACE_MODULE_H
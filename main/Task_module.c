@@ -0,0 +1,93 @@
+/******************************************************************************
+ * @file        Task_module.c
+ * @brief       Creation of the application tasks from the task table.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * The table in Task_module.h is expanded three times: into one stack array per task,
+ * into the descriptor table below and into compile-time checks of the stack sizes.
+ * ESP-IDF counts stack depth in bytes and StackType_t is a byte, so the arrays are
+ * sized directly from the table.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "LOG_module.h"
+#include "Task_module.h"
+
+// Every stack must hold at least the logging and FreeRTOS overhead
+#define TASK_CHECK(id, name, core, stackSize, priority) \
+    _Static_assert((stackSize) >= TASK_MIN_STACK_SIZE, name " stack is below TASK_MIN_STACK_SIZE");
+TASK_LIST(TASK_CHECK)
+#undef TASK_CHECK
+
+// Relay commands run in the esp-mqtt task, its core is set in sdkconfig
+#if TASK_PINNING && TASK_ACTUATION_CORE == 1 && !CONFIG_MQTT_USE_CORE_1
+#warning "CONFIG_MQTT_USE_CORE_1 is not set, relay commands will share the radio core"
+#endif
+
+#if TASK_STATIC_ALLOCATION
+#define TASK_STACK(id, name, core, stackSize, priority) static StackType_t id##_stack[(stackSize) / sizeof(StackType_t)];
+TASK_LIST(TASK_STACK)
+#undef TASK_STACK
+
+static StaticTask_t taskBuffers[TASK_COUNT]; // Control blocks, one per table entry
+#endif
+
+// Descriptor of one table entry
+typedef struct
+{
+    const char *name;
+    BaseType_t core;
+    uint32_t stackSize;
+    UBaseType_t priority;
+#if TASK_STATIC_ALLOCATION
+    StackType_t *stack;
+#endif
+} taskEntry;
+
+static const taskEntry taskTable[TASK_COUNT] = {
+#if TASK_STATIC_ALLOCATION
+#define TASK_ENTRY(id, name, core, stackSize, priority) [id] = {name, core, stackSize, priority, id##_stack},
+#else
+#define TASK_ENTRY(id, name, core, stackSize, priority) [id] = {name, core, stackSize, priority},
+#endif
+    TASK_LIST(TASK_ENTRY)
+#undef TASK_ENTRY
+};
+
+static TaskHandle_t taskHandles[TASK_COUNT]; // NULL until the task is started
+
+TaskHandle_t Task_Start(appTask task, TaskFunction_t function, void *parameters)
+{
+    if (task >= TASK_COUNT || function == NULL || taskHandles[task] != NULL)
+    {
+        return NULL;
+    }
+
+    const taskEntry *entry = &taskTable[task];
+    BaseType_t core = TASK_PINNING ? entry->core : tskNO_AFFINITY;
+#if TASK_STATIC_ALLOCATION
+    taskHandles[task] = xTaskCreateStaticPinnedToCore(function, entry->name, entry->stackSize, parameters, entry->priority,
+                                                      entry->stack, &taskBuffers[task], core);
+#else
+    if (xTaskCreatePinnedToCore(function, entry->name, entry->stackSize, parameters, entry->priority, &taskHandles[task], core) != pdPASS)
+    {
+        taskHandles[task] = NULL;
+    }
+#endif
+
+    if (taskHandles[task] == NULL)
+    {
+        LOG_E(LOG_MODULE_MAIN, "Could not start %s", LOG_STR(entry->name));
+    }
+    return taskHandles[task];
+}
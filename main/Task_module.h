@@ -0,0 +1,95 @@
+/******************************************************************************
+ * @file        Task_module.h
+ * @brief       Table of the application tasks and their stack and TCB storage.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file lists every task the application creates, with its name, core,
+ * stack size and priority, in a single X-macro table. With TASK_STATIC_ALLOCATION set the
+ * stacks and task control blocks are static arrays generated from the table and
+ * the tasks are created with xTaskCreateStatic, so starting them never touches the
+ * heap and a missing entry is a link-time cost rather than a run-time failure.
+ *
+ * Core layout: the Wi-Fi driver, the NimBLE host and the BT controller are pinned to
+ * core 0 by sdkconfig, so network and BLE work stays there with them. Core 1 is kept
+ * for actuation: relay commands run in the esp-mqtt task, which sdkconfig pins to
+ * core 1 (CONFIG_MQTT_USE_CORE_1), and so do scheduled actions and the sensor scheduler,
+ * whose local rules switch relays. Sensor acquisition shares core 1 below the esp-mqtt
+ * priority, so a frame being filtered never delays a command. Low-priority
+ * housekeeping floats and fills idle time on either core. With
+ * TASK_PINNING cleared every task floats, which gives the baseline to compare the
+ * command latency against.
+ ******************************************************************************/
+#ifndef TASK_MODULE_H
+#define TASK_MODULE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "LOG_module.h"
+#include "DIAG_module.h"
+
+#define TASK_STATIC_ALLOCATION 1     // 1: stacks and TCBs in .bss, 0: from the heap
+#define TASK_MIN_STACK_SIZE 1536     // Smallest stack accepted in the table
+#define TASK_PINNING 1               // 1: pin tasks as in the table, 0: no affinity for any task
+
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_RADIO_CORE 0            // Single core: everything shares core 0
+#define TASK_ACTUATION_CORE 0
+#else
+#define TASK_RADIO_CORE 0            // Wi-Fi, NimBLE and the BT controller
+#define TASK_ACTUATION_CORE 1        // Relay command handling, kept free of radio work
+#endif
+#define TASK_ANY_CORE tskNO_AFFINITY // Housekeeping, scheduled on whichever core is idle
+
+#define TASK_CONFIG_MODE_STACK_SIZE 3584      // BLE configuration task, also runs the NimBLE init
+#define TASK_SENSOR_SCHEDULER_STACK_SIZE 3072 // Sensor sampling, rules (switch relays), encoding and publishing
+#define TASK_SENSOR_STACK_SIZE 3072           // ADC frame processing
+#define TASK_SCHEDULE_STACK_SIZE 3072         // Scheduled relay actions, writes NVS
+#define TASK_SHADOW_STACK_SIZE 2560           // Device shadow encoding and publishing
+#define TASK_RECONFIG_STACK_SIZE 3072         // Live configuration changes, reads NVS
+#define TASK_SENSOR_PRIORITY 4                // Below the esp-mqtt task on the same core
+#define TASK_APP_PRIORITY 5                   // Application tasks
+#define TASK_SHADOW_PRIORITY 3                // Publishing only, below the relay work it reports
+
+// X(id, name, core, stack size in bytes, priority)
+#define TASK_LIST(X)                                                                                                       \
+    X(TASK_LOG_DRAIN, "Task_LogDrain", TASK_ANY_CORE, LOG_DRAIN_STACK_SIZE, LOG_DRAIN_TASK_PRIORITY)                       \
+    X(TASK_DIAG, "Task_Diag", TASK_ANY_CORE, DIAG_STACK_SIZE, DIAG_TASK_PRIORITY)                                          \
+    X(TASK_CONFIG_MODE, "Task_ConfigMode", TASK_RADIO_CORE, TASK_CONFIG_MODE_STACK_SIZE, TASK_APP_PRIORITY)                \
+    X(TASK_SENSOR_SCHEDULER, "Task_SensorSched", TASK_ACTUATION_CORE, TASK_SENSOR_SCHEDULER_STACK_SIZE, TASK_APP_PRIORITY) \
+    X(TASK_SENSOR, "Task_Sensor", TASK_ACTUATION_CORE, TASK_SENSOR_STACK_SIZE, TASK_SENSOR_PRIORITY)                       \
+    X(TASK_SCHEDULE, "Task_Schedule", TASK_ACTUATION_CORE, TASK_SCHEDULE_STACK_SIZE, TASK_APP_PRIORITY)                    \
+    X(TASK_SHADOW, "Task_Shadow", TASK_ANY_CORE, TASK_SHADOW_STACK_SIZE, TASK_SHADOW_PRIORITY)                             \
+    X(TASK_RECONFIG, "Task_Reconfig", TASK_RADIO_CORE, TASK_RECONFIG_STACK_SIZE, TASK_APP_PRIORITY)
+
+/**
+ * @brief Application tasks, in table order.
+ */
+typedef enum
+{
+#define TASK_ID(id, name, core, stackSize, priority) id,
+    TASK_LIST(TASK_ID)
+#undef TASK_ID
+    TASK_COUNT,
+} appTask;
+
+/**
+ * @brief Creates an application task with the parameters of its table entry, pinned
+ * to the core of the entry unless TASK_PINNING is cleared.
+ *
+ * @param task (appTask): Table entry of the task.
+ * @param function (TaskFunction_t): Task body.
+ * @param parameters (void *): Argument passed to the task body.
+ *
+ * @return TaskHandle_t: Handle of the task, NULL if it could not be created or was
+ * already started (a static stack can only host one task).
+ */
+TaskHandle_t Task_Start(appTask task, TaskFunction_t function, void *parameters);
+
+#endif // TASK_MODULE_H
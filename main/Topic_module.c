@@ -0,0 +1,454 @@
+/******************************************************************************
+ * @file        Topic_module.c
+ * @brief       Variable-length MQTT topic table with hashed lookups.
+ *
+ * @author      Eng. Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ * @copyright   © 2024 Smart Egat. All rights reserved.
+ *
+ * @details
+ * Two tables alternate: readers use the active one while a change is staged in the
+ * other, and an atomic index switches them. Each table holds its entries, an arena of
+ * null-terminated strings and two open-addressing indexes, by FNV-1a hash of the name
+ * and by id, whose slots hold the entry index plus one. Lookups count themselves on
+ * the table they read, and a change waits for the count of the table it is about to
+ * overwrite to drop to zero, so a lookup that started before the previous switch is
+ * never read from a table being rewritten. With TOPIC_HASH_SLOTS above
+ * TOPIC_MAX_ENTRIES every probe sequence ends on an empty slot, so a lookup never
+ * visits more than TOPIC_HASH_SLOTS slots. Removing a topic moves the strings after
+ * it down, so the arena never fragments, and the indexes are rebuilt after every
+ * change since the table is small and changes are rare.
+ *
+ * Stored layout: version, count, then per topic its id (little endian), its length
+ * and its characters without the terminator.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "LOG_module.h"
+#include "Memory_module.h"
+#include "SensorRegistry_module.h"
+#include "Topic_module.h"
+
+_Static_assert((TOPIC_HASH_SLOTS & (TOPIC_HASH_SLOTS - 1)) == 0, "TOPIC_HASH_SLOTS must be a power of two");
+_Static_assert(TOPIC_HASH_SLOTS > TOPIC_MAX_ENTRIES, "TOPIC_HASH_SLOTS must exceed TOPIC_MAX_ENTRIES");
+_Static_assert(TOPIC_MAX_ENTRIES < 255 && TOPIC_MAX_LENGTH < 256, "Entry index or length overflows a byte");
+_Static_assert(TOPIC_ARENA_SIZE <= UINT16_MAX, "Arena offsets are 16-bit");
+_Static_assert(TOPIC_BLOB_SIZE <= MEMORY_BATCH_BLOB_LENGTH, "The stored table must fit a batch blob");
+
+typedef struct
+{
+    uint32_t hash;   // FNV-1a hash of the topic
+    topicId id;
+    uint16_t offset; // Start of the topic in the arena
+    uint8_t length;  // Length without the terminator
+} topicEntry;
+
+typedef struct
+{
+    topicEntry entries[TOPIC_MAX_ENTRIES];
+    uint8_t count;
+    uint16_t arenaUsed;
+    uint8_t nameSlots[TOPIC_HASH_SLOTS]; // Entry index + 1 by topic hash, 0 when empty
+    uint8_t idSlots[TOPIC_HASH_SLOTS];   // Entry index + 1 by id hash, 0 when empty
+    char arena[TOPIC_ARENA_SIZE];
+} topicTable;
+
+static topicTable topicTables[2];
+static _Atomic uint8_t topicActive = 0; // Index of the table readers use
+static _Atomic uint8_t topicReaders[2];  // Lookups running on each table
+static uint8_t topicBlob[TOPIC_BLOB_SIZE];
+
+// Stored keys of a kit provisioned before the table existed
+static const struct
+{
+    const char *key;
+    topicId id;
+} topicLegacyKeys[] = {
+    {"relay_topic", TOPIC_RELAY_TYPE},
+    {"diag_topic", TOPIC_DIAG_TYPE},
+};
+
+static topicTable *Topic_Active(void)
+{
+    return &topicTables[atomic_load_explicit(&topicActive, memory_order_acquire)];
+}
+
+static topicTable *Topic_Staged(void)
+{
+    return &topicTables[atomic_load_explicit(&topicActive, memory_order_relaxed) ^ 1];
+}
+
+// Wait until no lookup reads the staged table any more, before it is overwritten
+static topicTable *Topic_ClaimStaged(void)
+{
+    uint8_t staged = atomic_load(&topicActive) ^ 1;
+
+    while (atomic_load(&topicReaders[staged]) != 0)
+    {
+        vTaskDelay(1); // A lookup that started before the last switch, a few microseconds
+    }
+    return &topicTables[staged];
+}
+
+// Count a lookup on the active table and return its index; Topic_Leave ends it
+static uint8_t Topic_Enter(void)
+{
+    while (1)
+    {
+        uint8_t index = atomic_load(&topicActive);
+        atomic_fetch_add(&topicReaders[index], 1);
+        if (atomic_load(&topicActive) == index)
+        {
+            return index; // Still active after being counted, so no change can claim it now
+        }
+        atomic_fetch_sub(&topicReaders[index], 1);
+    }
+}
+
+static void Topic_Leave(uint8_t index)
+{
+    atomic_fetch_sub(&topicReaders[index], 1);
+}
+
+static uint32_t Topic_Hash(const char *topic, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// First index slot of an id, multiplicative hashing
+static uint32_t Topic_IdSlot(topicId id)
+{
+    return ((uint32_t)id * 2654435761u >> 16) & (TOPIC_HASH_SLOTS - 1);
+}
+
+// Rebuild both indexes of a table
+static void Topic_Index(topicTable *table)
+{
+    memset(table->nameSlots, 0, sizeof(table->nameSlots));
+    memset(table->idSlots, 0, sizeof(table->idSlots));
+
+    for (uint8_t i = 0; i < table->count; i++)
+    {
+        uint32_t slot = table->entries[i].hash & (TOPIC_HASH_SLOTS - 1);
+        while (table->nameSlots[slot] != 0)
+        {
+            slot = (slot + 1) & (TOPIC_HASH_SLOTS - 1);
+        }
+        table->nameSlots[slot] = i + 1;
+
+        slot = Topic_IdSlot(table->entries[i].id);
+        while (table->idSlots[slot] != 0)
+        {
+            slot = (slot + 1) & (TOPIC_HASH_SLOTS - 1);
+        }
+        table->idSlots[slot] = i + 1;
+    }
+}
+
+// Entry index of an id, -1 if absent
+static int Topic_FindId(const topicTable *table, topicId id)
+{
+    uint32_t slot = Topic_IdSlot(id);
+
+    for (int probe = 0; probe < TOPIC_HASH_SLOTS && table->idSlots[slot] != 0; probe++)
+    {
+        if (table->entries[table->idSlots[slot] - 1].id == id)
+        {
+            return table->idSlots[slot] - 1;
+        }
+        slot = (slot + 1) & (TOPIC_HASH_SLOTS - 1);
+    }
+    return -1;
+}
+
+// Entry index of a topic name, -1 if absent
+static int Topic_FindName(const topicTable *table, const char *topic, size_t length)
+{
+    uint32_t hash = Topic_Hash(topic, length);
+    uint32_t slot = hash & (TOPIC_HASH_SLOTS - 1);
+
+    for (int probe = 0; probe < TOPIC_HASH_SLOTS && table->nameSlots[slot] != 0; probe++)
+    {
+        const topicEntry *entry = &table->entries[table->nameSlots[slot] - 1];
+        if (entry->hash == hash && entry->length == length && memcmp(&table->arena[entry->offset], topic, length) == 0)
+        {
+            return table->nameSlots[slot] - 1;
+        }
+        slot = (slot + 1) & (TOPIC_HASH_SLOTS - 1);
+    }
+    return -1;
+}
+
+// Remove an entry and close the gap it leaves in the arena
+static void Topic_Remove(topicTable *table, int index)
+{
+    topicEntry removed = table->entries[index];
+    uint16_t size = removed.length + 1;
+
+    memmove(&table->arena[removed.offset], &table->arena[removed.offset + size], table->arenaUsed - removed.offset - size);
+    table->arenaUsed -= size;
+
+    table->entries[index] = table->entries[--table->count];
+    for (uint8_t i = 0; i < table->count; i++)
+    {
+        if (table->entries[i].offset > removed.offset)
+        {
+            table->entries[i].offset -= size;
+        }
+    }
+}
+
+// Append an entry, the caller has checked the space
+static void Topic_Append(topicTable *table, topicId id, const char *topic, size_t length)
+{
+    topicEntry *entry = &table->entries[table->count++];
+
+    entry->hash = Topic_Hash(topic, length);
+    entry->id = id;
+    entry->offset = table->arenaUsed;
+    entry->length = (uint8_t)length;
+    memcpy(&table->arena[table->arenaUsed], topic, length);
+    table->arena[table->arenaUsed + length] = '\0';
+    table->arenaUsed += length + 1;
+}
+
+// Rebuild a table from a stored blob, false if the blob is malformed
+static bool Topic_Parse(topicTable *table, const uint8_t *blob, size_t length)
+{
+    size_t position = 2;
+
+    table->count = 0;
+    table->arenaUsed = 0;
+    if (length < 2 || blob[0] != TOPIC_BLOB_VERSION || blob[1] > TOPIC_MAX_ENTRIES)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < blob[1]; i++)
+    {
+        if (position + 3 > length)
+        {
+            return false;
+        }
+        topicId id = (topicId)(blob[position] | blob[position + 1] << 8);
+        size_t topicLength = blob[position + 2];
+        position += 3;
+
+        if (position + topicLength > length || topicLength == 0 || topicLength > TOPIC_MAX_LENGTH ||
+            table->arenaUsed + topicLength + 1 > TOPIC_ARENA_SIZE)
+        {
+            return false;
+        }
+        Topic_Append(table, id, (const char *)&blob[position], topicLength);
+        position += topicLength;
+    }
+
+    Topic_Index(table);
+    return true;
+}
+
+// Import the topics a kit stored as separate strings before the table existed
+static bool Topic_ImportLegacy(void)
+{
+    char topic[TOPIC_MAX_LENGTH + 1];
+    bool imported = false;
+
+    Topic_Stage();
+    for (size_t i = 0; i < sizeof(topicLegacyKeys) / sizeof(topicLegacyKeys[0]) + SensorRegistry_Count(); i++)
+    {
+        const char *key;
+        topicId id;
+
+        if (i < sizeof(topicLegacyKeys) / sizeof(topicLegacyKeys[0]))
+        {
+            key = topicLegacyKeys[i].key;
+            id = topicLegacyKeys[i].id;
+        }
+        else
+        {
+            const sensorDriver *driver = SensorRegistry_Get(i - sizeof(topicLegacyKeys) / sizeof(topicLegacyKeys[0]));
+            key = driver->topicKey;
+            id = (topicId)driver->topicType;
+        }
+
+        topic[0] = '\0';
+        Memory_LoadString("storage", key, topic, sizeof(topic));
+        if (topic[0] != '\0' && Topic_StageSet(id, topic))
+        {
+            imported = true;
+        }
+    }
+    return imported;
+}
+
+void Topic_Load(void)
+{
+    size_t length = sizeof(topicBlob);
+
+    if (Memory_LoadBlob("storage", TOPIC_BLOB_KEY, topicBlob, &length) && Topic_Parse(Topic_ClaimStaged(), topicBlob, length))
+    {
+        Topic_Activate();
+        return;
+    }
+
+    // No table yet: build it from the old keys and store it once
+    if (Topic_ImportLegacy())
+    {
+        const uint8_t *blob = Topic_StageBlob(&length);
+        Memory_SaveBlob("storage", TOPIC_BLOB_KEY, blob, length);
+        LOG_I(LOG_MODULE_MEMORY, "Imported (%u) topics into the topic table", (unsigned)Topic_Staged()->count);
+    }
+    Topic_Activate();
+}
+
+const char *Topic_Get(topicId id)
+{
+    const topicTable *table = Topic_Active();
+    int index = Topic_FindId(table, id);
+
+    return index < 0 ? "" : &table->arena[table->entries[index].offset];
+}
+
+size_t Topic_Copy(topicId id, char *topic, size_t size)
+{
+    size_t length = 0;
+
+    if (topic == NULL || size == 0)
+    {
+        return 0;
+    }
+
+    uint8_t reader = Topic_Enter();
+    const topicTable *table = &topicTables[reader];
+    int index = Topic_FindId(table, id);
+    if (index >= 0)
+    {
+        length = table->entries[index].length < size - 1 ? table->entries[index].length : size - 1;
+        memcpy(topic, &table->arena[table->entries[index].offset], length);
+    }
+    Topic_Leave(reader);
+
+    topic[length] = '\0';
+    return length;
+}
+
+bool Topic_Find(const char *topic, size_t length, topicId *id)
+{
+    int index = -1;
+
+    if (topic == NULL || length > TOPIC_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    uint8_t reader = Topic_Enter();
+    const topicTable *table = &topicTables[reader];
+    index = Topic_FindName(table, topic, length);
+    if (index >= 0 && id != NULL)
+    {
+        *id = table->entries[index].id;
+    }
+    Topic_Leave(reader);
+
+    return index >= 0;
+}
+
+void Topic_Stage(void)
+{
+    topicTable *staged = Topic_ClaimStaged();
+    *staged = *Topic_Active();
+}
+
+bool Topic_StageSet(topicId id, const char *topic)
+{
+    topicTable *table = Topic_Staged();
+    size_t length = topic != NULL ? strlen(topic) : 0;
+    int current = Topic_FindId(table, id);
+    int owner = length ? Topic_FindName(table, topic, length) : -1;
+
+    if (length > TOPIC_MAX_LENGTH || (topic != NULL && strpbrk(topic, "+#") != NULL))
+    {
+        return false; // Too long, or a wildcard that cannot be published to
+    }
+    if (owner >= 0 && owner != current)
+    {
+        return false; // Incoming messages must map to a single id
+    }
+
+    // Room once the current value is gone
+    size_t freeArena = TOPIC_ARENA_SIZE - table->arenaUsed + (current >= 0 ? table->entries[current].length + 1 : 0);
+    size_t freeEntries = TOPIC_MAX_ENTRIES - table->count + (current >= 0 ? 1 : 0);
+    if (length && (length + 1 > freeArena || freeEntries == 0))
+    {
+        return false;
+    }
+
+    if (current >= 0)
+    {
+        Topic_Remove(table, current);
+    }
+    if (length)
+    {
+        Topic_Append(table, id, topic, length);
+    }
+    Topic_Index(table);
+    return true;
+}
+
+const uint8_t *Topic_StageBlob(size_t *length)
+{
+    const topicTable *table = Topic_Staged();
+    size_t position = 2;
+
+    topicBlob[0] = TOPIC_BLOB_VERSION;
+    topicBlob[1] = table->count;
+    for (uint8_t i = 0; i < table->count; i++)
+    {
+        const topicEntry *entry = &table->entries[i];
+        topicBlob[position++] = (uint8_t)(entry->id & 0xff);
+        topicBlob[position++] = (uint8_t)(entry->id >> 8);
+        topicBlob[position++] = entry->length;
+        memcpy(&topicBlob[position], &table->arena[entry->offset], entry->length);
+        position += entry->length;
+    }
+
+    *length = position;
+    return topicBlob;
+}
+
+void Topic_Activate(void)
+{
+    atomic_fetch_xor_explicit(&topicActive, 1, memory_order_release);
+}
+
+bool Topic_Set(topicId id, const char *topic)
+{
+    size_t length;
+
+    Topic_Stage();
+    if (!Topic_StageSet(id, topic))
+    {
+        return false;
+    }
+
+    const uint8_t *blob = Topic_StageBlob(&length);
+    if (!Memory_SaveBlob("storage", TOPIC_BLOB_KEY, blob, length))
+    {
+        return false;
+    }
+    Topic_Activate();
+    return true;
+}
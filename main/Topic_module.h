@@ -0,0 +1,146 @@
+/******************************************************************************
+ * @file        Topic_module.h
+ * @brief       Variable-length MQTT topic table with hashed lookups.
+ *
+ * @author      Ali Mahrez
+ * @company     Smart Egat
+ * @email       a.mahrez@smart-egat.com
+ * @date        Oct 18, 2026
+ * @version     Xbeta
+ *
+ * @details
+ * This header file declares the topic table. Every topic the kit subscribes or
+ * publishes to is identified by a topicId: the relay command topic, one optional
+ * topic per relay, the diagnostics topic and one topic per registered sensor (its
+ * tconfigtype). The strings are kept back to back in a fixed arena, so a topic such
+ * as site/line/cell/device/relay costs its length rather than a fixed field, and two
+ * hash indexes find a topic by id for publishing and by name for incoming messages
+ * in a bounded number of probes.
+ *
+ * The table is stored as a single NVS blob and loaded at boot. Changes are made on a
+ * staged copy that replaces the active table only once it has been stored, so
+ * readers never see a half-applied configuration. Topic_Copy and Topic_Find are safe
+ * from any task during a change; the string Topic_Get returns is not protected.
+ ******************************************************************************/
+#ifndef TOPIC_MODULE_H
+#define TOPIC_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TOPIC_MAX_LENGTH 128    // Longest topic, without the terminator
+#define TOPIC_MAX_ENTRIES 24    // Topics in the table
+#define TOPIC_ARENA_SIZE 1024   // Bytes of topic strings, terminators included
+#define TOPIC_HASH_SLOTS 32     // Slots of each hash index, a power of two above TOPIC_MAX_ENTRIES
+#define TOPIC_BLOB_KEY "topics" // NVS key of the stored table
+#define TOPIC_BLOB_VERSION 1    // Layout of the stored table
+#define TOPIC_BLOB_SIZE (2 + TOPIC_MAX_ENTRIES * 3 + TOPIC_ARENA_SIZE) // Largest stored table
+
+// Topic identifiers; sensor topics use the tconfigtype of their driver
+#define TOPIC_RELAY_TYPE 1                          // Relay command topic
+#define TOPIC_RELAY_CHANNEL_TYPE 2                  // tconfigtype of a per-relay topic message
+#define TOPIC_DIAG_TYPE 12                          // Diagnostics report topic
+#define TOPIC_RULES_TYPE 13                         // Rule messages for the rules engine
+#define TOPIC_RELAY_CHANNEL(relay) (0x100 + (relay)) // Topic of one relay, 1 to TOPIC_RELAY_CHANNELS
+#define TOPIC_RELAY_CHANNELS 8                      // Relays that may have their own topic
+
+typedef uint16_t topicId;
+
+/**
+ * @brief Loads the stored table into the active table.
+ *
+ * @details
+ * A kit provisioned before the table existed has its topics under separate string
+ * keys; they are imported once and stored as a table. The sensor drivers must be
+ * registered first so their topic keys are known.
+ */
+void Topic_Load(void);
+
+/**
+ * @brief Returns the topic with the given id.
+ *
+ * @param id (topicId): Topic to look up.
+ *
+ * @return const char *: The topic, "" if it is not configured. The string is only
+ * guaranteed until the next change starts, so use it from the task that makes the
+ * changes or before they can happen (boot, host tools); other tasks use Topic_Copy.
+ */
+const char *Topic_Get(topicId id);
+
+/**
+ * @brief Copies the topic with the given id.
+ *
+ * @param id (topicId): Topic to look up.
+ * @param topic (char *): Receives the null-terminated topic, "" if it is not
+ * configured; TOPIC_MAX_LENGTH + 1 bytes hold any topic.
+ * @param size (size_t): Size of topic.
+ *
+ * @return size_t: Length of the copied topic, 0 if it is not configured.
+ *
+ * @details
+ * Safe from any task while a change is being applied: a change waits for copies of
+ * the table it replaces to finish before reusing it.
+ */
+size_t Topic_Copy(topicId id, char *topic, size_t size);
+
+/**
+ * @brief Finds the id of a topic.
+ *
+ * @param topic (const char *): Topic, not necessarily null-terminated.
+ * @param length (size_t): Length of the topic.
+ * @param id (topicId *): Receives the id.
+ *
+ * @return bool: false if the topic is not in the table.
+ */
+bool Topic_Find(const char *topic, size_t length, topicId *id);
+
+/**
+ * @brief Starts a change by copying the active table into the staged table.
+ *
+ * @details
+ * One change at a time: configuration messages are handled one after the other. Waits
+ * for the lookups still reading the table that was active before the last change.
+ */
+void Topic_Stage(void);
+
+/**
+ * @brief Sets a topic in the staged table.
+ *
+ * @param id (topicId): Topic to set.
+ * @param topic (const char *): New topic, "" to remove it.
+ *
+ * @return bool: false if the topic is too long, contains a wildcard, is already used
+ * by another id or does not fit in the table; the staged table is then unchanged.
+ */
+bool Topic_StageSet(topicId id, const char *topic);
+
+/**
+ * @brief Serializes the staged table for storage.
+ *
+ * @param length (size_t *): Receives the length of the blob.
+ *
+ * @return const uint8_t *: The blob, valid until the next staged change.
+ */
+const uint8_t *Topic_StageBlob(size_t *length);
+
+/**
+ * @brief Makes the staged table the active table.
+ *
+ * @details
+ * Called once the staged table has been stored.
+ */
+void Topic_Activate(void);
+
+/**
+ * @brief Sets one topic, stores the table and activates it.
+ *
+ * @param id (topicId): Topic to set.
+ * @param topic (const char *): New topic, "" to remove it.
+ *
+ * @return bool: false if the topic was rejected or could not be stored; the active
+ * table is then unchanged.
+ */
+bool Topic_Set(topicId id, const char *topic);
+
+#endif // TOPIC_MODULE_H
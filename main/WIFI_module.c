@@ -13,25 +13,90 @@
  * This module provides functions to initialize and configure Wi-Fi in station mode.
  * It handles connecting to an access point and includes a utility to check internet
  * connectivity by attempting to connect to a public server.
+ *
+ * Station events are handled on the default event loop: an IP address sets a bit of
+ * a static event group that WIFI_WaitForIP blocks on, and a lost association clears
+ * it and reconnects, so callers wake the moment the link is usable. Each change of
+ * the address is published as EVENT_WIFI_CHANGED.
+ *
+ * The wall clock is set by SNTP once the station is up; the SNTP client resyncs it
+ * periodically on its own and reports every sync to the registered callback.
  ******************************************************************************/
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_wifi.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "esp_http_client.h"
 #include "esp_http_server.h"
+#include "esp_netif_sntp.h"
 #include "DataHandle.h"
+#include "Event_module.h"
 #include "WIFI_module.h"
 
 // static const char *WIFI_TAG = "WIFI CONN";
 static const char *INTERNET_TAG = "NET-CONN";
 
+#define WIFI_GOT_IP_BIT (1 << 0) // Set while the station holds an IP address
+
+static EventGroupHandle_t wifiEvents = NULL;
+static StaticEventGroup_t wifiEventsBuffer;
+static void (*wifiTimeSynced)(void) = NULL;
+static _Atomic uint32_t wifiDrops = 0;
+
+// SNTP callback, runs in the lwIP task after the clock was set
+static void WIFI_TimeSynced(struct timeval *tv)
+{
+    if (wifiTimeSynced != NULL)
+    {
+        wifiTimeSynced();
+    }
+}
+
+// Station events: reconnect when the association is lost, publish the IP state. Only
+// changes of the address are published, not every failed reconnection attempt
+static void WIFI_EventHandler(void *arg, esp_event_base_t base, int32_t eventId, void *eventData)
+{
+    bool hadIP = (xEventGroupGetBits(wifiEvents) & WIFI_GOT_IP_BIT) != 0;
+    bool hasIP = hadIP;
+
+    if (base == WIFI_EVENT && eventId == WIFI_EVENT_STA_DISCONNECTED)
+    {
+        xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+        atomic_fetch_add(&wifiDrops, 1);
+        esp_wifi_connect();
+        hasIP = false;
+    }
+    else if (base == IP_EVENT && eventId == IP_EVENT_STA_GOT_IP)
+    {
+        xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+        hasIP = true;
+    }
+    else if (base == IP_EVENT && eventId == IP_EVENT_STA_LOST_IP)
+    {
+        xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+        hasIP = false;
+    }
+
+    if (hasIP != hadIP)
+    {
+        Event_Publish(&(appEvent){.type = EVENT_WIFI_CHANGED, .wifiChanged = {.up = hasIP}});
+    }
+}
+
 void WIFI_Init(char * SSID, char * PASS)
 {
     esp_netif_init();
     esp_event_loop_create_default();
     esp_netif_create_default_wifi_sta();
 
+    wifiEvents = xEventGroupCreateStatic(&wifiEventsBuffer);
+    esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, WIFI_EventHandler, NULL, NULL);
+    esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, WIFI_EventHandler, NULL, NULL);
+
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
@@ -53,6 +118,64 @@ void WIFI_StartConnection()
 }
 
 
+void WIFI_Reconfigure(const char *ssid, const char *password)
+{
+    wifi_config_t wifi_config;
+
+    memset(&wifi_config, 0, sizeof(wifi_config_t));
+    strncpy((char *)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+
+    // Clear the address first, so a wait that follows cannot see the old one
+    if (xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT) & WIFI_GOT_IP_BIT)
+    {
+        Event_Publish(&(appEvent){.type = EVENT_WIFI_CHANGED, .wifiChanged = {.up = false}});
+    }
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+    esp_wifi_disconnect(); // The disconnect event reconnects, with the new configuration
+}
+
+
+void WIFI_StartTimeSync(void (*synced)(void))
+{
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(WIFI_SNTP_SERVER);
+
+    wifiTimeSynced = synced;
+    config.sync_cb = WIFI_TimeSynced;
+    if (esp_netif_sntp_init(&config) != ESP_OK)
+    {
+        ESP_LOGW(INTERNET_TAG, "SNTP could not be started");
+    }
+}
+
+
+bool WIFI_WaitForIP(TickType_t timeout)
+{
+    if (wifiEvents == NULL)
+    {
+        return false; // WIFI_Init has not run
+    }
+    return (xEventGroupWaitBits(wifiEvents, WIFI_GOT_IP_BIT, pdFALSE, pdTRUE, timeout) & WIFI_GOT_IP_BIT) != 0;
+}
+
+int8_t WIFI_GetRssi(void)
+{
+    wifi_ap_record_t ap;
+
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+    {
+        return 0;
+    }
+    return ap.rssi;
+}
+
+uint32_t WIFI_GetDropCount(void)
+{
+    return atomic_load(&wifiDrops);
+}
+
+
 bool WIFI_IsInternetConnected()
 {
     esp_http_client_config_t config = {
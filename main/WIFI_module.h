@@ -17,6 +17,11 @@
 #ifndef WIFI_MODULE_H
 #define WIFI_MODULE_H
 
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define WIFI_SNTP_SERVER "pool.ntp.org" // Time server of the wall clock
+
 /**
  * @brief Initializes the Wi-Fi subsystem in station mode.
  *
@@ -40,6 +45,54 @@ void WIFI_Init(char *SSID, char *PASS);
  */
 void WIFI_StartConnection();
 
+/**
+ * @brief Moves the station to another access point without restarting Wi-Fi.
+ *
+ * @param ssid (const char *): SSID of the new access point.
+ * @param password (const char *): Its password.
+ *
+ * @details
+ * Drops the current association, which counts as a drop, and connects with the new
+ * credentials. Wait for the new address with WIFI_WaitForIP.
+ */
+void WIFI_Reconfigure(const char *ssid, const char *password);
+
+/**
+ * @brief Starts setting the wall clock from SNTP.
+ *
+ * @param synced (void (*)(void)): Called after every sync, may be NULL.
+ *
+ * @details
+ * May be called before the station has an address; the first sync happens once it
+ * has one. The clock stays unset (near 1970) until then.
+ */
+void WIFI_StartTimeSync(void (*synced)(void));
+
+/**
+ * @brief Waits until the station has an IP address.
+ *
+ * @param timeout (TickType_t): Longest wait in ticks, portMAX_DELAY to wait forever.
+ *
+ * @return bool: true if an IP address is held, false on timeout.
+ *
+ * @details
+ * Returns as soon as the IP_EVENT_STA_GOT_IP event arrives. A lost association is
+ * reconnected automatically, and the wait starts over until a new address is leased.
+ */
+bool WIFI_WaitForIP(TickType_t timeout);
+
+/**
+ * @brief Returns the signal of the access point.
+ *
+ * @return int8_t: RSSI in dBm, 0 while the station is not associated.
+ */
+int8_t WIFI_GetRssi(void);
+
+/**
+ * @brief Returns the number of associations lost since boot.
+ */
+uint32_t WIFI_GetDropCount(void);
+
 /**
  * @brief Checks if the device is connected to the internet.
  *
@@ -22,6 +22,8 @@
  * and periodically publish sensor data to the broker.
  ******************************************************************************/
 #include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -31,68 +33,107 @@
 #include "Memory_module.h"
 #include "DataHandle.h"
 #include "Relay_module.h"
+#include "Schedule_module.h"
 #include "WIFI_module.h"
-#include "MQTT_module.c"
+#include "MQTT_module.h"
 #include "JSON_module.h"
+#include "LOG_module.h"
+#include "DIAG_module.h"
+#include "Command_module.h"
+#include "BENCH_module.h"
+#include "Task_module.h"
+#include "Boot_module.h"
+#include "SensorRegistry_module.h"
+#include "Sensor_module.h"
+#include "Topic_module.h"
+#include "TRACE_module.h"
+#include "Rule_module.h"
+#include "Shadow_module.h"
+#include "Http_module.h"
+#include "Reconfig_module.h"
+#include "Event_module.h"
 
 // Global configuration structure to hold saved settings
 credentialConfig getData;
 
+// Sensor readings are only published while the broker is connected; rules run regardless
+static volatile bool brokerConnected = false;
+
+// Rule messages are not null-terminated in the MQTT event, they are parsed from this copy
+static char rulePayload[RULE_PAYLOAD_LENGTH];
+_Static_assert(RULE_PAYLOAD_LENGTH <= MQTT_BUFFER_SIZE, "RULE_PAYLOAD_LENGTH exceeds the MQTT receive buffer");
+
 /************************************************************************************************
- * @brief MQTT callback: Called when connected to the broker
+ * @brief Reconfiguration: switches the station to new Wi-Fi credentials
  */
-void connectedToBroker()
+static bool ApplyWifi(const char *ssid, const char *password, TickType_t timeout)
 {
-    ESP_LOGI(MQTT_TAG, "Connected to MQTT broker");
-    MQTT_Subscribe(getData.relay); // Subscribe to the relay topic
+    WIFI_Reconfigure(ssid, password);
+    return WIFI_WaitForIP(timeout);
 }
 
 /************************************************************************************************
- * @brief MQTT callback: Called when a message is received
+ * @brief EVENT_MQTT_CONNECTED: the command topics are subscribed by the reconfiguration module
  */
-void RecivedMsg()
+static void connectedToBroker(const appEvent *event, void *context)
 {
-    int32_t relayNumber, relayState;
-
-    // Log received message details
-    ESP_LOGI(MQTT_TAG, "Received message on topic: %.*s", General_event->topic_len, General_event->topic);
-    ESP_LOGI(MQTT_TAG, "Message: %.*s", General_event->data_len, General_event->data);
+    LOG_I(LOG_MODULE_MQTT, "Connected to MQTT broker (connection %lu)", (unsigned long)event->mqttConnected.connects);
+    brokerConnected = true;
+    BLE_BeaconSetLinkState(BLE_BEACON_LINK_MQTT, true);
+    BOOT_Mark(BOOT_PHASE_READY); // Logs the boot summary the first time
+}
 
-    // Extract relay information from JSON message
-    JSON_ExtractInt32(General_event->data, "relayNo", &relayNumber);
-    JSON_ExtractInt32(General_event->data, "state", &relayState);
+/************************************************************************************************
+ * @brief EVENT_MQTT_DATA: a message was received
+ */
+static void RecivedMsg(const appEvent *event, void *context)
+{
+    // Log received message size only, the payload is parsed by the command module
+    LOG_D(LOG_MODULE_MQTT, "Received %d bytes on a %d byte topic", event->mqttData.dataLength, event->mqttData.topicLength);
 
-    // Set relay state based on received information
-    if (relayNumber >= 1 && relayNumber <= 8)
-    {
-        Relay_Set((uint8_t)relayNumber, (bool)relayState);
-        ESP_LOGI(MQTT_TAG, "Relay %ld is %s", relayNumber, relayState ? "ON" : "OFF");
-    }
-    else if (relayNumber == 16)
+    topicId topic;
+    if (!Topic_Find(event->mqttData.topic, event->mqttData.topicLength, &topic))
     {
-        Relay_SetGroup((bool)relayState);
-        ESP_LOGI(MQTT_TAG, "All relays set to %s", relayState ? "ON" : "OFF");
+        LOG_W(LOG_MODULE_MQTT, "Message on an unknown topic ignored");
+        TRACE_End(NULL);
+        return;
     }
-    else
+
+    // Rules replace the whole rule table
+    if (topic == TOPIC_RULES_TYPE)
     {
-        ESP_LOGW(MQTT_TAG, "Invalid relay number: %ld", relayNumber);
+        TRACE_End(NULL);
+        if (event->mqttData.dataLength <= 0 || event->mqttData.dataLength >= (int)sizeof(rulePayload))
+        {
+            LOG_W(LOG_MODULE_RULE, "Rules of %d bytes ignored", event->mqttData.dataLength);
+            return;
+        }
+        memcpy(rulePayload, event->mqttData.data, event->mqttData.dataLength);
+        rulePayload[event->mqttData.dataLength] = '\0';
+        Rule_Configure(rulePayload);
+        return;
     }
+
+    Command_HandleRelayMessage(topic, event->mqttData.data, event->mqttData.dataLength);
+    BLE_BeaconSetRelayMask(Relay_GetStateMask()); // Refreshed only if a relay changed
 }
 
 /************************************************************************************************
- * @brief MQTT callback: Called when unsubscribed from a topic
+ * @brief EVENT_MQTT_DISCONNECTED: the connection to the broker was lost
  */
-void UnsubscribedFromTopic()
+static void DisconnectedToBroker(const appEvent *event, void *context)
 {
-    ESP_LOGI(MQTT_TAG, "Unsubscribed from the topic");
+    LOG_I(LOG_MODULE_MQTT, "Disconnected from MQTT broker");
+    brokerConnected = false;
+    BLE_BeaconSetLinkState(BLE_BEACON_LINK_MQTT, false);
 }
 
 /************************************************************************************************
- * @brief MQTT callback: Called when disconnected from the broker
+ * @brief EVENT_WIFI_CHANGED: the station gained or lost its address
  */
-void DisconnectedToBroker()
+static void WifiChanged(const appEvent *event, void *context)
 {
-    ESP_LOGI(MQTT_TAG, "Disconnected from MQTT broker");
+    BLE_BeaconSetLinkState(BLE_BEACON_LINK_WIFI, event->wifiChanged.up);
 }
 
 /************************************************************************************************
@@ -101,27 +142,56 @@ void DisconnectedToBroker()
  */
 void Task_ConfigMode(void *param)
 {
+    // Bring the NimBLE stack up here, concurrently with the relay restore in app_main
+    connect_ble();
+    BOOT_Mark(BOOT_PHASE_BLE);
+
     BLE_Task(); // Handle BLE configuration in this task
 }
 
 /************************************************************************************************
- * @brief MQTT task for Publish topics for the broker
- * @param param Task parameter (unused)
+ * @brief Sensor registry callback: run the local rules, then publish the encoded reading on
+ * the topic of its sensor
+ * @param sensor Registry index of the sensor
+ * @param reading The reading
+ * @param payload Encoded reading
+ * @param length Length of the payload
  */
-void Task_MQTTPublish(void *param)
+static void PublishSensor(int sensor, const sensorReading *reading, const char *payload, int length)
 {
-    while (1)
+    if (Rule_Evaluate(sensor, reading))
     {
-        MQTT_Publish(getData.tempSensor, "Temp = ", 10);
-        MQTT_Publish(getData.lightSensor,"Light = ", 5);
-        MQTT_Publish(getData.doorSensor, "Door State = ", 60);
+        BLE_BeaconSetRelayMask(Relay_GetStateMask());
     }
+
+    char topic[TOPIC_MAX_LENGTH + 1];
+    if (brokerConnected && length > 0 && Topic_Copy((topicId)SensorRegistry_Get(sensor)->topicType, topic, sizeof(topic)) > 0)
+    {
+        MQTT_Publish(topic, (char *)payload, 0);
+    }
+}
+
+/************************************************************************************************
+ * @brief Shadow link reader: signal and drops of the Wi-Fi station
+ * @param link Receives the metrics
+ */
+static void ReadShadowLink(shadowLink *link)
+{
+    link->rssi = WIFI_GetRssi();
+    link->wifiDrops = WIFI_GetDropCount();
 }
+
 /************************************************************************************************
  * @brief Application entry point
  */
 void app_main()
 {
+    // Start the deferred logger before anything else logs
+    LOG_Init();
+
+    // Parse JSON from a fixed pool instead of the heap
+    JSON_Init();
+
     // Initialize NVS for storing configuration data
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
@@ -130,37 +200,67 @@ void app_main()
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
+    BOOT_Mark(BOOT_PHASE_NVS);
 
-    // Initialize relays and retrieve saved states
-    Relay_Init();
-    Relay_RetDataState();
+    // Register the sensor drivers, which define the sensor topics of the configuration
+    Sensor_RegisterDrivers();
 
     // Retrieve configuration from non-volatile storage
     RetrieveConfigFromStorage(&getData);
+    Rule_Load();
+    BOOT_Mark(BOOT_PHASE_CONFIG);
 
-    // Initialize BLE for configuration
-    connect_ble();
+#if BENCH_RUN_AT_BOOT
+    // Bench kits only: measure the hot paths before the radio tasks start
+    BENCH_RunAll();
+#endif
 
-    // Initialize Wi-Fi with retrieved credentials
+    // Events are not queued: each subscriber below is started before the publishers of
+    // its events. Link state of the beacon, from the first association on
+    Event_Subscribe(EVENT_WIFI_CHANGED, WifiChanged, NULL);
+
+    // Start Wi-Fi first: association and DHCP proceed in the driver while the rest boots
     WIFI_Init(getData.wifiSSID, getData.wifiPassword);
+    WIFI_StartConnection();
+    WIFI_StartTimeSync(Schedule_ClockSynced);
+    BOOT_Mark(BOOT_PHASE_WIFI_START);
 
-    // Start BLE configuration mode task
-    xTaskCreate(Task_ConfigMode, "Task_ConfigMode", 2048, NULL, 5, NULL);
+    // Configuration changes apply from here on, without a restart, so a Wi-Fi correction
+    // sent over BLE reaches the station even while the boot waits for an address below
+    Reconfig_Start(&getData, ApplyWifi);
+    Event_Subscribe(EVENT_MQTT_CONNECTED, connectedToBroker, NULL);
+    Event_Subscribe(EVENT_MQTT_DATA, RecivedMsg, NULL);
+    Event_Subscribe(EVENT_MQTT_DISCONNECTED, DisconnectedToBroker, NULL);
 
-    // Start Wi-Fi connection and wait until connected
-    WIFI_StartConnection();
-    while (!WIFI_IsInternetConnected())
-        ;
+    // Serve the relays to local clients, pushed from the shadow, so subscribed before it
+    Http_Start();
+
+    // Keep the retained shadow of the relays and the link on the broker. Subscribed to
+    // relay, configuration and connection changes before any of them can happen
+    Shadow_Start(TOPIC_RELAY_TYPE, ReadShadowLink);
+
+    // Every subscriber is in place, the publishers start from here on. BLE initializes
+    // in its own task while the relays are restored here
+    Task_Start(TASK_CONFIG_MODE, Task_ConfigMode, NULL);
+
+    if (!Relay_Init())
+    {
+        BLE_BeaconSetFault(BLE_BEACON_ERROR_RELAYS); // Commands are refused and acknowledged as failed
+    }
+    Relay_RetDataState();
+    BOOT_Mark(BOOT_PHASE_RELAYS);
+    Schedule_Start(); // Pending pulses resume after the stored states are restored
+    BLE_BeaconSetRelayMask(Relay_GetStateMask());
 
-    // Register MQTT event callbacks
-    MQTT_EventConnectedCallback(connectedToBroker);
-    MQTT_EventDataActionCallback(RecivedMsg);
-    MQTT_EventUnsubscribedCallback(UnsubscribedFromTopic);
-    MQTT_EventDisconnectedCallback(DisconnectedToBroker);
+    // Start sampling, and the local rules with it, before waiting for the network
+    SensorRegistry_Init();
+    SensorRegistry_Start(PublishSensor);
 
-    // Connect to MQTT broker with retrieved credentials
-    MQTT_Connect(getData.mqttBroker, getData.mqttPort, getData.mqttUsername, getData.mqttPassword);
+    // Connect to the MQTT broker as soon as an IP address is leased
+    WIFI_WaitForIP(portMAX_DELAY);
+    BOOT_Mark(BOOT_PHASE_IP);
+    Reconfig_Connect(); // With the broker of any change stored meanwhile
 
-    // Start BLE configuration mode task
-    xTaskCreate(Task_MQTTPublish, "Task_MQTTPublish", 2048, NULL, 5, NULL);
+    // Start periodic diagnostics on the configured topic
+    DIAG_Start(TOPIC_DIAG_TYPE);
 }
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Load generator and soak test of the relay command path of a connected kit.
+
+Publishes relay commands to the kit relay topic through an MQTT broker (a local
+mosquitto, for example) at increasing rates, matches the acks the kit publishes on
+<relay topic>/ack and prints one JSON line per step, in the same format as the host
+okta_loadgen program:
+
+  {"rate":r,"mix":"m","seconds":s,"sent":n,"acked":a,"lost":l,"dropped":null,
+   "throughput":t,"p50_us":x,"p90_us":x,"p99_us":x,"max_us":x,"heap_min":b,
+   "heap_drift":b}
+
+heap_min is the minimum free heap reported by the kit on its diagnostics topic
+during the step and heap_drift the largest drift it reported, the free heap lost
+since the kit settled after boot (both null when no report arrived; the kit reports
+every 30 s, so use steps of at least that length to get one). The script exits with
+status 2 when heap_drift exceeds --max-drift, which turns a long single-rate run
+into a check that the steady state does not allocate. dropped is not observable from outside
+the kit and is always null. Requires paho-mqtt.
+
+  mosquitto -p 1883 &
+  tools/loadgen.py --broker 192.168.1.10 --topic kit/relay --diag kit/diag \
+      --rates 10,50,100,200 --seconds 30 --mix mixed
+"""
+import argparse
+import json
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+MIXES = ("set", "group", "mixed")
+
+
+def command(mix, sequence, command_id):
+    """Build command 'sequence' of the mix, matching the host load generator."""
+    pick = sequence % 10
+    relay = sequence % 8 + 1
+    state = (sequence // 8) & 1
+    if mix == "group" or (mix == "mixed" and pick == 8):
+        relay = 16
+    elif mix == "mixed" and pick == 9:
+        relay = 42  # Rejected by the kit, still acked
+    return json.dumps({"relayNo": relay, "state": state, "id": command_id}, separators=(",", ":"))
+
+
+def percentile(sorted_values, pct):
+    """Nearest-rank percentile."""
+    if not sorted_values:
+        return 0
+    rank = max(1, -(-len(sorted_values) * pct // 100))
+    return sorted_values[rank - 1]
+
+
+class LoadGenerator:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.sent = {}
+        self.latencies = []
+        self.heap_min = None
+        self.heap_drift = None
+        self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id="okta-loadgen")
+        if args.username:
+            self.client.username_pw_set(args.username, args.password)
+        self.client.on_message = self.on_message
+        self.client.connect(args.broker, args.port)
+        self.client.subscribe(args.topic + "/ack", qos=0)
+        if args.diag:
+            self.client.subscribe(args.diag, qos=0)
+        self.client.loop_start()
+
+    def on_message(self, client, userdata, message):
+        now = time.perf_counter()
+        try:
+            body = json.loads(message.payload)
+        except ValueError:
+            return
+        with self.lock:
+            if message.topic == self.args.diag:
+                heap = body.get("min")
+                if heap is not None:
+                    self.heap_min = heap if self.heap_min is None else min(self.heap_min, heap)
+                drift = body.get("drift")
+                if drift is not None:
+                    self.heap_drift = drift if self.heap_drift is None else max(self.heap_drift, drift)
+                return
+            start = self.sent.pop(body.get("id"), None)
+            if start is not None:
+                self.latencies.append(int((now - start) * 1e6))
+
+    def step(self, rate, next_id):
+        with self.lock:
+            self.sent.clear()
+            self.latencies = []
+            self.heap_min = None
+            self.heap_drift = None
+        total = rate * self.args.seconds
+        start = time.perf_counter()
+        for i in range(total):
+            due = start + i / rate
+            delay = due - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            with self.lock:
+                self.sent[next_id + i] = time.perf_counter()
+            self.client.publish(self.args.topic, command(self.args.mix, i, next_id + i), qos=self.args.qos)
+
+        # Wait for late acks
+        deadline = time.perf_counter() + self.args.drain
+        while time.perf_counter() < deadline:
+            with self.lock:
+                if not self.sent:
+                    break
+            time.sleep(0.01)
+        elapsed = time.perf_counter() - start
+
+        with self.lock:
+            latencies = sorted(self.latencies)
+            heap_min = self.heap_min
+            heap_drift = self.heap_drift
+        print(json.dumps({
+            "rate": rate, "mix": self.args.mix, "seconds": round(elapsed, 2), "sent": total,
+            "acked": len(latencies), "lost": total - len(latencies), "dropped": None,
+            "throughput": round(len(latencies) / elapsed, 1),
+            "p50_us": percentile(latencies, 50), "p90_us": percentile(latencies, 90),
+            "p99_us": percentile(latencies, 99), "max_us": latencies[-1] if latencies else 0,
+            "heap_min": heap_min, "heap_drift": heap_drift,
+        }, separators=(",", ":")), flush=True)
+        return next_id + total, heap_drift
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--username")
+    parser.add_argument("--password")
+    parser.add_argument("--topic", required=True, help="relay topic of the kit")
+    parser.add_argument("--diag", help="diagnostics topic of the kit, for heap_min and heap_drift")
+    parser.add_argument("--rates", default="5,10,20,50,100")
+    parser.add_argument("--seconds", type=int, default=30, help="duration of each step")
+    parser.add_argument("--mix", choices=MIXES, default="set")
+    parser.add_argument("--qos", type=int, choices=(0, 1), default=0)
+    parser.add_argument("--drain", type=float, default=5.0, help="seconds to wait for late acks")
+    parser.add_argument("--max-drift", type=int, default=0, help="heap bytes the steady state may lose")
+    args = parser.parse_args()
+
+    generator = LoadGenerator(args)
+    next_id = int(time.time()) % 1000000 * 1000  # Distinct ids across runs
+    worst_drift = 0
+    for rate in (int(value) for value in args.rates.split(",") if value):
+        next_id, drift = generator.step(rate, next_id)
+        worst_drift = max(worst_drift, drift or 0)
+
+    if worst_drift > args.max_drift:
+        print(f"heap not flat: {worst_drift} bytes lost (limit {args.max_drift})", file=sys.stderr)
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()